@@ -0,0 +1,235 @@
+// Packs the fields real snapshot and input messages write, with the BitPacker from before bits went
+// through a 64 bit scratch word and with the current one, then reads them back and compares.
+// Builds without a Release build type keep the asserts both packers are full of, configure one
+// for numbers worth comparing.
+#include "LegacyBitPacker.h"
+#include "Network/NetworkMessages.h"
+#include "Game/Shared/SharedConstants.h"
+#include "DataConstants.h"
+#include "WriteStream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Field
+    {
+        uint32_t value;
+        int32_t bits;
+    };
+
+    struct Throughput
+    {
+        double writeMBps;
+        double readMBps;
+        uint32_t checksum; // Of every value read in every loop
+    };
+
+    // Bytes packed per timed loop of each message, enough for the clock to resolve
+    const size_t BYTES_PER_LOOP = 64 * 1024 * 1024;
+    // A full match on a busy level
+    const uint8_t PLAYER_COUNT = 16;
+    const uint32_t ENTITY_COUNT = 200;
+    const float LEVEL_SIZE = 2048.f;
+
+    // Writes like any stream and keeps every field the message wrote, in order
+    class RecordingStream : public Net::WriteStream
+    {
+    public:
+        RecordingStream(void* buffer, int32_t bytes, std::vector<Field>& fields)
+        : WriteStream(buffer, bytes)
+        , m_fields(fields)
+        {
+        }
+
+        using WriteStream::SerializeBits;
+        bool SerializeBits(uint32_t& value, int32_t bits) override
+        {
+            m_fields.push_back({value, bits});
+            return WriteStream::SerializeBits(value, bits);
+        }
+
+    private:
+        std::vector<Field>& m_fields;
+    };
+
+    void flushBits(Net::BitPacker& packer)
+    {
+        packer.FlushBits();
+    }
+
+    void flushBits(Net::LegacyBitPacker&)
+    {
+        // Stored every byte as it went
+    }
+
+    template <typename Packer>
+    void writeFields(const std::vector<Field>& fields, std::vector<uint8_t>& buffer)
+    {
+        Packer packer(Packer::Write, buffer.data(), (int32_t)buffer.size());
+        for (const Field& field : fields)
+        {
+            packer.WriteBits(field.value, field.bits);
+        }
+        flushBits(packer);
+    }
+
+    template <typename Packer>
+    uint32_t readFields(const std::vector<Field>& fields, std::vector<uint8_t>& buffer)
+    {
+        Packer packer(Packer::Read, buffer.data(), (int32_t)buffer.size());
+        uint32_t checksum = 0;
+        for (const Field& field : fields)
+        {
+            uint32_t value = 0;
+            packer.ReadBits(value, field.bits);
+            checksum = checksum * 31 + value;
+        }
+        return checksum;
+    }
+
+    template <typename Packer>
+    Throughput measure(const std::vector<Field>& fields, std::vector<uint8_t>& buffer)
+    {
+        typedef std::chrono::steady_clock Clock;
+        const size_t loops = std::max<size_t>(1, BYTES_PER_LOOP / buffer.size());
+
+        const auto writeStart = Clock::now();
+        for (size_t i = 0; i < loops; i++)
+        {
+            writeFields<Packer>(fields, buffer);
+        }
+        const auto readStart = Clock::now();
+        uint32_t checksum = 0;
+        for (size_t i = 0; i < loops; i++)
+        {
+            checksum += readFields<Packer>(fields, buffer);
+        }
+        const auto readEnd = Clock::now();
+
+        const double megabytes = (double)(buffer.size() * loops) / (1024.0 * 1024.0);
+        Throughput throughput;
+        throughput.writeMBps = megabytes / std::chrono::duration<double>(readStart - writeStart).count();
+        throughput.readMBps = megabytes / std::chrono::duration<double>(readEnd - readStart).count();
+        throughput.checksum = checksum;
+        return throughput;
+    }
+
+    SnapshotData makeSnapshot(std::mt19937& random)
+    {
+        std::uniform_real_distribution<float> position(0.f, LEVEL_SIZE);
+        std::uniform_real_distribution<float> rotation(-M_PI, M_PI);
+        std::uniform_int_distribution<int> small(0, 100);
+
+        SnapshotData data = SNAPSHOT_ZERO;
+        data.serverTick = 123456;
+        data.lastReceivedInput = 123400;
+        for (uint8_t playerID = 0; playerID < PLAYER_COUNT; playerID++)
+        {
+            std::vector<InventoryItemState> weaponSlots;
+            for (size_t i = 0; i < 5; i++)
+            {
+                weaponSlots.push_back({(uint8_t)small(random), (uint16_t)small(random)});
+            }
+            data.playerData[playerID] = { (uint32_t)(playerID + 1), (uint8_t)small(random), (uint8_t)(small(random) % 8),
+                                          position(random), position(random), (float)small(random),
+                                          small(random) > 50, small(random) > 90, (uint8_t)(small(random) % 5), weaponSlots };
+        }
+        for (uint32_t entityID = PLAYER_COUNT + 1; entityID <= PLAYER_COUNT + ENTITY_COUNT; entityID++)
+        {
+            data.entityData[entityID] = { position(random), position(random), rotation(random), (uint8_t)small(random), 0, 0 };
+        }
+        for (size_t i = 0; i < 5; i++)
+        {
+            data.inventory.push_back({(uint8_t)small(random), (uint16_t)small(random)});
+        }
+        for (uint16_t i = 0; i < 4; i++)
+        {
+            data.hitData.push_back({(uint16_t)(i + 1), (uint16_t)(i + 2), (float)small(random),
+                                    position(random), position(random), i == 0, i == 1});
+        }
+        return data;
+    }
+
+    // Fields of one message, in the order its serialize wrote them
+    std::vector<Field> recordFields(Net::Message& message)
+    {
+        static std::vector<uint8_t> s_buffer(Net::BUFFER_SIZE_BYTES);
+        std::vector<Field> fields;
+        RecordingStream stream(s_buffer.data(), (int32_t)s_buffer.size(), fields);
+        message.serialize(stream);
+        return fields;
+    }
+
+    bool run(const std::string& name, const std::vector<Field>& fields)
+    {
+        int32_t bits = 0;
+        for (const Field& field : fields)
+        {
+            bits += field.bits;
+        }
+        // Whole words, the current packer stores them 32 bits at a time
+        const size_t bytes = ((bits + 31) / 32) * 4;
+        std::vector<uint8_t> legacyBuffer(bytes);
+        std::vector<uint8_t> buffer(bytes);
+
+        const Throughput legacy = measure<Net::LegacyBitPacker>(fields, legacyBuffer);
+        const Throughput current = measure<Net::BitPacker>(fields, buffer);
+        printf("BitPackerBenchmark:: %-20s %5zu bytes %4zu fields  write %7.1f -> %7.1f MB/s  read %7.1f -> %7.1f MB/s\n",
+               name.c_str(), bytes, fields.size(),
+               legacy.writeMBps, current.writeMBps, legacy.readMBps, current.readMBps);
+
+        if (legacyBuffer != buffer || legacy.checksum != current.checksum)
+        {
+            printf("BitPackerBenchmark:: %s packed differently by the two packers\n", name.c_str());
+            return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+#ifndef NDEBUG
+    printf("BitPackerBenchmark:: asserts are on, configure a Release build for numbers worth comparing\n");
+#endif
+    std::mt19937 random(1234);
+
+    ServerSnapshotMessage quantizedSnapshot;
+    quantizedSnapshot.data = makeSnapshot(random);
+    quantizedSnapshot.encoding = { true, LEVEL_SIZE, LEVEL_SIZE, SNAPSHOT_POSITION_RESOLUTION, SNAPSHOT_ROTATION_BITS };
+
+    ServerSnapshotMessage rawSnapshot;
+    rawSnapshot.data = quantizedSnapshot.data;
+    rawSnapshot.encoding = SNAPSHOT_ENCODING_RAW;
+
+    ClientInputMessage input;
+    input.inputSequence = 123456;
+    input.lastReceivedSnapshot = 123400;
+    input.directionX = 0.7f;
+    input.directionY = -0.7f;
+    input.aimPointX = 1024.5f;
+    input.aimPointY = 768.25f;
+    input.aim = true;
+    input.shoot = true;
+    input.interact = false;
+    input.run = true;
+    input.reload = false;
+    input.changeWeapon = false;
+    input.slot = 2;
+    input.pickUpType = 0;
+    input.pickUpAmount = 0;
+    input.pickUpID = 0;
+
+    bool matched = true;
+    matched &= run("snapshot quantized", recordFields(quantizedSnapshot));
+    matched &= run("snapshot raw", recordFields(rawSnapshot));
+    matched &= run("client input", recordFields(input));
+    return matched ? 0 : 1;
+}
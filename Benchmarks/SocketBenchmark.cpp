@@ -0,0 +1,106 @@
+// Sends a server's worth of snapshot sized packets over loopback, a tick at a time, with sockets
+// sending and receiving one packet per syscall and with batched ones, and prints the throughput of each.
+// Sockets only batch where SOCKET_BATCHED_IO is available, elsewhere both runs take the same path.
+#include "Socket.h"
+#include "DataConstants.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+    const int TICKS = 4000;
+    const int PACKETS_PER_TICK = 50;
+    const size_t PACKET_BYTES = Net::MAXIMUM_TRANSMISSION_UNIT_BYTES;
+    const Net::Port SENDER_PORT = 40100;
+    const Net::Port RECEIVER_PORT = 40101;
+
+    struct Throughput
+    {
+        double packetsPerSecond;
+        double megabytesPerSecond;
+        int64_t received;
+    };
+
+    // Whatever has arrived, the receiver is drained every tick like a server's I/O thread does
+    int64_t drain(Net::Socket& receiver, std::vector<unsigned char>& buffer, int64_t& bytes)
+    {
+        int64_t packets = 0;
+        Net::Address sender;
+        int64_t size = 0;
+        while ((size = receiver.Receive(sender, buffer.data(), buffer.size())) > 0)
+        {
+            packets++;
+            bytes += size;
+        }
+        return packets;
+    }
+
+    bool measure(const int32_t options, Throughput& throughput)
+    {
+        Net::Socket sender(options);
+        Net::Socket receiver(options);
+        if (!sender.Open(SENDER_PORT) ||
+            !receiver.Open(RECEIVER_PORT))
+        {
+            printf("SocketBenchmark:: failed to open ports %i and %i\n", SENDER_PORT, RECEIVER_PORT);
+            return false;
+        }
+
+        const Net::Address destination(127, 0, 0, 1, RECEIVER_PORT);
+        std::vector<unsigned char> packet(PACKET_BYTES, 0xAB);
+        std::vector<unsigned char> buffer(Net::MAXIMUM_TRANSMISSION_UNIT_BYTES);
+        int64_t received = 0;
+        int64_t bytes = 0;
+
+        typedef std::chrono::steady_clock Clock;
+        const auto start = Clock::now();
+        for (int tick = 0; tick < TICKS; tick++)
+        {
+            for (int i = 0; i < PACKETS_PER_TICK; i++)
+            {
+                sender.Send(destination, packet.data(), packet.size());
+            }
+            sender.Flush();
+            received += drain(receiver, buffer, bytes);
+        }
+        // Stragglers still on their way
+        received += drain(receiver, buffer, bytes);
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        throughput.packetsPerSecond = received / seconds;
+        throughput.megabytesPerSecond = bytes / seconds / (1024.0 * 1024.0);
+        throughput.received = received;
+        return true;
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    if (!Net::Socket::InitializeSockets())
+    {
+        printf("SocketBenchmark:: failed to initialize sockets\n");
+        return 1;
+    }
+
+    Throughput single;
+    Throughput batched;
+    const bool measured = (measure(Net::Socket::NonBlocking, single) &&
+                           measure(Net::Socket::NonBlocking | Net::Socket::Batched, batched));
+    Net::Socket::ShutdownSockets();
+    if (!measured)
+    {
+        return 1;
+    }
+
+    const int64_t sent = (int64_t)TICKS * PACKETS_PER_TICK;
+#if !SOCKET_BATCHED_IO
+    printf("SocketBenchmark:: no batched I/O on this platform, both runs send a packet per syscall\n");
+#endif
+    printf("SocketBenchmark:: per packet %9.0f packets/s %7.1f MB/s, %lli of %lli received\n",
+           single.packetsPerSecond, single.megabytesPerSecond, (long long)single.received, (long long)sent);
+    printf("SocketBenchmark:: batched    %9.0f packets/s %7.1f MB/s, %lli of %lli received\n",
+           batched.packetsPerSecond, batched.megabytesPerSecond, (long long)batched.received, (long long)sent);
+    return 0;
+}
@@ -4,6 +4,7 @@
 #include <functional>
 #include <map>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 class ICallbackContainer
@@ -23,6 +24,7 @@ public:
     std::function<void(const EventType&)> callback;
 };
 
+// Not thread safe, code running on other threads than the main one (like a server match) gets its own instance
 class Dispatcher
 {
 public:
@@ -30,6 +32,10 @@ public:
         return g_dispatcher;
     }
     
+    Dispatcher()
+    : m_isDispatching(false)
+    {}
+    
     template<typename EventType>
     void addListener(std::function<void(const EventType&)> callback, void* listener)
     {
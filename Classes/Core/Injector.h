@@ -21,21 +21,26 @@ using std::lock_guard;
  * Injector
  * Inversion-of-Control Dependency Injector
  * Uses variadic templates to provide dependencies at compile-time.
+ * A scoped injector has a parent, types it has no mapping for of its own are provided by the parent.
 */
 class Injector
 {
 public:
     static Injector& globalInjector() { return g_injector; }
     
+    Injector() : _parent(nullptr) {}
+    explicit Injector(Injector& parent) : _parent(&parent) {}
+    
     /**
      * Does this injector have a mapping for the given type?
+     * Mappings of the parent don't count, a scope can map its own instance over them.
      *
      * @return True if a mapping exists for the given type, otherwise false.
      */
     template <typename T>
     bool hasMapping()
     {
-        return hasTypeToInstanceMapping<T>() | hasTypeToFactoryMapping<T>() | hasTypeToInstanceMapping<T>();
+        return hasTypeToInstanceMapping<T>() | hasTypeToFactoryMapping<T>() | hasInterfaceToInstanceMapping<T>();
     }
     
     /**
@@ -194,6 +199,10 @@ public:
             auto holder = dynamic_cast<Holder<T>*>(iholder.get());
             return holder->_instance;
         }
+        else if (_parent)
+        {
+            return _parent->getInstance<T>();
+        }
         
         // If you debug, in some debuggers (e.g Apple's lldb in Xcode) it will breakpoint in this assert
         // and by looking in the stack trace you'll be able to see which class you forgot to map.
@@ -249,6 +258,9 @@ public:
 private:
     static Injector g_injector;
 
+    Injector(const Injector&) = delete;
+    Injector& operator=(const Injector&) = delete;
+
     struct IHolder
     {
         virtual ~IHolder() = default;
@@ -271,6 +283,7 @@ private:
     unordered_map<size_t, function<shared_ptr<IHolder>()>> _interfacesToInstanceGetters;
     
     recursive_mutex _mutex;
+    Injector* _parent;
     
     // Check if we have a mapped singleton or instance.
     template <typename T>
@@ -0,0 +1,167 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cstdio>
+
+JobSystem::JobSystem(const size_t workerCount)
+: m_nextQueue(0)
+, m_queuedBatches(0)
+, m_quit(false)
+{
+    size_t workers = workerCount;
+    if (workers == 0)
+    {
+        const size_t hardwareThreads = std::thread::hardware_concurrency();
+        workers = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+    }
+
+    // Without workers the queue still exists, the waiting thread runs everything on its own
+    const size_t queueCount = std::max(workers, (size_t)1);
+    for (size_t i = 0; i < queueCount; i++)
+    {
+        m_queues.emplace_back(new WorkerQueue());
+    }
+    for (size_t i = 0; i < workers; i++)
+    {
+        m_workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+    printf("JobSystem:: constructor: %p workers: %zu\n", this, workers);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_quit = true;
+    }
+    m_wakeCondition.notify_all();
+    for (std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+    printf("JobSystem:: destructor: %p\n", this);
+}
+
+void JobSystem::run(const size_t count,
+                    const size_t batchSize,
+                    const void* job,
+                    const JobFunction function)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    const size_t batchItems = std::max(batchSize, (size_t)1);
+    const size_t batchCount = (count + batchItems - 1) / batchItems;
+    if (m_workers.empty() || batchCount == 1)
+    {
+        function(job, 0, count);
+        return;
+    }
+
+    JobGroup group;
+    group.job = job;
+    group.function = function;
+    group.remaining = batchCount;
+
+    // Spread over all queues so every worker finds something of its own before it has to steal
+    const size_t firstQueue = m_nextQueue.fetch_add(1) % m_queues.size();
+    for (size_t i = 0; i < batchCount; i++)
+    {
+        const size_t begin = i * batchItems;
+        WorkerQueue& queue = *m_queues[(firstQueue + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        // Counted before it can be taken, the count never drops below what is queued
+        m_queuedBatches++;
+        queue.batches.push_back({&group, begin, std::min(begin + batchItems, count)});
+    }
+    {
+        // Taking the lock orders the count against a worker checking it before going to sleep
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+    }
+    m_wakeCondition.notify_all();
+
+    // Help out instead of blocking, whatever gets picked up here may also belong to another caller
+    while (group.remaining.load(std::memory_order_acquire) > 0)
+    {
+        Batch batch;
+        if (takeBatch(firstQueue, batch))
+        {
+            runBatch(batch);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::workerLoop(const size_t workerIndex)
+{
+    while (true)
+    {
+        Batch batch;
+        if (takeBatch(workerIndex, batch))
+        {
+            runBatch(batch);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_wakeCondition.wait(lock, [this]() {
+            return m_quit || m_queuedBatches.load() > 0;
+        });
+        if (m_quit)
+        {
+            return;
+        }
+    }
+}
+
+bool JobSystem::takeBatch(const size_t queueIndex, Batch& batch)
+{
+    // Newest batch of our own first, it was most likely pushed together with the ones before it
+    {
+        WorkerQueue& queue = *m_queues[queueIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.front < queue.batches.size())
+        {
+            batch = queue.batches.back();
+            queue.batches.pop_back();
+            if (queue.front == queue.batches.size())
+            {
+                queue.batches.clear();
+                queue.front = 0;
+            }
+            m_queuedBatches--;
+            return true;
+        }
+    }
+    // Steal the oldest from the others
+    for (size_t i = 1; i < m_queues.size(); i++)
+    {
+        WorkerQueue& queue = *m_queues[(queueIndex + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.front < queue.batches.size())
+        {
+            batch = queue.batches[queue.front];
+            queue.front++;
+            if (queue.front == queue.batches.size())
+            {
+                queue.batches.clear();
+                queue.front = 0;
+            }
+            m_queuedBatches--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::runBatch(const Batch& batch)
+{
+    batch.group->function(batch.group->job, batch.begin, batch.end);
+    // Release so the waiting thread sees everything the batch wrote, the group may be gone right after
+    batch.group->remaining.fetch_sub(1, std::memory_order_acq_rel);
+}
@@ -0,0 +1,85 @@
+#ifndef JobSystem_h
+#define JobSystem_h
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work stealing thread pool for splitting a loop over independent items across cores
+// Each worker has its own queue of batches, an idle worker takes from the back of its own
+// and steals from the front of the others. The thread waiting on a loop works on it too.
+// Jobs must only write to the items they were handed, results then don't depend on the
+// number of threads or on which of them ran what.
+class JobSystem
+{
+public:
+    // Zero workers uses one less than the hardware has, the waiting thread makes up the last one
+    JobSystem(const size_t workerCount = 0);
+    ~JobSystem();
+
+    size_t getWorkerCount() const { return m_workers.size(); }
+
+    // Calls job(begin, end) over [0, count) in batches of up to batchSize items, returns once all are done
+    // Safe to call from several threads at once, every caller waits only for its own batches
+    // The job is only referenced while the loop runs, a lambda capturing more than a std::function
+    // holds inline doesn't cost an allocation per call
+    template <typename Job>
+    void parallelFor(const size_t count,
+                     const size_t batchSize,
+                     const Job& job)
+    {
+        run(count, batchSize, &job, [](const void* job, const size_t begin, const size_t end) {
+            (*static_cast<const Job*>(job))(begin, end);
+        });
+    }
+
+private:
+    typedef void (*JobFunction)(const void* job, const size_t begin, const size_t end);
+
+    struct JobGroup
+    {
+        const void* job;
+        JobFunction function;
+        std::atomic<size_t> remaining;
+    };
+
+    struct Batch
+    {
+        JobGroup* group;
+        size_t begin;
+        size_t end;
+    };
+
+    // Batches in [front, end), the owner pops the back and thieves the front
+    // A deque would free and allocate blocks as batches move through it, this only grows
+    // until it fits the biggest loop and starts over at the beginning whenever it runs empty
+    struct WorkerQueue
+    {
+        WorkerQueue() : front(0) {}
+
+        std::mutex mutex;
+        std::vector<Batch> batches;
+        size_t front;
+    };
+
+    std::vector<std::thread> m_workers;
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+    std::atomic<size_t> m_nextQueue;
+    std::atomic<size_t> m_queuedBatches;
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wakeCondition;
+    bool m_quit;
+
+    void run(const size_t count,
+             const size_t batchSize,
+             const void* job,
+             const JobFunction function);
+    void workerLoop(const size_t workerIndex);
+    bool takeBatch(const size_t queueIndex, Batch& batch);
+    void runBatch(const Batch& batch);
+};
+
+#endif /* JobSystem_h */
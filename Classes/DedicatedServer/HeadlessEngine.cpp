@@ -0,0 +1,45 @@
+// The dedicated server builds only the cocos2d sources it uses, math, Value, FileUtils and the
+// TMX parser, instead of linking the whole engine with its renderer, GLFW and audio.
+// Those sources still reference a few engine parts, this is all the server needs of them.
+#include "base/CCDirector.h"
+#include "base/CCScheduler.h"
+#include "base/ccUtils.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+
+namespace cocos2d {
+
+void log(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    printf("\n");
+    fflush(stdout);
+}
+
+namespace utils {
+
+double atof(const char* str)
+{
+    return str ? ::atof(str) : 0.0;
+}
+
+} // namespace utils
+
+// Only the async FileUtils loaders ask for the Director, to call back on its thread, the server loads synchronously
+Director* Director::getInstance()
+{
+    printf("[Server]HeadlessEngine:: no Director in the dedicated server\n");
+    abort();
+}
+
+void Scheduler::performFunctionInCocosThread(const std::function<void()>& function)
+{
+    function();
+}
+
+} // namespace cocos2d
@@ -0,0 +1,102 @@
+#include "ServerMatch.h"
+
+#include "Core/Dispatcher.h"
+#include "Core/JobSystem.h"
+#include "Game/Client/InitServerCommand.h"
+#include "Game/Server/ServerController.h"
+#include "Game/Shared/GameSettings.h"
+#include "Network/NetworkController.h"
+#include "Network/NetworkModel.h"
+
+#include <chrono>
+
+const float ServerMatch::UPDATE_FREQUENCY = 1.f / 60.f;
+
+ServerMatch::ServerMatch(const GameMode::Config& config,
+                         const std::string& hostName,
+                         const uint16_t portOffset,
+                         const uint32_t seed)
+: m_config(config)
+, m_hostName(hostName)
+, m_portOffset(portOffset)
+, m_seed(seed)
+, m_injector(Injector::globalInjector())
+, m_serverController(nullptr)
+, m_running(false)
+, m_stopRequested(false)
+{
+}
+
+ServerMatch::~ServerMatch()
+{
+    stop();
+}
+
+bool ServerMatch::start()
+{
+    // Events never leave the match, the global dispatcher belongs to the main thread
+    m_injector.mapSingleton<Dispatcher>();
+    // One pool of workers for all matches, a tick's jobs go to whichever cores are free
+    m_injector.mapInstance<JobSystem>(Injector::globalInjector().getInstance<JobSystem>());
+    m_injector.mapSingleton<NetworkModel>();
+    m_injector.mapSingleton<NetworkController,
+        NetworkModel, GameSettings>();
+    m_injector.mapInterfaceToType<INetworkController, NetworkController>();
+
+    m_injector.getInstance<NetworkModel>()->setHostName(m_hostName);
+    auto networkController = m_injector.getInstance<NetworkController>();
+    networkController->setPortOffset(m_portOffset);
+    networkController->initialize(NetworkMode::HOST);
+
+    InitServerCommand initServer(m_config, m_seed, true, m_injector);
+    if (!initServer.run())
+    {
+        return false;
+    }
+    m_serverController = m_injector.getInstance<ServerController>();
+    // Nothing but the server touches the network here, acks and sends keep going while a tick runs long
+    networkController->startIOThread();
+
+    m_running = true;
+    m_thread = std::thread(&ServerMatch::run, this);
+    return true;
+}
+
+void ServerMatch::stop()
+{
+    m_stopRequested = true;
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+void ServerMatch::run()
+{
+    const std::chrono::microseconds updateMicroseconds((uint64_t)(UPDATE_FREQUENCY * 1000000));
+    std::chrono::steady_clock::time_point previousTime = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point nextUpdate = previousTime;
+
+    // The match ends by itself after game over, restarting is left to whatever launched the process
+    while (!m_stopRequested && !m_serverController->isStopped())
+    {
+        const std::chrono::steady_clock::time_point timeNow = std::chrono::steady_clock::now();
+        const float deltaTime = std::chrono::duration_cast<std::chrono::microseconds>(timeNow - previousTime).count() / 1000000.f;
+        previousTime = timeNow;
+
+        m_serverController->update(deltaTime);
+
+        nextUpdate += updateMicroseconds;
+        if (nextUpdate < timeNow)
+        {
+            nextUpdate = timeNow; // Fell behind, don't try to catch up with a burst of updates
+        }
+        std::this_thread::sleep_until(nextUpdate);
+    }
+
+    if (!m_serverController->isStopped())
+    {
+        m_serverController->stop();
+    }
+    m_running = false;
+}
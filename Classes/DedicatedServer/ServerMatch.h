@@ -0,0 +1,50 @@
+#ifndef ServerMatch_h
+#define ServerMatch_h
+
+#include "Core/Injector.h"
+#include "Game/Shared/GameMode.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+class ServerController;
+
+// One match hosted by the dedicated server, several can run side by side in one process
+// Its whole server graph lives in its own injector scope and is only touched by its own thread
+// Shared data like settings and static entity data comes from the global injector and is read only
+class ServerMatch
+{
+public:
+    ServerMatch(const GameMode::Config& config,
+                const std::string& hostName,
+                const uint16_t portOffset,
+                const uint32_t seed);
+    ~ServerMatch();
+
+    // Sets the match up on the calling thread, then hands it over to its simulation thread
+    bool start();
+    // Blocks until the simulation thread has finished
+    void stop();
+    bool isRunning() const { return m_running; }
+
+    const std::string& getHostName() const { return m_hostName; }
+
+private:
+    static const float UPDATE_FREQUENCY;
+
+    GameMode::Config m_config;
+    std::string m_hostName;
+    uint16_t m_portOffset;
+    uint32_t m_seed;
+    Injector m_injector;
+    std::shared_ptr<ServerController> m_serverController;
+    std::thread m_thread;
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_stopRequested;
+
+    void run();
+};
+
+#endif /* ServerMatch_h */
@@ -0,0 +1,157 @@
+#include "Core/Injector.h"
+#include "Core/JobSystem.h"
+#include "ServerMatch.h"
+#include "Game/Shared/GameSettings.h"
+#include "base/CCAutoreleasePool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <signal.h>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    volatile sig_atomic_t quit;
+    // Each match listens on its own ports, offset by this much from the configured ones
+    const uint16_t MATCH_PORT_STRIDE = 10;
+
+    void signal_handler(int sig)
+    {
+        signal(sig, signal_handler);
+        quit = 1;
+    }
+
+    void printUsage(const char* executable)
+    {
+        std::cout << "usage: " << executable << " [-level file.tmx] [-mode dm|br] [-tickrate ticks] [-maxplayers players] [-name hostname] [-matches count] [-seed seed]\n";
+    }
+
+    bool parseArguments(int argc, const char* argv[], GameMode::Config& config, std::string& hostName, int& matchCount, uint32_t& seed)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const bool hasValue = i + 1 < argc;
+            if (!strcmp(argv[i], "-level") && hasValue)
+            {
+                config.level = argv[++i];
+            }
+            else if (!strcmp(argv[i], "-mode") && hasValue)
+            {
+                const std::string mode = argv[++i];
+                if (mode == "dm")
+                {
+                    config.type = GameModeType::GAME_MODE_DEATHMATCH;
+                }
+                else if (mode == "br")
+                {
+                    config.type = GameModeType::GAME_MODE_BATTLEROYALE;
+                }
+                else
+                {
+                    return false;
+                }
+            }
+            else if (!strcmp(argv[i], "-tickrate") && hasValue)
+            {
+                config.tickRate = std::max(atoi(argv[++i]), 1);
+            }
+            else if (!strcmp(argv[i], "-maxplayers") && hasValue)
+            {
+                config.maxPlayers = std::min(std::max(atoi(argv[++i]), 1), 255);
+            }
+            else if (!strcmp(argv[i], "-name") && hasValue)
+            {
+                hostName = argv[++i];
+            }
+            else if (!strcmp(argv[i], "-matches") && hasValue)
+            {
+                matchCount = std::min(std::max(atoi(argv[++i]), 1), 64);
+            }
+            else if (!strcmp(argv[i], "-seed") && hasValue)
+            {
+                seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+// Runs a match without a window, GL context, audio or any views, only libcocos2d base types and file utils are used
+int main(int argc, const char * argv[])
+{
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+#ifdef SIGBREAK
+    signal(SIGBREAK, signal_handler);
+#endif
+
+    GameMode::Config config;
+    config.type = GameModeType::GAME_MODE_DEATHMATCH;
+    config.maxPlayers = 100;
+    config.tickRate = 20;
+    config.playersPerTeam = 1;
+    config.level = "BitTileMap.tmx";
+    std::string hostName = "MayhemServer";
+    int matchCount = 1;
+    // Match i is seeded with seed + i, passing a printed seed back with -seed spawns the same loot again
+    uint32_t seed = std::random_device()();
+    if (!parseArguments(argc, argv, config, hostName, matchCount, seed))
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // Only shared, read only state is mapped globally, every match scopes the rest in its own injector
+    Injector& injector = Injector::globalInjector();
+    injector.mapSingleton<GameSettings>();
+    injector.getInstance<GameSettings>()->load(GameSettings::DEFAULT_SETTINGS_FILE);
+    injector.mapSingleton<JobSystem>();
+
+    // Matches are set up one at a time on this thread, static entity data and tile maps load once from here
+    std::vector<std::unique_ptr<ServerMatch>> matches;
+    for (int i = 0; i < matchCount; i++)
+    {
+        const std::string matchName = matchCount > 1 ? hostName + "-" + std::to_string(i + 1) : hostName;
+        auto match = std::unique_ptr<ServerMatch>(new ServerMatch(config, matchName, i * MATCH_PORT_STRIDE, seed + i));
+        if (!match->start())
+        {
+            std::cout << "Failed to start match " << matchName << "\n";
+            continue;
+        }
+        std::cout << "Hosting " << GameMode::getGameModeName(config.type) << " on " << config.level << " as " << matchName << " seed " << seed + i << "\n";
+        matches.push_back(std::move(match));
+    }
+
+    const std::chrono::milliseconds POLL_INTERVAL(100);
+    while (!quit)
+    {
+        // Nothing else drains the autorelease pool without a Director
+        cocos2d::PoolManager::getInstance()->getCurrentPool()->clear();
+
+        const bool anyRunning = std::any_of(matches.begin(), matches.end(), [](const std::unique_ptr<ServerMatch>& match) {
+            return match->isRunning();
+        });
+        if (!anyRunning)
+        {
+            break;
+        }
+        std::this_thread::sleep_for(POLL_INTERVAL);
+    }
+
+    for (auto& match : matches)
+    {
+        match->stop();
+    }
+    matches.clear();
+
+    return 0;
+}
@@ -15,6 +15,7 @@
 #include "LevelModel.h"
 #include "LightController.h"
 #include "MovementIntegrator.h"
+#include "OccludersChangedEvent.h"
 #include "Network/NetworkMessages.h"
 #include "NetworkController.h"
 #include "PlayerLogic.h"
@@ -107,6 +108,8 @@ void ClientController::setMode(const ClientMode mode)
 
     m_networkController->setNodeDisconnectedCallback(std::bind(&ClientController::onNodeDisconnected, this,
                                                                std::placeholders::_1));
+    m_networkController->setDeltaDataCallback(std::bind(&ClientController::getDeltaData, this,
+                                                        std::placeholders::_1));
 
     if (m_networkController->getTransport())
     {
@@ -142,11 +145,8 @@ void ClientController::stop()
     m_clientModel->setGameStarted(false);
     m_stopping = true;
 
-    const cocos2d::Value& saveReplaySetting = m_gameSettings->getValue(ReplayModel::SETTING_SAVE_REPLAY, cocos2d::Value(true));
-    if (saveReplaySetting.asBool())
-    {
-        m_replayModel->saveFile(ReplayModel::DEFAULT_REPLAY_FILE, m_gameModel->getTickRate());
-    }
+    // Only the last chunk and the index are left to write
+    m_replayModel->stopRecording();
     
     m_networkController->removeMessageCallback(MessageTypes::MESSAGE_TYPE_SERVER_SNAPSHOT);
     m_networkController->removeMessageCallback(MessageTypes::MESSAGE_TYPE_SERVER_SNAPSHOT_DIFF);
@@ -156,6 +156,7 @@ void ClientController::stop()
     m_networkController->removeMessageCallback(MessageTypes::MESSAGE_TYPE_SERVER_SPECTATE);
     m_networkController->removeMessageCallback(MessageTypes::MESSAGE_TYPE_SERVER_GAME_OVER);
     m_networkController->setNodeDisconnectedCallback(nullptr);
+    m_networkController->setDeltaDataCallback(nullptr);
     
     if (m_networkController->getTransport())
     {
@@ -237,18 +238,13 @@ void ClientController::update(const float deltaTime)
 
 const SnapshotData& ClientController::getDeltaData(const uint32_t serverTick)
 {
-    const auto& snapshots = m_snapshotModel->getSnapshots();
-    auto snapshotIt = std::find_if(snapshots.begin(),
-                                   snapshots.end(),
-                                   [serverTick](const SnapshotData& data){
-        return data.serverTick == serverTick;
-    });
-    if (snapshotIt == snapshots.end())
+    const SnapshotData* baseline = m_snapshotModel->getBaseline(serverTick);
+    if (!baseline)
     {
-        CCLOG("ClientController::getDeltaData fail");
+        CCLOG("ClientController::getDeltaData fail - no baseline for tick %u", serverTick);
         return SNAPSHOT_ZERO;
     }
-    return *snapshotIt;
+    return *baseline;
 }
 
 void ClientController::updateGame(const float deltaTime, const bool processInput)
@@ -443,11 +439,7 @@ void ClientController::onSnapshotReceived(const std::shared_ptr<Net::Message>& d
             processIncomingSnapshot(snapshotMessage->data);
         }
         
-        const cocos2d::Value& saveReplaySetting = m_gameSettings->getValue(ReplayModel::SETTING_SAVE_REPLAY, cocos2d::Value(true));
-        if (saveReplaySetting.asBool())
-        {
-            m_replayModel->storeSnapshot(snapshotMessage->data);
-        }
+        recordSnapshot(snapshotMessage->data);
     }
     else
     {
@@ -457,7 +449,42 @@ void ClientController::onSnapshotReceived(const std::shared_ptr<Net::Message>& d
 
 void ClientController::onSnapshotDiffReceived(const std::shared_ptr<Net::Message>& data, const Net::NodeID nodeID)
 {
-    CCLOG("ClientController::onSnapshotDiffReceived not implemented!");
+    if (auto snapshotDiffMessage = std::dynamic_pointer_cast<ServerSnapshotDiffMessage>(data))
+    {
+        // Reading fails when the baseline is gone, the message then only holds partial data
+        if (!m_snapshotModel->getBaseline(snapshotDiffMessage->previousServerTick))
+        {
+            CCLOG("ClientController::onSnapshotDiffReceived fail - baseline tick %u missing",
+                  snapshotDiffMessage->previousServerTick);
+            return;
+        }
+        
+        if (m_snapshotModel->storeSnapshot(snapshotDiffMessage->data))
+        {
+            processIncomingSnapshot(snapshotDiffMessage->data);
+        }
+        
+        recordSnapshot(snapshotDiffMessage->data);
+    }
+    else
+    {
+        CCLOG("ClientController::onSnapshotDiffReceived fail");
+    }
+}
+
+void ClientController::recordSnapshot(const SnapshotData& snapshot)
+{
+    const cocos2d::Value& saveReplaySetting = m_gameSettings->getValue(ReplayModel::SETTING_SAVE_REPLAY, cocos2d::Value(true));
+    if (!saveReplaySetting.asBool() || m_stopping)
+    {
+        return;
+    }
+    
+    if (!m_replayModel->isRecording())
+    {
+        m_replayModel->startRecording(ReplayModel::DEFAULT_REPLAY_FILE, m_gameModel->getTickRate());
+    }
+    m_replayModel->storeSnapshot(snapshot);
 }
 
 void ClientController::onToggleClientPrediction()
@@ -592,6 +619,15 @@ void ClientController::onTileDeathReceived(const std::shared_ptr<Net::Message>&
         {
             lightSprite->runAction(cocos2d::FadeOut::create(1.f));
         }
+        
+        // Shadows around the tile keep changing until it has faded out
+        const cocos2d::Size& tileSize = m_levelModel->getTileSize();
+        const float mapHeight = m_levelModel->getMapSizeInTiles().height * tileSize.height;
+        const cocos2d::Rect tileRect = cocos2d::Rect(cocos2d::Vec2(deathMessage->tileX * tileSize.width,
+                                                                   mapHeight - ((deathMessage->tileY + 1) * tileSize.height)),
+                                                     tileSize);
+        OccludersChangedEvent occludersChanged(tileRect, 1.f);
+        Dispatcher::globalDispatcher().dispatch(occludersChanged);
     }
     else
     {
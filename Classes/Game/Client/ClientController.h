@@ -71,6 +71,7 @@ private:
     void onTileDeathReceived(const std::shared_ptr<Net::Message>& data, const Net::NodeID nodeID);
     void onSpectateReceived(const std::shared_ptr<Net::Message>& data, const Net::NodeID nodeID);
     void onGameOverReceived(const std::shared_ptr<Net::Message>& data, const Net::NodeID nodeID);
+    void recordSnapshot(const SnapshotData& snapshot);
 
     void onToggleClientPrediction();
     void onToggleInventory();
@@ -375,11 +375,11 @@ void GameViewController::renderHitEffects(const cocos2d::Vec2& shotStart,
                                           const uint16_t entityID,
                                           const std::map<uint32_t, EntitySnapshot>& entityData)
 {
-    RayElement raycastResult = RaycastUtil::rayCast2(shotStart,
-                                                     shotEnd,
-                                                     entityID,
-                                                     entityData,
-                                                     m_levelModel->getStaticRects());
+    RayElement raycastResult = RaycastUtil::rayCast(shotStart,
+                                                    shotEnd,
+                                                    entityID,
+                                                    SnapshotEntityView(entityData),
+                                                    *m_levelModel);
     const cocos2d::Vec2 fullRay = raycastResult.shotEndPoint - raycastResult.shotStartPoint;
     const cocos2d::Vec2 ray = fullRay.getNormalized();
 
@@ -389,11 +389,11 @@ void GameViewController::renderHitEffects(const cocos2d::Vec2& shotStart,
         if (hitEntity.type == PlayerEntity)
         {
             // Cast ray to other side of player to find blood spatter
-            RayElement raycastResult2 = RaycastUtil::rayCast2(raycastResult.shotEndPoint + ray * 20.0f,
-                                                              raycastResult.shotEndPoint,
-                                                              entityID,
-                                                              entityData,
-                                                              m_levelModel->getStaticRects());
+            RayElement raycastResult2 = RaycastUtil::rayCast(raycastResult.shotEndPoint + ray * 20.0f,
+                                                             raycastResult.shotEndPoint,
+                                                             entityID,
+                                                             SnapshotEntityView(entityData),
+                                                             *m_levelModel);
             for (int i = 0; i < 8; i++)
             {
                 const float randomX = cocos2d::random(-1.f, 1.f);
@@ -1022,11 +1022,11 @@ void GameViewController::updateCursor(const SnapshotData& snapshot)
 
         uint32_t entityUnderCursorID = 0;
         bool itemsInRange = false;
-        RayElement raycastResult = RaycastUtil::rayCast2(playerPosition,
-                                                         aimPosition,
-                                                         playerState.entityID,
-                                                         snapshot.entityData,
-                                                         m_levelModel->getStaticRects());
+        RayElement raycastResult = RaycastUtil::rayCast(playerPosition,
+                                                        aimPosition,
+                                                        playerState.entityID,
+                                                        SnapshotEntityView(snapshot.entityData),
+                                                        *m_levelModel);
 
         if (raycastResult.hitEntityID != 0)
         {
@@ -31,6 +31,8 @@
 #include "SnapshotModel.h"
 #include "GameModel.h"
 
+#include <random>
+
 InitClientCommand::InitClientCommand(const Mode mode,
                                      const GameMode::Config& config)
 : m_mode(mode)
@@ -66,7 +68,7 @@ bool InitClientCommand::run()
 
     auto gameView = injector.getInstance<GameView>();
     gameView->initialize();
-    gameView->setTileMap(levelModel->getTileMap());
+    gameView->setTileMap(cocos2d::TMXTiledMap::create(levelModel->getLevelPath()));
     
     auto particlesController = injector.getInstance<ParticlesController>();
     particlesController->initialize();
@@ -236,15 +238,14 @@ void InitClientCommand::mapDependencies()
             injector.mapInterfaceToType<INetworkController, FakeNetworkController>();
             auto networkController = injector.getInstance<INetworkController>();
             networkController->initialize(NetworkMode::CLIENT);
-//            networkController->setDeltaDataCallback(std::bind(&ClientController::getDeltaData, clientController, std::placeholders::_1));
         }
         
-        InitLocalServerCommand initLocalServer(m_config);
+        InitLocalServerCommand initLocalServer(m_config, std::random_device()());
         initLocalServer.run();
     }
     else if (m_mode == HOST)
     {
-        InitServerCommand initServer(m_config);
+        InitServerCommand initServer(m_config, std::random_device()());
         initServer.run();
     }
 
@@ -2,7 +2,6 @@
 
 #include "cocos2d.h"
 #include "Core/Dispatcher.h"
-#include "Core/Injector.h"
 #include "EntitiesController.h"
 #include "EntitiesModel.h"
 #include "EntityDataModel.h"
@@ -12,12 +11,17 @@
 #include "GameController.h"
 #include "GameModel.h"
 #include "InputCache.h"
+#include "JobSystem.h"
 #include "LevelModel.h"
 #include "LoadStaticEntityDataCommand.h"
 #include "ServerController.h"
 
-InitLocalServerCommand::InitLocalServerCommand(const GameMode::Config& config)
+InitLocalServerCommand::InitLocalServerCommand(const GameMode::Config& config,
+                                               const uint32_t seed,
+                                               Injector& injector)
 : m_config(config)
+, m_seed(seed)
+, m_injector(injector)
 {
 }
 
@@ -32,15 +36,19 @@ bool InitLocalServerCommand::run()
     
     mapDependencies();
     
-    Injector& injector = Injector::globalInjector();
+    Injector& injector = m_injector;
 
     auto entitiesModel = injector.getInstance<EntitiesModel>();
     auto entitiesController = injector.getInstance<EntitiesController>();
     entitiesController->initialize();
     auto levelModel = injector.getInstance<LevelModel>();
+    if (injector.hasMapping<Dispatcher>())
+    {
+        levelModel->setDispatcher(*injector.getInstance<Dispatcher>());
+    }
     levelModel->loadLevel(m_config.level);
     auto gameController = injector.getInstance<GameController>();
-    gameController->setGameMode(m_config, true);
+    gameController->setGameMode(m_config, true, m_seed);
 
     if (!injector.hasMapping<ServerController>())
     {
@@ -49,6 +57,7 @@ bool InitLocalServerCommand::run()
         networkController->initialize(NetworkMode::HOST);
         auto frameCache = injector.getInstance<FrameCache>();
         auto inputCache = injector.getInstance<InputCache>();
+        auto jobSystem = injector.getInstance<JobSystem>();
         auto gameModel = injector.instantiateUnmapped<GameModel>();
         gameModel->setConfig(m_config);
 
@@ -57,8 +66,9 @@ bool InitLocalServerCommand::run()
                                                                    gameModel,
                                                                    networkController,
                                                                    frameCache,
-                                                                   inputCache);
-        Injector::globalInjector().mapInstance<ServerController>(serverController);
+                                                                   inputCache,
+                                                                   jobSystem);
+        injector.mapInstance<ServerController>(serverController);
     }
     
     auto serverController = injector.getInstance<ServerController>();
@@ -69,7 +79,7 @@ bool InitLocalServerCommand::run()
 
 void InitLocalServerCommand::mapDependencies()
 {
-    Injector& injector = Injector::globalInjector();
+    Injector& injector = m_injector;
     
     if (!injector.hasMapping<EntitiesModel>())
     {
@@ -97,6 +107,10 @@ void InitLocalServerCommand::mapDependencies()
     {
         injector.mapSingleton<InputCache>();
     }
+    if (!injector.hasMapping<JobSystem>())
+    {
+        injector.mapSingleton<JobSystem>();
+    }
     if (!injector.hasMapping<FakeNet>())
     {
         injector.mapSingleton<FakeNet>();
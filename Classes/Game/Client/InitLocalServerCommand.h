@@ -2,17 +2,22 @@
 #define InitLocalServerCommand_h
 
 #include "Core/Command.h"
+#include "Core/Injector.h"
 #include "Game/Shared/GameMode.h"
 
 class InitLocalServerCommand : public Command
 {
 public:
-    InitLocalServerCommand(const GameMode::Config& config);
+    InitLocalServerCommand(const GameMode::Config& config,
+                           const uint32_t seed,
+                           Injector& injector = Injector::globalInjector());
 
     virtual bool run() override;
 
 private:
     GameMode::Config m_config;
+    uint32_t m_seed;
+    Injector& m_injector;
     void mapDependencies();
 };
 
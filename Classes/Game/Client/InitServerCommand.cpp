@@ -1,26 +1,29 @@
 #include "InitServerCommand.h"
 
-#include "cocos2d.h"
-#include "Core/Injector.h"
+#include "Core/Dispatcher.h"
 #include "EntitiesController.h"
 #include "EntitiesModel.h"
 #include "EntityDataModel.h"
 #include "FrameCache.h"
-#include "Game/Client/InputModel.h"
 #include "GameController.h"
 #include "GameModel.h"
-#include "GameScene.h"
 #include "GameSettings.h"
-#include "GameView.h"
 #include "InputCache.h"
+#include "JobSystem.h"
 #include "LevelModel.h"
 #include "LoadStaticEntityDataCommand.h"
 #include "NetworkController.h"
 #include "NetworkModel.h"
 #include "ServerController.h"
 
-InitServerCommand::InitServerCommand(const GameMode::Config& config)
+InitServerCommand::InitServerCommand(const GameMode::Config& config,
+                                     const uint32_t seed,
+                                     const bool headless,
+                                     Injector& injector)
 : m_config(config)
+, m_seed(seed)
+, m_headless(headless)
+, m_injector(injector)
 {
 }
 
@@ -35,15 +38,20 @@ bool InitServerCommand::run()
     
     mapDependencies();
         
-    Injector& injector = Injector::globalInjector();
+    Injector& injector = m_injector;
 
     auto entitiesModel = injector.getInstance<EntitiesModel>();
     auto entitiesController = injector.getInstance<EntitiesController>();
     entitiesController->initialize();
     auto levelModel = injector.getInstance<LevelModel>();
-    levelModel->loadLevel(m_config.level);
+    if (injector.hasMapping<Dispatcher>())
+    {
+        levelModel->setDispatcher(*injector.getInstance<Dispatcher>());
+    }
+    // Headless servers have nothing to render, skip the lights
+    levelModel->loadLevel(m_config.level, !m_headless);
     auto gameController = injector.getInstance<GameController>();
-    gameController->setGameMode(m_config, true);
+    gameController->setGameMode(m_config, true, m_seed);
 
     if (!injector.hasMapping<INetworkController>())
     {
@@ -53,15 +61,17 @@ bool InitServerCommand::run()
     }
     if (!injector.hasMapping<ServerController>())
     {
-        auto networkController = injector.getInstance<NetworkController>();
+        // Whatever network the caller mapped, the tests run the server over a fake one
+        auto networkController = injector.getInstance<INetworkController>();
 //        networkController->initialize(NetworkMode::HOST);
         auto frameCache = injector.getInstance<FrameCache>();
         auto inputCache = injector.getInstance<InputCache>();
+        auto jobSystem = injector.getInstance<JobSystem>();
         auto gameModel = injector.instantiateUnmapped<GameModel>();
         gameModel->setConfig(m_config);
 
-        auto serverController = std::make_shared<ServerController>(gameController, levelModel, gameModel, networkController, frameCache, inputCache);
-        Injector::globalInjector().mapInstance<ServerController>(serverController);
+        auto serverController = std::make_shared<ServerController>(gameController, levelModel, gameModel, networkController, frameCache, inputCache, jobSystem);
+        injector.mapInstance<ServerController>(serverController);
     }
     
     return true;
@@ -69,7 +79,7 @@ bool InitServerCommand::run()
 
 void InitServerCommand::mapDependencies()
 {
-    Injector& injector = Injector::globalInjector();
+    Injector& injector = m_injector;
     
     if (!injector.hasMapping<EntitiesModel>())
     {
@@ -97,4 +107,8 @@ void InitServerCommand::mapDependencies()
     {
         injector.mapSingleton<InputCache>();
     }
+    if (!injector.hasMapping<JobSystem>())
+    {
+        injector.mapSingleton<JobSystem>();
+    }
 }
@@ -2,17 +2,26 @@
 #define InitServerCommand_h
 
 #include "Core/Command.h"
+#include "Core/Injector.h"
 #include "Game/Shared/GameMode.h"
 
 class InitServerCommand : public Command
 {
 public:
-    InitServerCommand(const GameMode::Config& config);
+    // Maps the server graph into the given injector, a scoped one per match lets a process host several
+    // The seed starts the match's own random engine, the same seed spawns the same loot
+    InitServerCommand(const GameMode::Config& config,
+                      const uint32_t seed,
+                      const bool headless = false,
+                      Injector& injector = Injector::globalInjector());
 
     virtual bool run() override;
 
 private:
     GameMode::Config m_config;
+    uint32_t m_seed;
+    bool m_headless;
+    Injector& m_injector;
     void mapDependencies();
 };
 
@@ -111,7 +111,7 @@ bool InitReplayEditorCommand::run()
     
     auto gameView = injector.getInstance<GameView>();
     gameView->initialize();
-    gameView->setTileMap(levelModel->getTileMap());
+    gameView->setTileMap(cocos2d::TMXTiledMap::create(levelModel->getLevelPath()));
     
     auto particlesController = injector.getInstance<ParticlesController>();
     particlesController->initialize();
@@ -40,10 +40,9 @@ void ReplayEditorController::initialize()
     
     m_gameModel->setTickRate(m_replayModel->getTickRate());
     
-    const auto& snapshots = m_replayModel->getSnapshots();
-    if (!snapshots.empty())
+    if (m_replayModel->getSnapshotCount())
     {
-        const float maxTime = snapshots.back().serverTick * m_gameModel->getFrameTime();
+        const float maxTime = m_replayModel->getLastTick() * m_gameModel->getFrameTime();
         m_view->getTimeLineView()->setCurrentTime(0.f);
         m_view->getTimeLineView()->setMaxTime(maxTime);
     }
@@ -97,8 +96,7 @@ void ReplayEditorController::onMouseMoved(cocos2d::EventMouse *event)
         return;
     }
 
-    const auto& snapshots = m_replayModel->getSnapshots();
-    if (snapshots.empty())
+    if (!m_replayModel->getSnapshotCount())
     {
         return;
     }
@@ -108,7 +106,7 @@ void ReplayEditorController::onMouseMoved(cocos2d::EventMouse *event)
     size_t currentFrame = m_replayModel->getSnapshotIndexForTime(time);
 
 
-    const SnapshotData& snapshot = snapshots.at(currentFrame);
+    const SnapshotData& snapshot = m_replayModel->getSnapshot(currentFrame);
     uint32_t entityID = 0;
     const bool isEntityUnderCursor = PlayerLogic::getEntityAtPoint(entityID,
                                                                    snapshot,
@@ -145,13 +143,13 @@ void ReplayEditorController::onMouseDown(cocos2d::EventMouse* event)
     {
         jumpToMouseCoord(event->getLocationInView());
     }
-    else if (event->getMouseButton() == cocos2d::EventMouse::MouseButton::BUTTON_RIGHT)
+    else if (event->getMouseButton() == cocos2d::EventMouse::MouseButton::BUTTON_RIGHT &&
+             m_replayModel->getSnapshotCount())
     {
         const cocos2d::Vec2 aimPosition = m_gameViewController->getWorldPosition(event->getLocationInView());
         const float time = m_view->getTimeLineView()->getCurrentTime();
         size_t currentFrame = m_replayModel->getSnapshotIndexForTime(time);
-        const auto& snapshots = m_replayModel->getSnapshots();
-        const SnapshotData& snapshot = snapshots.at(currentFrame);
+        const SnapshotData& snapshot = m_replayModel->getSnapshot(currentFrame);
         uint32_t entityID = 0;
         const bool isEntityUnderCursor = PlayerLogic::getEntityAtPoint(entityID,
                                                                        snapshot,
@@ -229,10 +227,9 @@ void ReplayEditorController::onFastForwardButton(cocos2d::Ref* ref, cocos2d::ui:
         updatePlayButton();
     }
     
-    const auto& snapshots = m_replayModel->getSnapshots();
-    if (!snapshots.empty())
+    if (m_replayModel->getSnapshotCount())
     {
-        const float maxTime = snapshots.back().serverTick * m_gameModel->getFrameTime();
+        const float maxTime = m_replayModel->getLastTick() * m_gameModel->getFrameTime();
         const float previousTime = m_view->getTimeLineView()->getCurrentTime();
         const float time = std::min(previousTime + 1.f, maxTime);
         m_view->getTimeLineView()->setCurrentTime(time);
@@ -303,8 +300,8 @@ void ReplayEditorController::updatePlayButton()
 
 void ReplayEditorController::updateView(const float time)
 {
-    const auto& snapshots = m_replayModel->getSnapshots();
-    if (snapshots.empty())
+    const size_t snapshotCount = m_replayModel->getSnapshotCount();
+    if (!snapshotCount)
     {
         return;
     }
@@ -312,14 +309,14 @@ void ReplayEditorController::updateView(const float time)
     // Find snapshots in queue for target time
     const uint32_t targetFrame = std::floor(time * m_gameModel->getTickRate());
     size_t newFrameIndex = m_replayModel->getSnapshotIndexForFrame(targetFrame);
-    newFrameIndex = std::min(snapshots.size() - 1, newFrameIndex);
+    newFrameIndex = std::min(snapshotCount - 1, newFrameIndex);
     
     const bool isNewFrame = newFrameIndex != m_currentFrameIndex;
-    const bool isLastFrame = (newFrameIndex == snapshots.size() -1);
+    const bool isLastFrame = (newFrameIndex == snapshotCount -1);
     m_currentFrameIndex = newFrameIndex;
     
-    const SnapshotData& fromSnapshot = snapshots.at(m_currentFrameIndex);
-    const SnapshotData& toSnapshot = isLastFrame ? fromSnapshot : snapshots.at(m_currentFrameIndex + 1);
+    const SnapshotData& fromSnapshot = m_replayModel->getSnapshot(m_currentFrameIndex);
+    const SnapshotData& toSnapshot = isLastFrame ? fromSnapshot : m_replayModel->getSnapshot(m_currentFrameIndex + 1);
 
     const float frameStartTime = fromSnapshot.serverTick * m_gameModel->getFrameTime();
     const float alphaTime = std::min(std::max((time - frameStartTime) / m_gameModel->getFrameTime(), 0.f), 1.f);
@@ -329,10 +326,22 @@ void ReplayEditorController::updateView(const float time)
                                  isNewFrame,
                                  false);
     
-    // Update timeline view
+    // Update timeline view, only the frames around the cursor are looked up
+    const uint32_t visibleRange = TimeLineView::VISIBLE_FRAMES / 2;
+    const uint32_t firstVisibleFrame = targetFrame >= visibleRange ? targetFrame - visibleRange : 0;
+    m_frameMarkers.clear();
+    for (size_t index = m_replayModel->getSnapshotIndexForFrame(firstVisibleFrame); index < snapshotCount; index++)
+    {
+        const SnapshotData& snapshot = m_replayModel->getSnapshot(index);
+        if (snapshot.serverTick > targetFrame + visibleRange)
+        {
+            break;
+        }
+        m_frameMarkers.push_back({ snapshot.serverTick, !snapshot.hitData.empty() });
+    }
     m_view->getTimeLineView()->update(targetFrame,
-                                      snapshots.size(),
+                                      snapshotCount,
                                       m_gameModel->getTickRate(),
                                       m_playbackSpeed,
-                                      snapshots);
+                                      m_frameMarkers);
 }
@@ -39,6 +39,7 @@ private:
     size_t m_currentFrameIndex;
     bool m_isPlaying;
     bool m_isDraggingTimeLine;
+    std::vector<TimeLineView::FrameMarker> m_frameMarkers;
     
     void setupMouseListener(cocos2d::EventDispatcher* dispatcher);
 
@@ -10,6 +10,7 @@ const float TimeLineView::TIMELINE_PADDING = 8.f;
 const float TimeLineView::TIMELINE_ENDS_HEIGHT = 8.f;
 const float TimeLineView::CURSOR_HEIGHT = 20.f;
 const float TimeLineView::BUTTON_WIDTH = 80.f;
+const uint32_t TimeLineView::VISIBLE_FRAMES = 40;
 
 TimeLineView::TimeLineView()
 : m_background(nullptr)
@@ -75,9 +76,9 @@ void TimeLineView::update(const ssize_t currentFrame,
                           const ssize_t totalFrames,
                           const uint32_t tickRate,
                           const float speed,
-                          const std::vector<SnapshotData>& snapshots)
+                          const std::vector<FrameMarker>& frames)
 {
-    drawTimeLine(snapshots, tickRate);
+    drawTimeLine(frames, tickRate);
     
     const std::string frame = "Frame: " + std::to_string(currentFrame) + " / " + std::to_string(totalFrames) + " TickRate: " + std::to_string(tickRate) + "Hz";
     m_frameLabel->setString(frame);
@@ -101,7 +102,7 @@ float TimeLineView::getCursorTimeAtPosition(const cocos2d::Vec2& position) const
     return time;
 }
 
-void TimeLineView::drawTimeLine(const std::vector<SnapshotData>& snapshots,
+void TimeLineView::drawTimeLine(const std::vector<FrameMarker>& frames,
                                 const uint32_t tickRate)
 {
     m_drawNode->clear();
@@ -139,14 +140,13 @@ void TimeLineView::drawTimeLine(const std::vector<SnapshotData>& snapshots,
                          cocos2d::Vec2(DETAIL_POS_X + DETAIL_WIDTH*0.5f, DETAIL_POS_Y + DETAIL_HEIGHT),
                          cocos2d::Color4F::GREEN);
 
-    const uint32_t VISIBLE_FRAMES = 40;
     const uint32_t VISIBLE_RANGE = VISIBLE_FRAMES/2;
 
     const float FRAME_WIDTH = DETAIL_WIDTH / VISIBLE_FRAMES;
     const float FRAME_HEIGHT = DETAIL_HEIGHT - (TIMELINE_PADDING * 2);
     const uint32_t targetFrame = std::floor(m_currentTime * tickRate);
     const uint32_t firstVisibleFrame = targetFrame >= VISIBLE_RANGE ? targetFrame - VISIBLE_RANGE : 0;
-    const uint32_t lastVisibleFrame = targetFrame > snapshots.size() - VISIBLE_RANGE ? (uint32_t)snapshots.size() : targetFrame + VISIBLE_RANGE;
+    const uint32_t lastVisibleFrame = targetFrame + VISIBLE_RANGE;
 
     const float frameTime = 1.f / tickRate;
     const float frameStartTime = targetFrame * frameTime;
@@ -154,24 +154,24 @@ void TimeLineView::drawTimeLine(const std::vector<SnapshotData>& snapshots,
     const float offsetX = -alphaTime * FRAME_WIDTH;
     const float posY = DETAIL_POS_Y + TIMELINE_PADDING;
 
-    for (const auto& snapshot : snapshots)
+    for (const auto& frame : frames)
     {
-        if (snapshot.serverTick < firstVisibleFrame ||
-            snapshot.serverTick > lastVisibleFrame)
+        if (frame.serverTick < firstVisibleFrame ||
+            frame.serverTick > lastVisibleFrame)
         {
             continue;
         }
 
-        const float posX = DETAIL_POS_X + offsetX + ((snapshot.serverTick - (targetFrame - VISIBLE_RANGE)) * FRAME_WIDTH);
-        const float alpha = 1.f-fabs((float(snapshot.serverTick) - targetFrame) / VISIBLE_RANGE);
+        const float posX = DETAIL_POS_X + offsetX + ((frame.serverTick - (targetFrame - VISIBLE_RANGE)) * FRAME_WIDTH);
+        const float alpha = 1.f-fabs((float(frame.serverTick) - targetFrame) / VISIBLE_RANGE);
         
-        cocos2d::Color4F color = (snapshot.serverTick % tickRate == 0) ? cocos2d::Color4F::WHITE : cocos2d::Color4F::GRAY;
+        cocos2d::Color4F color = (frame.serverTick % tickRate == 0) ? cocos2d::Color4F::WHITE : cocos2d::Color4F::GRAY;
         color.a = alpha;
         m_drawNode->drawRect(cocos2d::Vec2(posX, posY),
                              cocos2d::Vec2(posX + FRAME_WIDTH - 1, posY + FRAME_HEIGHT),
                              color);
         
-        if (!snapshot.hitData.empty())
+        if (frame.hasHits)
         {
             m_drawNode->drawSolidRect(cocos2d::Vec2(posX+1, posY+1),
                                       cocos2d::Vec2(posX + FRAME_WIDTH - 2, posY + FRAME_HEIGHT - 1),
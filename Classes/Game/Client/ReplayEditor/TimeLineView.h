@@ -17,6 +17,14 @@ public:
         BUTTON_SPEED_MINUS,
     };
     
+    // Frames around the cursor drawn in the detail view
+    static const uint32_t VISIBLE_FRAMES;
+
+    struct FrameMarker {
+        uint32_t serverTick;
+        bool hasHits;
+    };
+
     TimeLineView();
     CREATE_FUNC(TimeLineView);
     
@@ -26,7 +34,7 @@ public:
                 const ssize_t totalFrames,
                 const uint32_t tickRate,
                 const float speed,
-                const std::vector<SnapshotData>& snapshots);
+                const std::vector<FrameMarker>& frames);
 
     void setMinTime(float time) { m_minTime = time; }
     void setMaxTime(float time) { m_maxTime = time; }
@@ -61,7 +69,7 @@ private:
     float m_maxTime;
     float m_currentTime;
     
-    void drawTimeLine(const std::vector<SnapshotData>& snapshots,
+    void drawTimeLine(const std::vector<FrameMarker>& frames,
                       const uint32_t tickRate);
 };
 
@@ -3,144 +3,455 @@
 #include "SharedConstants.h"
 #include "ReadStream.h"
 #include "WriteStream.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <zlib.h>
 
 const std::string ReplayModel::DEFAULT_REPLAY_FILE = "ReplayData.bin";
 const std::string ReplayModel::SETTING_SAVE_REPLAY = "SaveReplay";
 
+const size_t ReplayModel::SNAPSHOTS_PER_CHUNK = 64;
+const size_t ReplayModel::MAX_CHUNK_BYTES = 512 * 1024;
+const size_t ReplayModel::MAX_CACHED_CHUNKS = 4;
+
+namespace
+{
+    const uint32_t REPLAY_FILE_MAGIC = 0x5059414D; // "MAYP"
+    const uint32_t REPLAY_FILE_VERSION = 1;
+    const uint32_t REPLAY_CHUNK_MAGIC = 0x4B4E4843; // "CHNK"
+    const uint32_t REPLAY_INDEX_MAGIC = 0x58444E49; // "INDX"
+    const size_t DEFAULT_WRITE_BUFFER_BYTES = 64 * 1024;
+
+    struct ReplayFileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t tickRate;
+        uint32_t reserved;
+    };
+
+    struct ReplayChunkHeader {
+        uint32_t magic;
+        uint32_t compressedBytes;
+        uint32_t rawBytes;
+        uint32_t snapshotCount;
+        uint32_t firstTick;
+        uint32_t lastTick;
+    };
+
+    struct ReplayIndexFooter {
+        uint64_t indexOffset;
+        uint32_t chunkCount;
+        uint32_t magic;
+    };
+
+    bool seekFile(FILE* file, const uint64_t offset)
+    {
+        return fseek(file, (long)offset, SEEK_SET) == 0;
+    }
+}
+
 ReplayModel::ReplayModel()
 : m_tickRate(DEFAULT_TICK_RATE)
+, m_snapshotCount(0)
+, m_recordFile(nullptr)
+, m_recordOffset(0)
+, m_lastRecordedTick(0)
+, m_pendingChunk()
+, m_replayFile(nullptr)
+, m_cacheCounter(0)
 {
+    m_cachedChunks.reserve(MAX_CACHED_CHUNKS);
     printf("ReplayModel:: constructor: %p\n", this);
 }
 
 ReplayModel::~ReplayModel()
 {
+    stopRecording();
+    closeReplayFile();
     printf("ReplayModel:: destructor: %p\n", this);
 }
 
 void ReplayModel::reset()
 {
+    stopRecording();
+    closeReplayFile();
     m_tickRate = DEFAULT_TICK_RATE;
-    m_snapshots.clear();
 }
 
-bool ReplayModel::loadFile(const std::string& fileName)
+bool ReplayModel::startRecording(const std::string& fileName, const uint32_t tickRate)
 {
-    m_snapshots.clear();
-    
+    reset();
+
     auto fileUtil = cocos2d::FileUtils::getInstance();
     const std::string fullPath = fileUtil->getWritablePath() + fileName;
-    if (!fileUtil->isFileExist(fullPath))
+    m_recordFile = fopen(fullPath.c_str(), "wb");
+    if (!m_recordFile)
     {
+        printf("ReplayModel::startRecording failed to open %s\n", fullPath.c_str());
         return false;
     }
-    
-    cocos2d::Data data = fileUtil->getDataFromFile(fullPath);
-    if (data.getSize() < 10)
+
+    const ReplayFileHeader header = { REPLAY_FILE_MAGIC, REPLAY_FILE_VERSION, tickRate, 0 };
+    if (fwrite(&header, sizeof(header), 1, m_recordFile) != 1)
     {
+        fclose(m_recordFile);
+        m_recordFile = nullptr;
         return false;
     }
-    
-    Net::ReadStream stream(data.getBytes(), data.getSize());
-    
-    uint64_t frameCount = 0;
-    std::string HEADER;
-    m_tickRate = 0;
-    stream.SerializeString(HEADER);
-    stream.SerializeBits(frameCount, 64);
-    stream.SerializeInteger(m_tickRate);
-    
-    for (uint64_t frame = 0; frame < frameCount; frame++)
-    {
-        ServerSnapshotMessage snapshotMessage;
+
+    m_tickRate = tickRate;
+    m_recordOffset = sizeof(header);
+    m_pendingChunk = ChunkInfo();
+    m_pendingChunkData.reserve(MAX_CHUNK_BYTES + DEFAULT_WRITE_BUFFER_BYTES);
+    m_writeBuffer.resize(DEFAULT_WRITE_BUFFER_BYTES);
+    return true;
+}
+
+void ReplayModel::storeSnapshot(const SnapshotData& data)
+{
+    if (!m_recordFile)
+    {
+        return;
+    }
+    // Ticks must keep increasing for seeking to work, late and duplicate snapshots are dropped
+    const bool hasRecorded = m_pendingChunk.snapshotCount || !m_chunks.empty();
+    if (hasRecorded && data.serverTick <= m_lastRecordedTick)
+    {
+        return;
+    }
+
+    ServerSnapshotMessage snapshotMessage;
+    snapshotMessage.data = data;
+    int32_t snapshotBytes = 0;
+    while (true)
+    {
+        Net::WriteStream stream(m_writeBuffer.data(), (int32_t)m_writeBuffer.size());
         snapshotMessage.serialize(stream);
-        m_snapshots.push_back(snapshotMessage.data);
+        stream.Flush();
+        // A write that didn't fit leaves less than 64 bits remaining, try again with more room
+        if (stream.GetBitsRemaining() >= 64)
+        {
+            snapshotBytes = stream.GetDataBytes();
+            break;
+        }
+        m_writeBuffer.resize(m_writeBuffer.size() * 2);
+    }
+
+    // Each snapshot is stored as its byte size followed by the serialized message
+    const size_t previousBytes = m_pendingChunkData.size();
+    m_pendingChunkData.resize(previousBytes + sizeof(uint32_t) + snapshotBytes);
+    const uint32_t size = (uint32_t)snapshotBytes;
+    memcpy(&m_pendingChunkData[previousBytes], &size, sizeof(size));
+    memcpy(&m_pendingChunkData[previousBytes + sizeof(size)], m_writeBuffer.data(), snapshotBytes);
+
+    if (m_pendingChunk.snapshotCount == 0)
+    {
+        m_pendingChunk.firstTick = data.serverTick;
+    }
+    m_pendingChunk.lastTick = data.serverTick;
+    m_pendingChunk.snapshotCount++;
+    m_lastRecordedTick = data.serverTick;
+
+    if (m_pendingChunk.snapshotCount >= SNAPSHOTS_PER_CHUNK ||
+        m_pendingChunkData.size() >= MAX_CHUNK_BYTES)
+    {
+        writePendingChunk();
     }
-    
-    return true;
 }
 
-bool ReplayModel::saveFile(const std::string& fileName, const uint32_t tickRate) const
+void ReplayModel::stopRecording()
 {
+    if (!m_recordFile)
+    {
+        return;
+    }
+
+    writePendingChunk();
+    writeChunkIndex();
+    fclose(m_recordFile);
+    m_recordFile = nullptr;
+
+    m_chunks.clear();
+    m_snapshotCount = 0;
+    m_pendingChunkData.clear();
+    m_pendingChunkData.shrink_to_fit();
+    m_compressedData.clear();
+    m_compressedData.shrink_to_fit();
+    m_writeBuffer.clear();
+    m_writeBuffer.shrink_to_fit();
+}
+
+bool ReplayModel::loadFile(const std::string& fileName)
+{
+    reset();
+
     auto fileUtil = cocos2d::FileUtils::getInstance();
     const std::string fullPath = fileUtil->getWritablePath() + fileName;
-    if (fileUtil->isFileExist(fullPath))
+    FILE* file = fopen(fullPath.c_str(), "rb");
+    if (!file)
     {
         return false;
     }
-    
-    int32_t bufferSize = 16*1024*1024; // 16MB should do it I guess :D
-    void* bytes = malloc(bufferSize); // Will be freed by "data" below
-    
-    Net::WriteStream stream(bytes, bufferSize);
-    
-    uint64_t frameCount = m_snapshots.size();
-    std::string HEADER = "MayhemReplay-v0.0/";
-    uint32_t rate = tickRate;
-    stream.SerializeString(HEADER);
-    stream.SerializeBits(frameCount, 64);
-    stream.SerializeInteger(rate);
-    
-    for (auto snapshot : m_snapshots)
-    {
-        if (stream.GetBitsRemaining() <= 8096)
-        {
-            break;
-        }
-        ServerSnapshotMessage snapshotMessage;
-        snapshotMessage.data = snapshot;
-        snapshotMessage.serialize(stream);
+
+    ReplayFileHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        header.magic != REPLAY_FILE_MAGIC ||
+        header.version != REPLAY_FILE_VERSION ||
+        header.tickRate == 0)
+    {
+        printf("ReplayModel::loadFile %s is not a replay file\n", fullPath.c_str());
+        fclose(file);
+        return false;
     }
-        
-    cocos2d::Data data; // Takes ownership of buffer
-    data.fastSet((unsigned char*)bytes, stream.GetDataBytes());
-    
-    fileUtil->writeDataToFile(data, fullPath);
-    
+
+    fseek(file, 0, SEEK_END);
+    const uint64_t fileBytes = (uint64_t)ftell(file);
+
+    m_tickRate = header.tickRate;
+    if (!readChunkIndex(file, fileBytes))
+    {
+        // Recording never finished, rebuild the index from the chunks that made it to disk
+        scanChunks(file, fileBytes);
+    }
+    m_snapshotCount = m_chunks.empty() ? 0 : m_chunks.back().firstSnapshot + m_chunks.back().snapshotCount;
+    m_replayFile = file;
+
+    printf("ReplayModel::loadFile loaded index for %zu snapshots in %zu chunks\n", m_snapshotCount, m_chunks.size());
     return true;
 }
 
-void ReplayModel::storeSnapshot(const SnapshotData& data)
+const SnapshotData& ReplayModel::getSnapshot(const size_t index)
+{
+    assert(index < m_snapshotCount);
+    const auto it = std::upper_bound(m_chunks.begin(), m_chunks.end(), index,
+                                     [](const size_t snapshot, const ChunkInfo& chunk) {
+        return snapshot < chunk.firstSnapshot;
+    });
+    const size_t chunkIndex = (it - m_chunks.begin()) - 1;
+    const CachedChunk& chunk = loadChunk(chunkIndex);
+    return chunk.snapshots.at(index - m_chunks[chunkIndex].firstSnapshot);
+}
+
+size_t ReplayModel::getSnapshotIndexForTime(const float targetTime)
 {
-    m_snapshots.push_back(data);
+    const float frame = std::floor(std::max(targetTime, 0.f) * m_tickRate);
+    return getSnapshotIndexForFrame((uint32_t)frame);
 }
 
-size_t ReplayModel::getSnapshotIndexForTime(const float targetTime) const
+size_t ReplayModel::getSnapshotIndexForFrame(const uint32_t frame)
 {
-    if (m_snapshots.empty())
+    const auto it = std::upper_bound(m_chunks.begin(), m_chunks.end(), frame,
+                                     [](const uint32_t tick, const ChunkInfo& chunk) {
+        return tick < chunk.firstTick;
+    });
+    if (it == m_chunks.begin())
     {
         return 0;
     }
-    
-    const float frameTime = 1.f / m_tickRate;
 
-    float previousTime = m_snapshots.begin()->serverTick * frameTime;
-    size_t targetIndex = 1;
-    for (; targetIndex < m_snapshots.size() - 1; targetIndex++)
+    const size_t chunkIndex = (it - m_chunks.begin()) - 1;
+    const CachedChunk& chunk = loadChunk(chunkIndex);
+    const auto snapshotIt = std::upper_bound(chunk.snapshots.begin(), chunk.snapshots.end(), frame,
+                                             [](const uint32_t tick, const SnapshotData& snapshot) {
+        return tick < snapshot.serverTick;
+    });
+    if (snapshotIt == chunk.snapshots.begin())
+    {
+        return m_chunks[chunkIndex].firstSnapshot;
+    }
+    return m_chunks[chunkIndex].firstSnapshot + (snapshotIt - chunk.snapshots.begin()) - 1;
+}
+
+void ReplayModel::writePendingChunk()
+{
+    if (m_pendingChunk.snapshotCount == 0)
     {
-        const float nextTime = m_snapshots.at(targetIndex).serverTick * frameTime;
-        if (previousTime <= targetTime &&
-            nextTime > targetTime)
+        return;
+    }
+
+    uLongf compressedBytes = compressBound((uLong)m_pendingChunkData.size());
+    m_compressedData.resize(compressedBytes);
+    const int result = compress2(m_compressedData.data(), &compressedBytes,
+                                 m_pendingChunkData.data(), (uLong)m_pendingChunkData.size(),
+                                 Z_BEST_SPEED);
+    if (result == Z_OK)
+    {
+        m_pendingChunk.offset = m_recordOffset;
+        m_pendingChunk.compressedBytes = (uint32_t)compressedBytes;
+        m_pendingChunk.rawBytes = (uint32_t)m_pendingChunkData.size();
+        m_pendingChunk.firstSnapshot = m_chunks.empty() ? 0 : m_chunks.back().firstSnapshot + m_chunks.back().snapshotCount;
+
+        const ReplayChunkHeader header = {
+            REPLAY_CHUNK_MAGIC,
+            m_pendingChunk.compressedBytes,
+            m_pendingChunk.rawBytes,
+            m_pendingChunk.snapshotCount,
+            m_pendingChunk.firstTick,
+            m_pendingChunk.lastTick
+        };
+        if (fwrite(&header, sizeof(header), 1, m_recordFile) == 1 &&
+            fwrite(m_compressedData.data(), compressedBytes, 1, m_recordFile) == 1)
         {
-            return targetIndex;
-            break;
+            // Flushed per chunk so everything up to the last chunk survives a crash
+            fflush(m_recordFile);
+            m_recordOffset += sizeof(header) + compressedBytes;
+            m_chunks.push_back(m_pendingChunk);
         }
-        previousTime = nextTime;
+        else
+        {
+            printf("ReplayModel::writePendingChunk failed to write %u snapshots\n", m_pendingChunk.snapshotCount);
+        }
+    }
+    else
+    {
+        printf("ReplayModel::writePendingChunk compression failed: %i\n", result);
+    }
+
+    m_pendingChunk = ChunkInfo();
+    m_pendingChunkData.clear();
+}
+
+void ReplayModel::writeChunkIndex()
+{
+    const ReplayIndexFooter footer = { m_recordOffset, (uint32_t)m_chunks.size(), REPLAY_INDEX_MAGIC };
+    if ((!m_chunks.empty() && fwrite(m_chunks.data(), sizeof(ChunkInfo), m_chunks.size(), m_recordFile) != m_chunks.size()) ||
+        fwrite(&footer, sizeof(footer), 1, m_recordFile) != 1)
+    {
+        printf("ReplayModel::writeChunkIndex failed, the index will be rebuilt on load\n");
     }
-    
-    return 0;
 }
 
-size_t ReplayModel::getSnapshotIndexForFrame(const uint32_t frame) const
+bool ReplayModel::readChunkIndex(FILE* file, const uint64_t fileBytes)
 {
-    for (size_t index = 0; index < m_snapshots.size(); index++)
+    ReplayIndexFooter footer;
+    if (fileBytes < sizeof(ReplayFileHeader) + sizeof(footer) ||
+        !seekFile(file, fileBytes - sizeof(footer)) ||
+        fread(&footer, sizeof(footer), 1, file) != 1 ||
+        footer.magic != REPLAY_INDEX_MAGIC ||
+        footer.indexOffset + (footer.chunkCount * sizeof(ChunkInfo)) + sizeof(footer) != fileBytes)
     {
-        if (m_snapshots.at(index).serverTick == frame)
+        return false;
+    }
+
+    m_chunks.resize(footer.chunkCount);
+    if (footer.chunkCount &&
+        (!seekFile(file, footer.indexOffset) ||
+         fread(m_chunks.data(), sizeof(ChunkInfo), footer.chunkCount, file) != footer.chunkCount))
+    {
+        m_chunks.clear();
+        return false;
+    }
+    return true;
+}
+
+void ReplayModel::scanChunks(FILE* file, const uint64_t fileBytes)
+{
+    m_chunks.clear();
+    uint64_t offset = sizeof(ReplayFileHeader);
+    uint32_t firstSnapshot = 0;
+    ReplayChunkHeader header;
+    while (offset + sizeof(header) <= fileBytes &&
+           seekFile(file, offset) &&
+           fread(&header, sizeof(header), 1, file) == 1 &&
+           header.magic == REPLAY_CHUNK_MAGIC &&
+           offset + sizeof(header) + header.compressedBytes <= fileBytes)
+    {
+        ChunkInfo chunk;
+        chunk.offset = offset;
+        chunk.compressedBytes = header.compressedBytes;
+        chunk.rawBytes = header.rawBytes;
+        chunk.firstSnapshot = firstSnapshot;
+        chunk.snapshotCount = header.snapshotCount;
+        chunk.firstTick = header.firstTick;
+        chunk.lastTick = header.lastTick;
+        m_chunks.push_back(chunk);
+
+        firstSnapshot += header.snapshotCount;
+        offset += sizeof(header) + header.compressedBytes;
+    }
+}
+
+const ReplayModel::CachedChunk& ReplayModel::loadChunk(const size_t chunkIndex)
+{
+    m_cacheCounter++;
+    for (CachedChunk& cachedChunk : m_cachedChunks)
+    {
+        if (cachedChunk.chunkIndex == chunkIndex)
         {
-            return index;
+            cachedChunk.lastUsed = m_cacheCounter;
+            return cachedChunk;
         }
     }
-    
-    return 0;
+
+    // Reuse the least recently used slot once the cache is full
+    if (m_cachedChunks.size() < MAX_CACHED_CHUNKS)
+    {
+        m_cachedChunks.push_back(CachedChunk());
+    }
+    CachedChunk* cachedChunk = &m_cachedChunks.front();
+    for (CachedChunk& candidate : m_cachedChunks)
+    {
+        if (candidate.lastUsed < cachedChunk->lastUsed)
+        {
+            cachedChunk = &candidate;
+        }
+    }
+    cachedChunk->chunkIndex = chunkIndex;
+    cachedChunk->lastUsed = m_cacheCounter;
+    cachedChunk->snapshots.clear();
+
+    const ChunkInfo& chunk = m_chunks[chunkIndex];
+    std::vector<unsigned char> compressedData(chunk.compressedBytes);
+    std::vector<unsigned char> rawData(chunk.rawBytes);
+    uLongf rawBytes = chunk.rawBytes;
+    if (m_replayFile &&
+        seekFile(m_replayFile, chunk.offset + sizeof(ReplayChunkHeader)) &&
+        fread(compressedData.data(), 1, chunk.compressedBytes, m_replayFile) == chunk.compressedBytes &&
+        uncompress(rawData.data(), &rawBytes, compressedData.data(), chunk.compressedBytes) == Z_OK)
+    {
+        size_t offset = 0;
+        while (offset + sizeof(uint32_t) <= rawBytes &&
+               cachedChunk->snapshots.size() < chunk.snapshotCount)
+        {
+            uint32_t snapshotBytes = 0;
+            memcpy(&snapshotBytes, &rawData[offset], sizeof(snapshotBytes));
+            offset += sizeof(snapshotBytes);
+            if (offset + snapshotBytes > rawBytes)
+            {
+                break;
+            }
+
+            Net::ReadStream stream(&rawData[offset], (int32_t)snapshotBytes);
+            ServerSnapshotMessage snapshotMessage;
+            snapshotMessage.serialize(stream);
+            cachedChunk->snapshots.push_back(std::move(snapshotMessage.data));
+            offset += snapshotBytes;
+        }
+    }
+
+    if (cachedChunk->snapshots.size() != chunk.snapshotCount)
+    {
+        printf("ReplayModel::loadChunk chunk %zu is damaged, read %zu of %u snapshots\n",
+               chunkIndex, cachedChunk->snapshots.size(), chunk.snapshotCount);
+        // Keep indexing safe, missing snapshots are left empty at the last good tick
+        const uint32_t lastTick = cachedChunk->snapshots.empty() ? chunk.firstTick : cachedChunk->snapshots.back().serverTick;
+        SnapshotData emptySnapshot;
+        emptySnapshot.serverTick = lastTick;
+        cachedChunk->snapshots.resize(chunk.snapshotCount, emptySnapshot);
+    }
+    return *cachedChunk;
 }
 
+void ReplayModel::closeReplayFile()
+{
+    if (m_replayFile)
+    {
+        fclose(m_replayFile);
+        m_replayFile = nullptr;
+    }
+    m_chunks.clear();
+    m_cachedChunks.clear();
+    m_snapshotCount = 0;
+    m_cacheCounter = 0;
+}
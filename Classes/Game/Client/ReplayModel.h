@@ -5,6 +5,9 @@
 #include "Network/NetworkMessages.h"
 #include "Network/DrudgeNet/include/DataTypes.h"
 
+// Replays are recorded straight to disk, snapshots are compressed a chunk at a time and
+// appended while playing. A chunk index at the end of the file lets playback seek by tick
+// and only decompress the chunks it needs.
 class ReplayModel
 {
 public:
@@ -15,21 +18,71 @@ public:
     ~ReplayModel();
 
     void reset();
-    
-    bool loadFile(const std::string& fileName);
-    bool saveFile(const std::string& fileName, const uint32_t tickRate) const;
 
+    bool startRecording(const std::string& fileName, const uint32_t tickRate);
     void storeSnapshot(const SnapshotData& data);
-    size_t getSnapshotIndexForTime(const float targetTime) const;
-    size_t getSnapshotIndexForFrame(const uint32_t frame) const;
+    void stopRecording();
+    bool isRecording() const { return m_recordFile != nullptr; }
 
-    uint32_t getTickRate() const { return m_tickRate; }
+    bool loadFile(const std::string& fileName);
 
-    std::vector<SnapshotData>& getSnapshots() { return m_snapshots; }
+    size_t getSnapshotCount() const { return m_snapshotCount; }
+    // Stays valid until MAX_CACHED_CHUNKS other chunks have been loaded
+    const SnapshotData& getSnapshot(const size_t index);
+    uint32_t getLastTick() const { return m_chunks.empty() ? 0 : m_chunks.back().lastTick; }
+
+    // Index of the last snapshot at or before the given time or frame
+    size_t getSnapshotIndexForTime(const float targetTime);
+    size_t getSnapshotIndexForFrame(const uint32_t frame);
+
+    uint32_t getTickRate() const { return m_tickRate; }
 
 private:
+    static const size_t SNAPSHOTS_PER_CHUNK;
+    static const size_t MAX_CHUNK_BYTES;
+    static const size_t MAX_CACHED_CHUNKS;
+
+    // Stored as is in the file index
+    struct ChunkInfo {
+        uint64_t offset;
+        uint32_t compressedBytes;
+        uint32_t rawBytes;
+        uint32_t firstSnapshot;
+        uint32_t snapshotCount;
+        uint32_t firstTick;
+        uint32_t lastTick;
+    };
+
+    struct CachedChunk {
+        size_t chunkIndex;
+        uint32_t lastUsed;
+        std::vector<SnapshotData> snapshots;
+    };
+
     uint32_t m_tickRate;
-    std::vector<SnapshotData> m_snapshots;
+    std::vector<ChunkInfo> m_chunks;
+    size_t m_snapshotCount;
+
+    // Recording
+    FILE* m_recordFile;
+    uint64_t m_recordOffset;
+    uint32_t m_lastRecordedTick;
+    ChunkInfo m_pendingChunk;
+    std::vector<unsigned char> m_pendingChunkData;
+    std::vector<unsigned char> m_compressedData;
+    std::vector<unsigned char> m_writeBuffer;
+
+    // Playback
+    FILE* m_replayFile;
+    std::vector<CachedChunk> m_cachedChunks;
+    uint32_t m_cacheCounter;
+
+    void writePendingChunk();
+    void writeChunkIndex();
+    bool readChunkIndex(FILE* file, const uint64_t fileBytes);
+    void scanChunks(FILE* file, const uint64_t fileBytes);
+    const CachedChunk& loadChunk(const size_t chunkIndex);
+    void closeReplayFile();
 };
 
 #endif /* ReplayModel_h */
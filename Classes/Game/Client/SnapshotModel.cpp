@@ -109,6 +109,7 @@ void SnapshotModel::reset()
     m_lastReceivedSnapshot = 0;
     m_lastAppliedSnapshot = 0;
     m_snapshots.clear();
+    m_baselines.clear();
 }
 
 bool SnapshotModel::storeSnapshot(const SnapshotData& data)
@@ -125,6 +126,7 @@ bool SnapshotModel::storeSnapshot(const SnapshotData& data)
 
     m_lastReceivedSnapshot = data.serverTick;
     m_snapshots.push_back(data);
+    m_baselines.storeSnapshot(data);
     return true;
 }
 
@@ -4,6 +4,7 @@
 #include "cocos2d.h"
 #include "Network/NetworkMessages.h"
 #include "Network/DrudgeNet/include/DataTypes.h"
+#include "SnapshotBuffer.h"
 
 class SnapshotModel
 {
@@ -29,6 +30,8 @@ public:
     uint32_t getLastReceived() const { return m_lastReceivedSnapshot; }
     uint32_t getLastApplied() const { return m_lastAppliedSnapshot; }
     std::vector<SnapshotData>& getSnapshots() { return m_snapshots; }
+    // Untouched copy of a received snapshot for decoding deltas against
+    const SnapshotData* getBaseline(const uint32_t serverTick) const { return m_baselines.getSnapshot(serverTick); }
 
     size_t getSnapshotIndexForFrame(const uint32_t frame) const;
     void eraseUpToIndex(const size_t index);
@@ -39,6 +42,7 @@ private:
     uint32_t m_lastReceivedSnapshot;
     uint32_t m_lastAppliedSnapshot;
     std::vector<SnapshotData> m_snapshots;
+    SnapshotBuffer m_baselines;
 };
 
 #endif /* SnapshotModel_h */
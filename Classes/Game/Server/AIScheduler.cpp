@@ -0,0 +1,59 @@
+#include "AIScheduler.h"
+#include "BaseAI.h"
+
+const float AIScheduler::THINK_TIME_SMOOTHING = 0.1f;
+
+AIScheduler::AIScheduler(const uint32_t budget)
+: m_budget(budget)
+, m_averageThinkTime(0.f)
+, m_nextBot(0)
+{
+}
+
+void AIScheduler::schedule(const std::vector<std::pair<uint8_t, BaseAI*>>& bots,
+                           std::vector<size_t>& thinkers)
+{
+    thinkers.clear();
+    if (bots.empty())
+    {
+        m_nextBot = 0;
+        return;
+    }
+
+    const size_t firstBot = m_nextBot % bots.size();
+    size_t nextBot = firstBot;
+    uint32_t cost = 0;
+    for (size_t i = 0; i < bots.size(); i++)
+    {
+        const size_t botIndex = (firstBot + i) % bots.size();
+        if (bots[botIndex].second->getThinkOverdue() < 0.f)
+        {
+            continue;
+        }
+        // At least one bot thinks every tick however crowded it gets, or some would never get to
+        const uint32_t thinkCost = bots[botIndex].second->getThinkCost();
+        if (!thinkers.empty() && cost + thinkCost > m_budget)
+        {
+            break; // Next tick starts with this one
+        }
+        cost += thinkCost;
+        thinkers.push_back(botIndex);
+        nextBot = botIndex + 1;
+    }
+    m_nextBot = nextBot % bots.size();
+}
+
+void AIScheduler::onThinksDone(const size_t count, const float microseconds)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    const float thinkTime = microseconds / count;
+    if (m_averageThinkTime == 0.f)
+    {
+        m_averageThinkTime = thinkTime;
+        return;
+    }
+    m_averageThinkTime += (thinkTime - m_averageThinkTime) * THINK_TIME_SMOOTHING;
+}
@@ -0,0 +1,37 @@
+#ifndef AIScheduler_h
+#define AIScheduler_h
+
+#include <cstddef>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+class BaseAI;
+
+// Picks which bots think each tick so all of them thinking together stays within a budget.
+// Bots due to think take turns round robin, those left over wait a tick or more instead of
+// making the tick where many of their timers run out together a slow one.
+// A think costs the entities the bot looked at last time it thought, counted rather than timed
+// so the same world picks the same thinkers on any machine and with any number of workers.
+class AIScheduler
+{
+public:
+    AIScheduler(const uint32_t budget);
+
+    // Fills thinkers with indices into bots, cleared first
+    void schedule(const std::vector<std::pair<uint8_t, BaseAI*>>& bots,
+                  std::vector<size_t>& thinkers);
+    // How long the scheduled thinks took together, for the stats only, scheduling never reads it
+    void onThinksDone(const size_t count, const float microseconds);
+
+    float getAverageThinkTime() const { return m_averageThinkTime; }
+
+private:
+    static const float THINK_TIME_SMOOTHING;
+
+    uint32_t m_budget;
+    float m_averageThinkTime;
+    size_t m_nextBot;
+};
+
+#endif /* AIScheduler_h */
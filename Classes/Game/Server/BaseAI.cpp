@@ -1,4 +1,5 @@
 #include "BaseAI.h"
+#include "FlowField.h"
 #include "NetworkMessages.h"
 #include "EntitiesModel.h"
 #include "EntityDataModel.h"
@@ -7,12 +8,22 @@
 
 const float BaseAI::AI_UPDATE_INTERVAL = 1.f;
 const float BaseAI::AI_AWARENESS_RADIUS = 300.f;
+const float BaseAI::AI_PATH_RETARGET_DISTANCE = 48.f;
+const float BaseAI::AI_PATH_OFF_CORRIDOR_DISTANCE = 16.f;
+const float BaseAI::AI_PATH_SEARCH_EXTENT = 32.f;
+const float BaseAI::AI_WANDER_REACHED_DISTANCE = 16.f;
+const float BaseAI::AI_PATH_OPTIMIZE_RANGE = 256.f;
+const int BaseAI::AI_PATH_MAX_POLYS = 256;
+const int BaseAI::AI_NAV_QUERY_NODES = 64;
+const int BaseAI::AI_PATH_MAX_CORNERS = 3;
+const size_t BaseAI::AI_NEAR_QUERY_CAPACITY = 64;
 
-BaseAI::BaseAI()
+BaseAI::BaseAI(const uint32_t seed)
 : m_state(MOVE_TO_TARGET)
 , m_targetType(NONE)
 , m_updateAccumulator(0.f)
 , m_updateTime(1.f)
+, m_thinkCost(AI_THINK_BASE_COST)
 , m_directionX(0.f)
 , m_directionY(0.f)
 , m_aimPointX(0.f)
@@ -23,13 +34,40 @@ BaseAI::BaseAI()
 , m_reload(false)
 , m_changeWeapon(false)
 , m_slot(0)
+, m_random(seed)
+, m_navQuery(nullptr)
+, m_navQueryMesh(nullptr)
+, m_hasCorridor(false)
+, m_pathRequest(NavMesh::NO_PATH_REQUEST)
+, m_wantsPath(false)
+, m_pathFailed(false)
+, m_pathStartRef(0)
+, m_pathEndRef(0)
+, m_hasWanderTarget(false)
+, m_hasChaseTarget(false)
+, m_chaseTargetID(0)
+, m_hasTarget(false)
+, m_targetID(0)
 {
+    m_corridor.init(AI_PATH_MAX_POLYS);
+    m_path.reserve(AI_PATH_MAX_POLYS);
+    m_nearEntities.reserve(AI_NEAR_QUERY_CAPACITY);
+    m_nearPlayers.reserve(AI_NEAR_QUERY_CAPACITY);
+}
+
+BaseAI::~BaseAI()
+{
+    dtFreeNavMeshQuery(m_navQuery);
 }
 
 void BaseAI::update(const float deltaTime,
                     const uint8_t playerID,
-                    const std::shared_ptr<EntitiesModel>& entitiesModel)
+                    const std::shared_ptr<EntitiesModel>& entitiesModel,
+                    const AINavigation& navigation)
 {
+    m_wantsPath = false;
+    m_hasChaseTarget = false;
+
     const auto& players = entitiesModel->getPlayers();
     auto playerIt = players.find(playerID);
     if (playerIt == players.end())
@@ -39,24 +77,99 @@ void BaseAI::update(const float deltaTime,
     
     m_updateAccumulator += deltaTime;
     
-    if (m_updateAccumulator >= m_updateTime)
+    updateState(playerID, entitiesModel, navigation);
+}
+
+void BaseAI::think(const uint8_t playerID,
+                   const std::shared_ptr<EntitiesModel>& entitiesModel)
+{
+    const auto& players = entitiesModel->getPlayers();
+    auto playerIt = players.find(playerID);
+    if (playerIt == players.end())
     {
-        m_updateAccumulator = 0.f;
-        
-        refreshState(playerID, entitiesModel);
+        return;
     }
-    
-    updateState(playerID, entitiesModel);
+
+    m_updateAccumulator = 0.f;
+    refreshState(playerID, entitiesModel);
+
+    // Pick what to go for now, every tick until the next think only looks up where it went
+    const auto& botPlayer = playerIt->second;
+    const cocos2d::Vec2 position = botPlayer->getPosition();
+    const InventoryItem& weapon = botPlayer->getWeaponSlots().at(botPlayer->getActiveSlot());
+    EntityType ammoType = EntityType::NoEntity;
+    if (weapon.type != EntityType::NoEntity)
+    {
+        const auto& itemData = EntityDataModel::getStaticEntityData(weapon.type);
+        ammoType = (EntityType)itemData.ammo.type;
+    }
+    m_hasTarget = false;
+    m_targetID = 0;
+    if (m_targetType != TargetType::NONE)
+    {
+        entitiesModel->getEntitiesNearPosition(position, AI_AWARENESS_RADIUS, m_nearEntities);
+        m_hasTarget = getClosestOfType(m_targetType,
+                                       position,
+                                       botPlayer->getEntityID(),
+                                       m_nearEntities,
+                                       ammoType,
+                                       m_targetID);
+        m_thinkCost += (uint32_t)m_nearEntities.size();
+        m_nearEntities.clear();
+    }
+}
+
+bool BaseAI::getChaseTarget(uint16_t& entityID) const
+{
+    entityID = m_chaseTargetID;
+    return m_hasChaseTarget;
 }
 
-std::shared_ptr<ClientInputMessage> BaseAI::getInput() const
+void BaseAI::updatePathRequest(NavMesh& navMesh)
 {
-    auto input = std::make_shared<ClientInputMessage>();
+    if (m_pathRequest != NavMesh::NO_PATH_REQUEST)
+    {
+        const NavMesh::PathStatus status = navMesh.getPathResult(m_pathRequest, m_path);
+        if (status == NavMesh::PATH_PENDING)
+        {
+            return;
+        }
+
+        m_pathRequest = NavMesh::NO_PATH_REQUEST;
+        m_pathFailed = status == NavMesh::PATH_FAILED;
+        m_hasCorridor = !m_pathFailed;
+        if (m_hasCorridor)
+        {
+            float start[3];
+            float end[3];
+            NavMesh::toNavPosition(m_pathStart, start);
+            NavMesh::toNavPosition(m_pathEnd, end);
+            m_corridor.reset(m_path.front(), start);
+            m_corridor.setCorridor(end, m_path.data(), (int)m_path.size());
+            m_pathTarget = m_requestedTarget;
+        }
+        return;
+    }
+
+    if (!m_wantsPath)
+    {
+        return;
+    }
+
+    // A full queue hands out no request, the next update asks again from wherever the bot is by then
+    m_pathRequest = navMesh.requestPath(m_pathStartRef, m_pathStart, m_pathEndRef, m_pathEnd);
+    m_wantsPath = false;
+}
+
+std::shared_ptr<ClientInputMessage> BaseAI::getInput()
+{
+    auto input = m_inputPool.acquire();
     
     input->directionX = m_directionX;
     input->directionY = m_directionY;
     input->aimPointX = m_aimPointX;
     input->aimPointY = m_aimPointY;
+    input->aim = false;
     input->shoot = m_shoot;
     input->interact = m_interact;
     input->run = m_run;
@@ -92,8 +205,10 @@ void BaseAI::refreshState(const uint8_t playerID,
     const auto& botPlayer = playerIt->second;
     const cocos2d::Vec2 position = botPlayer->getPosition();
     const InventoryItem& weapon = botPlayer->getWeaponSlots().at(botPlayer->getActiveSlot());
-    const auto nearbyPlayers = entitiesModel->getPlayersNearPosition(position, AI_AWARENESS_RADIUS);
-    const bool areThreatsNearby = nearbyPlayers.size() > 1;
+    entitiesModel->getPlayersNearPosition(position, AI_AWARENESS_RADIUS, m_nearPlayers);
+    const bool areThreatsNearby = m_nearPlayers.size() > 1;
+    m_thinkCost = AI_THINK_BASE_COST + (uint32_t)m_nearPlayers.size();
+    m_nearPlayers.clear();
     const bool hasWeapon = weapon.type != EntityType::NoEntity;
     const bool seekWeapon = !hasWeapon;
     const bool needsReload = hasWeapon && weapon.amount == 0;
@@ -144,7 +259,8 @@ void BaseAI::refreshState(const uint8_t playerID,
 }
 
 void BaseAI::updateState(const uint8_t playerID,
-                         const std::shared_ptr<EntitiesModel>& entitiesModel)
+                         const std::shared_ptr<EntitiesModel>& entitiesModel,
+                         const AINavigation& navigation)
 {
     resetState();
     
@@ -157,22 +273,48 @@ void BaseAI::updateState(const uint8_t playerID,
 
     const auto& botPlayer = playerIt->second;
     const cocos2d::Vec2 position = botPlayer->getPosition();
-    const InventoryItem& weapon = botPlayer->getWeaponSlots().at(botPlayer->getActiveSlot());
-    EntityType ammoType = EntityType::NoEntity;
     
-    if (weapon.type != EntityType::NoEntity)
+    const NavMesh* navMesh = navigation.navMesh;
+    cocos2d::Vec2 waypoint;
+    if (m_state == State::MOVE_TO_TARGET &&
+        navigation.safeZoneField &&
+        navigation.safeZoneField->getNextWaypoint(position, waypoint))
     {
-        const auto& itemData = EntityDataModel::getStaticEntityData(weapon.type);
-        ammoType = (EntityType)itemData.ammo.type;
+        // Out on the dead tiles, getting back into the zone comes before anything else
+        const cocos2d::Vec2 direction = (waypoint - position).getNormalized();
+        m_directionX = direction.x;
+        m_directionY = -direction.y;
+        m_aimPointX = direction.x * 10.f;
+        m_aimPointY = direction.y * 10.f;
+        return;
     }
-    const auto nearbyPlayers = entitiesModel->getPlayersNearPosition(position, AI_AWARENESS_RADIUS);
-//    const bool areThreatsNearby = nearbyPlayers.size() > 1;
-//    const bool seekWeapon = weapon.type == EntityType::NoEntity;
-//    const bool needsReload = weapon.amount == 0;
-//    const uint16_t inventoryAmmo = botPlayer->getInventoryAmount((EntityType)itemData.ammo.type);
-    
+
     if (m_state == State::MOVE_TO_TARGET)
     {
+        if (m_targetType == TargetType::NONE &&
+            navMesh && navMesh->isBuilt())
+        {
+            // Wander to random spots around us, the path gets them around walls
+            const bool reachedCorridorEnd = m_hasCorridor &&
+                position.distanceSquared(NavMesh::fromNavPosition(m_corridor.getTarget())) < AI_WANDER_REACHED_DISTANCE * AI_WANDER_REACHED_DISTANCE;
+            if (!m_hasWanderTarget || m_pathFailed || reachedCorridorEnd ||
+                position.distanceSquared(m_wanderTarget) < AI_WANDER_REACHED_DISTANCE * AI_WANDER_REACHED_DISTANCE)
+            {
+                std::uniform_real_distribution<float> offset(-AI_AWARENESS_RADIUS, AI_AWARENESS_RADIUS);
+                const float offsetX = offset(m_random);
+                const float offsetY = offset(m_random);
+                m_wanderTarget = position + cocos2d::Vec2(offsetX, offsetY);
+                m_hasWanderTarget = true;
+                m_pathFailed = false;
+            }
+
+            const cocos2d::Vec2 direction = (getSteeringTarget(position, m_wanderTarget, navMesh) - position).getNormalized();
+            m_directionX = direction.x;
+            m_directionY = -direction.y;
+            m_aimPointX = direction.x * 10.f;
+            m_aimPointY = direction.y * 10.f;
+            return;
+        }
         if (m_targetType == TargetType::NONE)
         {
             const float distSQ = position.distanceSquared(cocos2d::Vec2(m_aimPointX, m_aimPointY));
@@ -181,7 +323,7 @@ void BaseAI::updateState(const uint8_t playerID,
                 static const std::vector<cocos2d::Vec2> DIRECTIONS = {
                     cocos2d::Vec2(-1,0), cocos2d::Vec2(0, 1), cocos2d::Vec2(1, 0), cocos2d::Vec2(0, -1)
                 };
-                const int random = cocos2d::random(0, 3);
+                const int random = std::uniform_int_distribution<int>(0, 3)(m_random);
                 // Move to random position
                 m_directionX = DIRECTIONS.at(random).x;
                 m_directionY = DIRECTIONS.at(random).y;
@@ -192,13 +334,7 @@ void BaseAI::updateState(const uint8_t playerID,
             return;
         }
         // Seek target
-        const auto nearEntities = entitiesModel->getEntitiesNearPosition(position, AI_AWARENESS_RADIUS);
-        
-        cocos2d::Vec2 targetPos = getClosestOfType(m_targetType,
-                                                   position,
-                                                   botPlayer->getEntityID(),
-                                                   nearEntities,
-                                                   ammoType);
+        const cocos2d::Vec2 targetPos = getTargetPosition(position, entitiesModel);
 
         m_aimPointX = targetPos.x - position.x;
         m_aimPointY = targetPos.y - position.y;
@@ -213,8 +349,42 @@ void BaseAI::updateState(const uint8_t playerID,
         {
             const cocos2d::Vec2 targetDelta = (targetPos - position);
             const float distToTarget = targetDelta.length();
-            m_directionX = targetDelta.getNormalized().x;
-            m_directionY = -targetDelta.getNormalized().y;
+            cocos2d::Vec2 steeringDelta = targetDelta;
+            if (m_targetType == TargetType::ENEMY &&
+                distToTarget > 0.f)
+            {
+                // Enemies are chased over a field shared with every other bot after them,
+                // a path of our own only until that exists
+                m_hasChaseTarget = true;
+                m_chaseTargetID = m_targetID;
+                const FlowField* chaseField = nullptr;
+                if (navigation.chaseFields)
+                {
+                    auto fieldIt = navigation.chaseFields->find(m_targetID);
+                    if (fieldIt != navigation.chaseFields->end())
+                    {
+                        chaseField = &fieldIt->second;
+                    }
+                }
+                if (chaseField)
+                {
+                    // Nowhere to go once on the enemy's tile, straight at them from there
+                    if (chaseField->getNextWaypoint(position, waypoint))
+                    {
+                        steeringDelta = waypoint - position;
+                    }
+                }
+                else
+                {
+                    steeringDelta = getSteeringTarget(position, targetPos, navMesh) - position;
+                }
+            }
+            else if (distToTarget > 0.f)
+            {
+                steeringDelta = getSteeringTarget(position, targetPos, navMesh) - position;
+            }
+            m_directionX = steeringDelta.getNormalized().x;
+            m_directionY = -steeringDelta.getNormalized().y;
 
             if (distToTarget < ITEM_GRAB_RADIUS &&
                 (m_targetType == TargetType::AMMO || m_targetType == TargetType::WEAPON))
@@ -231,13 +401,7 @@ void BaseAI::updateState(const uint8_t playerID,
     else
     {
         // Seek target
-        const auto nearEntities = entitiesModel->getEntitiesNearPosition(position, AI_AWARENESS_RADIUS);
-        
-        cocos2d::Vec2 targetPos = getClosestOfType(m_targetType,
-                                                   position,
-                                                   botPlayer->getEntityID(),
-                                                   nearEntities,
-                                                   ammoType);
+        const cocos2d::Vec2 targetPos = getTargetPosition(position, entitiesModel);
 
         m_aimPointX = targetPos.x - position.x;
         m_aimPointY = targetPos.y - position.y;
@@ -256,8 +420,9 @@ void BaseAI::updateState(const uint8_t playerID,
             {
                 // Miss by a little bit
                 const float AI_AIM_MISS_RANGE = 0.3f;
-                float randomX = cocos2d::random(-AI_AIM_MISS_RANGE, AI_AIM_MISS_RANGE);
-                float randomY = cocos2d::random(-AI_AIM_MISS_RANGE, AI_AIM_MISS_RANGE);
+                std::uniform_real_distribution<float> aimMiss(-AI_AIM_MISS_RANGE, AI_AIM_MISS_RANGE);
+                float randomX = aimMiss(m_random);
+                float randomY = aimMiss(m_random);
                 m_aimPointX += randomX;
                 m_aimPointY += randomY;
                 m_shoot = true;
@@ -281,13 +446,138 @@ void BaseAI::resetState()
     m_changeWeapon = false;
 }
 
-cocos2d::Vec2 BaseAI::getClosestOfType(const TargetType type,
-                                       const cocos2d::Vec2& position,
-                                       const uint16_t ignoreEntityID,
-                                       const std::vector<std::shared_ptr<Entity>>& entities,
-                                       EntityType ammoType) const
+cocos2d::Vec2 BaseAI::getSteeringTarget(const cocos2d::Vec2& position,
+                                        const cocos2d::Vec2& target,
+                                        const NavMesh* navMesh)
+{
+    if (!navMesh || !navMesh->isBuilt())
+    {
+        return target;
+    }
+
+    if (m_navQueryMesh != navMesh->getNavMesh())
+    {
+        // New level, anything searched on the previous mesh is meaningless
+        if (!m_navQuery)
+        {
+            m_navQuery = dtAllocNavMeshQuery();
+        }
+        if (!m_navQuery ||
+            dtStatusFailed(m_navQuery->init(navMesh->getNavMesh(), AI_NAV_QUERY_NODES)))
+        {
+            m_navQueryMesh = nullptr;
+            return target;
+        }
+        m_navQueryMesh = navMesh->getNavMesh();
+        m_hasCorridor = false;
+        m_pathRequest = NavMesh::NO_PATH_REQUEST;
+    }
+
+    const dtQueryFilter* filter = &navMesh->getFilter();
+    bool needsPath = !m_hasCorridor;
+    if (m_hasCorridor)
+    {
+        float navPosition[3];
+        NavMesh::toNavPosition(position, navPosition);
+        m_corridor.movePosition(navPosition, m_navQuery, filter);
+        const cocos2d::Vec2 corridorPosition = NavMesh::fromNavPosition(m_corridor.getPos());
+        if (corridorPosition.distanceSquared(position) > AI_PATH_OFF_CORRIDOR_DISTANCE * AI_PATH_OFF_CORRIDOR_DISTANCE)
+        {
+            // Pushed off the corridor, it no longer leads anywhere from here
+            m_hasCorridor = false;
+            needsPath = true;
+        }
+        else if (m_pathTarget.distanceSquared(target) > AI_PATH_RETARGET_DISTANCE * AI_PATH_RETARGET_DISTANCE)
+        {
+            needsPath = true; // Keep following the old corridor until the new one is found
+        }
+        else
+        {
+            float navTarget[3];
+            NavMesh::toNavPosition(target, navTarget);
+            m_corridor.moveTargetPosition(navTarget, m_navQuery, filter);
+        }
+    }
+
+    if (needsPath &&
+        m_pathRequest == NavMesh::NO_PATH_REQUEST)
+    {
+        queuePath(position, target, *navMesh);
+    }
+
+    if (!m_hasCorridor)
+    {
+        return target;
+    }
+
+    // Room for more than one, the straight path starts at our own position before that gets pruned
+    float corners[AI_PATH_MAX_CORNERS * 3];
+    unsigned char cornerFlags[AI_PATH_MAX_CORNERS];
+    dtPolyRef cornerPolys[AI_PATH_MAX_CORNERS];
+    int cornerCount = m_corridor.findCorners(corners, cornerFlags, cornerPolys, AI_PATH_MAX_CORNERS, m_navQuery, filter);
+    if (cornerCount > 0)
+    {
+        // Shortcut to the corner after next when it is in sight, the wall cost bends searched paths
+        // more than needed and bots would turn back at tile borders
+        m_corridor.optimizePathVisibility(&corners[std::min(1, cornerCount - 1) * 3], AI_PATH_OPTIMIZE_RANGE, m_navQuery, filter);
+        cornerCount = m_corridor.findCorners(corners, cornerFlags, cornerPolys, AI_PATH_MAX_CORNERS, m_navQuery, filter);
+    }
+    if (cornerCount == 0)
+    {
+        return target;
+    }
+    return navMesh->getSteeringPoint(NavMesh::fromNavPosition(corners));
+}
+
+void BaseAI::queuePath(const cocos2d::Vec2& position,
+                       const cocos2d::Vec2& target,
+                       const NavMesh& navMesh)
+{
+    const float extents[3] = { AI_PATH_SEARCH_EXTENT, 1.f, AI_PATH_SEARCH_EXTENT };
+    float navPosition[3];
+    float nearestPosition[3];
+    NavMesh::toNavPosition(position, navPosition);
+    m_navQuery->findNearestPoly(navPosition, extents, &navMesh.getFilter(), &m_pathStartRef, nearestPosition);
+    m_pathStart = NavMesh::fromNavPosition(nearestPosition);
+    NavMesh::toNavPosition(target, navPosition);
+    m_navQuery->findNearestPoly(navPosition, extents, &navMesh.getFilter(), &m_pathEndRef, nearestPosition);
+    m_pathEnd = NavMesh::fromNavPosition(nearestPosition);
+    if (!m_pathStartRef || !m_pathEndRef)
+    {
+        m_pathFailed = true; // Inside a wall or off the map, no path from or to there
+        return;
+    }
+    m_requestedTarget = target;
+    m_wantsPath = true;
+}
+
+cocos2d::Vec2 BaseAI::getTargetPosition(const cocos2d::Vec2& position,
+                                        const std::shared_ptr<EntitiesModel>& entitiesModel)
+{
+    if (m_hasTarget)
+    {
+        const auto& entities = entitiesModel->getEntities();
+        auto entityIt = entities.find(m_targetID);
+        if (entityIt != entities.end())
+        {
+            return entityIt->second->getPosition();
+        }
+        // Picked up or dead, think again as soon as the scheduler lets us
+        m_hasTarget = false;
+        m_targetID = 0;
+        m_updateAccumulator = std::max(m_updateAccumulator, m_updateTime);
+    }
+    return position;
+}
+
+bool BaseAI::getClosestOfType(const TargetType type,
+                              const cocos2d::Vec2& position,
+                              const uint16_t ignoreEntityID,
+                              const std::vector<std::shared_ptr<Entity>>& entities,
+                              EntityType ammoType,
+                              uint16_t& closestEntityID) const
 {
-    cocos2d::Vec2 closestPosition = position;
+    bool found = false;
     float closestDistanceSQ = AI_AWARENESS_RADIUS * AI_AWARENESS_RADIUS;
     for (const auto& entity : entities)
     {
@@ -318,9 +608,10 @@ cocos2d::Vec2 BaseAI::getClosestOfType(const TargetType type,
             if (distSQ < closestDistanceSQ)
             {
                 closestDistanceSQ = distSQ;
-                closestPosition = entity->getPosition();
+                closestEntityID = entity->getEntityID();
+                found = true;
             }
         }
     }
-    return closestPosition;
+    return found;
 }
@@ -2,14 +2,29 @@
 #define BaseAI_h
 
 #include "EntityConstants.h"
+#include "MessagePool.h"
+#include "NavMesh.h"
+#include "recast/DetourCrowd/DetourPathCorridor.h"
 #include <stdint.h>
+#include <map>
 #include <memory>
+#include <random>
+#include <vector>
 
 class ClientInputMessage;
 class EntitiesModel;
 class Entity;
+class FlowField;
 class Player;
 
+// What bots find their way with, shared by all of them and only changed between their updates
+struct AINavigation
+{
+    const NavMesh* navMesh;
+    const FlowField* safeZoneField; // Leads out of the dead tiles, nowhere while inside the zone
+    const std::map<uint16_t, FlowField>* chaseFields; // Toward chased players by entity ID
+};
+
 class BaseAI
 {
 public:
@@ -25,26 +40,53 @@ public:
         THREAT,
     };
     
-    BaseAI();
+    // Every bot draws from its own generator so bots can update in any order, or at once, and decide the same
+    BaseAI(const uint32_t seed);
+    virtual ~BaseAI();
     
+    // Deciding what to do and what to go for, the expensive part, the AI scheduler spreads it over ticks
+    void think(const uint8_t playerID,
+               const std::shared_ptr<EntitiesModel>& entityModel);
+    // Every tick, steers toward what the last think picked
+    // Without a nav mesh or flow fields bots head straight for their targets
     virtual void update(const float deltaTime,
                         const uint8_t playerID,
-                        const std::shared_ptr<EntitiesModel>& entityModel);
+                        const std::shared_ptr<EntitiesModel>& entityModel,
+                        const AINavigation& navigation);
+    // Hands the path search wanted during update to the nav mesh and picks up finished ones, main thread only
+    void updatePathRequest(NavMesh& navMesh);
     
-    std::shared_ptr<ClientInputMessage> getInput() const;
+    // Recycles the inputs the server has let go of instead of allocating one every tick
+    std::shared_ptr<ClientInputMessage> getInput();
 
     const State getState() const { return m_state; }
     const TargetType getTargetType() const { return m_targetType; }
     const float getUpdateAccumulator() const { return m_updateAccumulator; }
+    // How long ago the next think was due, negative until then
+    const float getThinkOverdue() const { return m_updateAccumulator - m_updateTime; }
+    // Entities the last think looked at, what the AI scheduler expects the next one to cost
+    const uint32_t getThinkCost() const { return m_thinkCost; }
+    // The enemy this bot chased in its last update, it reads the chase field for them once there is one
+    bool getChaseTarget(uint16_t& entityID) const;
     
 private:
     static const float AI_UPDATE_INTERVAL;
     static const float AI_AWARENESS_RADIUS;
+    static const float AI_PATH_RETARGET_DISTANCE;
+    static const float AI_PATH_OFF_CORRIDOR_DISTANCE;
+    static const float AI_PATH_SEARCH_EXTENT;
+    static const float AI_WANDER_REACHED_DISTANCE;
+    static const float AI_PATH_OPTIMIZE_RANGE;
+    static const int AI_PATH_MAX_POLYS;
+    static const int AI_NAV_QUERY_NODES;
+    static const int AI_PATH_MAX_CORNERS;
+    static const size_t AI_NEAR_QUERY_CAPACITY;
 
     State m_state;
     TargetType m_targetType;
     float m_updateAccumulator;
     float m_updateTime;
+    uint32_t m_thinkCost;
 
     float m_directionX;
     float m_directionY;
@@ -56,18 +98,58 @@ private:
     bool m_reload;
     bool m_changeWeapon;
     uint8_t m_slot;
+    std::mt19937 m_random;
+
+    // Path following, the query is only used for this bot's corridor so bots can update at once
+    dtNavMeshQuery* m_navQuery;
+    const dtNavMesh* m_navQueryMesh;
+    dtPathCorridor m_corridor;
+    bool m_hasCorridor;
+    cocos2d::Vec2 m_pathTarget; // Target the corridor was searched for
+    NavMesh::PathRequestID m_pathRequest;
+    bool m_wantsPath;
+    bool m_pathFailed;
+    dtPolyRef m_pathStartRef;
+    dtPolyRef m_pathEndRef;
+    cocos2d::Vec2 m_pathStart;
+    cocos2d::Vec2 m_pathEnd;
+    cocos2d::Vec2 m_requestedTarget;
+    std::vector<dtPolyRef> m_path;
+    bool m_hasWanderTarget;
+    cocos2d::Vec2 m_wanderTarget;
+    bool m_hasChaseTarget;
+    uint16_t m_chaseTargetID;
+    bool m_hasTarget;
+    uint16_t m_targetID; // Picked by the last think
+    MessagePool<ClientInputMessage> m_inputPool;
+    // Scratch for the think queries, emptied after each so no entity is kept alive by them
+    std::vector<std::shared_ptr<Entity>> m_nearEntities;
+    std::vector<std::shared_ptr<Player>> m_nearPlayers;
 
     void refreshState(const uint8_t playerID,
                       const std::shared_ptr<EntitiesModel>& entityModel);
     void updateState(const uint8_t playerID,
-                     const std::shared_ptr<EntitiesModel>& entityModel);
+                     const std::shared_ptr<EntitiesModel>& entityModel,
+                     const AINavigation& navigation);
     void resetState();
+
+    // Next point to move toward on the way to target, the target itself until a path is found
+    cocos2d::Vec2 getSteeringTarget(const cocos2d::Vec2& position,
+                                    const cocos2d::Vec2& target,
+                                    const NavMesh* navMesh);
+    void queuePath(const cocos2d::Vec2& position,
+                   const cocos2d::Vec2& target,
+                   const NavMesh& navMesh);
     
-    cocos2d::Vec2 getClosestOfType(const TargetType type,
-                                   const cocos2d::Vec2& position,
-                                   const uint16_t ignoreEntityID,
-                                   const std::vector<std::shared_ptr<Entity>>& entities,
-                                   EntityType ammoType) const;
+    // Where the target is now, our own position once it's gone
+    cocos2d::Vec2 getTargetPosition(const cocos2d::Vec2& position,
+                                    const std::shared_ptr<EntitiesModel>& entityModel);
+    bool getClosestOfType(const TargetType type,
+                          const cocos2d::Vec2& position,
+                          const uint16_t ignoreEntityID,
+                          const std::vector<std::shared_ptr<Entity>>& entities,
+                          EntityType ammoType,
+                          uint16_t& closestEntityID) const;
 
 };
 
@@ -51,7 +51,7 @@ std::shared_ptr<Player> EntitiesController::createPlayer(const uint8_t playerID,
                                                          const cocos2d::Vec2& position,
                                                          const float rotation)
 {
-    std::shared_ptr<Player> player = std::make_shared<Player>(entityID);
+    std::shared_ptr<Player> player = std::make_shared<Player>(m_model->getStore(), entityID);
     player->setPlayerID(playerID);
     player->setPosition(position);
     player->setRotation(rotation);
@@ -72,11 +72,11 @@ std::shared_ptr<Item> EntitiesController::createItem(const uint16_t entityID,
 
     if (type == EntityType::Loot_Box)
     {
-        item = std::make_shared<LootBox>(entityID);
+        item = std::make_shared<LootBox>(m_model->getStore(), entityID);
     }
     else
     {
-        item = std::make_shared<Item>(entityID, type);
+        item = std::make_shared<Item>(m_model->getStore(), entityID, type);
     }
     
     item->setPosition(position);
@@ -84,13 +84,13 @@ std::shared_ptr<Item> EntitiesController::createItem(const uint16_t entityID,
     if (type >= EntityType::Item_Ammo_9mm &&
         type <= EntityType::Item_Ammo_Slugs)
     {
-        auto itemData = EntityDataModel::getStaticEntityData(type);
+        const auto& itemData = EntityDataModel::getStaticEntityData(type);
         amount = itemData.ammo.amount;
     }
     else if (type >= EntityType::Item_Deagle &&
              type <= EntityType::Item_Kar98 )
     {
-        auto itemData = EntityDataModel::getStaticEntityData(type);
+        const auto& itemData = EntityDataModel::getStaticEntityData(type);
         amount = itemData.ammo.amount;
     }
 
@@ -106,7 +106,7 @@ std::shared_ptr<Projectile> EntitiesController::createProjectile(const uint16_t
                                                                  const cocos2d::Vec2& velocity,
                                                                  const float rotation)
 {
-    std::shared_ptr<Projectile> projectile = std::make_shared<Projectile>(entityID, type);
+    std::shared_ptr<Projectile> projectile = std::make_shared<Projectile>(m_model->getStore(), entityID, type);
     projectile->setPosition(position);
     projectile->setRotation(rotation);
     projectile->setVelocity(velocity);
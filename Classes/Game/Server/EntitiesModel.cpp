@@ -2,6 +2,8 @@
 
 #include "Entity.h"
 #include "Player.h"
+#include "EntityDataModel.h"
+#include <cassert>
 
 EntitiesModel::EntitiesModel()
 : m_nextEntityID(0)
@@ -17,12 +19,30 @@ EntitiesModel::~EntitiesModel()
 
 void EntitiesModel::addEntity(const uint32_t entityID, const std::shared_ptr<Entity>& entity)
 {
+    // Any bigger and the store would give it the row of another entity
+    assert(entityID < EntityStore::MAX_ENTITY_IDS);
     m_entities[entityID] = entity;
 }
 
+uint32_t EntitiesModel::incrementNextEntityID()
+{
+    // Counts up through the whole range before reusing any, clients have long forgotten an ID by then
+    for (size_t i = 0; i < EntityStore::MAX_ENTITY_IDS; i++)
+    {
+        m_nextEntityID = (m_nextEntityID + 1) % EntityStore::MAX_ENTITY_IDS;
+        if (m_entities.find(m_nextEntityID) == m_entities.end())
+        {
+            return m_nextEntityID;
+        }
+    }
+    assert(false); // Every entity ID is taken
+    return m_nextEntityID;
+}
+
 void EntitiesModel::removeEntity(const uint32_t entityID)
 {
     m_entities.erase(entityID);
+    m_store.remove(entityID);
 }
 
 void EntitiesModel::removePlayer(const uint8_t playerID)
@@ -32,61 +52,77 @@ void EntitiesModel::removePlayer(const uint8_t playerID)
 
 void EntitiesModel::setSnapshot(const std::map<uint32_t, EntitySnapshot>& snapshot)
 {
-    for (auto entityPair : m_entities)
+    std::vector<cocos2d::Vec2>& positions = m_store.getPositions();
+    std::vector<float>& rotations = m_store.getRotations();
+    for (const auto& snapshotPair : snapshot)
     {
-        if (!snapshot.count(entityPair.first))
+        const int32_t index = m_store.getIndex(snapshotPair.first);
+        if (index == EntityStore::NO_INDEX)
         {
             continue;
         }
-        const cocos2d::Vec2 position = cocos2d::Vec2(snapshot.at(entityPair.first).positionX,
-                                                     snapshot.at(entityPair.first).positionY);
-        entityPair.second->setPosition(position);
-        entityPair.second->setRotation(snapshot.at(entityPair.first).rotation);
+        positions[index] = cocos2d::Vec2(snapshotPair.second.positionX, snapshotPair.second.positionY);
+        rotations[index] = snapshotPair.second.rotation;
     }
 }
 
 std::map<uint32_t, EntitySnapshot> EntitiesModel::getSnapshot() const
 {
     std::map<uint32_t, EntitySnapshot> snapshot;
-    for (auto entityPair : m_entities)
+    getSnapshot(snapshot);
+    return snapshot;
+}
+
+void EntitiesModel::getSnapshot(std::map<uint32_t, EntitySnapshot>& snapshot) const
+{
+    // Only entities which are gone get erased, the nodes of everything else are overwritten
+    // so a tick without spawns or deaths doesn't touch the heap
+    removeMissingEntities(snapshot);
+
+    const std::vector<uint16_t>& entityIDs = m_store.getEntityIDs();
+    const std::vector<cocos2d::Vec2>& positions = m_store.getPositions();
+    const std::vector<float>& rotations = m_store.getRotations();
+    const std::vector<uint8_t>& types = m_store.getTypes();
+    for (size_t i = 0; i < entityIDs.size(); i++)
     {
-        snapshot[entityPair.first] = {
-            entityPair.second->getPosition().x,
-            entityPair.second->getPosition().y,
-            entityPair.second->getRotation(),
-            (uint8_t)entityPair.second->getEntityType()
+        snapshot[entityIDs[i]] = {
+            positions[i].x,
+            positions[i].y,
+            rotations[i],
+            types[i]
         };
     }
-    
-    return snapshot;
 }
 
 std::map<uint32_t, EntitySnapshot> EntitiesModel::getDiff(const std::map<uint32_t, EntitySnapshot>& snapshot) const
 {
     std::map<uint32_t, EntitySnapshot> diff;
-
-    for (auto entityPair : m_entities)
+    const std::vector<uint16_t>& entityIDs = m_store.getEntityIDs();
+    const std::vector<cocos2d::Vec2>& positions = m_store.getPositions();
+    const std::vector<float>& rotations = m_store.getRotations();
+    const std::vector<uint8_t>& types = m_store.getTypes();
+    for (size_t i = 0; i < entityIDs.size(); i++)
     {
-        auto it = snapshot.find(entityPair.first);
+        auto it = snapshot.find(entityIDs[i]);
         if (it == snapshot.end())
         {
             // New entity
-            diff[entityPair.first] = {
-                entityPair.second->getPosition().x,
-                entityPair.second->getPosition().y,
-                entityPair.second->getRotation(),
-                (uint8_t)entityPair.second->getEntityType()
+            diff[entityIDs[i]] = {
+                positions[i].x,
+                positions[i].y,
+                rotations[i],
+                types[i]
             };
         }
         else
         {
             // Store delta
-            auto snapshotEntity = it->second;
-            diff[entityPair.first] = {
-                entityPair.second->getPosition().x - snapshotEntity.positionX,
-                entityPair.second->getPosition().y - snapshotEntity.positionY,
-                entityPair.second->getRotation() - snapshotEntity.rotation,
-                (uint8_t)entityPair.second->getEntityType()
+            const EntitySnapshot& snapshotEntity = it->second;
+            diff[entityIDs[i]] = {
+                positions[i].x - snapshotEntity.positionX,
+                positions[i].y - snapshotEntity.positionY,
+                rotations[i] - snapshotEntity.rotation,
+                types[i]
             };
         }
     }
@@ -94,6 +130,21 @@ std::map<uint32_t, EntitySnapshot> EntitiesModel::getDiff(const std::map<uint32_
     return diff;
 }
 
+void EntitiesModel::removeMissingEntities(std::map<uint32_t, EntitySnapshot>& snapshot) const
+{
+    for (auto it = snapshot.begin(); it != snapshot.end();)
+    {
+        if (it->first >= EntityStore::MAX_ENTITY_IDS ||
+            !m_store.contains(it->first))
+        {
+            it = snapshot.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
 
 const std::shared_ptr<Player> EntitiesModel::getPlayer(const uint8_t playerID)
 {
@@ -129,36 +180,92 @@ const uint8_t EntitiesModel::getPlayerIDByEntityID(const uint16_t entityID)
     return 0;
 }
 
-const std::vector<std::shared_ptr<Entity>> EntitiesModel::getEntitiesNearPosition(const cocos2d::Vec2 position,
-                                                                                  const float radius) const
+void EntitiesModel::getEntitiesNearPosition(const cocos2d::Vec2& position,
+                                            const float radius,
+                                            std::vector<std::shared_ptr<Entity>>& nearEntities) const
 {
-    std::vector<std::shared_ptr<Entity>> nearEntities;
+    nearEntities.clear();
     const float radiusSq = radius * radius;
-    for (auto entityPair : m_entities)
+    const std::vector<uint16_t>& entityIDs = m_store.getEntityIDs();
+    const std::vector<cocos2d::Vec2>& positions = m_store.getPositions();
+    for (size_t i = 0; i < entityIDs.size(); i++)
     {
-        if (entityPair.second->getPosition().distanceSquared(position) <= radiusSq)
+        if (positions[i].distanceSquared(position) <= radiusSq)
         {
-            nearEntities.push_back(entityPair.second);
+            auto it = m_entities.find(entityIDs[i]);
+            if (it != m_entities.end())
+            {
+                nearEntities.push_back(it->second);
+            }
         }
     }
-    
-    return nearEntities;
 }
 
-const std::vector<std::shared_ptr<Player>> EntitiesModel::getPlayersNearPosition(const cocos2d::Vec2 position,
-                                                                                 const float radius) const
+void EntitiesModel::getPlayersNearPosition(const cocos2d::Vec2& position,
+                                           const float radius,
+                                           std::vector<std::shared_ptr<Player>>& nearPlayers) const
 {
-    std::vector<std::shared_ptr<Player>> nearPlayers;
+    nearPlayers.clear();
     const float radiusSq = radius * radius;
-    for (auto playerPair : m_players)
+    for (const auto& playerPair : m_players)
     {
-        const int16_t entityID = playerPair.second->getEntityID();
-        auto entity = m_entities.at(entityID);
-        if (entity->getPosition().distanceSquared(position) <= radiusSq)
+        if (playerPair.second->getPosition().distanceSquared(position) <= radiusSq)
         {
             nearPlayers.push_back(playerPair.second);
         }
     }
-    
-    return nearPlayers;
+}
+
+void EntitiesModel::setupSpatialIndex(const cocos2d::Rect& bounds, const float cellSize)
+{
+    m_spatialIndex.setup(bounds, cellSize);
+}
+
+void EntitiesModel::updateSpatialIndex()
+{
+    m_spatialIndex.clearEntities();
+    for (auto& ownedProjectiles : m_ownedProjectileIDs)
+    {
+        ownedProjectiles.second.clear();
+    }
+
+    const std::vector<uint16_t>& entityIDs = m_store.getEntityIDs();
+    const std::vector<uint8_t>& types = m_store.getTypes();
+    const std::vector<cocos2d::Vec2>& positions = m_store.getPositions();
+    const std::vector<uint16_t>& ownerIDs = m_store.getOwnerIDs();
+    for (size_t i = 0; i < entityIDs.size(); i++)
+    {
+        m_spatialIndex.insertEntity(entityIDs[i], cocos2d::Rect(positions[i].x, positions[i].y, 0.f, 0.f));
+
+        if (EntityDataModel::isProjectileType((EntityType)types[i]))
+        {
+            m_ownedProjectileIDs[(uint8_t)ownerIDs[i]].push_back(entityIDs[i]);
+        }
+    }
+}
+
+void EntitiesModel::getEntityIDsNearPosition(const cocos2d::Vec2& position,
+                                             const float radius,
+                                             std::vector<uint32_t>& entityIDs) const
+{
+    const cocos2d::Rect area = cocos2d::Rect(position.x - radius, position.y - radius, radius * 2.f, radius * 2.f);
+    m_spatialIndex.queryEntities(area, entityIDs);
+
+    // Grid cells only narrow it down to the bounding square
+    const float radiusSq = radius * radius;
+    entityIDs.erase(std::remove_if(entityIDs.begin(), entityIDs.end(), [this, &position, radiusSq](const uint32_t entityID) {
+        const int32_t index = m_store.getIndex(entityID);
+        return index == EntityStore::NO_INDEX || m_store.getPositions()[index].distanceSquared(position) > radiusSq;
+    }), entityIDs.end());
+}
+
+const std::vector<uint32_t>& EntitiesModel::getOwnedProjectileIDs(const uint8_t playerID) const
+{
+    static const std::vector<uint32_t> NO_PROJECTILES;
+    auto it = m_ownedProjectileIDs.find(playerID);
+    if (it == m_ownedProjectileIDs.end())
+    {
+        return NO_PROJECTILES;
+    }
+    return it->second;
 }
@@ -6,6 +6,8 @@
 #include <list>
 #include "Network/NetworkMessages.h"
 #include "Game/Shared/EntityConstants.h"
+#include "Game/Shared/SpatialGrid.h"
+#include "EntityStore.h"
 
 
 class Entity;
@@ -22,7 +24,10 @@ public:
     
     void removePlayer(const uint8_t playerID);
     
+    // Entity objects by ID, their simulation state lives in the store
     std::map<uint32_t, std::shared_ptr<Entity>>& getEntities() { return m_entities; }
+    EntityStore& getStore() { return m_store; }
+    const EntityStore& getStore() const { return m_store; }
     std::map<uint8_t, std::shared_ptr<Player>>& getPlayers() { return m_players; }
 
     const std::shared_ptr<Player> getPlayer(const uint8_t playerID);
@@ -38,21 +43,43 @@ public:
     
     uint32_t getNextEntityID() const { return m_nextEntityID; }
     void setNextEntityID(const uint32_t nextID) { m_nextEntityID = nextID; }
-    uint32_t incrementNextEntityID() { return ++m_nextEntityID; }
+    // Entity IDs are 16 bits in the store and on the wire, past the last one they wrap around to IDs no entity holds
+    uint32_t incrementNextEntityID();
 
     void setSnapshot(const std::map<uint32_t, EntitySnapshot>& snapshot);
     std::map<uint32_t, EntitySnapshot> getSnapshot() const;
+    // Fills an existing snapshot in place, reusing its nodes for entities it already holds
+    void getSnapshot(std::map<uint32_t, EntitySnapshot>& snapshot) const;
     std::map<uint32_t, EntitySnapshot> getDiff(const std::map<uint32_t, EntitySnapshot>& snapshot) const;
 
-    const std::vector<std::shared_ptr<Entity>> getEntitiesNearPosition(const cocos2d::Vec2 position, const float radius) const;
-    const std::vector<std::shared_ptr<Player>> getPlayersNearPosition(const cocos2d::Vec2 position, const float radius) const;
+    // Both fill the given vector so callers asking every tick can keep reusing one
+    void getEntitiesNearPosition(const cocos2d::Vec2& position,
+                                 const float radius,
+                                 std::vector<std::shared_ptr<Entity>>& nearEntities) const;
+    void getPlayersNearPosition(const cocos2d::Vec2& position,
+                                const float radius,
+                                std::vector<std::shared_ptr<Player>>& nearPlayers) const;
+
+    // Position index for relevancy queries, only as fresh as the last updateSpatialIndex call
+    void setupSpatialIndex(const cocos2d::Rect& bounds, const float cellSize);
+    void updateSpatialIndex();
+    void getEntityIDsNearPosition(const cocos2d::Vec2& position,
+                                  const float radius,
+                                  std::vector<uint32_t>& entityIDs) const;
+    const std::vector<uint32_t>& getOwnedProjectileIDs(const uint8_t playerID) const;
 
 private:
+    EntityStore m_store;
     std::map<uint32_t, std::shared_ptr<Entity>> m_entities;
     std::map<uint8_t, std::shared_ptr<Player>> m_players;
     
+    SpatialGrid m_spatialIndex;
+    std::map<uint8_t, std::vector<uint32_t>> m_ownedProjectileIDs;
+
     uint32_t m_nextEntityID;
     uint8_t m_localPlayerID;
+
+    void removeMissingEntities(std::map<uint32_t, EntitySnapshot>& snapshot) const;
 };
 
 #endif /* EntitiesModel_h */
@@ -1,12 +1,12 @@
 #include "Entity.h"
 
-Entity::Entity(const uint16_t entityID, EntityType type)
-: m_entityID(entityID)
+Entity::Entity(EntityStore& store,
+               const uint16_t entityID,
+               const EntityType type)
+: m_store(store)
+, m_entityID(entityID)
 , m_entityType(type)
-, m_position(cocos2d::Vec2::ZERO)
-, m_rotation(0.f)
-, m_velocity(cocos2d::Vec2::ZERO)
-, m_angularVelocity(0.f)
 , m_isRemoved(false)
 {
+    m_store.add(entityID, type);
 }
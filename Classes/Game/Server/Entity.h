@@ -1,37 +1,38 @@
 #ifndef Entity_h
 #define Entity_h
 
-#include "cocos2d.h"
+#include "math/CCGeometry.h"
 #include "Game/Shared/EntityConstants.h"
+#include "EntityStore.h"
 
+// Facade over the entity's row in the EntitiesModel store, the row is created along with the entity
 class Entity
 {
 public:
-    Entity(const uint16_t entityID,
+    Entity(EntityStore& store,
+           const uint16_t entityID,
            const EntityType type);
+    virtual ~Entity() {}
     
     const uint16_t getEntityID() const { return m_entityID; }
     const EntityType& getEntityType() const { return m_entityType; }
     
-    virtual const cocos2d::Vec2& getPosition() const { return m_position; }
-    virtual const float getRotation() const { return m_rotation; }
-    virtual const cocos2d::Vec2& getVelocity() const { return m_velocity; }
-    virtual const float getAngularVelocity() const { return m_angularVelocity; }
-    virtual const bool getIsRemoved() const { return m_isRemoved; }
+    cocos2d::Vec2 getPosition() const { return m_store.getPosition(m_entityID); }
+    float getRotation() const { return m_store.getRotation(m_entityID); }
+    cocos2d::Vec2 getVelocity() const { return m_store.getVelocity(m_entityID); }
+    float getAngularVelocity() const { return m_store.getAngularVelocity(m_entityID); }
+    const bool getIsRemoved() const { return m_isRemoved; }
 
-    virtual void setPosition(const cocos2d::Vec2& position) { m_position = position; }
-    virtual void setRotation(const float rotation) { m_rotation = rotation; }
-    virtual void setVelocity(const cocos2d::Vec2& velocity) { m_velocity = velocity; }
-    virtual void setAngularVelocity(const float angularVelocity) { m_angularVelocity = angularVelocity; }
-    virtual void setIsRemoved(const bool isRemoved) { m_isRemoved = isRemoved; }
+    void setPosition(const cocos2d::Vec2& position) { m_store.setPosition(m_entityID, position); }
+    void setRotation(const float rotation) { m_store.setRotation(m_entityID, rotation); }
+    void setVelocity(const cocos2d::Vec2& velocity) { m_store.setVelocity(m_entityID, velocity); }
+    void setAngularVelocity(const float angularVelocity) { m_store.setAngularVelocity(m_entityID, angularVelocity); }
+    void setIsRemoved(const bool isRemoved) { m_isRemoved = isRemoved; }
     
 protected:
+    EntityStore& m_store;
     const uint16_t m_entityID;
     EntityType m_entityType;
-    cocos2d::Vec2 m_position;
-    float m_rotation;
-    cocos2d::Vec2 m_velocity;
-    float m_angularVelocity;
     bool m_isRemoved;
 };
 
@@ -0,0 +1,98 @@
+#include "EntityStore.h"
+
+const int32_t EntityStore::NO_INDEX = -1;
+const float EntityStore::NO_SPAWN_TIME = -1.f;
+const size_t EntityStore::MAX_ENTITY_IDS = 65536;
+const size_t EntityStore::DEFAULT_RESERVED_ROWS = 1024;
+
+EntityStore::EntityStore()
+: m_indices(MAX_ENTITY_IDS, NO_INDEX)
+{
+    m_entityIDs.reserve(DEFAULT_RESERVED_ROWS);
+    m_types.reserve(DEFAULT_RESERVED_ROWS);
+    m_positions.reserve(DEFAULT_RESERVED_ROWS);
+    m_rotations.reserve(DEFAULT_RESERVED_ROWS);
+    m_velocities.reserve(DEFAULT_RESERVED_ROWS);
+    m_angularVelocities.reserve(DEFAULT_RESERVED_ROWS);
+    m_ownerIDs.reserve(DEFAULT_RESERVED_ROWS);
+    m_spawnTimes.reserve(DEFAULT_RESERVED_ROWS);
+}
+
+size_t EntityStore::add(const uint16_t entityID, const EntityType type)
+{
+    int32_t index = m_indices[entityID];
+    if (index == NO_INDEX)
+    {
+        index = (int32_t)m_entityIDs.size();
+        m_indices[entityID] = index;
+        m_entityIDs.push_back(entityID);
+        m_types.push_back((uint8_t)type);
+        m_positions.push_back(cocos2d::Vec2::ZERO);
+        m_rotations.push_back(0.f);
+        m_velocities.push_back(cocos2d::Vec2::ZERO);
+        m_angularVelocities.push_back(0.f);
+        m_ownerIDs.push_back(0);
+        m_spawnTimes.push_back(NO_SPAWN_TIME);
+        return index;
+    }
+
+    // Entity ID was reused before the old entity was removed, start the row over
+    m_types[index] = (uint8_t)type;
+    m_positions[index] = cocos2d::Vec2::ZERO;
+    m_rotations[index] = 0.f;
+    m_velocities[index] = cocos2d::Vec2::ZERO;
+    m_angularVelocities[index] = 0.f;
+    m_ownerIDs[index] = 0;
+    m_spawnTimes[index] = NO_SPAWN_TIME;
+    return index;
+}
+
+void EntityStore::remove(const uint16_t entityID)
+{
+    const int32_t index = m_indices[entityID];
+    if (index == NO_INDEX)
+    {
+        return;
+    }
+
+    const int32_t lastIndex = (int32_t)m_entityIDs.size() - 1;
+    if (index != lastIndex)
+    {
+        const uint16_t lastEntityID = m_entityIDs[lastIndex];
+        m_entityIDs[index] = lastEntityID;
+        m_types[index] = m_types[lastIndex];
+        m_positions[index] = m_positions[lastIndex];
+        m_rotations[index] = m_rotations[lastIndex];
+        m_velocities[index] = m_velocities[lastIndex];
+        m_angularVelocities[index] = m_angularVelocities[lastIndex];
+        m_ownerIDs[index] = m_ownerIDs[lastIndex];
+        m_spawnTimes[index] = m_spawnTimes[lastIndex];
+        m_indices[lastEntityID] = index;
+    }
+
+    m_entityIDs.pop_back();
+    m_types.pop_back();
+    m_positions.pop_back();
+    m_rotations.pop_back();
+    m_velocities.pop_back();
+    m_angularVelocities.pop_back();
+    m_ownerIDs.pop_back();
+    m_spawnTimes.pop_back();
+    m_indices[entityID] = NO_INDEX;
+}
+
+void EntityStore::clear()
+{
+    for (const uint16_t entityID : m_entityIDs)
+    {
+        m_indices[entityID] = NO_INDEX;
+    }
+    m_entityIDs.clear();
+    m_types.clear();
+    m_positions.clear();
+    m_rotations.clear();
+    m_velocities.clear();
+    m_angularVelocities.clear();
+    m_ownerIDs.clear();
+    m_spawnTimes.clear();
+}
@@ -0,0 +1,89 @@
+#ifndef EntityStore_h
+#define EntityStore_h
+
+#include "math/CCGeometry.h"
+#include "Game/Shared/EntityConstants.h"
+#include <vector>
+
+// Simulation state of every entity packed into parallel arrays, one row per entity.
+// Rows stay dense, removing an entity moves the last row into its place, so entity IDs
+// are mapped to rows through a handle table indexed by the 16-bit entity ID.
+// Systems that touch every entity walk the columns directly, the Entity classes are a
+// facade reading and writing their own row.
+class EntityStore
+{
+public:
+    static const int32_t NO_INDEX;
+    static const float NO_SPAWN_TIME;
+    static const size_t MAX_ENTITY_IDS;
+
+    EntityStore();
+
+    size_t add(const uint16_t entityID, const EntityType type);
+    void remove(const uint16_t entityID);
+    void clear();
+
+    size_t size() const { return m_entityIDs.size(); }
+    bool contains(const uint16_t entityID) const { return m_indices[entityID] != NO_INDEX; }
+    int32_t getIndex(const uint16_t entityID) const { return m_indices[entityID]; }
+
+    // Columns, indexed by row
+    const std::vector<uint16_t>& getEntityIDs() const { return m_entityIDs; }
+    const std::vector<uint8_t>& getTypes() const { return m_types; }
+    std::vector<cocos2d::Vec2>& getPositions() { return m_positions; }
+    const std::vector<cocos2d::Vec2>& getPositions() const { return m_positions; }
+    std::vector<float>& getRotations() { return m_rotations; }
+    const std::vector<float>& getRotations() const { return m_rotations; }
+    const std::vector<cocos2d::Vec2>& getVelocities() const { return m_velocities; }
+    const std::vector<float>& getAngularVelocities() const { return m_angularVelocities; }
+    const std::vector<uint16_t>& getOwnerIDs() const { return m_ownerIDs; }
+    const std::vector<float>& getSpawnTimes() const { return m_spawnTimes; }
+
+    // Per entity access, entities which are not in the store read as zero and ignore writes
+    cocos2d::Vec2 getPosition(const uint16_t entityID) const { return get(m_positions, entityID, cocos2d::Vec2::ZERO); }
+    float getRotation(const uint16_t entityID) const { return get(m_rotations, entityID, 0.f); }
+    cocos2d::Vec2 getVelocity(const uint16_t entityID) const { return get(m_velocities, entityID, cocos2d::Vec2::ZERO); }
+    float getAngularVelocity(const uint16_t entityID) const { return get(m_angularVelocities, entityID, 0.f); }
+    uint16_t getOwnerID(const uint16_t entityID) const { return get(m_ownerIDs, entityID, (uint16_t)0); }
+    float getSpawnTime(const uint16_t entityID) const { return get(m_spawnTimes, entityID, NO_SPAWN_TIME); }
+
+    void setPosition(const uint16_t entityID, const cocos2d::Vec2& position) { set(m_positions, entityID, position); }
+    void setRotation(const uint16_t entityID, const float rotation) { set(m_rotations, entityID, rotation); }
+    void setVelocity(const uint16_t entityID, const cocos2d::Vec2& velocity) { set(m_velocities, entityID, velocity); }
+    void setAngularVelocity(const uint16_t entityID, const float angularVelocity) { set(m_angularVelocities, entityID, angularVelocity); }
+    void setOwnerID(const uint16_t entityID, const uint16_t ownerID) { set(m_ownerIDs, entityID, ownerID); }
+    void setSpawnTime(const uint16_t entityID, const float spawnTime) { set(m_spawnTimes, entityID, spawnTime); }
+
+private:
+    static const size_t DEFAULT_RESERVED_ROWS;
+
+    std::vector<int32_t> m_indices; // Indexed by entity ID
+
+    std::vector<uint16_t> m_entityIDs;
+    std::vector<uint8_t> m_types;
+    std::vector<cocos2d::Vec2> m_positions;
+    std::vector<float> m_rotations;
+    std::vector<cocos2d::Vec2> m_velocities;
+    std::vector<float> m_angularVelocities;
+    std::vector<uint16_t> m_ownerIDs;
+    std::vector<float> m_spawnTimes; // NO_SPAWN_TIME for entities which don't expire
+
+    template<typename T>
+    T get(const std::vector<T>& column, const uint16_t entityID, const T defaultValue) const
+    {
+        const int32_t index = m_indices[entityID];
+        return index != NO_INDEX ? column[index] : defaultValue;
+    }
+
+    template<typename T>
+    void set(std::vector<T>& column, const uint16_t entityID, const T& value)
+    {
+        const int32_t index = m_indices[entityID];
+        if (index != NO_INDEX)
+        {
+            column[index] = value;
+        }
+    }
+};
+
+#endif /* EntityStore_h */
@@ -1,11 +1,12 @@
 #include "Explosion.h"
 #include "Timer.h"
 
-Explosion::Explosion(const uint16_t entityID,
+Explosion::Explosion(EntityStore& store,
+                     const uint16_t entityID,
                      const cocos2d::Vec2& position,
                      const float radius,
                      const float force)
-: Entity(entityID, EntityType::ExplosionEntity)
+: Entity(store, entityID, EntityType::ExplosionEntity)
 , m_radius(0.1)
 , m_force(force)
 , m_lifeTime(1.0)
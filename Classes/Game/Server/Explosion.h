@@ -6,7 +6,8 @@
 class Explosion : public Entity
 {
 public:
-    Explosion(const uint16_t entityID,
+    Explosion(EntityStore& store,
+              const uint16_t entityID,
               const cocos2d::Vec2& position,
               const float radius,
               const float force);
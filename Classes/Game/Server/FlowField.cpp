@@ -0,0 +1,295 @@
+#include "FlowField.h"
+#include "LevelModel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+const uint32_t FlowField::UNREACHABLE = std::numeric_limits<uint32_t>::max();
+const uint32_t FlowField::STRAIGHT_COST = 10;
+const uint32_t FlowField::DIAGONAL_COST = 14;
+const uint32_t FlowField::WALL_EDGE_COST = 10;
+const int8_t FlowField::NO_DIRECTION = -1;
+
+namespace
+{
+    // Straight neighbours first, a direction and its opposite differ in the lowest bit only
+    const int NEIGHBOUR_X[8] = { 1, -1, 0, 0, 1, -1, 1, -1 };
+    const int NEIGHBOUR_Y[8] = { 0, 0, 1, -1, 1, -1, -1, 1 };
+    const int FIRST_DIAGONAL = 4;
+}
+
+FlowField::FlowField()
+: m_columns(0)
+, m_rows(0)
+{
+}
+
+void FlowField::setup(const LevelModel& levelModel)
+{
+    m_columns = (int)levelModel.getMapSizeInTiles().width;
+    m_rows = (int)levelModel.getMapSizeInTiles().height;
+    m_tileSize = levelModel.getTileSize();
+
+    const size_t tileCount = m_columns * m_rows;
+    m_solidTiles.assign(tileCount, 0);
+    for (int row = 0; row < m_rows; row++)
+    {
+        for (int column = 0; column < m_columns; column++)
+        {
+            // The level counts its rows from the top
+            if (levelModel.isTileSolid(cocos2d::Vec2(column, m_rows - 1 - row)))
+            {
+                m_solidTiles[column + row * m_columns] = 1;
+            }
+        }
+    }
+
+    m_wallEdgeTiles.assign(tileCount, 0);
+    for (int row = 0; row < m_rows; row++)
+    {
+        for (int column = 0; column < m_columns; column++)
+        {
+            for (int direction = 0; direction < 8; direction++)
+            {
+                if (isSolid(column + NEIGHBOUR_X[direction], row + NEIGHBOUR_Y[direction]))
+                {
+                    m_wallEdgeTiles[column + row * m_columns] = 1;
+                    break;
+                }
+            }
+        }
+    }
+
+    m_sources.assign(tileCount, 0);
+    m_costs.assign(tileCount, UNREACHABLE);
+    m_directions.assign(tileCount, NO_DIRECTION);
+    // Room for a search over the whole level, so a field's first one doesn't grow them mid game
+    m_open.reserve(tileCount);
+    m_invalidated.reserve(tileCount);
+}
+
+void FlowField::setSources(const std::vector<std::pair<int, int>>& tiles)
+{
+    clearSources();
+    for (const auto& tile : tiles)
+    {
+        seedSource(tile.first, tile.second);
+    }
+    std::make_heap(m_open.begin(), m_open.end(), std::greater<std::pair<uint32_t, int>>());
+    propagate();
+}
+
+void FlowField::setSource(const int column, const int row)
+{
+    clearSources();
+    seedSource(column, row);
+    propagate();
+}
+
+void FlowField::clearSources()
+{
+    std::fill(m_sources.begin(), m_sources.end(), 0);
+    std::fill(m_costs.begin(), m_costs.end(), UNREACHABLE);
+    std::fill(m_directions.begin(), m_directions.end(), NO_DIRECTION);
+    m_open.clear();
+}
+
+void FlowField::seedSource(const int column, const int row)
+{
+    if (isSolid(column, row))
+    {
+        return;
+    }
+    const int index = column + row * m_columns;
+    m_sources[index] = 1;
+    m_costs[index] = 0;
+    m_open.push_back({0, index});
+}
+
+void FlowField::addSource(const int column, const int row)
+{
+    if (isSolid(column, row) ||
+        isSource(column, row))
+    {
+        return;
+    }
+
+    // Costs only go down, spreading out from the new source is enough
+    const int index = column + row * m_columns;
+    m_sources[index] = 1;
+    m_costs[index] = 0;
+    m_directions[index] = NO_DIRECTION;
+    m_open.clear();
+    m_open.push_back({0, index});
+    propagate();
+}
+
+void FlowField::removeSource(const int column, const int row)
+{
+    if (!isSource(column, row))
+    {
+        return;
+    }
+
+    // Forget every tile that was reached through this one, the rest of the field still holds
+    const int index = column + row * m_columns;
+    m_sources[index] = 0;
+    m_costs[index] = UNREACHABLE;
+    m_invalidated.clear();
+    m_invalidated.push_back(index);
+    for (size_t i = 0; i < m_invalidated.size(); i++)
+    {
+        const int tile = m_invalidated[i];
+        for (int direction = 0; direction < 8; direction++)
+        {
+            if (!canStep(tile, direction))
+            {
+                continue;
+            }
+            const int neighbour = tile + NEIGHBOUR_X[direction] + NEIGHBOUR_Y[direction] * m_columns;
+            if (m_directions[neighbour] == (direction ^ 1))
+            {
+                m_costs[neighbour] = UNREACHABLE;
+                m_directions[neighbour] = NO_DIRECTION;
+                m_invalidated.push_back(neighbour);
+            }
+        }
+    }
+    m_directions[index] = NO_DIRECTION;
+
+    // Then fill them in again from the tiles around them that kept their cost
+    m_open.clear();
+    for (const int tile : m_invalidated)
+    {
+        for (int direction = 0; direction < 8; direction++)
+        {
+            if (!canStep(tile, direction))
+            {
+                continue;
+            }
+            const int neighbour = tile + NEIGHBOUR_X[direction] + NEIGHBOUR_Y[direction] * m_columns;
+            if (m_costs[neighbour] != UNREACHABLE)
+            {
+                m_open.push_back({m_costs[neighbour], neighbour});
+            }
+        }
+    }
+    std::make_heap(m_open.begin(), m_open.end(), std::greater<std::pair<uint32_t, int>>());
+    propagate();
+}
+
+bool FlowField::isSource(const int column, const int row) const
+{
+    if (column < 0 || column >= m_columns ||
+        row < 0 || row >= m_rows)
+    {
+        return false;
+    }
+    return m_sources[column + row * m_columns] != 0;
+}
+
+bool FlowField::getTile(const cocos2d::Vec2& position, int& column, int& row) const
+{
+    if (!isSetup())
+    {
+        return false;
+    }
+    column = (int)std::floor(position.x / m_tileSize.width);
+    row = (int)std::floor(position.y / m_tileSize.height);
+    return column >= 0 && column < m_columns &&
+           row >= 0 && row < m_rows;
+}
+
+uint32_t FlowField::getCost(const cocos2d::Vec2& position) const
+{
+    int column = 0;
+    int row = 0;
+    if (!getTile(position, column, row))
+    {
+        return UNREACHABLE;
+    }
+    return m_costs[column + row * m_columns];
+}
+
+bool FlowField::getNextWaypoint(const cocos2d::Vec2& position, cocos2d::Vec2& waypoint) const
+{
+    int column = 0;
+    int row = 0;
+    if (!getTile(position, column, row))
+    {
+        return false;
+    }
+    const int8_t direction = m_directions[column + row * m_columns];
+    if (direction == NO_DIRECTION)
+    {
+        return false;
+    }
+    waypoint = cocos2d::Vec2((column + NEIGHBOUR_X[direction] + 0.5f) * m_tileSize.width,
+                             (row + NEIGHBOUR_Y[direction] + 0.5f) * m_tileSize.height);
+    return true;
+}
+
+bool FlowField::isSolid(const int column, const int row) const
+{
+    if (column < 0 || column >= m_columns ||
+        row < 0 || row >= m_rows)
+    {
+        return true;
+    }
+    return m_solidTiles[column + row * m_columns] != 0;
+}
+
+bool FlowField::canStep(const int tile, const int direction) const
+{
+    const int column = tile % m_columns;
+    const int row = tile / m_columns;
+    const int toColumn = column + NEIGHBOUR_X[direction];
+    const int toRow = row + NEIGHBOUR_Y[direction];
+    if (isSolid(toColumn, toRow))
+    {
+        return false;
+    }
+    if (direction >= FIRST_DIAGONAL &&
+        (isSolid(toColumn, row) || isSolid(column, toRow)))
+    {
+        return false;
+    }
+    return true;
+}
+
+void FlowField::propagate()
+{
+    const std::greater<std::pair<uint32_t, int>> compare;
+    while (!m_open.empty())
+    {
+        std::pop_heap(m_open.begin(), m_open.end(), compare);
+        const uint32_t cost = m_open.back().first;
+        const int tile = m_open.back().second;
+        m_open.pop_back();
+        if (cost > m_costs[tile])
+        {
+            continue; // Reached for less since it was queued
+        }
+
+        // Neighbours get here by stepping onto this tile, which costs more when it's by a wall
+        const uint32_t enterCost = cost + (m_wallEdgeTiles[tile] ? WALL_EDGE_COST : 0);
+        for (int direction = 0; direction < 8; direction++)
+        {
+            if (!canStep(tile, direction))
+            {
+                continue;
+            }
+            const int neighbour = tile + NEIGHBOUR_X[direction] + NEIGHBOUR_Y[direction] * m_columns;
+            const uint32_t neighbourCost = enterCost + (direction >= FIRST_DIAGONAL ? DIAGONAL_COST : STRAIGHT_COST);
+            if (neighbourCost < m_costs[neighbour])
+            {
+                m_costs[neighbour] = neighbourCost;
+                m_directions[neighbour] = (int8_t)(direction ^ 1);
+                m_open.push_back({neighbourCost, neighbour});
+                std::push_heap(m_open.begin(), m_open.end(), compare);
+            }
+        }
+    }
+}
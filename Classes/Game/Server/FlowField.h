@@ -0,0 +1,67 @@
+#ifndef FlowField_h
+#define FlowField_h
+
+#include "math/CCGeometry.h"
+
+#include <stdint.h>
+#include <vector>
+
+class LevelModel;
+
+// Distance to the closest of any number of source tiles for every tile of the level,
+// and the neighbour to step to for getting closer. Bots heading to the same place all
+// read the one field instead of each searching for a path.
+// Costs come from a multi source Dijkstra over the 8 neighbours, diagonals don't cut wall corners
+// and tiles next to walls cost more to cross. Adding or removing a source only recomputes
+// the tiles whose distance it changes.
+class FlowField
+{
+public:
+    static const uint32_t UNREACHABLE;
+
+    FlowField();
+
+    // Solid tiles of the level are never entered, starts out without sources
+    void setup(const LevelModel& levelModel);
+    bool isSetup() const { return !m_costs.empty(); }
+
+    // Tiles are counted from the bottom left like the world's positions
+    void setSources(const std::vector<std::pair<int, int>>& tiles);
+    // Same as setting a list of just this tile, without one to build
+    void setSource(const int column, const int row);
+    void addSource(const int column, const int row);
+    void removeSource(const int column, const int row);
+    bool isSource(const int column, const int row) const;
+
+    bool getTile(const cocos2d::Vec2& position, int& column, int& row) const;
+    uint32_t getCost(const cocos2d::Vec2& position) const;
+    // Center of the next tile toward the closest source, false on a source or where none can be reached
+    bool getNextWaypoint(const cocos2d::Vec2& position, cocos2d::Vec2& waypoint) const;
+
+private:
+    static const uint32_t STRAIGHT_COST;
+    static const uint32_t DIAGONAL_COST;
+    static const uint32_t WALL_EDGE_COST;
+    static const int8_t NO_DIRECTION;
+
+    int m_columns;
+    int m_rows;
+    cocos2d::Size m_tileSize;
+    std::vector<uint8_t> m_solidTiles;
+    std::vector<uint8_t> m_wallEdgeTiles;
+    std::vector<uint8_t> m_sources;
+    std::vector<uint32_t> m_costs;
+    std::vector<int8_t> m_directions; // Neighbour the cost was reached from, the way toward the source
+
+    // Scratch space for the searches, kept around between them
+    std::vector<std::pair<uint32_t, int>> m_open;
+    std::vector<int> m_invalidated;
+
+    bool isSolid(const int column, const int row) const;
+    bool canStep(const int tile, const int direction) const;
+    void clearSources();
+    void seedSource(const int column, const int row);
+    void propagate();
+};
+
+#endif /* FlowField_h */
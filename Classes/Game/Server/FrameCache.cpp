@@ -2,10 +2,22 @@
 #include "Entity.h"
 
 const size_t DEFAULT_MAX_ROLLBACK_FRAMES = 20;
+const size_t DEFAULT_RESERVED_ENTITY_SLOTS = 256;
+
+const uint32_t FrameCache::NO_FRAME = 0;
+const int32_t FrameCache::NO_SLOT = -1;
+const size_t FrameCache::MAX_ENTITY_IDS = 1 << 16;
 
 FrameCache::FrameCache()
 : m_maxRollbackFrames(DEFAULT_MAX_ROLLBACK_FRAMES)
+, m_frameCount(0)
+, m_frameNumber(NO_FRAME)
+, m_entitySlots(MAX_ENTITY_IDS, NO_SLOT)
 {
+    m_tracks.reserve(DEFAULT_RESERVED_ENTITY_SLOTS * m_maxRollbackFrames);
+    m_slotEntityIDs.reserve(DEFAULT_RESERVED_ENTITY_SLOTS);
+    m_slotLastFrames.reserve(DEFAULT_RESERVED_ENTITY_SLOTS);
+    m_freeSlots.reserve(DEFAULT_RESERVED_ENTITY_SLOTS);
     printf("[Server]FrameCache:: constructor: %p\n", this);
 }
 
@@ -14,28 +26,167 @@ FrameCache::~FrameCache()
     printf("[Server]FrameCache:: destructor: %p\n", this);
 }
 
-void FrameCache::takeFrameSnapshot(std::map<uint32_t, EntitySnapshot> frameData)
+void FrameCache::setMaxRollbackFrames(const size_t frames)
+{
+    assert(frames);
+    if (frames == m_maxRollbackFrames)
+    {
+        return;
+    }
+
+    // Track layout depends on the window size, cached history is dropped
+    m_maxRollbackFrames = frames;
+    clear();
+    m_tracks.reserve(DEFAULT_RESERVED_ENTITY_SLOTS * m_maxRollbackFrames);
+}
+
+void FrameCache::clear()
 {
-    if (m_frames.size() == m_maxRollbackFrames)
+    for (const uint32_t entityID : m_slotEntityIDs)
+    {
+        m_entitySlots[entityID % MAX_ENTITY_IDS] = NO_SLOT;
+    }
+    m_tracks.clear();
+    m_slotEntityIDs.clear();
+    m_slotLastFrames.clear();
+    m_freeSlots.clear();
+    m_frameCount = 0;
+    m_frameNumber = NO_FRAME;
+}
+
+void FrameCache::takeFrameSnapshot(const std::map<uint32_t, EntitySnapshot>& frameData)
+{
+    m_frameNumber++;
+    m_frameCount = std::min(m_frameCount + 1, m_maxRollbackFrames);
+
+    const size_t ringIndex = getRingIndex(m_frameNumber);
+    for (const auto& entityPair : frameData)
     {
-        m_frames.erase(m_frames.begin());
+        const int32_t slot = getOrCreateSlot(entityPair.first);
+        TrackSample& sample = m_tracks[(slot * m_maxRollbackFrames) + ringIndex];
+        sample.frameNumber = m_frameNumber;
+        sample.snapshot = entityPair.second;
+        m_slotLastFrames[slot] = m_frameNumber;
     }
 
-    m_frames.push_back(frameData);
+    releaseStaleSlots();
 }
 
-std::map<uint32_t, EntitySnapshot>& FrameCache::rollBack(const size_t frames)
+void FrameCache::rollBack(const size_t frames)
 {
     assert(frames);
-    assert(frames <= m_frames.size());
-    
-//    CCLOG("FrameCache::rollBack %zu frames of %zu cached", frames, m_frames.size());
-    m_frames.resize(m_frames.size() - (frames - 1));
-    return m_frames.back();
+    assert(frames <= m_frameCount);
+
+//    CCLOG("FrameCache::rollBack %zu frames of %zu cached", frames, m_frameCount);
+    // Samples newer than the current frame number fail the frame check and get overwritten
+    m_frameNumber -= (frames - 1);
+    m_frameCount -= (frames - 1);
+}
+
+bool FrameCache::getEntitySnapshot(const size_t frame,
+                                   const uint32_t entityID,
+                                   EntitySnapshot& snapshot) const
+{
+    uint32_t frameNumber = NO_FRAME;
+    if (!getFrameNumber(frame, frameNumber))
+    {
+        return false;
+    }
+
+    const int32_t slot = m_entitySlots[entityID % MAX_ENTITY_IDS];
+    if (slot == NO_SLOT || m_slotEntityIDs[slot] != entityID)
+    {
+        return false;
+    }
+
+    const TrackSample& sample = m_tracks[(slot * m_maxRollbackFrames) + getRingIndex(frameNumber)];
+    if (sample.frameNumber != frameNumber)
+    {
+        return false; // Entity didn't exist in that frame
+    }
+    snapshot = sample.snapshot;
+    return true;
 }
 
-std::map<uint32_t, EntitySnapshot>& FrameCache::getFrame(const size_t frame)
+bool FrameCache::getFrame(const size_t frame, std::map<uint32_t, EntitySnapshot>& frameData) const
 {
-    const size_t frameIndex = (m_frames.size() - 1) - (frame - 1);
-    return m_frames[frameIndex];
+    frameData.clear();
+    uint32_t frameNumber = NO_FRAME;
+    if (!getFrameNumber(frame, frameNumber))
+    {
+        return false;
+    }
+
+    const size_t ringIndex = getRingIndex(frameNumber);
+    for (size_t slot = 0; slot < m_slotEntityIDs.size(); slot++)
+    {
+        const TrackSample& sample = m_tracks[(slot * m_maxRollbackFrames) + ringIndex];
+        if (sample.frameNumber == frameNumber)
+        {
+            frameData[m_slotEntityIDs[slot]] = sample.snapshot;
+        }
+    }
+    return true;
+}
+
+int32_t FrameCache::getOrCreateSlot(const uint32_t entityID)
+{
+    int32_t& slot = m_entitySlots[entityID % MAX_ENTITY_IDS];
+    if (slot != NO_SLOT && m_slotEntityIDs[slot] == entityID)
+    {
+        return slot;
+    }
+
+    if (!m_freeSlots.empty())
+    {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+        m_slotEntityIDs[slot] = entityID;
+    }
+    else
+    {
+        // Only grows when the live entity count reaches a new high
+        slot = (int32_t)m_slotEntityIDs.size();
+        m_slotEntityIDs.push_back(entityID);
+        m_slotLastFrames.push_back(NO_FRAME);
+        m_tracks.resize(m_tracks.size() + m_maxRollbackFrames, { NO_FRAME, EntitySnapshot() });
+    }
+
+    // Reused slots may still hold samples from the previous owner, invalidate them
+    for (size_t ringIndex = 0; ringIndex < m_maxRollbackFrames; ringIndex++)
+    {
+        m_tracks[(slot * m_maxRollbackFrames) + ringIndex].frameNumber = NO_FRAME;
+    }
+    return slot;
+}
+
+void FrameCache::releaseStaleSlots()
+{
+    for (size_t slot = 0; slot < m_slotEntityIDs.size(); slot++)
+    {
+        const uint32_t lastFrame = m_slotLastFrames[slot];
+        if (lastFrame == NO_FRAME ||
+            lastFrame + m_maxRollbackFrames > m_frameNumber)
+        {
+            continue; // Free already or still inside the window
+        }
+
+        int32_t& entitySlot = m_entitySlots[m_slotEntityIDs[slot] % MAX_ENTITY_IDS];
+        if (entitySlot == (int32_t)slot)
+        {
+            entitySlot = NO_SLOT;
+        }
+        m_slotLastFrames[slot] = NO_FRAME;
+        m_freeSlots.push_back((int32_t)slot);
+    }
+}
+
+bool FrameCache::getFrameNumber(const size_t frame, uint32_t& frameNumber) const
+{
+    if (frame == 0 || frame > m_frameCount)
+    {
+        return false;
+    }
+    frameNumber = m_frameNumber - (uint32_t)(frame - 1);
+    return true;
 }
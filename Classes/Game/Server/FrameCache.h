@@ -1,33 +1,102 @@
 #ifndef FrameCache_h
 #define FrameCache_h
 
-#include "cocos2d.h"
+#include "math/CCGeometry.h"
+#include "Entity.h"
 #include "Network/NetworkMessages.h"
 #include <vector>
 #include <map>
 #include <memory>
 
-class Entity;
-
+// Fixed capacity ring of past frames, stored as one history track per entity.
+// Every entity seen in the window owns a slot, and each slot holds one sample
+// per ring position, so looking up an entity at any cached frame is O(1).
+// Frame numbering follows the old API: frame 1 is the most recent snapshot.
 class FrameCache
 {
 public:
     FrameCache();
     ~FrameCache();
-    
-    void setMaxRollbackFrames(const size_t frames) { m_maxRollbackFrames = frames; }
+
+    void setMaxRollbackFrames(const size_t frames);
     const size_t getMaxRollbackFrames() const { return m_maxRollbackFrames; }
 
-    const size_t getFrameCount() const { return m_frames.size(); }
-    void takeFrameSnapshot(std::map<uint32_t, EntitySnapshot> frameData);
-    
-    std::map<uint32_t, EntitySnapshot>& rollBack(const size_t frames);
-    std::map<uint32_t, EntitySnapshot>& getFrame(const size_t frame);
+    const size_t getFrameCount() const { return m_frameCount; }
+    void takeFrameSnapshot(const std::map<uint32_t, EntitySnapshot>& frameData);
+    void clear();
+
+    // Discards the newest frames-1 frames, leaving the requested frame as the most recent
+    void rollBack(const size_t frames);
+
+    bool getEntitySnapshot(const size_t frame,
+                           const uint32_t entityID,
+                           EntitySnapshot& snapshot) const;
+    // Copies a whole frame into an existing map, prefer getEntitySnapshot on hot paths
+    bool getFrame(const size_t frame, std::map<uint32_t, EntitySnapshot>& frameData) const;
 
 private:
-    std::vector<std::map<uint32_t, EntitySnapshot>> m_frames;
-    
+    static const uint32_t NO_FRAME;
+    static const int32_t NO_SLOT;
+    static const size_t MAX_ENTITY_IDS;
+
+    struct TrackSample {
+        uint32_t frameNumber;
+        EntitySnapshot snapshot;
+    };
+
     size_t m_maxRollbackFrames;
+    size_t m_frameCount;
+    uint32_t m_frameNumber; // Absolute number of the most recent frame
+
+    std::vector<TrackSample> m_tracks; // slot * m_maxRollbackFrames + ring index
+    std::vector<uint32_t> m_slotEntityIDs;
+    std::vector<uint32_t> m_slotLastFrames;
+    std::vector<int32_t> m_freeSlots;
+    std::vector<int32_t> m_entitySlots; // Indexed by 16-bit entity ID
+
+    int32_t getOrCreateSlot(const uint32_t entityID);
+    void releaseStaleSlots();
+    bool getFrameNumber(const size_t frame, uint32_t& frameNumber) const;
+    size_t getRingIndex(const uint32_t frameNumber) const { return frameNumber % m_maxRollbackFrames; }
+};
+
+// Entity view for RaycastUtil::rayCast of the live entities as they were a number of frames ago,
+// read from the frame cache without touching the entities. Entities which are not in that frame
+// and all entities when frame is 0 are at their present position.
+class RollbackEntityView
+{
+public:
+    RollbackEntityView(const std::map<uint32_t, std::shared_ptr<Entity>>& entities,
+                       const FrameCache& frameCache,
+                       const size_t frame)
+    : m_entities(entities)
+    , m_frameCache(frameCache)
+    , m_frame(frame)
+    {}
+
+    template<typename Visitor>
+    void forEach(Visitor&& visit) const
+    {
+        EntitySnapshot pastSnapshot;
+        for (const auto& entityPair : m_entities)
+        {
+            const Entity& entity = *entityPair.second;
+            if (m_frame > 0 &&
+                m_frameCache.getEntitySnapshot(m_frame, entityPair.first, pastSnapshot))
+            {
+                visit(entityPair.first, entity.getEntityType(), cocos2d::Vec2(pastSnapshot.positionX, pastSnapshot.positionY));
+            }
+            else
+            {
+                visit(entityPair.first, entity.getEntityType(), entity.getPosition());
+            }
+        }
+    }
+
+private:
+    const std::map<uint32_t, std::shared_ptr<Entity>>& m_entities;
+    const FrameCache& m_frameCache;
+    const size_t m_frame;
 };
 
 #endif /* FrameCache_h */
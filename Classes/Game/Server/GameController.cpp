@@ -34,7 +34,7 @@ GameController::~GameController()
 
 void GameController::setSnapshot(const SnapshotData& data)
 {
-    auto entities = m_entitiesModel->getEntities();
+    const auto& entities = m_entitiesModel->getEntities();
     for (const auto& entityData : data.entityData)
     {
         if (!entities.count(entityData.first))
@@ -49,7 +49,7 @@ void GameController::setSnapshot(const SnapshotData& data)
         entity->setRotation(entityData.second.rotation);
     }
 
-    auto players = m_entitiesModel->getPlayers();
+    const auto& players = m_entitiesModel->getPlayers();
     for (const auto& playerData : data.playerData)
     {
         if (!players.count(playerData.first))
@@ -192,17 +192,18 @@ void GameController::tick(const float deltaTime)
     m_entitiesController->update(deltaTime);
 }
 
-void GameController::setGameMode(const GameMode::Config& config, const bool host)
+void GameController::setGameMode(const GameMode::Config& config, const bool host, const uint32_t seed)
 {
     m_host = host;
+    m_random.seed(seed);
 
     if (config.type == GameModeType::GAME_MODE_BATTLEROYALE)
     {
-        m_gameMode = std::make_shared<GameModeBR>(m_entitiesController, m_entitiesModel, m_levelModel, 1337);
+        m_gameMode = std::make_shared<GameModeBR>(m_entitiesController, m_entitiesModel, m_levelModel, seed);
     }
     else
     {
-        m_gameMode = std::make_shared<GameModeDM>(m_entitiesController, m_entitiesModel, m_levelModel, 1337);
+        m_gameMode = std::make_shared<GameModeDM>(m_entitiesController, m_entitiesModel, m_levelModel, m_random);
     }
     
     m_gameMode->onLevelLoaded(host);
@@ -211,7 +212,7 @@ void GameController::setGameMode(const GameMode::Config& config, const bool host
 std::shared_ptr<Entity> GameController::getEntityAtPoint(const cocos2d::Vec2& point,
                                                          const uint32_t ignoreEntityID) const
 {
-    auto entities = m_entitiesModel->getEntities();
+    const auto& entities = m_entitiesModel->getEntities();
     for (const auto& entityPair : entities)
     {
         if (entityPair.first == ignoreEntityID)
@@ -4,6 +4,8 @@
 #include "Network/NetworkMessages.h"
 #include "Game/Shared/GameMode.h"
 
+#include <random>
+
 class EntitiesController;
 class EntitiesModel;
 class LevelModel;
@@ -23,10 +25,13 @@ public:
     const std::shared_ptr<EntitiesModel>& getEntitiesModel() const { return m_entitiesModel; }
     const std::shared_ptr<LevelModel>& getLevelModel() const { return m_levelModel; }
 
-    void setGameMode(const GameMode::Config& config, const bool host);
+    // Seeds the match's random engine before the game mode spawns anything with it
+    void setGameMode(const GameMode::Config& config, const bool host, const uint32_t seed);
     const std::shared_ptr<GameMode>& getGameMode() const { return m_gameMode; }
 
     const float getCurrentTime() const { return m_currentTime; }
+    // Spawns, loot and anything else random in the match draws from this, only on the match's own thread
+    std::mt19937& getRandom() { return m_random; }
 
     bool isTileSolid(const cocos2d::Vec2& tilePos) const;
     
@@ -49,6 +54,7 @@ private:
     std::shared_ptr<GameMode> m_gameMode;
     float m_currentTime;
     bool m_host;
+    std::mt19937 m_random;
     
     const bool checkForReload(uint8_t playerID, const std::shared_ptr<ClientInputMessage>& input);
 };
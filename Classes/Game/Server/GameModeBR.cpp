@@ -134,7 +134,7 @@ void GameModeBR::spawnThings()
 
 void GameModeBR::fillDeadTiles()
 {
-    const cocos2d::Size mapSize = m_levelModel->getTileMap()->getMapSize();
+    const cocos2d::Size mapSize = m_levelModel->getMapSizeInTiles();
     const cocos2d::Vec2 centerTile = cocos2d::Vec2((mapSize.width / 2) - 1, (mapSize.height / 2) - 1);
     const int numRings = std::max((mapSize.width / 2), (mapSize.height / 2));
     
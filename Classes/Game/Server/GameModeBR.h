@@ -2,6 +2,7 @@
 #define GameModeBR_h
 
 #include "Game/Shared/GameMode.h"
+#include "math/CCGeometry.h"
 
 class GameModeBR : public GameMode
 {
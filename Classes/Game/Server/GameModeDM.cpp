@@ -9,9 +9,9 @@
 GameModeDM::GameModeDM(std::shared_ptr<EntitiesController> entitiesController,
            std::shared_ptr<EntitiesModel> entitiesModel,
            std::shared_ptr<LevelModel> levelModel,
-           const int seed)
+           std::mt19937& random)
 : GameMode(entitiesController, entitiesModel, levelModel)
-, m_seed(seed)
+, m_random(random)
 , m_maxKills(10)
 , m_maxTime(5.f * 60.f)
 , m_time(0.f)
@@ -81,16 +81,19 @@ void GameModeDM::spawnThings()
     const bool SPAWN_RANDOM_WEAPONS = true;
     if (SPAWN_RANDOM_WEAPONS)
     {
-        const cocos2d::Size scaling = m_levelModel->getTileMap()->getTileSize();
+        const cocos2d::Size scaling = m_levelModel->getTileSize();
         const float CHUNK_SIZE = 16.f;
-        int xChunks = m_levelModel->getTileMap()->getMapSize().width / CHUNK_SIZE;
-        int yChunks = m_levelModel->getTileMap()->getMapSize().height / CHUNK_SIZE;
+        int xChunks = m_levelModel->getMapSizeInTiles().width / CHUNK_SIZE;
+        int yChunks = m_levelModel->getMapSizeInTiles().height / CHUNK_SIZE;
 
         for (int x = 0; x < xChunks; x++)
         {
             for (int y = 0; y < yChunks; y++)
             {
-                const cocos2d::Vec2 random = cocos2d::Vec2(cocos2d::random(-4, 4), cocos2d::random(-4, 4)) * 16.f;
+                std::uniform_int_distribution<int> offset(-4, 4);
+                const int offsetX = offset(m_random);
+                const int offsetY = offset(m_random);
+                const cocos2d::Vec2 random = cocos2d::Vec2(offsetX, offsetY) * 16.f;
                 const cocos2d::Vec2 chunkMiddle = cocos2d::Vec2(CHUNK_SIZE * 0.5f, CHUNK_SIZE * 0.5f);
                 const cocos2d::Vec2 position = (((cocos2d::Vec2(x, y) * CHUNK_SIZE) + chunkMiddle) * scaling.width) + random;
                 spawnRandomGunWithAmmo(position);
@@ -138,7 +141,8 @@ void GameModeDM::spawnThings()
 void GameModeDM::spawnRandomGunWithAmmo(const cocos2d::Vec2& position)
 {
     // TODO: Save in weapon cluster data for respawning after being picked up
-    const int randomWeapon = cocos2d::random((int)EntityType::Item_First_Placeholder + 1, (int)EntityType::Item_Railgun);
+    const int randomWeapon = std::uniform_int_distribution<int>((int)EntityType::Item_First_Placeholder + 1,
+                                                                (int)EntityType::Item_Railgun)(m_random);
     m_entitiesController->createItem(m_entitiesModel->getNextEntityID(),
                                      (EntityType)randomWeapon,
                                      position,
@@ -147,10 +151,13 @@ void GameModeDM::spawnRandomGunWithAmmo(const cocos2d::Vec2& position)
     
     const auto& itemData = EntityDataModel::getStaticEntityData((EntityType)randomWeapon);
         
-    const int randomAmmoCount = cocos2d::random(1, 3);
+    const int randomAmmoCount = std::uniform_int_distribution<int>(1, 3)(m_random);
+    std::uniform_int_distribution<int> offset(-16, 16);
     for (int i = 0; i < randomAmmoCount; i++)
     {
-        const cocos2d::Vec2 random = cocos2d::Vec2(cocos2d::random(-16, 16), cocos2d::random(-16, 16));
+        const int offsetX = offset(m_random);
+        const int offsetY = offset(m_random);
+        const cocos2d::Vec2 random = cocos2d::Vec2(offsetX, offsetY);
 
         m_entitiesController->createItem(m_entitiesModel->getNextEntityID(),
                                      (EntityType)itemData.ammo.type,
@@ -2,7 +2,9 @@
 #define GameModeDM_h
 
 #include "Game/Shared/GameMode.h"
+#include "math/CCGeometry.h"
 #include <stdint.h>
+#include <random>
 
 class GameModeDM : public GameMode
 {
@@ -10,7 +12,7 @@ public:
     GameModeDM(std::shared_ptr<EntitiesController> entitiesController,
                std::shared_ptr<EntitiesModel> entitiesModel,
                std::shared_ptr<LevelModel> levelModel,
-               const int seed);
+               std::mt19937& random);
 
     const GameModeType getType() override { return GameModeType::GAME_MODE_DEATHMATCH; }
 
@@ -24,7 +26,7 @@ public:
     void onPlayerGotAKill(const uint8_t playerID) override;
     
 private:
-    const int m_seed;
+    std::mt19937& m_random; // The match's, owned by the GameController
     const uint32_t m_maxKills;
     const float m_maxTime;
     float m_time;
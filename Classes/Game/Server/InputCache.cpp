@@ -28,9 +28,13 @@ void InputCache::clear()
     m_lastAppliedSequences.clear();
 }
 
-std::map<uint8_t, ServerInput> InputCache::popCombinedInputs()
+void InputCache::popCombinedInputs(std::map<uint8_t, ServerInput>& inputs)
 {
-    std::map<uint8_t, ServerInput> output;
+    // Assigned over last tick's inputs, players who had one then keep their node
+    for (auto& input : inputs)
+    {
+        input.second.clientInput = nullptr;
+    }
     for (auto& input : m_inputs)
     {
         const uint8_t playerID = input.first;
@@ -40,12 +44,22 @@ std::map<uint8_t, ServerInput> InputCache::popCombinedInputs()
             printf("[Server]InputCache:: no input sequence for player %i\n", playerID);
             continue;
         }
-        output[playerID] = playerInputs.front();
+        inputs[playerID] = playerInputs.front();
         playerInputs.pop();
 
-        m_lastAppliedSequences[playerID] = output[playerID].clientInput->inputSequence;
+        m_lastAppliedSequences[playerID] = inputs[playerID].clientInput->inputSequence;
+    }
+    for (auto it = inputs.begin(); it != inputs.end();)
+    {
+        if (!it->second.clientInput)
+        {
+            it = inputs.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
     }
-    return output;
 }
 
 const uint32_t InputCache::getLastReceivedSequence(const uint8_t playerID) const
@@ -3,13 +3,49 @@
 
 #include "Network/NetworkMessages.h"
 #include <map>
-#include <queue>
+#include <vector>
 
 struct ServerInput {
     float gameTime;
     std::shared_ptr<ClientInputMessage> clientInput;
 };
 
+// One player's inputs in the order they arrived, used like a std::queue
+// A deque frees and allocates blocks as inputs move through it, this keeps one vector
+// and only moves the remaining inputs to its start once most of it has been popped
+class ServerInputQueue
+{
+public:
+    ServerInputQueue() : m_front(0) {}
+
+    bool empty() const { return m_front == m_inputs.size(); }
+    size_t size() const { return m_inputs.size() - m_front; }
+    const ServerInput& front() const { return m_inputs[m_front]; }
+    const ServerInput& back() const { return m_inputs.back(); }
+
+    void push(const ServerInput& input) { m_inputs.push_back(input); }
+    void pop()
+    {
+        // The message goes back to its pool once nothing holds it
+        m_inputs[m_front].clientInput = nullptr;
+        m_front++;
+        if (m_front == m_inputs.size())
+        {
+            m_inputs.clear();
+            m_front = 0;
+        }
+        else if (m_front * 2 >= m_inputs.size())
+        {
+            m_inputs.erase(m_inputs.begin(), m_inputs.begin() + m_front);
+            m_front = 0;
+        }
+    }
+
+private:
+    std::vector<ServerInput> m_inputs;
+    size_t m_front;
+};
+
 class InputCache
 {
 public:
@@ -21,9 +57,10 @@ public:
                              const float gameTime);
     void clear();
     
-    std::map<uint8_t, ServerInput> popCombinedInputs();
+    // Fills the map in place with the next input of every player who has one
+    void popCombinedInputs(std::map<uint8_t, ServerInput>& inputs);
 
-    std::map<uint8_t, std::queue<ServerInput>>& getInputData() { return m_inputs; }
+    std::map<uint8_t, ServerInputQueue>& getInputData() { return m_inputs; }
     const uint32_t getLastReceivedSequence(const uint8_t playerID) const;
     const uint32_t getLastReceivedSnapshot(const uint8_t playerID) const;
     const uint32_t getLastAppliedSequence(const uint8_t playerID) const;
@@ -32,7 +69,7 @@ public:
     bool hasReceivedSnapshot(const uint8_t playerID) const { return m_lastReceivedSnapshots.find(playerID) != m_lastReceivedSnapshots.end(); }
 private:
     // PlayerID, Data
-    std::map<uint8_t, std::queue<ServerInput>> m_inputs;
+    std::map<uint8_t, ServerInputQueue> m_inputs;
     std::map<uint8_t, uint32_t> m_lastReceivedSequences;
     std::map<uint8_t, uint32_t> m_lastReceivedSnapshots;
     std::map<uint8_t, uint32_t> m_lastAppliedSequences;
@@ -1,11 +1,12 @@
 #include "Item.h"
 
-Item::Item(const uint16_t entityID,
+Item::Item(EntityStore& store,
+           const uint16_t entityID,
            const EntityType& type)
-: Entity(entityID, type)
-, m_ownerID(entityID)
+: Entity(store, entityID, type)
 , m_amount(0)
 {
+    setOwnerID(entityID);
 }
 
 Item::~Item()
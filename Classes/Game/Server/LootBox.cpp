@@ -1,8 +1,9 @@
 #include "LootBox.h"
 #include "SharedConstants.h"
 
-LootBox::LootBox(const uint16_t entityID)
-: Item(entityID, EntityType::Loot_Box)
+LootBox::LootBox(EntityStore& store,
+                 const uint16_t entityID)
+: Item(store, entityID, EntityType::Loot_Box)
 {
 }
 
@@ -7,7 +7,8 @@
 class LootBox : public Item
 {
 public:
-    LootBox(const uint16_t entityID);
+    LootBox(EntityStore& store,
+            const uint16_t entityID);
 
     std::vector<InventoryItem>& getInventory() { return m_inventory; }
     
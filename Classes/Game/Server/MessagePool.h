@@ -0,0 +1,38 @@
+#ifndef MessagePool_h
+#define MessagePool_h
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Recycles outgoing messages of one type once the network layer has let go of them.
+// Assigning new data into a recycled message reuses the nodes and capacity of its maps
+// and vectors, so sending a snapshot every tick stops allocating once the pool is warm.
+template<typename T>
+class MessagePool
+{
+public:
+    template<typename... Args>
+    std::shared_ptr<T> acquire(Args&&... args)
+    {
+        for (const auto& message : m_messages)
+        {
+            if (message.use_count() == 1)
+            {
+                // The network thread may have just let go, see its last reads before overwriting
+                std::atomic_thread_fence(std::memory_order_acquire);
+                return message; // Only referenced by the pool, safe to overwrite
+            }
+        }
+
+        m_messages.push_back(std::make_shared<T>(std::forward<Args>(args)...));
+        return m_messages.back();
+    }
+
+    void clear() { m_messages.clear(); }
+
+private:
+    std::vector<std::shared_ptr<T>> m_messages;
+};
+
+#endif /* MessagePool_h */
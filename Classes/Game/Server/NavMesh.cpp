@@ -0,0 +1,495 @@
+#include "NavMesh.h"
+
+#include "recast/Detour/DetourAlloc.h"
+#include "recast/Detour/DetourNavMeshBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+const NavMesh::PathRequestID NavMesh::NO_PATH_REQUEST = 0;
+const int NavMesh::TILE_CELLS = 64;
+const int NavMesh::MAX_PATH_POLYS = 256;
+const int NavMesh::MAX_SEARCH_NODES = 4096;
+const int NavMesh::SEARCH_ITERATIONS_PER_UPDATE = 2048;
+const size_t NavMesh::PATH_CACHE_SIZE = 256;
+const float NavMesh::WALL_AREA_COST = 3.f;
+const float NavMesh::CORNER_MARGIN = 6.f;
+
+namespace
+{
+    const unsigned short NO_NEIGHBOUR = 0xffff;
+    const unsigned short PORTAL = 0x8000;
+    // Portal sides as dtCreateNavMeshData expects them
+    const unsigned short PORTAL_X_MIN = 0;
+    const unsigned short PORTAL_Z_MAX = 1;
+    const unsigned short PORTAL_X_MAX = 2;
+    const unsigned short PORTAL_Z_MIN = 3;
+    const unsigned short POLY_FLAG_WALK = 0x01;
+    const int VERTS_PER_POLY = 4;
+}
+
+NavMesh::NavMesh()
+: m_navMesh(nullptr)
+, m_columns(0)
+, m_rows(0)
+, m_nextRequestID(1)
+, m_nextCachedPath(0)
+{
+}
+
+NavMesh::~NavMesh()
+{
+    clear();
+}
+
+bool NavMesh::build(const std::vector<cocos2d::Rect>& staticRects,
+                    const cocos2d::Size& mapSizeInTiles,
+                    const cocos2d::Size& tileSize)
+{
+    clear();
+
+    m_columns = (int)mapSizeInTiles.width;
+    m_rows = (int)mapSizeInTiles.height;
+    m_cellSize = tileSize;
+    if (m_columns <= 0 || m_rows <= 0 ||
+        tileSize.width <= 0.f || tileSize.height <= 0.f)
+    {
+        return false;
+    }
+
+    m_solidCells.assign(m_columns * m_rows, 0);
+    for (const cocos2d::Rect& rect : staticRects)
+    {
+        const int minColumn = std::max((int)std::floor(rect.getMinX() / tileSize.width), 0);
+        const int maxColumn = std::min((int)std::ceil(rect.getMaxX() / tileSize.width), m_columns);
+        const int minRow = std::max((int)std::floor(rect.getMinY() / tileSize.height), 0);
+        const int maxRow = std::min((int)std::ceil(rect.getMaxY() / tileSize.height), m_rows);
+        for (int row = minRow; row < maxRow; row++)
+        {
+            for (int column = minColumn; column < maxColumn; column++)
+            {
+                const cocos2d::Vec2 center = cocos2d::Vec2((column + 0.5f) * tileSize.width,
+                                                           (row + 0.5f) * tileSize.height);
+                if (rect.containsPoint(center))
+                {
+                    m_solidCells[column + row * m_columns] = 1;
+                }
+            }
+        }
+    }
+
+    const int tilesX = (m_columns + TILE_CELLS - 1) / TILE_CELLS;
+    const int tilesY = (m_rows + TILE_CELLS - 1) / TILE_CELLS;
+    dtNavMeshParams params;
+    params.orig[0] = 0.f;
+    params.orig[1] = 0.f;
+    params.orig[2] = 0.f;
+    params.tileWidth = TILE_CELLS * tileSize.width;
+    params.tileHeight = TILE_CELLS * tileSize.height;
+    params.maxTiles = tilesX * tilesY;
+    params.maxPolys = TILE_CELLS * TILE_CELLS;
+
+    m_navMesh = dtAllocNavMesh();
+    if (!m_navMesh ||
+        dtStatusFailed(m_navMesh->init(&params)))
+    {
+        printf("[Server]NavMesh::build failed to init the nav mesh\n");
+        clear();
+        return false;
+    }
+
+    for (int tileY = 0; tileY < tilesY; tileY++)
+    {
+        for (int tileX = 0; tileX < tilesX; tileX++)
+        {
+            if (!buildTile(tileX, tileY))
+            {
+                printf("[Server]NavMesh::build failed to build tile %i,%i\n", tileX, tileY);
+                clear();
+                return false;
+            }
+        }
+    }
+
+    if (!m_pathQueue.init(MAX_PATH_POLYS, MAX_SEARCH_NODES, m_navMesh))
+    {
+        printf("[Server]NavMesh::build failed to init the path queue\n");
+        clear();
+        return false;
+    }
+    m_filter.setAreaCost(AREA_GROUND, 1.f);
+    m_filter.setAreaCost(AREA_WALL_EDGE, WALL_AREA_COST);
+    m_pathCache.resize(PATH_CACHE_SIZE);
+    for (CachedPath& cachedPath : m_pathCache)
+    {
+        cachedPath.startRef = 0;
+        cachedPath.path.reserve(MAX_PATH_POLYS);
+    }
+    m_nextCachedPath = 0;
+
+    printf("[Server]NavMesh::build %ix%i tiles in %ix%i nav tiles\n", m_columns, m_rows, tilesX, tilesY);
+    return true;
+}
+
+void NavMesh::clear()
+{
+    if (m_navMesh)
+    {
+        dtFreeNavMesh(m_navMesh);
+        m_navMesh = nullptr;
+    }
+    m_solidCells.clear();
+    m_columns = 0;
+    m_rows = 0;
+    m_requests.clear();
+    m_pathCache.clear();
+    m_nextCachedPath = 0;
+}
+
+void NavMesh::toNavPosition(const cocos2d::Vec2& position, float* navPosition)
+{
+    navPosition[0] = position.x;
+    navPosition[1] = 0.f;
+    navPosition[2] = position.y;
+}
+
+cocos2d::Vec2 NavMesh::fromNavPosition(const float* navPosition)
+{
+    return cocos2d::Vec2(navPosition[0], navPosition[2]);
+}
+
+cocos2d::Vec2 NavMesh::getSteeringPoint(const cocos2d::Vec2& corner) const
+{
+    if (m_columns == 0)
+    {
+        return corner;
+    }
+
+    // Path corners other than the end sit on tile corners
+    const int column = (int)std::round(corner.x / m_cellSize.width);
+    const int row = (int)std::round(corner.y / m_cellSize.height);
+    const cocos2d::Vec2 vertex = cocos2d::Vec2(column * m_cellSize.width, row * m_cellSize.height);
+    if (vertex.distanceSquared(corner) > 0.25f)
+    {
+        return corner;
+    }
+
+    cocos2d::Vec2 away = cocos2d::Vec2::ZERO;
+    for (int cellRow = row - 1; cellRow <= row; cellRow++)
+    {
+        for (int cellColumn = column - 1; cellColumn <= column; cellColumn++)
+        {
+            if (isCellSolid(cellColumn, cellRow))
+            {
+                const cocos2d::Vec2 cellCenter = cocos2d::Vec2((cellColumn + 0.5f) * m_cellSize.width,
+                                                               (cellRow + 0.5f) * m_cellSize.height);
+                away += (vertex - cellCenter);
+            }
+        }
+    }
+    if (away == cocos2d::Vec2::ZERO)
+    {
+        return corner;
+    }
+    return corner + away.getNormalized() * CORNER_MARGIN;
+}
+
+NavMesh::PathRequestID NavMesh::requestPath(const dtPolyRef startRef,
+                                            const cocos2d::Vec2& start,
+                                            const dtPolyRef endRef,
+                                            const cocos2d::Vec2& end)
+{
+    if (!m_navMesh || !startRef || !endRef)
+    {
+        return NO_PATH_REQUEST;
+    }
+
+    const PathRequestID requestID = m_nextRequestID;
+    const CachedPath* cachedPath = findCachedPath(startRef, endRef);
+    if (cachedPath)
+    {
+        PathRequest& request = addRequest(requestID);
+        request.queueRef = DT_PATHQ_INVALID;
+        request.path = cachedPath->path;
+    }
+    else
+    {
+        float startPosition[3];
+        float endPosition[3];
+        toNavPosition(start, startPosition);
+        toNavPosition(end, endPosition);
+        const dtPathQueueRef queueRef = m_pathQueue.request(startRef, endRef, startPosition, endPosition, &m_filter);
+        if (queueRef == DT_PATHQ_INVALID)
+        {
+            return NO_PATH_REQUEST; // Queue is full, the search budget is spent on the ones already in it
+        }
+        PathRequest& request = addRequest(requestID);
+        request.queueRef = queueRef;
+        request.startRef = startRef;
+        request.endRef = endRef;
+    }
+
+    m_nextRequestID++;
+    if (m_nextRequestID == NO_PATH_REQUEST)
+    {
+        m_nextRequestID++;
+    }
+    return requestID;
+}
+
+NavMesh::PathStatus NavMesh::getPathResult(const PathRequestID requestID, std::vector<dtPolyRef>& path)
+{
+    PathRequest* request = findRequest(requestID);
+    if (!request)
+    {
+        return PATH_FAILED;
+    }
+    if (request->queueRef == DT_PATHQ_INVALID)
+    {
+        path = request->path;
+        request->requestID = NO_PATH_REQUEST;
+        return PATH_READY;
+    }
+
+    const dtStatus status = m_pathQueue.getRequestStatus(request->queueRef);
+    if (status == 0 || // Not started yet
+        dtStatusInProgress(status))
+    {
+        return PATH_PENDING;
+    }
+
+    // Reading the result frees the queue slot, failed searches included
+    int pathCount = 0;
+    path.resize(MAX_PATH_POLYS);
+    m_pathQueue.getPathResult(request->queueRef, path.data(), &pathCount, MAX_PATH_POLYS);
+    if (dtStatusFailed(status))
+    {
+        pathCount = 0;
+    }
+    path.resize(pathCount);
+    if (pathCount > 0 &&
+        !dtStatusDetail(status, DT_PARTIAL_RESULT))
+    {
+        cachePath(request->startRef, request->endRef, path);
+    }
+    request->requestID = NO_PATH_REQUEST;
+    return pathCount > 0 ? PATH_READY : PATH_FAILED;
+}
+
+void NavMesh::update()
+{
+    if (!m_navMesh)
+    {
+        return;
+    }
+
+    m_pathQueue.update(SEARCH_ITERATIONS_PER_UPDATE);
+
+    // The queue only keeps results for a couple of updates, drop requests nobody picked up in time
+    for (PathRequest& request : m_requests)
+    {
+        if (request.requestID != NO_PATH_REQUEST &&
+            request.queueRef != DT_PATHQ_INVALID &&
+            dtStatusFailed(m_pathQueue.getRequestStatus(request.queueRef)))
+        {
+            request.requestID = NO_PATH_REQUEST;
+        }
+    }
+}
+
+bool NavMesh::isCellSolid(const int column, const int row) const
+{
+    if (column < 0 || column >= m_columns ||
+        row < 0 || row >= m_rows)
+    {
+        return true; // Nothing to walk on outside the map
+    }
+    return m_solidCells[column + row * m_columns] != 0;
+}
+
+bool NavMesh::buildTile(const int tileX, const int tileY)
+{
+    const int firstColumn = tileX * TILE_CELLS;
+    const int firstRow = tileY * TILE_CELLS;
+    const int columns = std::min(TILE_CELLS, m_columns - firstColumn);
+    const int rows = std::min(TILE_CELLS, m_rows - firstRow);
+    const int tileWidth = (int)m_cellSize.width;
+    const int tileHeight = (int)m_cellSize.height;
+
+    // Vertices in whole world units from the tile's origin, polygons share them with their neighbours
+    std::vector<unsigned short> verts;
+    verts.reserve((columns + 1) * (rows + 1) * 3);
+    for (int row = 0; row <= rows; row++)
+    {
+        for (int column = 0; column <= columns; column++)
+        {
+            verts.push_back((unsigned short)(column * tileWidth));
+            verts.push_back(0);
+            verts.push_back((unsigned short)(row * tileHeight));
+        }
+    }
+    auto vertexIndex = [columns](const int column, const int row) {
+        return (unsigned short)(column + row * (columns + 1));
+    };
+
+    std::vector<int> polyIndices(columns * rows, -1);
+    int polyCount = 0;
+    for (int row = 0; row < rows; row++)
+    {
+        for (int column = 0; column < columns; column++)
+        {
+            if (!isCellSolid(firstColumn + column, firstRow + row))
+            {
+                polyIndices[column + row * columns] = polyCount++;
+            }
+        }
+    }
+    if (polyCount == 0)
+    {
+        return true; // Solid all the way through, nothing to add
+    }
+
+    // Neighbour of an edge: a polygon in this tile, a portal to the next tile or a wall
+    auto getNeighbour = [&](const int column, const int row, const unsigned short portalSide) -> unsigned short {
+        if (isCellSolid(firstColumn + column, firstRow + row))
+        {
+            return NO_NEIGHBOUR;
+        }
+        if (column < 0 || column >= columns ||
+            row < 0 || row >= rows)
+        {
+            return PORTAL | portalSide;
+        }
+        return (unsigned short)polyIndices[column + row * columns];
+    };
+
+    std::vector<unsigned short> polys(polyCount * VERTS_PER_POLY * 2, NO_NEIGHBOUR);
+    std::vector<unsigned short> polyFlags(polyCount, POLY_FLAG_WALK);
+    std::vector<unsigned char> polyAreas(polyCount, AREA_GROUND);
+    for (int row = 0; row < rows; row++)
+    {
+        for (int column = 0; column < columns; column++)
+        {
+            const int polyIndex = polyIndices[column + row * columns];
+            if (polyIndex < 0)
+            {
+                continue;
+            }
+
+            // Clockwise seen from above like Recast's polygons, edge i runs from vertex i to vertex i + 1
+            unsigned short* poly = &polys[polyIndex * VERTS_PER_POLY * 2];
+            poly[0] = vertexIndex(column, row);
+            poly[1] = vertexIndex(column, row + 1);
+            poly[2] = vertexIndex(column + 1, row + 1);
+            poly[3] = vertexIndex(column + 1, row);
+            poly[VERTS_PER_POLY + 0] = getNeighbour(column - 1, row, PORTAL_X_MIN);
+            poly[VERTS_PER_POLY + 1] = getNeighbour(column, row + 1, PORTAL_Z_MAX);
+            poly[VERTS_PER_POLY + 2] = getNeighbour(column + 1, row, PORTAL_X_MAX);
+            poly[VERTS_PER_POLY + 3] = getNeighbour(column, row - 1, PORTAL_Z_MIN);
+
+            for (int neighbourRow = row - 1; neighbourRow <= row + 1; neighbourRow++)
+            {
+                for (int neighbourColumn = column - 1; neighbourColumn <= column + 1; neighbourColumn++)
+                {
+                    if (isCellSolid(firstColumn + neighbourColumn, firstRow + neighbourRow))
+                    {
+                        polyAreas[polyIndex] = AREA_WALL_EDGE;
+                    }
+                }
+            }
+        }
+    }
+
+    dtNavMeshCreateParams params;
+    memset(&params, 0, sizeof(params));
+    params.verts = verts.data();
+    params.vertCount = (int)verts.size() / 3;
+    params.polys = polys.data();
+    params.polyFlags = polyFlags.data();
+    params.polyAreas = polyAreas.data();
+    params.polyCount = polyCount;
+    params.nvp = VERTS_PER_POLY;
+    params.tileX = tileX;
+    params.tileY = tileY;
+    params.bmin[0] = firstColumn * m_cellSize.width;
+    params.bmin[1] = 0.f;
+    params.bmin[2] = firstRow * m_cellSize.height;
+    params.bmax[0] = params.bmin[0] + columns * tileWidth;
+    params.bmax[1] = 1.f;
+    params.bmax[2] = params.bmin[2] + rows * tileHeight;
+    params.walkableHeight = 1.f;
+    params.walkableRadius = 0.f;
+    params.walkableClimb = 1.f;
+    params.cs = 1.f;
+    params.ch = 1.f;
+    params.buildBvTree = true;
+
+    unsigned char* data = nullptr;
+    int dataSize = 0;
+    if (!dtCreateNavMeshData(&params, &data, &dataSize))
+    {
+        return false;
+    }
+    if (dtStatusFailed(m_navMesh->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, nullptr)))
+    {
+        dtFree(data);
+        return false;
+    }
+    return true;
+}
+
+NavMesh::PathRequest* NavMesh::findRequest(const PathRequestID requestID)
+{
+    // One request per bot at most, a search through them is cheaper than keeping an index
+    for (PathRequest& request : m_requests)
+    {
+        if (request.requestID == requestID)
+        {
+            return &request;
+        }
+    }
+    return nullptr;
+}
+
+NavMesh::PathRequest& NavMesh::addRequest(const PathRequestID requestID)
+{
+    PathRequest* request = findRequest(NO_PATH_REQUEST);
+    if (!request)
+    {
+        m_requests.push_back(PathRequest());
+        request = &m_requests.back();
+        request->path.reserve(MAX_PATH_POLYS);
+    }
+    request->requestID = requestID;
+    return *request;
+}
+
+const NavMesh::CachedPath* NavMesh::findCachedPath(const dtPolyRef startRef, const dtPolyRef endRef) const
+{
+    for (const CachedPath& cachedPath : m_pathCache)
+    {
+        if (cachedPath.startRef == startRef &&
+            cachedPath.endRef == endRef)
+        {
+            return &cachedPath;
+        }
+    }
+    return nullptr;
+}
+
+void NavMesh::cachePath(const dtPolyRef startRef,
+                        const dtPolyRef endRef,
+                        const std::vector<dtPolyRef>& path)
+{
+    if (m_pathCache.empty() ||
+        findCachedPath(startRef, endRef))
+    {
+        return;
+    }
+    CachedPath& cachedPath = m_pathCache[m_nextCachedPath];
+    cachedPath.startRef = startRef;
+    cachedPath.endRef = endRef;
+    cachedPath.path = path;
+    m_nextCachedPath = (m_nextCachedPath + 1) % m_pathCache.size();
+}
@@ -0,0 +1,109 @@
+#ifndef NavMesh_h
+#define NavMesh_h
+
+#include "math/CCGeometry.h"
+#include "recast/Detour/DetourNavMesh.h"
+#include "recast/Detour/DetourNavMeshQuery.h"
+#include "recast/DetourCrowd/DetourPathQueue.h"
+
+#include <vector>
+
+// Detour navigation mesh over the walkable tiles of a level, one square polygon per tile.
+// The level's x and y become Detour's x and z, height is always zero.
+// Tiles touching a wall cost more to cross so paths keep off the walls where there is room.
+// Path searches are queued and advanced a bounded number of iterations per tick,
+// finished paths are cached by their start and end polygons.
+class NavMesh
+{
+public:
+    typedef uint32_t PathRequestID;
+    static const PathRequestID NO_PATH_REQUEST;
+
+    enum PathStatus {
+        PATH_PENDING,
+        PATH_READY,
+        PATH_FAILED
+    };
+
+    NavMesh();
+    ~NavMesh();
+
+    // Tiles are walkable unless the center of the tile lies in one of the static rects
+    bool build(const std::vector<cocos2d::Rect>& staticRects,
+               const cocos2d::Size& mapSizeInTiles,
+               const cocos2d::Size& tileSize);
+    void clear();
+    bool isBuilt() const { return m_navMesh != nullptr; }
+
+    const dtNavMesh* getNavMesh() const { return m_navMesh; }
+    const dtQueryFilter& getFilter() const { return m_filter; }
+
+    static void toNavPosition(const cocos2d::Vec2& position, float* navPosition);
+    static cocos2d::Vec2 fromNavPosition(const float* navPosition);
+    // Pushes a path corner off the wall corners it touches, bots steering at it then don't catch the wall
+    cocos2d::Vec2 getSteeringPoint(const cocos2d::Vec2& corner) const;
+
+    // Main thread only. A cached path is ready right away, otherwise the search is queued.
+    // NO_PATH_REQUEST when the queue is full or a point is off the mesh, ask again next tick.
+    PathRequestID requestPath(const dtPolyRef startRef,
+                              const cocos2d::Vec2& start,
+                              const dtPolyRef endRef,
+                              const cocos2d::Vec2& end);
+    // Results stay available until fetched, at most for a couple of updates once searched
+    // Copied into path, which doesn't allocate once it has room for the longest path
+    PathStatus getPathResult(const PathRequestID requestID, std::vector<dtPolyRef>& path);
+    // Advances queued searches by the per tick budget, main thread only
+    void update();
+
+private:
+    static const int TILE_CELLS;
+    static const int MAX_PATH_POLYS;
+    static const int MAX_SEARCH_NODES;
+    static const int SEARCH_ITERATIONS_PER_UPDATE;
+    static const size_t PATH_CACHE_SIZE;
+    static const float WALL_AREA_COST;
+    static const float CORNER_MARGIN;
+
+    enum AreaType {
+        AREA_GROUND = 0,
+        AREA_WALL_EDGE = 1
+    };
+
+    // Slots are reused and their paths keep room for the longest one, requests don't allocate
+    struct PathRequest {
+        PathRequestID requestID; // NO_PATH_REQUEST while the slot is free
+        dtPathQueueRef queueRef; // DT_PATHQ_INVALID once the path is ready
+        dtPolyRef startRef;
+        dtPolyRef endRef;
+        std::vector<dtPolyRef> path;
+    };
+    struct CachedPath {
+        dtPolyRef startRef; // Zero while the entry is unused
+        dtPolyRef endRef;
+        std::vector<dtPolyRef> path;
+    };
+
+    dtNavMesh* m_navMesh;
+    dtPathQueue m_pathQueue;
+    dtQueryFilter m_filter;
+    std::vector<uint8_t> m_solidCells; // Row major from the bottom, same as the world's y
+    int m_columns;
+    int m_rows;
+    cocos2d::Size m_cellSize;
+
+    PathRequestID m_nextRequestID;
+    std::vector<PathRequest> m_requests;
+    std::vector<CachedPath> m_pathCache; // Filled in order, the oldest is overwritten once it's full
+    size_t m_nextCachedPath;
+
+    bool isCellSolid(const int column, const int row) const;
+    bool buildTile(const int tileX, const int tileY);
+    PathRequest* findRequest(const PathRequestID requestID);
+    PathRequest& addRequest(const PathRequestID requestID);
+    const CachedPath* findCachedPath(const dtPolyRef startRef, const dtPolyRef endRef) const;
+    void cachePath(const dtPolyRef startRef,
+                   const dtPolyRef endRef,
+                   const std::vector<dtPolyRef>& path);
+};
+
+#endif /* NavMesh_h */
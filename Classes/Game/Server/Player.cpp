@@ -2,8 +2,9 @@
 #include "SharedConstants.h"
 #include "EntityDataModel.h"
 
-Player::Player(const uint16_t entityID)
-: Entity(entityID, EntityType::PlayerEntity)
+Player::Player(EntityStore& store,
+               const uint16_t entityID)
+: Entity(store, entityID, EntityType::PlayerEntity)
 , m_lastActionTime(0.f)
 , m_health(PLAYER_DEFAULT_HEALTH)
 , m_animationState(Idle)
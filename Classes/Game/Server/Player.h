@@ -7,7 +7,8 @@
 class Player : public Entity
 {
 public:
-    Player(const uint16_t entityID);
+    Player(EntityStore& store,
+           const uint16_t entityID);
     
     const uint8_t getPlayerID() const { return m_playerID; }
     void setPlayerID(const uint8_t playerID) { m_playerID = playerID; }
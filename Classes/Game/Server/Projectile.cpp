@@ -1,12 +1,12 @@
 #include "Projectile.h"
 
 
-Projectile::Projectile(const uint16_t entityID,
+Projectile::Projectile(EntityStore& store,
+                       const uint16_t entityID,
                        const EntityType& type)
-: Entity(entityID, type)
-, m_spawnTime(0)
-, m_ownerID(0)
+: Entity(store, entityID, type)
 {
+    setSpawnTime(0.f);
 }
 
 Projectile::~Projectile()
@@ -6,19 +6,16 @@
 class Projectile : public Entity
 {
 public:
-    Projectile(const uint16_t entityID,
+    Projectile(EntityStore& store,
+               const uint16_t entityID,
                const EntityType& type);
     ~Projectile();
     
-    float getSpawnTime() const { return m_spawnTime; }
-    void setSpawnTime(const float time) { m_spawnTime = time; }
+    float getSpawnTime() const { return m_store.getSpawnTime(m_entityID); }
+    void setSpawnTime(const float time) { m_store.setSpawnTime(m_entityID, time); }
 
-    uint8_t getOwnerID() const { return m_ownerID; }
-    void setOwnerID(const uint8_t ownerID) { m_ownerID = ownerID; }
-
-private:
-    float m_spawnTime;
-    uint8_t m_ownerID;
+    uint8_t getOwnerID() const { return (uint8_t)m_store.getOwnerID(m_entityID); }
+    void setOwnerID(const uint8_t ownerID) { m_store.setOwnerID(m_entityID, ownerID); }
 };
 
 
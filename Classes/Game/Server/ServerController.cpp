@@ -6,14 +6,15 @@
 #include "Entity.h"
 #include "EntityDataModel.h"
 #include "FrameCache.h"
-#include "Game/Client/InputModel.h"
 #include "GameController.h"
 #include "GameModel.h"
 #include "InputCache.h"
 #include "Item.h"
+#include "JobSystem.h"
 #include "LevelModel.h"
 #include "LootBox.h"
 #include "NetworkController.h"
+#include "PacketPool.h"
 #include "Player.h"
 #include "Projectile.h"
 #include "ReliabilitySystem.h"
@@ -21,6 +22,8 @@
 #include "WeaponConstants.h"
 
 #include <algorithm>
+#include <chrono>
+#include <limits>
 #include <random>
 
 ServerController::ServerController(std::shared_ptr<GameController> gameController,
@@ -28,16 +31,23 @@ ServerController::ServerController(std::shared_ptr<GameController> gameControlle
                                    std::shared_ptr<GameModel> gameModel,
                                    std::shared_ptr<INetworkController> networkController,
                                    std::shared_ptr<FrameCache> frameCache,
-                                   std::shared_ptr<InputCache> inputCache)
+                                   std::shared_ptr<InputCache> inputCache,
+                                   std::shared_ptr<JobSystem> jobSystem)
 : m_gameController(gameController)
 , m_levelModel(levelModel)
 , m_gameModel(gameModel)
 , m_networkController(networkController)
 , m_inputCache(inputCache)
 , m_frameCache(frameCache)
+, m_jobSystem(jobSystem)
 , m_maxPingThreshold(0.5f) // TODO: Set a reasonable threshold value
-, m_sendDeltaUpdates(false)
+, m_relevancyRadius(SNAPSHOT_RELEVANCY_RADIUS)
+, m_snapshotEncoding(SNAPSHOT_ENCODING_RAW)
+, m_sendDeltaUpdates(true)
 , m_gameOverTimer(-1.f)
+, m_stopped(false)
+, m_rollbackFrames(0)
+, m_aiScheduler(AI_THINK_BUDGET)
 {    
     m_networkController->addMessageCallback(MessageTypes::MESSAGE_TYPE_CLIENT_STATE_UPDATE,
                                             std::bind(&ServerController::onClientStateMessageReceived, this,
@@ -54,6 +64,29 @@ ServerController::ServerController(std::shared_ptr<GameController> gameControlle
     m_gameController->getGameMode()->setWinConditionReachedCallback(std::bind(&ServerController::onGameModeWinConditionReached, this,
                                                                               std::placeholders::_1));
     m_frameCache->setMaxRollbackFrames((m_maxPingThreshold / m_gameModel->getFrameTime()) + DEFAULT_CLIENT_TICKS_BUFFERED);
+    m_collisionGrid.setup(cocos2d::Rect(cocos2d::Vec2::ZERO, m_levelModel->getMapSize()), COLLISION_GRID_CELL_SIZE);
+    m_collisionGrid.setStaticRects(m_levelModel->getStaticRects());
+    m_navMesh.build(m_levelModel->getStaticRects(), m_levelModel->getMapSizeInTiles(), m_levelModel->getTileSize());
+    // The whole level starts out as the safe zone, tiles drop out of it as they die
+    m_safeZoneField.setup(*m_levelModel);
+    std::vector<std::pair<int, int>> zoneTiles;
+    for (int row = 0; row < (int)m_levelModel->getMapSizeInTiles().height; row++)
+    {
+        for (int column = 0; column < (int)m_levelModel->getMapSizeInTiles().width; column++)
+        {
+            zoneTiles.push_back({column, row});
+        }
+    }
+    m_safeZoneField.setSources(zoneTiles);
+    // Quantize entity state against the map bounds unless a different encoding gets set
+    m_snapshotEncoding = { true,
+                           m_levelModel->getMapSize().width,
+                           m_levelModel->getMapSize().height,
+                           SNAPSHOT_POSITION_RESOLUTION,
+                           SNAPSHOT_ROTATION_BITS };
+    m_frameHitData.reserve(SNAPSHOT_HIT_CAPACITY);
+    m_gameController->getEntitiesModel()->setupSpatialIndex(cocos2d::Rect(cocos2d::Vec2::ZERO, m_levelModel->getMapSize()),
+                                                            RELEVANCY_GRID_CELL_SIZE);
 
     CCLOG("[Server]ServerController:: constructor: %p", this);
 }
@@ -108,6 +141,7 @@ void ServerController::update(float deltaTime)
 
 void ServerController::stop()
 {
+    m_networkController->stopIOThread();
     m_inputCache->clear();
     m_networkController->removeMessageCallback(MessageTypes::MESSAGE_TYPE_CLIENT_STATE_UPDATE);
     m_networkController->removeMessageCallback(MessageTypes::MESSAGE_TYPE_CLIENT_INPUT);
@@ -119,11 +153,28 @@ void ServerController::stop()
     }
     m_networkController->terminate();
     
-    m_preRollbackState.clear();
+    m_rollbackFrames = 0;
     m_clientData.clear();
     m_clientSnapshots.clear();
+    m_entityPriorities.clear();
+    m_snapshotScratch.clear();
+    m_snapshotJobs.clear();
+    m_spectatedPlayers.clear();
+    m_worldState.clear();
+    m_outgoingPlayerData.clear();
+    m_outgoingSnapshots.clear();
+    m_snapshotMessages.clear();
+    m_snapshotDiffMessages.clear();
     m_frameHitData.clear();
     m_botPlayers.clear();
+    m_botUpdates.clear();
+    m_thinkingBots.clear();
+    m_navMesh.clear();
+    m_chaseFields.clear();
+    m_chaseFieldTicks.clear();
+    m_chasedEntityIDs.clear();
+    m_chaseFieldJobs.clear();
+    m_stopped = true;
 }
 
 const std::string ServerController::getDebugInfo() const
@@ -132,17 +183,27 @@ const std::string ServerController::getDebugInfo() const
     
     const std::string input0 = inputs[0].size() ? std::to_string(inputs[0].back().clientInput->inputSequence) : "x";
     const std::string input1 = inputs[1].size() ? std::to_string(inputs[1].back().clientInput->inputSequence) : "x";
+    const Net::PacketPool::Stats packetStats = Net::PacketPool::getDefault().getStats();
     return "Server Tick:" + std::to_string(m_gameModel->getCurrentTick()) + "Inputs P0: " + std::to_string(inputs[0].size()) + "/" + input0 +
-                        " P1: " + std::to_string(inputs[1].size()) + "/" + input1;
+                        " P1: " + std::to_string(inputs[1].size()) + "/" + input1 +
+                        " Packets: " + std::to_string(packetStats.inUse) + "/" + std::to_string(packetStats.highWaterMark) +
+                        "/" + std::to_string(packetStats.capacity) + " heap: " + std::to_string(packetStats.heapFallbacks) +
+                        " AI think: " + std::to_string((int)m_aiScheduler.getAverageThinkTime()) + "us";
 }
 
 void ServerController::performGameUpdate(const float deltaTime)
 {
     // Check for unprocessed inputs
-    const auto inputData = m_inputCache->popCombinedInputs(); // map of inputs
+    m_inputCache->popCombinedInputs(m_tickInputData);
+    const auto& inputData = m_tickInputData;
     const auto& players = m_gameController->getEntitiesModel()->getPlayers();
-    std::map<uint8_t, std::shared_ptr<ClientInputMessage>> inputs;
-    for (auto pair : inputData) // first == playerID, second == inputs
+    // Kept between ticks so players sending inputs every tick keep their nodes, the rest are dropped below
+    auto& inputs = m_tickInputs;
+    for (auto& input : inputs)
+    {
+        input.second = nullptr;
+    }
+    for (const auto& pair : inputData) // first == playerID, second == inputs
     {
         const uint8_t playerID = pair.first;
         auto playerIt = players.find(playerID);
@@ -174,18 +235,29 @@ void ServerController::performGameUpdate(const float deltaTime)
         
         if (rollbackRequired) // Reset world to server state
         {
-            m_gameController->getEntitiesModel()->setSnapshot(m_preRollbackState);
+            restoreRollbackState();
+        }
+    }
+    for (auto it = inputs.begin(); it != inputs.end();)
+    {
+        if (!it->second)
+        {
+            it = inputs.erase(it);
+        }
+        else
+        {
+            ++it;
         }
     }
                     
     m_gameController->applyInputs(inputs);
 
-    std::map<uint32_t, EntitySnapshot> worldState = m_gameController->getEntitiesModel()->getSnapshot();
+    m_gameController->getEntitiesModel()->getSnapshot(m_worldState);
     
     integratePositions(m_gameModel->getFrameTime(),
-                       worldState,
+                       m_worldState,
                        m_levelModel->getStaticRects());
-    m_gameController->getEntitiesModel()->setSnapshot(worldState);
+    m_gameController->getEntitiesModel()->setSnapshot(m_worldState);
     
     m_gameController->tick(m_gameModel->getFrameTime());
 
@@ -193,7 +265,7 @@ void ServerController::performGameUpdate(const float deltaTime)
     removeExpiredEntities();
         
     // Save state after simulating
-    m_frameCache->takeFrameSnapshot(worldState);
+    m_frameCache->takeFrameSnapshot(m_worldState);
 }
 
 void ServerController::checkForShots(uint8_t playerID, const std::shared_ptr<ClientInputMessage>& input)
@@ -206,7 +278,7 @@ void ServerController::checkForShots(uint8_t playerID, const std::shared_ptr<Cli
         return;
     }
     
-    auto itemData = EntityDataModel::getStaticEntityData(heldItemType);
+    const auto& itemData = EntityDataModel::getStaticEntityData(heldItemType);
     float shotDelay = itemData.weapon.timeShot;
     const size_t ammo = weapon.amount;
     const bool canFire = (player->getLastActionTime() < 0.f ||
@@ -284,8 +356,10 @@ const RayElement ServerController::fireHitScanWeapon(const cocos2d::Vec2& shotSt
     RayElement raycastResult = RaycastUtil::rayCast(shotStart,
                                                     shotEnd,
                                                     entityID,
-                                                    m_gameController->getEntitiesModel()->getEntities(),
-                                                    m_gameController->getLevelModel()->getStaticRects());
+                                                    RollbackEntityView(m_gameController->getEntitiesModel()->getEntities(),
+                                                                       *m_frameCache,
+                                                                       m_rollbackFrames),
+                                                    *m_gameController->getLevelModel());
     if (raycastResult.hitEntityID != 0)
     {
         auto hitEntity = m_gameController->getEntitiesModel()->getEntities().at(raycastResult.hitEntityID);
@@ -325,8 +399,10 @@ void ServerController::checkForInteraction(uint8_t playerID, const std::shared_p
         RayElement raycastResult = RaycastUtil::rayCast(playerPosition,
                                                         aimPosition,
                                                         player->getEntityID(),
-                                                        m_gameController->getEntitiesModel()->getEntities(),
-                                                        m_gameController->getLevelModel()->getStaticRects());
+                                                        RollbackEntityView(m_gameController->getEntitiesModel()->getEntities(),
+                                                                           *m_frameCache,
+                                                                           m_rollbackFrames),
+                                                        *m_gameController->getLevelModel());
         if (raycastResult.hitEntityID == 0)
         {
             return;
@@ -346,23 +422,38 @@ void ServerController::checkForInteraction(uint8_t playerID, const std::shared_p
 
 void ServerController::removeExpiredEntities()
 {
-    const auto& entities = m_gameController->getEntitiesModel()->getEntities();
-    for (auto entityPair : entities)
+    // Only entities with a spawn time expire, destroying them can spawn loot so they're collected first
+    const EntityStore& store = m_gameController->getEntitiesModel()->getStore();
+    const std::vector<uint16_t>& entityIDs = store.getEntityIDs();
+    const std::vector<uint8_t>& types = store.getTypes();
+    const std::vector<float>& spawnTimes = store.getSpawnTimes();
+    const float currentTime = m_gameModel->getCurrentTime();
+    m_expiredEntityIDs.clear();
+    for (size_t i = 0; i < entityIDs.size(); i++)
     {
-        const auto projectile = std::dynamic_pointer_cast<Projectile>(entityPair.second);
-        if (!projectile)
+        if (spawnTimes[i] == EntityStore::NO_SPAWN_TIME)
         {
             continue;
         }
-        
-        auto itemData = EntityDataModel::getStaticEntityData(projectile->getEntityType());
-        const float expireTime = projectile->getSpawnTime() + itemData.weapon.timeReload;
-        if (expireTime > m_gameModel->getCurrentTime())
+        const auto& itemData = EntityDataModel::getStaticEntityData((EntityType)types[i]);
+        if (spawnTimes[i] + itemData.weapon.timeReload <= currentTime)
+        {
+            m_expiredEntityIDs.push_back(entityIDs[i]);
+        }
+    }
+    
+    const auto& entities = m_gameController->getEntitiesModel()->getEntities();
+    for (const uint16_t entityID : m_expiredEntityIDs)
+    {
+        auto it = entities.find(entityID);
+        if (it == entities.end())
         {
             continue;
         }
-        
-        onProjectileDestroyed(projectile);
+        if (const auto projectile = std::dynamic_pointer_cast<Projectile>(it->second))
+        {
+            onProjectileDestroyed(projectile);
+        }
     }
 }
 
@@ -540,7 +631,7 @@ bool ServerController::onProjectileHit(const std::shared_ptr<Entity>& entity,
         return false;
     }
     
-    auto itemData = EntityDataModel::getStaticEntityData(projectile->getEntityType());
+    const auto& itemData = EntityDataModel::getStaticEntityData(projectile->getEntityType());
     if (itemData.weapon.damageType == DamageType::Damage_Type_Projectile)
     {
         if (entity && entity->getEntityType() != EntityType::NoEntity)
@@ -587,7 +678,14 @@ void ServerController::onProjectileDestroyed(const std::shared_ptr<Projectile>&
             if (dist < EXPLOSION_RADIUS &&
                 !player->getIsRemoved())
             {
-                // TODO: Check for objects blocking explosion path by raycast
+                // Walls between the player and the explosion block it, unless the wall is the one
+                // the projectile exploded against
+                cocos2d::Vec2 wallPoint;
+                if (m_gameController->getLevelModel()->rayCast(player->getPosition(), projectile->getPosition(), wallPoint) &&
+                    wallPoint.distanceSquared(projectile->getPosition()) > 1.f)
+                {
+                    continue;
+                }
                 const float damageMultilpier = (dist <= 16.f) ? 1.f : (dist / EXPLOSION_RADIUS);
                 const float damage = itemData.weapon.damageAmount * damageMultilpier;
                 applyDamage(player, damage, projectile->getPosition(), ownerEntityID, EntityType::ExplosionEntity, 0);
@@ -601,11 +699,14 @@ void ServerController::onProjectileDestroyed(const std::shared_ptr<Projectile>&
 
 void ServerController::onTileDeath(const int tileX, const int tileY)
 {
+    // Dead tiles count their rows from the top like the tile map
+    m_safeZoneField.removeSource(tileX, (int)m_levelModel->getMapSizeInTiles().height - 1 - tileY);
+
     std::shared_ptr<ServerTileDeathMessage> deathMessage = std::make_shared<ServerTileDeathMessage>();
     deathMessage->tileX = tileX;
     deathMessage->tileY = tileY;
     std::shared_ptr<Net::Message> message = std::dynamic_pointer_cast<Net::Message>(deathMessage);
-    sendToAllConnectedClients(message);
+    sendToAllConnectedClients(message, true);
 }
 
 void ServerController::onGameModeWinConditionReached(uint8_t winner)
@@ -613,7 +714,7 @@ void ServerController::onGameModeWinConditionReached(uint8_t winner)
     std::shared_ptr<ServerGameOverMessage> gameOverMessage = std::make_shared<ServerGameOverMessage>();
     gameOverMessage->winnerID = winner;
     std::shared_ptr<Net::Message> message = std::dynamic_pointer_cast<Net::Message>(gameOverMessage);
-    sendToAllConnectedClients(message);
+    sendToAllConnectedClients(message, true);
 
     m_gameOverTimer = 0.f;
 }
@@ -698,12 +799,12 @@ void ServerController::applyDamage(const std::shared_ptr<Player>& player,
         deathMessage->killerType = damageType;
         deathMessage->headshot = isHeadshot;
         std::shared_ptr<Net::Message> message = std::dynamic_pointer_cast<Net::Message>(deathMessage);
-        m_networkController->sendMessage(playerID, message);
+        m_networkController->sendMessage(playerID, message, true);
 
         const std::shared_ptr<Player> killerPlayer = m_gameController->getEntitiesModel()->getPlayerByEntityID(damagerID);
         if (killerPlayer)
         {
-            m_networkController->sendMessage(killerPlayer->getPlayerID(), message);
+            m_networkController->sendMessage(killerPlayer->getPlayerID(), message, true);
             const uint8_t killerPlayerID = m_gameController->getEntitiesModel()->getPlayerIDByEntityID(damagerID);
             m_gameController->getGameMode()->onPlayerGotAKill(killerPlayerID);
         }
@@ -720,7 +821,7 @@ void ServerController::applyDamage(const std::shared_ptr<Player>& player,
                     const std::shared_ptr<Player> ownerPlayer = m_gameController->getEntitiesModel()->getPlayerByEntityID(item->getOwnerID());
                     if (ownerPlayer)
                     {
-                        m_networkController->sendMessage(ownerPlayer->getPlayerID(), message);
+                        m_networkController->sendMessage(ownerPlayer->getPlayerID(), message, true);
                     }
                 }
                 else if (EntityDataModel::isProjectileType(damagerEntity->getEntityType()))
@@ -729,7 +830,7 @@ void ServerController::applyDamage(const std::shared_ptr<Player>& player,
                     const std::shared_ptr<Player> ownerPlayer = m_gameController->getEntitiesModel()->getPlayerByEntityID(projectile->getOwnerID());
                     if (ownerPlayer)
                     {
-                        m_networkController->sendMessage(ownerPlayer->getPlayerID(), message);
+                        m_networkController->sendMessage(ownerPlayer->getPlayerID(), message, true);
                     }
                 }
             }
@@ -752,7 +853,7 @@ bool ServerController::wasWeaponFired(uint8_t playerID)
         return false;
     }
     
-    auto itemData = EntityDataModel::getStaticEntityData(heldItemType);
+    const auto& itemData = EntityDataModel::getStaticEntityData(heldItemType);
     float shotDelay = itemData.weapon.timeShot;
     
     return (player->getLastActionTime() < 0.f ||
@@ -761,9 +862,8 @@ bool ServerController::wasWeaponFired(uint8_t playerID)
 
 void ServerController::rollbackForPlayer(const uint8_t playerID, const uint32_t lastReceivedSnapshot)
 {
-    // Save current state to be applied after shot/interaction has been processed
-    m_preRollbackState = m_gameController->getEntitiesModel()->getSnapshot();
-    
+    m_rollbackFrames = 0;
+
     // Roll back network latency + client-side buffer for everyone else before processing frame interactions
     const float networkLatency = m_networkController->getRoundTripTime(playerID) * 0.5f; // 0.5 because only one-way latency counts here
     const uint32_t rollbackLatencyTicks = (networkLatency / m_gameModel->getFrameTime()) + DEFAULT_CLIENT_TICKS_BUFFERED;
@@ -775,10 +875,14 @@ void ServerController::rollbackForPlayer(const uint8_t playerID, const uint32_t
 //    CCLOG("ServerController::rollbackForPlayer %i is %i frames (%fms+%iticks)",
 //           playerID, rollbackLatencyTicks, networkLatency, DEFAULT_CLIENT_TICKS_BUFFERED);
 
-    const auto& player = m_gameController->getEntitiesModel()->getPlayer(playerID);
-    std::map<uint32_t, EntitySnapshot> preShotSnapshot = m_frameCache->getFrame(rollbackLatencyTicks);
-    preShotSnapshot[player->getEntityID()] = m_preRollbackState.at(player->getEntityID()); // Move shooting player forward in past snapshot
-    m_gameController->getEntitiesModel()->setSnapshot(preShotSnapshot);
+    // Entities aren't moved, raycasts read their past positions straight from the frame cache.
+    // The shooting player is the ignored entity of those raycasts so it stays at its present position.
+    m_rollbackFrames = rollbackLatencyTicks;
+}
+
+void ServerController::restoreRollbackState()
+{
+    m_rollbackFrames = 0;
 }
 
 void ServerController::onDisconnected()
@@ -815,6 +919,10 @@ void ServerController::onNodeDisconnected(const Net::NodeID nodeID)
 {
     CCLOG("[Server]ServerController::onNodeDisconnected %i", nodeID);
     m_clientData[nodeID].state = ClientPlayerState::DISCONNECTED;
+    m_clientSnapshots.erase(nodeID);
+    m_entityPriorities.erase(nodeID);
+    m_snapshotScratch.erase(nodeID);
+    m_spectatedPlayers.erase(nodeID);
     if (nodeID == 0)
     {
         stop();
@@ -833,10 +941,14 @@ void ServerController::onPlayerJoined(const uint8_t playerID)
                                                                           rotation);
 //    CCLOG("[Server]ServerController::onPlayerJoined %i, entityID: %i", playerID, player->getEntityID());
 
-    const cocos2d::Size mapSize = m_levelModel->getTileMap()->getMapSize();
-    const cocos2d::Size tileSize = m_levelModel->getTileMap()->getTileSize();
-    float randX = cocos2d::RandomHelper::random_real(tileSize.width, (mapSize.width-1) * tileSize.width);
-    float randY = cocos2d::RandomHelper::random_real(tileSize.height, (mapSize.height-1) * tileSize.height);
+    const cocos2d::Size mapSize = m_levelModel->getMapSizeInTiles();
+    const cocos2d::Size tileSize = m_levelModel->getTileSize();
+    // From the match's own engine, matches on other threads spawn their players at the same time
+    std::mt19937& random = m_gameController->getRandom();
+    std::uniform_real_distribution<float> spawnX(tileSize.width, (mapSize.width-1) * tileSize.width);
+    std::uniform_real_distribution<float> spawnY(tileSize.height, (mapSize.height-1) * tileSize.height);
+    float randX = spawnX(random);
+    float randY = spawnY(random);
     cocos2d::Vec2 randomTile = cocos2d::Vec2(randX / tileSize.width, mapSize.height - (randY / tileSize.height));
     while (true)
     {
@@ -844,12 +956,13 @@ void ServerController::onPlayerJoined(const uint8_t playerID)
         {
             break;
         }
-        randX = cocos2d::RandomHelper::random_real(tileSize.width, (mapSize.width-1) * tileSize.width);
-        randY = cocos2d::RandomHelper::random_real(tileSize.height, (mapSize.height-1) * tileSize.height);
+        randX = spawnX(random);
+        randY = spawnY(random);
         randomTile = cocos2d::Vec2(randX / tileSize.width, mapSize.height - (randY / tileSize.height));
     }
 
     player->setPosition(cocos2d::Vec2(randX, randY));
+    setupChaseField(entityID);
     
     m_gameController->getGameMode()->onPlayerReady(playerID);
 }
@@ -903,6 +1016,7 @@ void ServerController::onClientStateMessageReceived(const std::shared_ptr<Net::M
             {
                 std::shared_ptr<ServerSpectateMessage> spectateMessage = std::make_shared<ServerSpectateMessage>();
                 spectateMessage->spectatingPlayerID = players.begin()->first;
+                m_spectatedPlayers[playerID] = spectateMessage->spectatingPlayerID;
                 std::shared_ptr<Net::Message> message = spectateMessage;
                 m_networkController->sendMessage(playerID, message);
             }
@@ -934,15 +1048,15 @@ void ServerController::onInputMessageReceived(const std::shared_ptr<Net::Message
 
 std::shared_ptr<ServerSnapshotMessage> ServerController::getFullWorldState(const Net::NodeID playerID)
 {
-    auto worldState = m_gameController->getEntitiesModel()->getSnapshot();
     std::shared_ptr<ServerSnapshotMessage> snapshotMessage = std::make_shared<ServerSnapshotMessage>();
     snapshotMessage->data.serverTick = m_gameModel->getCurrentTick();
     snapshotMessage->data.lastReceivedInput = m_inputCache->getLastReceivedSequence(playerID);
-    snapshotMessage->data.entityCount = (uint32_t)worldState.size();
-    snapshotMessage->data.entityData = worldState;
+    m_gameController->getEntitiesModel()->getSnapshot(snapshotMessage->data.entityData);
+    snapshotMessage->data.entityCount = (uint32_t)snapshotMessage->data.entityData.size();
+    snapshotMessage->encoding = m_snapshotEncoding;
 
-    auto players = m_gameController->getEntitiesModel()->getPlayers();
-    for (auto player : players)
+    const auto& players = m_gameController->getEntitiesModel()->getPlayers();
+    for (const auto& player : players)
     {
         snapshotMessage->data.playerData[player.first].entityID = player.second->getEntityID();
         snapshotMessage->data.playerData[player.first].animationState = player.second->getAnimationState();
@@ -970,12 +1084,42 @@ std::shared_ptr<ServerSnapshotMessage> ServerController::getFullWorldState(const
     return snapshotMessage;
 }
 
-std::shared_ptr<ServerSnapshotMessage> ServerController::getWorldStateDiff(const Net::NodeID playerID)
+const SnapshotData* ServerController::getDiffBaseline(const uint8_t playerID,
+                                                     const SnapshotBuffer& sentSnapshots,
+                                                     uint32_t& baselineTick) const
 {
-    // TODO: This requires us to keep track of which server tick snapshot was last confirmed received by the client node
-//    const uint32_t lastClientTick = m_inputCache->getLastReceivedSequence(playerID);
-    
-    return nullptr;
+    // Encode against the most recent snapshot the client told us it received
+    baselineTick = m_inputCache->getLastReceivedSnapshot(playerID);
+    if (baselineTick == 0)
+    {
+        return nullptr;
+    }
+    return sentSnapshots.getSnapshot(baselineTick); // Null once the acked snapshot fell out of the ring
+}
+
+std::shared_ptr<ServerSnapshotDiffMessage> ServerController::getWorldStateDiff(const SnapshotData* baseline,
+                                                                               const uint32_t baselineTick)
+{
+    // Data and the baseline copy are filled in by whoever acquired it, for every client at once
+    auto getBaseline = [baseline](const uint32_t) -> const SnapshotData& {
+        return *baseline;
+    };
+    std::shared_ptr<ServerSnapshotDiffMessage> deltaMessage = m_snapshotDiffMessages.acquire(getBaseline);
+    if (m_networkController->isIOThreadRunning())
+    {
+        // Written on the I/O thread while this one keeps storing snapshots, encode against a copy
+        ServerSnapshotDiffMessage* message = deltaMessage.get();
+        deltaMessage->setDataCallback([message](const uint32_t) -> const SnapshotData& {
+            return message->baseline;
+        });
+    }
+    else
+    {
+        deltaMessage->setDataCallback(getBaseline);
+    }
+    deltaMessage->encoding = m_snapshotEncoding;
+    deltaMessage->previousServerTick = baselineTick;
+    return deltaMessage;
 }
 
 void ServerController::initDebugStuff()
@@ -984,7 +1128,7 @@ void ServerController::initDebugStuff()
     {
         size_t playerID = x;
         onPlayerJoined(playerID);
-        m_botPlayers[playerID] = std::make_shared<BaseAI>();
+        m_botPlayers[playerID] = std::make_shared<BaseAI>(playerID);
         
         m_clientData[playerID] = { ClientPlayerState::AI, "Bot-" + std::to_string(playerID) };
     }
@@ -992,14 +1136,57 @@ void ServerController::initDebugStuff()
 
 void ServerController::applyAI()
 {
-    for (auto botPlayerIt : m_botPlayers)
+    m_botUpdates.clear();
+    for (const auto& botPlayer : m_botPlayers)
     {
-        const uint8_t playerID = botPlayerIt.first;
-        const auto& botAI = botPlayerIt.second;
-        
-        botAI->update(m_gameModel->getFrameTime(), playerID, m_gameController->getEntitiesModel());
-        
-        auto input = botAI->getInput();
+        m_botUpdates.push_back({botPlayer.first, botPlayer.second.get()});
+    }
+    
+    // Bots only read the world and write their own state, they can decide all at once
+    // Only as many think as fit the budget, the rest keep going after what they last picked
+    const auto& entitiesModel = m_gameController->getEntitiesModel();
+    m_aiScheduler.schedule(m_botUpdates, m_thinkingBots);
+    if (!m_thinkingBots.empty())
+    {
+        const auto thinkStart = std::chrono::steady_clock::now();
+        m_jobSystem->parallelFor(m_thinkingBots.size(), JOB_BATCH_BOTS, [this, &entitiesModel](const size_t begin, const size_t end) {
+            for (size_t i = begin; i < end; i++)
+            {
+                const auto& botUpdate = m_botUpdates[m_thinkingBots[i]];
+                botUpdate.second->think(botUpdate.first, entitiesModel);
+            }
+        });
+        // Timed for the debug info only, scheduling by wall time would depend on the machine and worker count
+        const std::chrono::duration<float, std::micro> thinkTime = std::chrono::steady_clock::now() - thinkStart;
+        m_aiScheduler.onThinksDone(m_thinkingBots.size(), thinkTime.count());
+    }
+
+    const float frameTime = m_gameModel->getFrameTime();
+    const AINavigation navigation = { &m_navMesh, &m_safeZoneField, &m_chaseFields };
+    m_jobSystem->parallelFor(m_botUpdates.size(), JOB_BATCH_BOTS, [this, frameTime, &entitiesModel, &navigation](const size_t begin, const size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            m_botUpdates[i].second->update(frameTime, m_botUpdates[i].first, entitiesModel, navigation);
+        }
+    });
+    updateChaseFields();
+    
+    // Path searches share one queue, start with a different bot each tick so none waits on the others forever
+    if (!m_botUpdates.empty())
+    {
+        const size_t firstBot = m_gameModel->getCurrentTick() % m_botUpdates.size();
+        for (size_t i = 0; i < m_botUpdates.size(); i++)
+        {
+            m_botUpdates[(firstBot + i) % m_botUpdates.size()].second->updatePathRequest(m_navMesh);
+        }
+    }
+    m_navMesh.update();
+    
+    // Inputs go in by player ID like before, whichever thread finished first
+    for (const auto& botUpdate : m_botUpdates)
+    {
+        const uint8_t playerID = botUpdate.first;
+        auto input = botUpdate.second->getInput();
         input->inputSequence = m_gameModel->getCurrentTick();
         input->lastReceivedSnapshot = m_gameModel->getCurrentTick() - 1;
         
@@ -1007,53 +1194,185 @@ void ServerController::applyAI()
     }
 }
 
+void ServerController::setupChaseField(const uint16_t entityID)
+{
+    // Set up while the player spawns, a field dropped later isn't set up again until they respawn
+    // Bots chasing a player without a field use their own nav mesh path, so no steady tick allocates one
+    FlowField& field = m_chaseFields[entityID];
+    field.setup(*m_levelModel);
+    // Due for a build as soon as someone chases them, and the whole idle time for someone to start
+    const uint32_t currentTick = m_gameModel->getCurrentTick();
+    m_chaseFieldTicks[entityID] = { currentTick - AI_CHASE_FIELD_REFRESH_TICKS, currentTick };
+}
+
+void ServerController::updateChaseFields()
+{
+    // However many bots chase a player there is one field leading to them
+    m_chasedEntityIDs.clear();
+    m_chasedEntityIDs.reserve(m_botUpdates.size());
+    for (const auto& botUpdate : m_botUpdates)
+    {
+        uint16_t entityID = 0;
+        if (botUpdate.second->getChaseTarget(entityID))
+        {
+            m_chasedEntityIDs.push_back(entityID);
+        }
+    }
+    std::sort(m_chasedEntityIDs.begin(), m_chasedEntityIDs.end());
+    m_chasedEntityIDs.erase(std::unique(m_chasedEntityIDs.begin(), m_chasedEntityIDs.end()), m_chasedEntityIDs.end());
+
+    const uint32_t currentTick = m_gameModel->getCurrentTick();
+    for (const uint16_t entityID : m_chasedEntityIDs)
+    {
+        auto ticksIt = m_chaseFieldTicks.find(entityID);
+        if (ticksIt != m_chaseFieldTicks.end())
+        {
+            ticksIt->second.chased = currentTick;
+        }
+    }
+
+    // The dead's fields go, so do those of players nobody chased for a while
+    const auto& entities = m_gameController->getEntitiesModel()->getEntities();
+    for (auto it = m_chaseFields.begin(); it != m_chaseFields.end();)
+    {
+        const ChaseFieldTicks& ticks = m_chaseFieldTicks[it->first];
+        if (entities.find(it->first) == entities.end() ||
+            currentTick - ticks.chased > AI_CHASE_FIELD_IDLE_TICKS)
+        {
+            m_chaseFieldTicks.erase(it->first);
+            it = m_chaseFields.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    m_chaseFieldJobs.reserve(m_chaseFields.size());
+
+    // A field is rebuilt once its player leaves the source tile, at most every few ticks while they keep moving
+    // Moving the only source invalidates most of the field anyway, a full rebuild is cheaper than patching it
+    m_chaseFieldJobs.clear();
+    for (const uint16_t entityID : m_chasedEntityIDs)
+    {
+        auto entityIt = entities.find(entityID);
+        auto fieldIt = m_chaseFields.find(entityID);
+        if (entityIt == entities.end() || fieldIt == m_chaseFields.end())
+        {
+            continue;
+        }
+
+        FlowField& field = fieldIt->second;
+        int column = 0;
+        int row = 0;
+        if (!field.getTile(entityIt->second->getPosition(), column, row) ||
+            field.isSource(column, row))
+        {
+            continue;
+        }
+        uint32_t& builtTick = m_chaseFieldTicks[entityID].built;
+        if (currentTick - builtTick < AI_CHASE_FIELD_REFRESH_TICKS)
+        {
+            continue;
+        }
+        builtTick = currentTick;
+        m_chaseFieldJobs.push_back({&field, column, row});
+    }
+
+    m_jobSystem->parallelFor(m_chaseFieldJobs.size(), JOB_BATCH_FLOW_FIELDS, [this](const size_t begin, const size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            const ChaseFieldJob& job = m_chaseFieldJobs[i];
+            job.field->setSource(job.column, job.row);
+        }
+    });
+}
+
 void ServerController::integratePositions(const float deltaTime,
                                           std::map<uint32_t, EntitySnapshot>& snapshot,
                                           const std::vector<cocos2d::Rect>& staticRects)
 {
-    MovementIntegrator::setCollisionCallback(std::bind(&ServerController::onEntityCollision, this, std::placeholders::_1));
+    // Rebuild the broadphase from this tick's state, spawned and dead entities are picked up here
+    m_integrationState = snapshot;
+    m_collisionGrid.clearEntities();
+    m_integratedEntities.clear();
     for (auto& entityPair : snapshot)
     {
-        EntitySnapshot& entity = entityPair.second;
-        const uint32_t entityID = entityPair.first;
-        const cocos2d::Vec2& velocity = m_gameController->getEntitiesModel()->getEntities().at(entityID)->getVelocity();
-        const float angularVelocity = m_gameController->getEntitiesModel()->getEntities().at(entityID)->getAngularVelocity();
-        MovementIntegrator::integratePosition(deltaTime, entityID, entity, velocity, angularVelocity, snapshot, staticRects);
+        m_collisionGrid.insertEntity(entityPair.first, MovementIntegrator::getCollisionBounds(entityPair.second));
+        m_integratedEntities.push_back({entityPair.first, &entityPair.second});
+    }
+    m_integrationCollisions.resize(m_integratedEntities.size());
+    m_integrationHits.assign(m_integratedEntities.size(), 0);
+
+    // Each entity sweeps against the start of tick state and the grid, neither moves until all are done
+    const EntityStore& store = m_gameController->getEntitiesModel()->getStore();
+    m_jobSystem->parallelFor(m_integratedEntities.size(), JOB_BATCH_INTEGRATION, [this, deltaTime, &store, &staticRects](const size_t begin, const size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            const uint32_t entityID = m_integratedEntities[i].first;
+            EntitySnapshot& entity = *m_integratedEntities[i].second;
+            const int32_t index = store.getIndex(entityID);
+            const cocos2d::Vec2 velocity = store.getVelocities()[index];
+            const float angularVelocity = store.getAngularVelocities()[index];
+            m_integrationHits[i] = MovementIntegrator::integratePosition(deltaTime, entityID, entity, velocity, angularVelocity,
+                                                                         m_integrationState, staticRects, m_collisionGrid,
+                                                                         m_integrationCollisions[i]);
+        }
+    });
+    
+    // Hits change the world, they are applied here in entity ID order whatever the thread count
+    for (size_t i = 0; i < m_integratedEntities.size(); i++)
+    {
+        if (m_integrationHits[i])
+        {
+            onEntityCollision(m_integrationCollisions[i]);
+        }
     }
-    MovementIntegrator::setCollisionCallback(nullptr);
 }
 
 void ServerController::sendUpdateMessages()
 {
-    const auto postTickState = m_gameController->getEntitiesModel()->getSnapshot();
-    const auto players = m_gameController->getEntitiesModel()->getPlayers();
+    // Post tick state, expired entities are gone and spawned ones are in
+    m_gameController->getEntitiesModel()->getSnapshot(m_worldState);
+    const auto& postTickState = m_worldState;
+    const auto& players = m_gameController->getEntitiesModel()->getPlayers();
+    m_gameController->getEntitiesModel()->updateSpatialIndex();
     
-    SnapshotData snapshot;
-    snapshot.serverTick = m_gameModel->getCurrentTick();
-    snapshot.entityCount = (uint32_t)postTickState.size();
-    snapshot.entityData = postTickState;
-    snapshot.playerCount = players.size();
-    snapshot.hitData = m_frameHitData;
-
-    for (auto player : players)
+    // Filled in place every tick, player and weapon slot storage carries over
+    for (auto it = m_outgoingPlayerData.begin(); it != m_outgoingPlayerData.end();)
+    {
+        if (players.find(it->first) == players.end())
+        {
+            it = m_outgoingPlayerData.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    for (const auto& player : players)
     {
         const uint8_t playerID = player.first;
         const auto& playerState = player.second;
-        snapshot.playerData[playerID].entityID = playerState->getEntityID();
-        snapshot.playerData[playerID].kills = m_gameController->getGameMode()->getPlayerKills(playerID);
-        snapshot.playerData[playerID].animationState = playerState->getAnimationState();
-        snapshot.playerData[playerID].aimPointX = playerState->getAimPosition().x;
-        snapshot.playerData[playerID].aimPointY = playerState->getAimPosition().y;
-        snapshot.playerData[playerID].health = playerState->getHealth();
-        snapshot.playerData[playerID].flipX = playerState->getFlipX();
-        snapshot.playerData[playerID].activeWeaponSlot = playerState->getActiveSlot();
+        PlayerState& playerData = m_outgoingPlayerData[playerID];
+        playerData.entityID = playerState->getEntityID();
+        playerData.kills = m_gameController->getGameMode()->getPlayerKills(playerID);
+        playerData.animationState = playerState->getAnimationState();
+        playerData.aimPointX = playerState->getAimPosition().x;
+        playerData.aimPointY = playerState->getAimPosition().y;
+        playerData.health = playerState->getHealth();
+        playerData.flipX = playerState->getFlipX();
+        playerData.weaponFired = false;
+        playerData.activeWeaponSlot = playerState->getActiveSlot();
         const auto& weaponSlots = playerState->getWeaponSlots();
+        playerData.weaponSlots.clear();
         for (size_t i = 0; i < 5; i++)
         {
-            snapshot.playerData[playerID].weaponSlots.push_back({(uint8_t)weaponSlots.at(i).type, weaponSlots.at(i).amount});
+            playerData.weaponSlots.push_back({(uint8_t)weaponSlots.at(i).type, weaponSlots.at(i).amount});
         }
     }
     
+    // Every map a client's snapshot touches gets its entry here, the jobs below only look them up
+    m_snapshotJobs.clear();
     for (const auto& clientData : m_clientData)
     {
         const uint8_t playerID = clientData.first;
@@ -1074,65 +1393,320 @@ void ServerController::sendUpdateMessages()
             continue;
         }
         
-        snapshot.lastReceivedInput = m_inputCache->getLastAppliedSequence(playerID);
-//        CCLOG("[Server]ServerController::sendUpdateMessages - player %i last applied input %u on server tick: %i",
-//              playerID, snapshot.lastReceivedInput, snapshot.serverTick);
-
-        const auto& sendingPlayer = players.find(playerID);
-        if (sendingPlayer != players.end())
+        SnapshotJob job;
+        job.playerID = playerID;
+        job.snapshot = &m_outgoingSnapshots[playerID];
+        job.snapshot->hitData.reserve(SNAPSHOT_HIT_CAPACITY);
+        job.priorities = &m_entityPriorities[playerID];
+        job.sentSnapshots = &m_clientSnapshots[playerID];
+        job.scratch = &m_snapshotScratch[playerID];
+        job.baseline = nullptr;
+        job.baselineTick = 0;
+        m_snapshotJobs.push_back(job);
+    }
+    
+    m_jobSystem->parallelFor(m_snapshotJobs.size(), JOB_BATCH_SNAPSHOTS, [this, &postTickState](const size_t begin, const size_t end) {
+        for (size_t i = begin; i < end; i++)
         {
-            auto& inventory = sendingPlayer->second->getInventory();
-            for (const auto& inventoryItem : inventory)
+            buildSnapshot(m_snapshotJobs[i], postTickState);
+        }
+    });
+    
+    // The message pools aren't shared between threads, messages are handed out in client order
+    for (SnapshotJob& job : m_snapshotJobs)
+    {
+        job.diffMessage = job.baseline ? getWorldStateDiff(job.baseline, job.baselineTick) : nullptr;
+        job.snapshotMessage = job.baseline ? nullptr : m_snapshotMessages.acquire();
+        // Pooled messages keep room for a busy tick's hits too, copying a snapshot in doesn't grow them
+        if (job.diffMessage)
+        {
+            job.diffMessage->data.hitData.reserve(SNAPSHOT_HIT_CAPACITY);
+            job.diffMessage->baseline.hitData.reserve(SNAPSHOT_HIT_CAPACITY);
+        }
+        else
+        {
+            job.snapshotMessage->data.hitData.reserve(SNAPSHOT_HIT_CAPACITY);
+        }
+    }
+    
+    // Copying the snapshots into the messages is most of the remaining work, again one client per job
+    const bool copyBaselines = m_networkController->isIOThreadRunning();
+    m_jobSystem->parallelFor(m_snapshotJobs.size(), JOB_BATCH_SNAPSHOTS, [this, copyBaselines](const size_t begin, const size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            SnapshotJob& job = m_snapshotJobs[i];
+            if (job.diffMessage)
             {
-                snapshot.inventory.push_back({(uint8_t)inventoryItem.type, inventoryItem.amount});
+                if (copyBaselines)
+                {
+                    job.diffMessage->baseline = *job.baseline;
+                }
+                job.diffMessage->data = *job.snapshot;
             }
-        }
-        
-        if (m_sendDeltaUpdates)
-        {
-            auto& playerSnapshots = m_clientSnapshots.at(playerID);
-            playerSnapshots.push_back(snapshot);
-
-            const uint32_t lastReceivedSnapshotTick = m_inputCache->getLastReceivedSnapshot(playerID);
-            auto snapshotIt = std::find_if(playerSnapshots.begin(),
-                                           playerSnapshots.end(),
-                                           [lastReceivedSnapshotTick](const SnapshotData& data){
-                return data.serverTick == lastReceivedSnapshotTick;
-            });
-            if (snapshotIt != playerSnapshots.end())
+            else
             {
-                const auto& lastReceivedState = *snapshotIt;
-                std::shared_ptr<ServerSnapshotDiffMessage> deltaMessage = std::make_shared<ServerSnapshotDiffMessage>([lastReceivedState](const uint32_t){ return lastReceivedState; });
-                deltaMessage->data = snapshot;
-                deltaMessage->previousServerTick = lastReceivedSnapshotTick;
-                std::shared_ptr<Net::Message> message = std::dynamic_pointer_cast<Net::Message>(deltaMessage);
-                m_networkController->sendMessage(playerID, message);
+                job.snapshotMessage->data = *job.snapshot;
+                job.snapshotMessage->encoding = m_snapshotEncoding;
             }
-            
-            // Erase up to last received
-            playerSnapshots.erase(std::remove_if(playerSnapshots.begin(),
-                                                 playerSnapshots.end(),
-                                                 [lastReceivedSnapshotTick](const SnapshotData& data)
-                                                 {
-                                                    return data.serverTick < lastReceivedSnapshotTick;
-                                                }),
-                                  playerSnapshots.end());
+        }
+    });
+    
+    for (SnapshotJob& job : m_snapshotJobs)
+    {
+        std::shared_ptr<Net::Message> message;
+        if (job.diffMessage)
+        {
+            message = job.diffMessage;
         }
         else
         {
-            std::shared_ptr<ServerSnapshotMessage> snapshotMessage = std::make_shared<ServerSnapshotMessage>();
-            snapshotMessage->data = snapshot;
-
-            std::shared_ptr<Net::Message> message = std::dynamic_pointer_cast<Net::Message>(snapshotMessage);
-            m_networkController->sendMessage(playerID, message);
-            
-//            CCLOG("[Server]ServerController::sendUpdateMessages snapshot tick %u sent to player %i", snapshot.serverTick, playerID);
+            message = job.snapshotMessage;
         }
+        m_networkController->sendMessage(job.playerID, message);
+//        CCLOG("[Server]ServerController::sendUpdateMessages snapshot tick %u sent to player %i", job.snapshot->serverTick, job.playerID);
+        job.diffMessage = nullptr;
+        job.snapshotMessage = nullptr;
     }
             
     m_frameHitData.clear();
 }
 
+void ServerController::buildSnapshot(SnapshotJob& job, const std::map<uint32_t, EntitySnapshot>& postTickState)
+{
+    // Each client keeps its own snapshot so only entities entering or leaving its relevancy
+    // radius cost map nodes, copying the shared state over reuses the existing ones
+    const auto& players = m_gameController->getEntitiesModel()->getPlayers();
+    SnapshotData& snapshot = *job.snapshot;
+    snapshot.serverTick = m_gameModel->getCurrentTick();
+    snapshot.playerCount = players.size();
+    assignMapValues(snapshot.playerData, m_outgoingPlayerData);
+    snapshot.hitData = m_frameHitData;
+    snapshot.lastReceivedInput = m_inputCache->getLastAppliedSequence(job.playerID);
+//    CCLOG("[Server]ServerController::sendUpdateMessages - player %i last applied input %u on server tick: %i",
+//          job.playerID, snapshot.lastReceivedInput, snapshot.serverTick);
+
+    getRelevantEntities(job.playerID, postTickState, snapshot.entityData, job.scratch->relevantEntityIDs);
+    prioritizeSnapshotEntities(job.playerID, snapshot, *job.priorities, job.scratch->prioritizedEntities);
+    snapshot.entityCount = (uint32_t)snapshot.entityData.size();
+    
+    snapshot.inventory.clear();
+    const auto& sendingPlayer = players.find(job.playerID);
+    if (sendingPlayer != players.end())
+    {
+        auto& inventory = sendingPlayer->second->getInventory();
+        for (const auto& inventoryItem : inventory)
+        {
+            snapshot.inventory.push_back({(uint8_t)inventoryItem.type, inventoryItem.amount});
+        }
+    }
+    
+    if (m_sendDeltaUpdates)
+    {
+        // Store first, the baseline lookup then can't be invalidated by this tick's snapshot
+        job.sentSnapshots->storeSnapshot(snapshot);
+        job.baseline = getDiffBaseline(job.playerID, *job.sentSnapshots, job.baselineTick);
+    }
+}
+
+bool ServerController::getRelevancyCenter(const uint8_t playerID, cocos2d::Vec2& center) const
+{
+    auto player = m_gameController->getEntitiesModel()->getPlayer(playerID);
+    if (!player)
+    {
+        // Dead or not yet spawned, follow whoever the client is spectating
+        auto spectatedIt = m_spectatedPlayers.find(playerID);
+        if (spectatedIt != m_spectatedPlayers.end())
+        {
+            player = m_gameController->getEntitiesModel()->getPlayer(spectatedIt->second);
+        }
+    }
+    if (!player)
+    {
+        return false;
+    }
+    center = player->getPosition();
+    return true;
+}
+
+void ServerController::getRelevantEntities(const uint8_t playerID,
+                                           const std::map<uint32_t, EntitySnapshot>& worldState,
+                                           std::map<uint32_t, EntitySnapshot>& relevantState,
+                                           std::vector<uint32_t>& relevantEntityIDs)
+{
+    cocos2d::Vec2 center;
+    if (m_relevancyRadius <= 0.f ||
+        !getRelevancyCenter(playerID, center))
+    {
+        relevantState = worldState;
+        return;
+    }
+    
+    const auto& entitiesModel = m_gameController->getEntitiesModel();
+    entitiesModel->getEntityIDsNearPosition(center, m_relevancyRadius, relevantEntityIDs);
+    
+    // Own projectiles are always relevant so the client can reconcile its predicted shots
+    const std::vector<uint32_t>& ownedProjectileIDs = entitiesModel->getOwnedProjectileIDs(playerID);
+    if (!ownedProjectileIDs.empty())
+    {
+        relevantEntityIDs.insert(relevantEntityIDs.end(), ownedProjectileIDs.begin(), ownedProjectileIDs.end());
+        std::sort(relevantEntityIDs.begin(), relevantEntityIDs.end());
+        relevantEntityIDs.erase(std::unique(relevantEntityIDs.begin(), relevantEntityIDs.end()), relevantEntityIDs.end());
+    }
+    
+    // Merge the sorted IDs into last tick's state, entities which stayed relevant keep their nodes
+    auto stateIt = relevantState.begin();
+    for (const uint32_t entityID : relevantEntityIDs)
+    {
+        auto worldIt = worldState.find(entityID);
+        if (worldIt == worldState.end())
+        {
+            continue;
+        }
+        while (stateIt != relevantState.end() && stateIt->first < entityID)
+        {
+            stateIt = relevantState.erase(stateIt);
+        }
+        if (stateIt != relevantState.end() && stateIt->first == entityID)
+        {
+            stateIt->second = worldIt->second;
+            ++stateIt;
+        }
+        else
+        {
+            relevantState.emplace_hint(stateIt, *worldIt);
+        }
+    }
+    relevantState.erase(stateIt, relevantState.end());
+}
+
+size_t ServerController::getSnapshotEntityBudget(const uint8_t playerID, const SnapshotData& snapshot) const
+{
+    // One packet at most so busy maps don't fragment, less when the connection can't carry that every tick
+    float budgetBytes = SNAPSHOT_MAX_BYTES;
+    const float bandwidth = m_networkController->getBandwidth(playerID);
+    if (bandwidth > 0.f)
+    {
+        budgetBytes = std::min(budgetBytes, bandwidth * SNAPSHOT_BANDWIDTH_SHARE * m_gameModel->getFrameTime());
+    }
+    
+    const float entityBudgetBits = budgetBytes * 8.f - snapshot.playerData.size() * SNAPSHOT_PLAYER_BITS;
+    const size_t maxEntities = entityBudgetBits > 0.f ? (size_t)(entityBudgetBits / getSnapshotEntityBits(m_snapshotEncoding)) : 0;
+    return std::max(maxEntities, SNAPSHOT_MIN_ENTITIES);
+}
+
+float ServerController::getEntityPriority(const EntitySnapshot& entity,
+                                          const cocos2d::Vec2* center,
+                                          const bool changed) const
+{
+    float priority = SNAPSHOT_PRIORITY_DEFAULT;
+    if (entity.type == EntityType::PlayerEntity)
+    {
+        priority = SNAPSHOT_PRIORITY_PLAYER;
+    }
+    else if (entity.type >= EntityType::Projectile_Bullet &&
+             entity.type <= EntityType::Projectile_Smoke)
+    {
+        priority = SNAPSHOT_PRIORITY_PROJECTILE;
+    }
+    if (changed)
+    {
+        priority *= SNAPSHOT_PRIORITY_CHANGED_SCALE;
+    }
+    if (center)
+    {
+        // Falls off to a quarter at the relevancy radius
+        const float radius = m_relevancyRadius > 0.f ? m_relevancyRadius : SNAPSHOT_RELEVANCY_RADIUS;
+        const float distance = center->distance(cocos2d::Vec2(entity.positionX, entity.positionY));
+        priority /= 1.f + 3.f * distance / radius;
+    }
+    return priority;
+}
+
+void ServerController::prioritizeSnapshotEntities(const uint8_t playerID,
+                                                  SnapshotData& snapshot,
+                                                  std::map<uint32_t, EntityPriority>& priorities,
+                                                  std::vector<std::pair<float, uint32_t>>& prioritizedEntities)
+{
+    // Entities which left the relevant set are gone for the client too, both maps are sorted by ID
+    auto stateIt = snapshot.entityData.begin();
+    for (auto it = priorities.begin(); it != priorities.end();)
+    {
+        while (stateIt != snapshot.entityData.end() && stateIt->first < it->first)
+        {
+            ++stateIt;
+        }
+        if (stateIt == snapshot.entityData.end() || stateIt->first != it->first)
+        {
+            it = priorities.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    
+    cocos2d::Vec2 center;
+    const bool hasCenter = getRelevancyCenter(playerID, center);
+    auto playerIt = m_outgoingPlayerData.find(playerID);
+    const uint32_t playerEntityID = playerIt != m_outgoingPlayerData.end() ? playerIt->second.entityID : 0;
+    const std::vector<uint32_t>& ownedProjectileIDs = m_gameController->getEntitiesModel()->getOwnedProjectileIDs(playerID);
+    
+    prioritizedEntities.clear();
+    size_t requiredEntities = 0;
+    for (const auto& entity : snapshot.entityData)
+    {
+        EntityPriority& priority = priorities[entity.first];
+        const bool changed = !priority.sent || ServerSnapshotDiffMessage::hasEntityChanged(priority.sentState, entity.second);
+        if (m_sendDeltaUpdates && !changed)
+        {
+            continue; // Costs next to nothing against the baseline
+        }
+        priority.accumulated += getEntityPriority(entity.second, hasCenter ? &center : nullptr, changed);
+        
+        // The client predicts its own player and shots, those can't wait
+        const bool required = entity.first == playerEntityID ||
+                              std::find(ownedProjectileIDs.begin(), ownedProjectileIDs.end(), entity.first) != ownedProjectileIDs.end();
+        prioritizedEntities.push_back({required ? std::numeric_limits<float>::max() : priority.accumulated, entity.first});
+        if (required)
+        {
+            requiredEntities++;
+        }
+    }
+    
+    // Required entities go out even when there are more of them than the budget, the rest get cut instead
+    const size_t maxEntities = std::max(getSnapshotEntityBudget(playerID, snapshot), requiredEntities);
+    if (prioritizedEntities.size() > maxEntities)
+    {
+        std::nth_element(prioritizedEntities.begin(),
+                         prioritizedEntities.begin() + maxEntities,
+                         prioritizedEntities.end(),
+                         std::greater<std::pair<float, uint32_t>>());
+        for (auto it = prioritizedEntities.begin() + maxEntities; it != prioritizedEntities.end(); ++it)
+        {
+            // Starved entities keep what they accumulated, with deltas the client holds the state it was last sent
+            EntityPriority& priority = priorities[it->second];
+            if (m_sendDeltaUpdates && priority.sent)
+            {
+                snapshot.entityData[it->second] = priority.sentState;
+            }
+            else
+            {
+                snapshot.entityData.erase(it->second);
+                priority.sent = false;
+            }
+        }
+        prioritizedEntities.resize(maxEntities);
+    }
+    
+    for (const auto& prioritizedEntity : prioritizedEntities)
+    {
+        EntityPriority& priority = priorities[prioritizedEntity.second];
+        priority.accumulated = 0.f;
+        priority.sent = true;
+        priority.sentState = snapshot.entityData[prioritizedEntity.second];
+    }
+}
+
 void ServerController::sendInfoMessages()
 {
     std::shared_ptr<ServerInfoMessage> infoMessage = std::make_shared<ServerInfoMessage>();
@@ -1147,13 +1721,14 @@ void ServerController::sendInfoMessages()
     sendToAllConnectedClients(outMessage);
 }
 
-void ServerController::sendToAllConnectedClients(std::shared_ptr<Net::Message>& message)
+void ServerController::sendToAllConnectedClients(std::shared_ptr<Net::Message>& message,
+                                                 const bool reliable /*= false*/)
 {
     for (const auto& pair : m_clientData)
     {
         if (pair.second.state == ClientPlayerState::CONNECTED)
         {
-            m_networkController->sendMessage(pair.first, message);
+            m_networkController->sendMessage(pair.first, message, reliable);
         }
     }
 }
@@ -2,15 +2,22 @@
 #define ServerController_h
 
 #include "Network/NetworkMessages.h"
+#include "AIScheduler.h"
 #include "RaycastUtil.h"
 #include "MovementIntegrator.h"
-#include "cocos2d.h"
+#include "MessagePool.h"
+#include "FlowField.h"
+#include "InputCache.h"
+#include "NavMesh.h"
+#include "SnapshotBuffer.h"
+#include "SpatialGrid.h"
+#include "math/CCGeometry.h"
 
 class BaseAI;
+class JobSystem;
 class GameController;
 class LevelModel;
 class FrameCache;
-class InputCache;
 class Entity;
 class INetworkController;
 class Player;
@@ -30,14 +37,21 @@ public:
                      std::shared_ptr<GameModel> gameModel,
                      std::shared_ptr<INetworkController> networkController,
                      std::shared_ptr<FrameCache> frameCache,
-                     std::shared_ptr<InputCache> inputCache);
+                     std::shared_ptr<InputCache> inputCache,
+                     std::shared_ptr<JobSystem> jobSystem);
     ~ServerController();
 
     void update(const float deltaTime);
     void stop();
+    bool isStopped() const { return m_stopped; }
 
     std::shared_ptr<GameController> getGameController() const { return m_gameController; }
     float getMaxPingThreshold() const { return m_maxPingThreshold; }
+    // Entities further than this from a client's player are left out of its snapshots, 0 disables culling
+    void setRelevancyRadius(const float radius) { m_relevancyRadius = radius; }
+    float getRelevancyRadius() const { return m_relevancyRadius; }
+    void setSnapshotEncoding(const SnapshotEncoding& encoding) { m_snapshotEncoding = encoding; }
+    const SnapshotEncoding& getSnapshotEncoding() const { return m_snapshotEncoding; }
 
     const std::string getDebugInfo() const;
     
@@ -56,22 +70,90 @@ private:
         std::string name;
     };
     
+    struct EntityPriority {
+        float accumulated; // Grows every tick the entity is due but left out, reset once sent
+        bool sent;
+        EntitySnapshot sentState; // What the client last got, valid while sent
+    };
+    
+    // Per client scratch, snapshots for several clients get built at once
+    struct SnapshotScratch {
+        std::vector<uint32_t> relevantEntityIDs;
+        std::vector<std::pair<float, uint32_t>> prioritizedEntities;
+    };
+    
+    // One client's share of building this tick's snapshots, everything it touches belongs to that client alone
+    struct SnapshotJob {
+        uint8_t playerID;
+        SnapshotData* snapshot;
+        std::map<uint32_t, EntityPriority>* priorities;
+        SnapshotBuffer* sentSnapshots;
+        SnapshotScratch* scratch;
+        const SnapshotData* baseline; // Acked snapshot to encode against, null sends the whole snapshot
+        uint32_t baselineTick;
+        std::shared_ptr<ServerSnapshotMessage> snapshotMessage;
+        std::shared_ptr<ServerSnapshotDiffMessage> diffMessage;
+    };
+
+    // A chase field due to be rebuilt around where its player stands now
+    struct ChaseFieldJob {
+        FlowField* field;
+        int column;
+        int row;
+    };
+    struct ChaseFieldTicks {
+        uint32_t built;
+        uint32_t chased;
+    };
+    
     std::shared_ptr<GameController> m_gameController;
     std::shared_ptr<LevelModel> m_levelModel;
     std::shared_ptr<GameModel> m_gameModel;
     std::shared_ptr<INetworkController> m_networkController;
     std::shared_ptr<FrameCache> m_frameCache;
     std::shared_ptr<InputCache> m_inputCache;
+    std::shared_ptr<JobSystem> m_jobSystem;
     
     float m_maxPingThreshold;
+    float m_relevancyRadius;
+    SnapshotEncoding m_snapshotEncoding;
     bool m_sendDeltaUpdates;
     float m_gameOverTimer;
+    bool m_stopped;
+    size_t m_rollbackFrames; // How far back shots and interactions of the current input see the world, 0 for present
+    std::vector<uint16_t> m_expiredEntityIDs;
 
-    std::map<uint32_t, EntitySnapshot> m_preRollbackState;
     std::map<uint8_t, ClientPlayerData> m_clientData;
-    std::map<uint8_t, std::vector<SnapshotData>> m_clientSnapshots;
+    std::map<uint8_t, SnapshotBuffer> m_clientSnapshots;
+    std::map<uint8_t, std::map<uint32_t, EntityPriority>> m_entityPriorities;
+    std::map<uint8_t, SnapshotScratch> m_snapshotScratch;
+    std::vector<SnapshotJob> m_snapshotJobs;
+    std::map<uint8_t, uint8_t> m_spectatedPlayers;
+    // Kept between ticks and filled in place, a tick without spawns or deaths doesn't allocate
+    std::map<uint32_t, EntitySnapshot> m_worldState;
+    std::map<uint8_t, ServerInput> m_tickInputData;
+    std::map<uint8_t, std::shared_ptr<ClientInputMessage>> m_tickInputs;
+    std::map<uint8_t, PlayerState> m_outgoingPlayerData;
+    std::map<uint8_t, SnapshotData> m_outgoingSnapshots;
+    MessagePool<ServerSnapshotMessage> m_snapshotMessages;
+    MessagePool<ServerSnapshotDiffMessage> m_snapshotDiffMessages;
     std::vector<FrameHitData> m_frameHitData;
     std::map<uint8_t, std::shared_ptr<BaseAI>> m_botPlayers;
+    std::vector<std::pair<uint8_t, BaseAI*>> m_botUpdates; // The bots updated this tick, indexable for the job system
+    AIScheduler m_aiScheduler;
+    std::vector<size_t> m_thinkingBots; // Indices into m_botUpdates of the bots thinking this tick
+    SpatialGrid m_collisionGrid;
+    NavMesh m_navMesh; // Built from the level's static rects, bots path over it
+    FlowField m_safeZoneField; // Every living tile is a source, dead ones lead back to them
+    std::map<uint16_t, FlowField> m_chaseFields; // Living players bots chased lately, by entity ID
+    std::map<uint16_t, ChaseFieldTicks> m_chaseFieldTicks; // When each chase field was last built and last chased
+    std::vector<uint16_t> m_chasedEntityIDs;
+    std::vector<ChaseFieldJob> m_chaseFieldJobs;
+    // Every entity sweeps against where the others were at the start of integration, that state stays untouched meanwhile
+    std::map<uint32_t, EntitySnapshot> m_integrationState;
+    std::vector<std::pair<uint32_t, EntitySnapshot*>> m_integratedEntities;
+    std::vector<CollisionData> m_integrationCollisions;
+    std::vector<uint8_t> m_integrationHits; // One per integrated entity, not a vector<bool> so jobs never share a byte
 
     void performGameUpdate(const float deltaTime);
     void checkForShots(uint8_t playerID, const std::shared_ptr<ClientInputMessage>& input);
@@ -101,6 +183,7 @@ private:
     
     bool wasWeaponFired(uint8_t playerID);
     void rollbackForPlayer(const uint8_t playerID, const uint32_t lastReceivedSnapshot);
+    void restoreRollbackState();
     
     void onDisconnected();
     void onNodeConnected(const Net::NodeID nodeID);
@@ -115,9 +198,16 @@ private:
                                 const Net::NodeID playerID);
 
     std::shared_ptr<ServerSnapshotMessage> getFullWorldState(const Net::NodeID playerID);
-    std::shared_ptr<ServerSnapshotMessage> getWorldStateDiff(const Net::NodeID playerID);
+    // The snapshot the client last acked, if it is still around to encode this tick's one against
+    const SnapshotData* getDiffBaseline(const uint8_t playerID,
+                                        const SnapshotBuffer& sentSnapshots,
+                                        uint32_t& baselineTick) const;
+    std::shared_ptr<ServerSnapshotDiffMessage> getWorldStateDiff(const SnapshotData* baseline,
+                                                                 const uint32_t baselineTick);
 
     void applyAI();
+    void setupChaseField(const uint16_t entityID);
+    void updateChaseFields();
     
     cocos2d::Vec2 getAverageAICenter() const;
     cocos2d::Vec2 getAverageAIVelocity() const;
@@ -126,8 +216,25 @@ private:
                             std::map<uint32_t, EntitySnapshot>& snapshot,
                             const std::vector<cocos2d::Rect>& staticRects);
     void sendUpdateMessages();
+    bool getRelevancyCenter(const uint8_t playerID, cocos2d::Vec2& center) const;
+    void getRelevantEntities(const uint8_t playerID,
+                             const std::map<uint32_t, EntitySnapshot>& worldState,
+                             std::map<uint32_t, EntitySnapshot>& relevantState,
+                             std::vector<uint32_t>& relevantEntityIDs);
+    // How many entities fit one snapshot, bounded by a packet and by the client's share of the estimated bandwidth
+    size_t getSnapshotEntityBudget(const uint8_t playerID, const SnapshotData& snapshot) const;
+    float getEntityPriority(const EntitySnapshot& entity,
+                            const cocos2d::Vec2* center,
+                            const bool changed) const;
+    // Sends the entities which accumulated the most priority when not all of them fit the budget
+    void prioritizeSnapshotEntities(const uint8_t playerID,
+                                    SnapshotData& snapshot,
+                                    std::map<uint32_t, EntityPriority>& priorities,
+                                    std::vector<std::pair<float, uint32_t>>& prioritizedEntities);
+    void buildSnapshot(SnapshotJob& job, const std::map<uint32_t, EntitySnapshot>& postTickState);
     void sendInfoMessages();
-    void sendToAllConnectedClients(std::shared_ptr<Net::Message>& message);
+    void sendToAllConnectedClients(std::shared_ptr<Net::Message>& message,
+                                   const bool reliable = false);
 };
 
 #endif /* ServerController_h */
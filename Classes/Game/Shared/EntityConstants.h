@@ -1,7 +1,7 @@
 #ifndef EntityConstants_h
 #define EntityConstants_h
 
-#include "cocos2d.h"
+#include "math/CCGeometry.h"
 #include <string>
 
 static constexpr float PLAYER_WALK_VEL = 120.f;
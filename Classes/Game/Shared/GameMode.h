@@ -1,8 +1,11 @@
 #ifndef GameMode_h
 #define GameMode_h
 
-#include "cocos2d.h"
+#include <stdint.h>
+#include <functional>
 #include <map>
+#include <memory>
+#include <string>
 #include <vector>
 
 class EntitiesController;
@@ -1,7 +1,6 @@
 #ifndef GameModel_h
 #define GameModel_h
 
-#include "cocos2d.h"
 #include "Game/Shared/GameMode.h"
 
 class GameModel
@@ -1,4 +1,5 @@
 #include "GameSettings.h"
+#include "platform/CCFileUtils.h"
 
 const std::string GameSettings::DEFAULT_SETTINGS_FILE = "res/Settings.plist";
 const std::string GameSettings::SETTING_SAVE_SETTINGS_ON_EXIT = "SaveSettingsOnExit";
@@ -1,7 +1,7 @@
 #ifndef GameSettings_h
 #define GameSettings_h
 
-#include "cocos2d.h"
+#include "base/CCValue.h"
 
 class GameSettings
 {
@@ -4,9 +4,21 @@
 #include "CollisionUtils.h"
 #include "SharedConstants.h"
 #include "AddLightEvent.h"
+#include "base/base64.h"
+#include "base/ZipUtils.h"
+#include "platform/CCFileUtils.h"
+#include "external/tinyxml2/tinyxml2.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+
+const std::string LevelModel::LEVEL_FOLDER = "res/tilemaps/";
+const uint32_t LevelModel::TILE_FLIP_FLAGS = 0xE0000000; // Horizontal, vertical and diagonal flips in the top bits
 
 LevelModel::LevelModel()
-: m_tileMap(nullptr)
+: m_dispatcher(&Dispatcher::globalDispatcher())
 {
     printf("LevelModel:: constructor: %p\n", this);
 }
@@ -17,100 +29,136 @@ LevelModel::~LevelModel()
 }
 
 void LevelModel::loadLevel(const std::string& level,
-                               const bool lights)
+                           const bool lights)
 {
-    const std::string levelPath = "res/tilemaps/" + level;
-    loadTileMap(levelPath);
-    
-    if (m_tileMap && lights)
+    unloadLevel();
+
+    if (!loadMapInfo(LEVEL_FOLDER + level, lights))
     {
-        loadLights();
+        return;
     }
     
-    m_level = m_tileMap ? level : "";
+    m_level = level;
 }
 
 void LevelModel::unloadLevel()
 {
     m_level = "";
-    m_tileMap = nullptr;
+    m_staticRects.clear();
+    m_solidTiles.clear();
+    m_mapSizeInTiles = cocos2d::Size::ZERO;
+    m_tileSize = cocos2d::Size::ZERO;
+}
+
+const std::string LevelModel::getLevelPath() const
+{
+    return LEVEL_FOLDER + m_level;
 }
 
 const cocos2d::Size LevelModel::getMapSize() const
 {
-    if (!m_tileMap)
+    return cocos2d::Size(m_tileSize.width * m_mapSizeInTiles.width,
+                         m_tileSize.height * m_mapSizeInTiles.height);
+}
+
+bool LevelModel::loadMapInfo(const std::string& tileMap, const bool lights)
+{
+    // Reads the TMX itself, cocos2d::TMXMapInfo asks the Director to scale object positions
+    // and the dedicated server has none
+    const std::string fullPath = cocos2d::FileUtils::getInstance()->fullPathForFilename(tileMap);
+    tinyxml2::XMLDocument xmlDoc;
+    if (xmlDoc.LoadFile(fullPath.c_str()) != tinyxml2::XMLError::XML_SUCCESS)
+    {
+        printf("LevelModel::loadMapInfo failed to load %s\n", tileMap.c_str());
+        return false;
+    }
+    const tinyxml2::XMLElement* map = xmlDoc.FirstChildElement("map");
+    if (!map)
     {
-        return cocos2d::Size();
+        printf("LevelModel::loadMapInfo no map in %s\n", tileMap.c_str());
+        return false;
     }
-    const cocos2d::Size& tileSize = m_tileMap->getTileSize();
-    const cocos2d::Size& mapSize = m_tileMap->getMapSize();
-    return cocos2d::Size(tileSize.width * mapSize.width,
-                         tileSize.height * mapSize.height);
+
+    m_mapSizeInTiles = cocos2d::Size(map->IntAttribute("width"), map->IntAttribute("height"));
+    m_tileSize = cocos2d::Size(map->IntAttribute("tilewidth"), map->IntAttribute("tileheight"));
+    loadSolidTiles(map);
+    loadTileWalls();
+    
+    if (lights)
+    {
+        loadLights(map);
+    }
+    
+    return true;
 }
 
-void LevelModel::loadTileMap(const std::string& tileMap)
+void LevelModel::loadSolidTiles(const tinyxml2::XMLElement* map)
 {
-    // create a TMX map
-    m_tileMap = cocos2d::TMXTiledMap::create(tileMap);
+    // Solid where the Meta layer has a tile with the Collidable property
+    std::set<uint32_t> collidableTiles;
+    for (const tinyxml2::XMLElement* tileset = map->FirstChildElement("tileset");
+         tileset != nullptr;
+         tileset = tileset->NextSiblingElement("tileset"))
+    {
+        const uint32_t firstGID = tileset->UnsignedAttribute("firstgid");
+        for (const tinyxml2::XMLElement* tile = tileset->FirstChildElement("tile");
+             tile != nullptr;
+             tile = tile->NextSiblingElement("tile"))
+        {
+            if (findNamedElement(tile->FirstChildElement("properties"), "property", "Collidable"))
+            {
+                collidableTiles.insert(firstGID + tile->UnsignedAttribute("id"));
+            }
+        }
+    }
+
+    const tinyxml2::XMLElement* meta = findNamedElement(map, "layer", "Meta");
+    std::vector<uint32_t> tiles;
+    if (!meta || !loadLayerTiles(meta, tiles))
+    {
+        return;
+    }
+
+    const int width = meta->IntAttribute("width");
+    const int height = meta->IntAttribute("height");
+    if ((int)tiles.size() < width * height)
+    {
+        printf("LevelModel::loadSolidTiles Meta layer has %zu of %i tiles\n", tiles.size(), width * height);
+        return;
+    }
+    m_solidTiles.assign(width * height, 0);
     
-    loadTileWalls();
+    for (int i = 0; i < width * height; i++)
+    {
+        const uint32_t tileGID = tiles[i] & ~TILE_FLIP_FLAGS;
+        if (collidableTiles.count(tileGID))
+        {
+            m_solidTiles[i] = 1;
+        }
+    }
 }
 
 void LevelModel::loadTileWalls()
 {
-    // Create physics for tiles
-    cocos2d::TMXLayer* meta = m_tileMap->getLayer("Meta");
-    
-    if (!meta)
+    if (m_solidTiles.empty())
     {
         return;
     }
 
-    const cocos2d::Size& tileSize = m_tileMap->getTileSize();
-    const float tileWidth = tileSize.width;
-    const float tileHeight = tileSize.height;
-    const float mapHeight = tileHeight * m_tileMap->getMapSize().height;
+    // Create physics for tiles
+    const float tileWidth = m_tileSize.width;
+    const float tileHeight = m_tileSize.height;
+    const float mapHeight = tileHeight * m_mapSizeInTiles.height;
     int totalStaticBlocks = 0;
     
-    for (int column = 0; column < m_tileMap->getMapSize().height; column++)
+    for (int column = 0; column < m_mapSizeInTiles.height; column++)
     {
         bool previousTileCollidable = false;
         cocos2d::Rect box;
         
-        for (int row = 0; row < m_tileMap->getMapSize().width; row++)
+        for (int row = 0; row < m_mapSizeInTiles.width; row++)
         {
-            const uint32_t tileGID = meta->getTileGIDAt(cocos2d::Vec2(row, column));
-            cocos2d::Value tileProperties = m_tileMap->getPropertiesForGID(tileGID);
-            if (tileProperties.getType() != cocos2d::Value::Type::MAP)
-            {
-                if (previousTileCollidable)
-                {
-                    m_staticRects.push_back(box);
-                    ++totalStaticBlocks;
-                    previousTileCollidable = false;
-                }
-                continue;
-            }
-            
-            bool foundCollidable = false;
-            cocos2d::ValueMap& values = tileProperties.asValueMap();
-            for(auto& keyval : values)
-            {
-                const std::string key = keyval.first;
-                if (key == "Collidable")
-                {
-                    foundCollidable = true;
-                }
-//                else
-//                {
-//                    if (key == "Breakable")
-//                    {
-//                        box = cocos2d::Rect(tileWidth*row, mapHeight-(tileHeight*col), tileWidth, tileHeight);
-//                        foundCollidable = true;
-//                    }
-//                }
-            }
-            if (foundCollidable)
+            if (isTileSolid(cocos2d::Vec2(row, column)))
             {
                 if (previousTileCollidable)
                 {
@@ -167,70 +215,141 @@ void LevelModel::mergeTileWalls()
 //	m_staticRects = mergedRects;
 }
 
-void LevelModel::loadLights()
+void LevelModel::loadLights(const tinyxml2::XMLElement* map)
 {
-    cocos2d::TMXObjectGroup* objectGroup = m_tileMap->getObjectGroup("Lights");
+    const tinyxml2::XMLElement* objectGroup = findNamedElement(map, "objectgroup", "Lights");
     if (!objectGroup)
     {
         return;
     }
-    const auto& objects = objectGroup->getObjects();
-    for (const auto& object : objects)
+    
+    // Objects are placed from the top left of the map in TMX, the game counts from the bottom left
+    const float mapHeight = m_tileSize.height * m_mapSizeInTiles.height;
+    const cocos2d::Vec2 groupOffset = cocos2d::Vec2(objectGroup->FloatAttribute("x") * m_tileSize.width,
+                                                    objectGroup->FloatAttribute("y") * m_tileSize.height);
+    for (const tinyxml2::XMLElement* object = objectGroup->FirstChildElement("object");
+         object != nullptr;
+         object = object->NextSiblingElement("object"))
     {
-        if (object.getType() != cocos2d::Value::Type::MAP)
+        const int width = object->IntAttribute("width");
+        const int height = object->IntAttribute("height");
+        const cocos2d::Vec2 lightPosition = cocos2d::Vec2(object->IntAttribute("x") + groupOffset.x,
+                                                          mapHeight - object->IntAttribute("y") - groupOffset.y - height);
+        const float lightRadius = std::max(1.f, std::max(width, height) * 0.5f);
+        cocos2d::Color4F lightColor = cocos2d::Color4F::BLACK;
+        
+        const tinyxml2::XMLElement* properties = object->FirstChildElement("properties");
+        const tinyxml2::XMLElement* red = findNamedElement(properties, "property", "Red");
+        const tinyxml2::XMLElement* green = findNamedElement(properties, "property", "Green");
+        const tinyxml2::XMLElement* blue = findNamedElement(properties, "property", "Blue");
+        if (red)
         {
-            continue;
+            lightColor.r = red->FloatAttribute("value") / 255.f;
+        }
+        if (green)
+        {
+            lightColor.g = green->FloatAttribute("value") / 255.f;
+        }
+        if (blue)
+        {
+            lightColor.b = blue->FloatAttribute("value") / 255.f;
         }
-
-        cocos2d::Vec2 lightPosition;
-        float lightRadius = 1.f;
-        cocos2d::Color4F lightColor = cocos2d::Color4F::BLACK;
         
-        const auto& values = object.asValueMap();
-        for (const auto& value : values)
+        AddLightEvent light({lightPosition + cocos2d::Vec2(lightRadius,lightRadius), lightRadius, lightColor, -1.f});
+        m_dispatcher->dispatch(light);
+    }
+}
+
+bool LevelModel::loadLayerTiles(const tinyxml2::XMLElement* layer,
+                                std::vector<uint32_t>& tiles)
+{
+    tiles.clear();
+    const tinyxml2::XMLElement* data = layer->FirstChildElement("data");
+    if (!data || !data->GetText())
+    {
+        return false;
+    }
+    
+    const char* encoding = data->Attribute("encoding");
+    if (encoding && strcmp(encoding, "csv") == 0)
+    {
+        const char* text = data->GetText();
+        while (*text != '\0')
         {
-            if (value.first == "Red")
-            {
-                lightColor.r = std::stof(value.second.asString()) / 255.f;
-            }
-            else if (value.first == "Green")
+            char* end = nullptr;
+            const uint32_t tileGID = (uint32_t)strtoul(text, &end, 10);
+            if (end == text)
             {
-                lightColor.g = std::stof(value.second.asString()) / 255.f;
-            }
-            else if (value.first == "Blue")
-            {
-                lightColor.b = std::stof(value.second.asString()) / 255.f;
-            }
-            else if (value.first == "width" ||
-                     value.first == "height")
-            {
-                float radius = value.second.asFloat() * 0.5f;
-                if (radius > lightRadius)
-                {
-                    lightRadius = radius;
-                }
-            }
-            else if (value.first == "x")
-            {
-                lightPosition.x = value.second.asFloat();
-            }
-            else if (value.first == "y")
-            {
-                lightPosition.y = value.second.asFloat();
+                break;
             }
+            tiles.push_back(tileGID);
+            text = *end == ',' ? end + 1 : end;
         }
-        
-        AddLightEvent light({lightPosition + cocos2d::Vec2(lightRadius,lightRadius), lightRadius, lightColor, -1.f});
-        Dispatcher::globalDispatcher().dispatch(light);
+        return true;
     }
+    if (!encoding || strcmp(encoding, "base64") != 0)
+    {
+        printf("LevelModel::loadLayerTiles unsupported layer encoding %s\n", encoding ? encoding : "xml");
+        return false;
+    }
+    
+    const char* text = data->GetText();
+    unsigned char* decoded = nullptr;
+    const int decodedLength = cocos2d::base64Decode((const unsigned char*)text, (unsigned int)strlen(text), &decoded);
+    unsigned char* bytes = decoded;
+    ssize_t length = decodedLength;
+    unsigned char* inflated = nullptr;
+    if (decoded && data->Attribute("compression"))
+    {
+        // zlib and gzip alike
+        length = cocos2d::ZipUtils::inflateMemory(decoded, decodedLength, &inflated);
+        bytes = inflated;
+    }
+    if (bytes)
+    {
+        // Four bytes per tile, little endian
+        tiles.resize(length / 4);
+        for (size_t i = 0; i < tiles.size(); i++)
+        {
+            const unsigned char* tile = bytes + (i * 4);
+            tiles[i] = tile[0] | (tile[1] << 8) | (tile[2] << 16) | ((uint32_t)tile[3] << 24);
+        }
+    }
+    free(decoded);
+    free(inflated);
+    
+    return bytes != nullptr;
 }
 
-const cocos2d::Vec2 LevelModel::getRandomTile() const
+const tinyxml2::XMLElement* LevelModel::findNamedElement(const tinyxml2::XMLElement* parent,
+                                                         const char* element,
+                                                         const char* name)
 {
-    const cocos2d::Size mapSize = m_tileMap->getMapSize();
-    const cocos2d::Size tileSize = m_tileMap->getTileSize();
-    float randX = cocos2d::RandomHelper::random_real(tileSize.width, (mapSize.width-1) * tileSize.width);
-    float randY = cocos2d::RandomHelper::random_real(tileSize.height, (mapSize.height-1) * tileSize.height);
+    if (!parent)
+    {
+        return nullptr;
+    }
+    for (const tinyxml2::XMLElement* child = parent->FirstChildElement(element);
+         child != nullptr;
+         child = child->NextSiblingElement(element))
+    {
+        const char* childName = child->Attribute("name");
+        if (childName && strcmp(childName, name) == 0)
+        {
+            return child;
+        }
+    }
+    return nullptr;
+}
+
+const cocos2d::Vec2 LevelModel::getRandomTile(std::mt19937& random) const
+{
+    const cocos2d::Size& mapSize = m_mapSizeInTiles;
+    const cocos2d::Size& tileSize = m_tileSize;
+    std::uniform_real_distribution<float> tileX(tileSize.width, (mapSize.width-1) * tileSize.width);
+    std::uniform_real_distribution<float> tileY(tileSize.height, (mapSize.height-1) * tileSize.height);
+    float randX = tileX(random);
+    float randY = tileY(random);
     cocos2d::Vec2 randomTile = cocos2d::Vec2(randX / tileSize.width, mapSize.height - (randY / tileSize.height));
     while (true)
     {
@@ -238,8 +357,8 @@ const cocos2d::Vec2 LevelModel::getRandomTile() const
         {
             break;
         }
-        randX = cocos2d::RandomHelper::random_real(tileSize.width, (mapSize.width-1) * tileSize.width);
-        randY = cocos2d::RandomHelper::random_real(tileSize.height, (mapSize.height-1) * tileSize.height);
+        randX = tileX(random);
+        randY = tileY(random);
         randomTile = cocos2d::Vec2(randX / tileSize.width, mapSize.height - (randY / tileSize.height));
     }
     
@@ -248,27 +367,79 @@ const cocos2d::Vec2 LevelModel::getRandomTile() const
 
 bool LevelModel::isTileSolid(const cocos2d::Vec2 &position) const
 {
-    cocos2d::TMXLayer* meta = m_tileMap->getLayer("Meta");
-    if (!meta)
+    const int x = (int)position.x;
+    const int y = (int)position.y;
+    if (m_solidTiles.empty() ||
+        x < 0 || x >= (int)m_mapSizeInTiles.width ||
+        y < 0 || y >= (int)m_mapSizeInTiles.height)
     {
         return false;
     }
 
-    const uint32_t tileGID = meta->getTileGIDAt(position);
-    const cocos2d::Value& tileProperties = m_tileMap->getPropertiesForGID(tileGID);
-    if (tileProperties.getType() != cocos2d::Value::Type::MAP)
+    return m_solidTiles[x + (y * (int)m_mapSizeInTiles.width)] != 0;
+}
+
+bool LevelModel::rayCast(const cocos2d::Vec2& start,
+                         const cocos2d::Vec2& end,
+                         cocos2d::Vec2& hitPoint) const
+{
+    if (m_solidTiles.empty())
     {
         return false;
     }
-    
-    const cocos2d::ValueMap& values = tileProperties.asValueMap();
-    for(const auto& keyval : values)
+
+    // Amanatides-Woo grid traversal, tile rows are counted from the bottom here
+    // and flipped when looking up the solid tiles
+    const float tileWidth = m_tileSize.width;
+    const float tileHeight = m_tileSize.height;
+    const int lastRow = (int)m_mapSizeInTiles.height - 1;
+    const cocos2d::Vec2 delta = end - start;
+
+    int tileX = (int)std::floor(start.x / tileWidth);
+    int tileY = (int)std::floor(start.y / tileHeight);
+    const int endTileX = (int)std::floor(end.x / tileWidth);
+    const int endTileY = (int)std::floor(end.y / tileHeight);
+    const int stepX = delta.x > 0.f ? 1 : -1;
+    const int stepY = delta.y > 0.f ? 1 : -1;
+
+    // Fraction of the line to cross one tile, and to reach the next tile edge on each axis
+    const float tDeltaX = delta.x != 0.f ? std::abs(tileWidth / delta.x) : INFINITY;
+    const float tDeltaY = delta.y != 0.f ? std::abs(tileHeight / delta.y) : INFINITY;
+    float tMaxX = INFINITY;
+    float tMaxY = INFINITY;
+    if (delta.x != 0.f)
+    {
+        const float edgeX = (tileX + (stepX > 0 ? 1 : 0)) * tileWidth;
+        tMaxX = (edgeX - start.x) / delta.x;
+    }
+    if (delta.y != 0.f)
     {
-        const std::string& key = keyval.first;
-        if (key == "Collidable")
+        const float edgeY = (tileY + (stepY > 0 ? 1 : 0)) * tileHeight;
+        tMaxY = (edgeY - start.y) / delta.y;
+    }
+
+    const int tileCount = std::abs(endTileX - tileX) + std::abs(endTileY - tileY) + 1;
+    float t = 0.f;
+    for (int i = 0; i < tileCount; i++)
+    {
+        if (isTileSolid(cocos2d::Vec2(tileX, lastRow - tileY)))
         {
+            hitPoint = start + (delta * t);
             return true;
         }
+        if (tMaxX < tMaxY)
+        {
+            t = tMaxX;
+            tMaxX += tDeltaX;
+            tileX += stepX;
+        }
+        else
+        {
+            t = tMaxY;
+            tMaxY += tDeltaY;
+            tileY += stepY;
+        }
     }
+
     return false;
 }
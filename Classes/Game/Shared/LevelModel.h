@@ -1,7 +1,15 @@
 #ifndef LevelModel_h
 #define LevelModel_h
 
-#include "cocos2d.h"
+#include "math/CCGeometry.h"
+#include <random>
+#include <string>
+#include <vector>
+
+class Dispatcher;
+namespace tinyxml2 {
+    class XMLElement;
+}
 
 class LevelModel
 {
@@ -9,7 +17,6 @@ public:
     LevelModel();
     ~LevelModel();
 
-    cocos2d::TMXTiledMap* getTileMap() const { return m_tileMap; }
     const std::vector<cocos2d::Rect>& getStaticRects() const { return m_staticRects; }
 
     void loadLevel(const std::string& level,
@@ -17,20 +24,47 @@ public:
     void unloadLevel();
     
     const cocos2d::Size getMapSize() const;
+    const cocos2d::Size& getMapSizeInTiles() const { return m_mapSizeInTiles; }
+    const cocos2d::Size& getTileSize() const { return m_tileSize; }
 
-    const cocos2d::Vec2 getRandomTile() const;
+    // Takes the engine of the match asking, several matches can share a process
+    const cocos2d::Vec2 getRandomTile(std::mt19937& random) const;
     bool isTileSolid(const cocos2d::Vec2& tilePos) const;
+    // Walks the tiles along the line in order, outputs where it enters the first solid one
+    // Lines starting inside a solid tile hit at their start
+    bool rayCast(const cocos2d::Vec2& start,
+                 const cocos2d::Vec2& end,
+                 cocos2d::Vec2& hitPoint) const;
 
     const std::string& getLevel() const { return m_level; }
+    // Where the views create the tile map to draw from, the model only keeps what the game needs
+    const std::string getLevelPath() const;
+    
+    // Light events go to the global dispatcher unless the level belongs to a server match
+    void setDispatcher(Dispatcher& dispatcher) { m_dispatcher = &dispatcher; }
 private:
-    cocos2d::RefPtr<cocos2d::TMXTiledMap> m_tileMap;
+    static const std::string LEVEL_FOLDER;
+    static const uint32_t TILE_FLIP_FLAGS;
+
     std::vector<cocos2d::Rect> m_staticRects;
+    std::vector<uint8_t> m_solidTiles; // One per tile, row major from the top like the TMX layers
+    cocos2d::Size m_mapSizeInTiles;
+    cocos2d::Size m_tileSize;
     std::string m_level;
+    Dispatcher* m_dispatcher;
     
-    void loadTileMap(const std::string& tileMap);
+    bool loadMapInfo(const std::string& tileMap, const bool lights);
+    void loadSolidTiles(const tinyxml2::XMLElement* map);
     void loadTileWalls();
     void mergeTileWalls();
-    void loadLights();
+    void loadLights(const tinyxml2::XMLElement* map);
+    
+    // Tile GIDs of a layer, row major from the top, base64 with or without compression or CSV
+    static bool loadLayerTiles(const tinyxml2::XMLElement* layer,
+                               std::vector<uint32_t>& tiles);
+    static const tinyxml2::XMLElement* findNamedElement(const tinyxml2::XMLElement* parent,
+                                                        const char* element,
+                                                        const char* name);
 };
 
 #endif /* LevelModel_h */
@@ -1,5 +1,6 @@
 #include "LoadStaticEntityDataCommand.h"
 #include "external/tinyxml2/tinyxml2.h"
+#include "platform/CCFileUtils.h"
 
 const std::map<std::string, WeaponType> WEAPON_TYPES =
 {
@@ -2,10 +2,11 @@
 #include "EntityDataModel.h"
 #include "CollisionUtils.h"
 #include "SharedConstants.h"
+#include "SpatialGrid.h"
 #include "Game/Shared/EntityConstants.h"
 
 
-std::function<void(const CollisionData collisionData)> MovementIntegrator::s_collisionCallback = nullptr;
+thread_local std::function<void(const CollisionData collisionData)> MovementIntegrator::s_collisionCallback = nullptr;
 
 void MovementIntegrator::setCollisionCallback(std::function<void(const CollisionData collisionData)> collisionCallback)
 {
@@ -19,6 +20,71 @@ void MovementIntegrator::integratePosition(const float deltaTime,
                                            const float angularVelocity,
                                            const std::map<uint32_t, EntitySnapshot>& snapshot,
                                            const std::vector<cocos2d::Rect>& staticRects)
+{
+    CollisionData collision;
+    if (integratePositionInternal(deltaTime, entityID, entity, velocity, angularVelocity, snapshot, staticRects, nullptr, collision) &&
+        s_collisionCallback)
+    {
+        s_collisionCallback(collision);
+    }
+}
+
+void MovementIntegrator::integratePosition(const float deltaTime,
+                                           const uint32_t entityID,
+                                           EntitySnapshot& entity,
+                                           const cocos2d::Vec2& velocity,
+                                           const float angularVelocity,
+                                           const std::map<uint32_t, EntitySnapshot>& snapshot,
+                                           const std::vector<cocos2d::Rect>& staticRects,
+                                           const SpatialGrid& grid)
+{
+    CollisionData collision;
+    if (integratePositionInternal(deltaTime, entityID, entity, velocity, angularVelocity, snapshot, staticRects, &grid, collision) &&
+        s_collisionCallback)
+    {
+        s_collisionCallback(collision);
+    }
+}
+
+bool MovementIntegrator::integratePosition(const float deltaTime,
+                                           const uint32_t entityID,
+                                           EntitySnapshot& entity,
+                                           const cocos2d::Vec2& velocity,
+                                           const float angularVelocity,
+                                           const std::map<uint32_t, EntitySnapshot>& snapshot,
+                                           const std::vector<cocos2d::Rect>& staticRects,
+                                           const SpatialGrid& grid,
+                                           CollisionData& collision)
+{
+    return integratePositionInternal(deltaTime, entityID, entity, velocity, angularVelocity, snapshot, staticRects, &grid, collision);
+}
+
+cocos2d::Rect MovementIntegrator::getCollisionBounds(const EntitySnapshot& entity)
+{
+    const cocos2d::Vec2 position = cocos2d::Vec2(entity.positionX, entity.positionY);
+    const auto& rects = EntityDataModel::getCollisionRects((EntityType)entity.type);
+    if (rects.empty())
+    {
+        return cocos2d::Rect(position, cocos2d::Size::ZERO);
+    }
+
+    cocos2d::Rect bounds = cocos2d::Rect(rects.front().origin + position, rects.front().size);
+    for (const cocos2d::Rect& baseRect : rects)
+    {
+        bounds.merge(cocos2d::Rect(baseRect.origin + position, baseRect.size));
+    }
+    return bounds;
+}
+
+bool MovementIntegrator::integratePositionInternal(const float deltaTime,
+                                                   const uint32_t entityID,
+                                                   EntitySnapshot& entity,
+                                                   const cocos2d::Vec2& velocity,
+                                                   const float angularVelocity,
+                                                   const std::map<uint32_t, EntitySnapshot>& snapshot,
+                                                   const std::vector<cocos2d::Rect>& staticRects,
+                                                   const SpatialGrid* grid,
+                                                   CollisionData& collision)
 {
     const bool useContinuousCollisionDetection = true;
 
@@ -33,7 +99,7 @@ void MovementIntegrator::integratePosition(const float deltaTime,
     
     if (velocity == cocos2d::Vec2::ZERO)
     {
-        return;
+        return false;
     }
     
     const cocos2d::Vec2 originalPosition = cocos2d::Vec2(entity.positionX, entity.positionY);
@@ -46,20 +112,18 @@ void MovementIntegrator::integratePosition(const float deltaTime,
     }
     
     float movementRatio = 1.f;
-    // Check collision rect against all other entities
-    for (const auto& collisionEntityPair : snapshot)
+    auto checkEntityCollider = [&](const uint32_t colliderID, const EntitySnapshot& colliderEntity)
     {
-        if (entityID == collisionEntityPair.first)
+        if (entityID == colliderID)
         {
-            continue; // No need to test against own shapes
+            return; // No need to test against own shapes
         }
         
-        const EntitySnapshot& colliderEntity = collisionEntityPair.second;
         if ((colliderEntity.type > EntityType::Item_First_Placeholder &&
             colliderEntity.type < EntityType::Item_Last_Placeholder) ||
             colliderEntity.type == EntityType::Loot_Box)
         {
-            continue; // No collisions against items
+            return; // No collisions against items
         }
         
         size_t shapeIndex = 0;
@@ -73,7 +137,7 @@ void MovementIntegrator::integratePosition(const float deltaTime,
             if (newRatio < movementRatio)
             {
                 movementRatio = newRatio;
-                collisionEntityID = collisionEntityPair.first;
+                collisionEntityID = colliderID;
                 collisionShapeIndex = shapeIndex;
             }
             shapeIndex++;
@@ -84,19 +148,65 @@ void MovementIntegrator::integratePosition(const float deltaTime,
                 break;
             }
         }
-    }
-    
-    size_t staticColliderID = 0;
-    for (const auto& staticRect : staticRects)
+    };
+    auto checkStaticCollider = [&](const size_t staticColliderID)
     {
-        const float newRatio = getMovementRatio(entity, velocity, staticRect, cocos2d::Vec2::ZERO, deltaTime);
+        const float newRatio = getMovementRatio(entity, velocity, staticRects.at(staticColliderID), cocos2d::Vec2::ZERO, deltaTime);
         if (newRatio < movementRatio)
         {
             movementRatio = newRatio;
             isStaticCollision = true;
             collisionShapeIndex = staticColliderID;
         }
-        staticColliderID++;
+    };
+    
+    if (grid)
+    {
+        // Broadphase: only sweep against whatever the grid holds along the path of our
+        // bottom-most shape, candidates come back sorted so results match the full scan
+        static thread_local std::vector<uint32_t> s_entityCandidates;
+        static thread_local std::vector<size_t> s_staticCandidates;
+        if (s_staticCandidates.capacity() < COLLISION_GRID_QUERY_CAPACITY)
+        {
+            s_entityCandidates.reserve(COLLISION_GRID_QUERY_CAPACITY);
+            s_staticCandidates.reserve(COLLISION_GRID_QUERY_CAPACITY);
+        }
+        const auto& rects = EntityDataModel::getCollisionRects((EntityType)entity.type);
+        if (!rects.empty())
+        {
+            const cocos2d::Rect startRect = cocos2d::Rect(rects.at(0).origin + originalPosition, rects.at(0).size);
+            cocos2d::Rect sweptRect = cocos2d::Rect(startRect.origin + (velocity * deltaTime), startRect.size);
+            sweptRect.merge(startRect);
+            sweptRect.origin -= cocos2d::Vec2(COLLISION_GRID_QUERY_MARGIN, COLLISION_GRID_QUERY_MARGIN);
+            sweptRect.size = sweptRect.size + cocos2d::Size(COLLISION_GRID_QUERY_MARGIN * 2.f, COLLISION_GRID_QUERY_MARGIN * 2.f);
+
+            grid->queryEntities(sweptRect, s_entityCandidates);
+            for (const uint32_t colliderID : s_entityCandidates)
+            {
+                auto colliderIt = snapshot.find(colliderID);
+                if (colliderIt != snapshot.end())
+                {
+                    checkEntityCollider(colliderID, colliderIt->second);
+                }
+            }
+            grid->queryStaticRects(sweptRect, s_staticCandidates);
+            for (const size_t staticColliderID : s_staticCandidates)
+            {
+                checkStaticCollider(staticColliderID);
+            }
+        }
+    }
+    else
+    {
+        // Check collision rect against all other entities
+        for (const auto& collisionEntityPair : snapshot)
+        {
+            checkEntityCollider(collisionEntityPair.first, collisionEntityPair.second);
+        }
+        for (size_t staticColliderID = 0; staticColliderID < staticRects.size(); staticColliderID++)
+        {
+            checkStaticCollider(staticColliderID);
+        }
     }
     
     if (useContinuousCollisionDetection &&
@@ -109,14 +219,14 @@ void MovementIntegrator::integratePosition(const float deltaTime,
     
     if ((entity.type == Projectile_Bullet ||
          entity.type == Projectile_Rocket) &&
-        movementRatio < 1.f &&
-        s_collisionCallback)
+        movementRatio < 1.f)
     {
-        const CollisionData collision = {
+        collision = {
             (uint16_t)entityID, collisionEntityID, isStaticCollision, collisionShapeIndex
         };
-        s_collisionCallback(collision);
+        return true;
     }
+    return false;
 }
 
 float MovementIntegrator::getMovementRatio(EntitySnapshot& entity,
@@ -3,6 +3,8 @@
 
 #include "Network/NetworkMessages.h"
 
+class SpatialGrid;
+
 struct CollisionData {
     uint16_t entityID;
     uint16_t colliderID;
@@ -21,14 +23,48 @@ public:
                                   const float angularVelocity,
                                   const std::map<uint32_t, EntitySnapshot>& snapshot,
                                   const std::vector<cocos2d::Rect>& staticRects);
+    // Same as above but only sweeps against colliders the grid finds along the movement
+    static void integratePosition(const float deltaTime,
+                                  const uint32_t entityID,
+                                  EntitySnapshot& entity,
+                                  const cocos2d::Vec2& velocity,
+                                  const float angularVelocity,
+                                  const std::map<uint32_t, EntitySnapshot>& snapshot,
+                                  const std::vector<cocos2d::Rect>& staticRects,
+                                  const SpatialGrid& grid);
+    // Same as above but the projectile hit is returned instead of going to the collision callback,
+    // only the entity gets written so several can be integrated at once against a snapshot nobody moves
+    static bool integratePosition(const float deltaTime,
+                                  const uint32_t entityID,
+                                  EntitySnapshot& entity,
+                                  const cocos2d::Vec2& velocity,
+                                  const float angularVelocity,
+                                  const std::map<uint32_t, EntitySnapshot>& snapshot,
+                                  const std::vector<cocos2d::Rect>& staticRects,
+                                  const SpatialGrid& grid,
+                                  CollisionData& collision);
     static float getMovementRatio(EntitySnapshot& entity,
                                   const cocos2d::Vec2& velocity,
                                   const cocos2d::Rect& colliderRect,
                                   const cocos2d::Vec2& colliderVelocity,
                                   const float deltaTime);
-    
+    // Union of all collision rects for the entity at its current position
+    static cocos2d::Rect getCollisionBounds(const EntitySnapshot& entity);
+
 private:
-    static std::function<void(const CollisionData collisionData)> s_collisionCallback;
+    // Per thread, every server match integrates its own entities on its own thread
+    static thread_local std::function<void(const CollisionData collisionData)> s_collisionCallback;
+
+    // Returns true and fills the collision when a projectile hit something
+    static bool integratePositionInternal(const float deltaTime,
+                                          const uint32_t entityID,
+                                          EntitySnapshot& entity,
+                                          const cocos2d::Vec2& velocity,
+                                          const float angularVelocity,
+                                          const std::map<uint32_t, EntitySnapshot>& snapshot,
+                                          const std::vector<cocos2d::Rect>& staticRects,
+                                          const SpatialGrid* grid,
+                                          CollisionData& collision);
 };
 
 #endif /* MovementIntegrator_h */
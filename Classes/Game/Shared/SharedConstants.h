@@ -9,5 +9,32 @@ static const float EXPLOSION_RADIUS = 64.f;
 static const float DEFAULT_RELOAD_TIME = 1.f;
 static const float DEFAULT_HEADSHOT_DAMAGE_MULTIPLIER = 1.5f;
 static const float AIM_RADIUS = 64.f;
+static const float COLLISION_GRID_CELL_SIZE = 64.f;
+static const float COLLISION_GRID_QUERY_MARGIN = 1.f;
+static const size_t COLLISION_GRID_QUERY_CAPACITY = 256; // Candidates each thread has room for up front
+static const size_t SNAPSHOT_BASELINE_BUFFER_SIZE = 64;
+static const size_t SNAPSHOT_HIT_CAPACITY = 32; // Hits of one tick every kept snapshot has room for up front
+static const float SNAPSHOT_RELEVANCY_RADIUS = 512.f;
+static const float SNAPSHOT_POSITION_RESOLUTION = 1.f / 16.f;
+static const uint8_t SNAPSHOT_ROTATION_BITS = 10;
+static const float RELEVANCY_GRID_CELL_SIZE = 128.f;
+static const float SNAPSHOT_BANDWIDTH_SHARE = 0.8f; // Of a client's estimated bandwidth, the rest is left for everything else
+static const size_t SNAPSHOT_MIN_ENTITIES = 16; // Highest priority entities sent however tight the budget gets
+static const float SNAPSHOT_MAX_BYTES = 1024.f; // Keeps snapshots within one unfragmented packet
+static const float SNAPSHOT_PRIORITY_PLAYER = 4.f;
+static const float SNAPSHOT_PRIORITY_PROJECTILE = 3.f;
+static const float SNAPSHOT_PRIORITY_DEFAULT = 1.f;
+static const float SNAPSHOT_PRIORITY_CHANGED_SCALE = 2.f;
+// Items per job system batch for the parallel parts of a server tick, small enough to balance and big enough to be worth a batch
+static const size_t JOB_BATCH_BOTS = 2;
+static const size_t JOB_BATCH_INTEGRATION = 64;
+static const size_t JOB_BATCH_SNAPSHOTS = 1;
+static const size_t JOB_BATCH_FLOW_FIELDS = 1;
+// Bots chasing a moving player follow a field at most this many ticks behind them
+static const uint32_t AI_CHASE_FIELD_REFRESH_TICKS = 2;
+static const uint32_t AI_CHASE_FIELD_IDLE_TICKS = 60 * 5; // Unchased this long and a player's field is freed until they respawn
+// Entities bots thinking in one tick may look at between them, those that don't fit wait for a later tick
+static const uint32_t AI_THINK_BUDGET = 512;
+static const uint32_t AI_THINK_BASE_COST = 8; // On top of the entities looked at, all a bot costs before its first think
 
 #endif /* SharedConstants_h */
@@ -0,0 +1,36 @@
+#include "SnapshotBuffer.h"
+#include "SharedConstants.h"
+
+SnapshotBuffer::SnapshotBuffer()
+: m_snapshots(SNAPSHOT_BASELINE_BUFFER_SIZE)
+, m_validSnapshots(SNAPSHOT_BASELINE_BUFFER_SIZE, false)
+{
+    for (auto& snapshot : m_snapshots)
+    {
+        snapshot.hitData.reserve(SNAPSHOT_HIT_CAPACITY);
+    }
+}
+
+void SnapshotBuffer::storeSnapshot(const SnapshotData& data)
+{
+    // Assigning over the old entry lets the containers reuse their storage
+    const size_t index = data.serverTick % m_snapshots.size();
+    m_snapshots[index] = data;
+    m_validSnapshots[index] = true;
+}
+
+const SnapshotData* SnapshotBuffer::getSnapshot(const uint32_t serverTick) const
+{
+    const size_t index = serverTick % m_snapshots.size();
+    if (!m_validSnapshots[index] ||
+        m_snapshots[index].serverTick != serverTick)
+    {
+        return nullptr;
+    }
+    return &m_snapshots[index];
+}
+
+void SnapshotBuffer::clear()
+{
+    std::fill(m_validSnapshots.begin(), m_validSnapshots.end(), false);
+}
@@ -0,0 +1,24 @@
+#ifndef SnapshotBuffer_h
+#define SnapshotBuffer_h
+
+#include "Network/NetworkMessages.h"
+#include <vector>
+
+// Bounded ring of sent or received snapshots, indexed by server tick.
+// Used as delta baselines, a tick older than the capacity is simply gone.
+class SnapshotBuffer
+{
+public:
+    SnapshotBuffer();
+
+    void storeSnapshot(const SnapshotData& data);
+    // Returns nullptr when the tick was never stored or has been overwritten
+    const SnapshotData* getSnapshot(const uint32_t serverTick) const;
+    void clear();
+
+private:
+    std::vector<SnapshotData> m_snapshots;
+    std::vector<bool> m_validSnapshots;
+};
+
+#endif /* SnapshotBuffer_h */
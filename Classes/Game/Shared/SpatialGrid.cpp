@@ -0,0 +1,178 @@
+#include "SpatialGrid.h"
+
+#include <algorithm>
+
+// Room every cell starts with, entities walking into a cell for the first time don't allocate
+const size_t SpatialGrid::CELL_ENTITY_CAPACITY = 16;
+
+SpatialGrid::SpatialGrid()
+: m_origin(cocos2d::Vec2::ZERO)
+, m_cellSize(1.f)
+, m_columns(0)
+, m_rows(0)
+{
+}
+
+void SpatialGrid::setup(const cocos2d::Rect& bounds, const float cellSize)
+{
+    assert(cellSize > 0.f);
+    m_origin = bounds.origin;
+    m_cellSize = cellSize;
+    m_columns = std::max((int)std::ceil(bounds.size.width / cellSize), 1);
+    m_rows = std::max((int)std::ceil(bounds.size.height / cellSize), 1);
+
+    m_entityCells.clear();
+    m_entityCells.resize(m_columns * m_rows);
+    for (auto& cell : m_entityCells)
+    {
+        cell.reserve(CELL_ENTITY_CAPACITY);
+    }
+    m_staticCells.clear();
+    m_staticCells.resize(m_columns * m_rows);
+}
+
+void SpatialGrid::setStaticRects(const std::vector<cocos2d::Rect>& staticRects)
+{
+    for (auto& cell : m_staticCells)
+    {
+        cell.clear();
+    }
+
+    for (size_t index = 0; index < staticRects.size(); index++)
+    {
+        const CellRange range = getCellRange(staticRects.at(index));
+        for (int y = range.minY; y <= range.maxY; y++)
+        {
+            for (int x = range.minX; x <= range.maxX; x++)
+            {
+                m_staticCells[getCellIndex(x, y)].push_back(index);
+            }
+        }
+    }
+}
+
+void SpatialGrid::clearEntities()
+{
+    // Keep the cell capacity around, a full rebuild every tick shouldn't allocate
+    for (auto& cell : m_entityCells)
+    {
+        cell.clear();
+    }
+}
+
+void SpatialGrid::insertEntity(const uint32_t entityID, const cocos2d::Rect& bounds)
+{
+    if (!isSetup())
+    {
+        return;
+    }
+    const CellRange range = getCellRange(bounds);
+    for (int y = range.minY; y <= range.maxY; y++)
+    {
+        for (int x = range.minX; x <= range.maxX; x++)
+        {
+            m_entityCells[getCellIndex(x, y)].push_back(entityID);
+        }
+    }
+}
+
+void SpatialGrid::removeEntity(const uint32_t entityID, const cocos2d::Rect& bounds)
+{
+    if (!isSetup())
+    {
+        return;
+    }
+    const CellRange range = getCellRange(bounds);
+    for (int y = range.minY; y <= range.maxY; y++)
+    {
+        for (int x = range.minX; x <= range.maxX; x++)
+        {
+            auto& cell = m_entityCells[getCellIndex(x, y)];
+            auto it = std::find(cell.begin(), cell.end(), entityID);
+            if (it != cell.end())
+            {
+                *it = cell.back();
+                cell.pop_back();
+            }
+        }
+    }
+}
+
+void SpatialGrid::moveEntity(const uint32_t entityID,
+                             const cocos2d::Rect& oldBounds,
+                             const cocos2d::Rect& newBounds)
+{
+    const CellRange oldRange = getCellRange(oldBounds);
+    const CellRange newRange = getCellRange(newBounds);
+    if (oldRange.minX == newRange.minX &&
+        oldRange.minY == newRange.minY &&
+        oldRange.maxX == newRange.maxX &&
+        oldRange.maxY == newRange.maxY)
+    {
+        return; // Still covering the same cells
+    }
+
+    removeEntity(entityID, oldBounds);
+    insertEntity(entityID, newBounds);
+}
+
+void SpatialGrid::queryEntities(const cocos2d::Rect& area, std::vector<uint32_t>& entityIDs) const
+{
+    entityIDs.clear();
+    if (!isSetup())
+    {
+        return;
+    }
+
+    const CellRange range = getCellRange(area);
+    for (int y = range.minY; y <= range.maxY; y++)
+    {
+        for (int x = range.minX; x <= range.maxX; x++)
+        {
+            const auto& cell = m_entityCells[getCellIndex(x, y)];
+            entityIDs.insert(entityIDs.end(), cell.begin(), cell.end());
+        }
+    }
+
+    // Entities spanning several cells show up more than once
+    std::sort(entityIDs.begin(), entityIDs.end());
+    entityIDs.erase(std::unique(entityIDs.begin(), entityIDs.end()), entityIDs.end());
+}
+
+void SpatialGrid::queryStaticRects(const cocos2d::Rect& area, std::vector<size_t>& staticRectIndices) const
+{
+    staticRectIndices.clear();
+    if (!isSetup())
+    {
+        return;
+    }
+
+    const CellRange range = getCellRange(area);
+    for (int y = range.minY; y <= range.maxY; y++)
+    {
+        for (int x = range.minX; x <= range.maxX; x++)
+        {
+            const auto& cell = m_staticCells[getCellIndex(x, y)];
+            staticRectIndices.insert(staticRectIndices.end(), cell.begin(), cell.end());
+        }
+    }
+
+    std::sort(staticRectIndices.begin(), staticRectIndices.end());
+    staticRectIndices.erase(std::unique(staticRectIndices.begin(), staticRectIndices.end()), staticRectIndices.end());
+}
+
+const SpatialGrid::CellRange SpatialGrid::getCellRange(const cocos2d::Rect& rect) const
+{
+    const float invCellSize = 1.f / m_cellSize;
+    CellRange range;
+    range.minX = (int)std::floor((rect.getMinX() - m_origin.x) * invCellSize);
+    range.minY = (int)std::floor((rect.getMinY() - m_origin.y) * invCellSize);
+    range.maxX = (int)std::floor((rect.getMaxX() - m_origin.x) * invCellSize);
+    range.maxY = (int)std::floor((rect.getMaxY() - m_origin.y) * invCellSize);
+
+    range.minX = std::min(std::max(range.minX, 0), m_columns - 1);
+    range.minY = std::min(std::max(range.minY, 0), m_rows - 1);
+    range.maxX = std::min(std::max(range.maxX, 0), m_columns - 1);
+    range.maxY = std::min(std::max(range.maxY, 0), m_rows - 1);
+    return range;
+}
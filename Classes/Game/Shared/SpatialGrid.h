@@ -0,0 +1,51 @@
+#ifndef SpatialGrid_h
+#define SpatialGrid_h
+
+#include "math/CCGeometry.h"
+
+// Uniform grid broadphase over the level bounds.
+// Cells store entity IDs and static rect indices, anything outside the
+// bounds is clamped into the edge cells so queries stay conservative.
+class SpatialGrid
+{
+public:
+    SpatialGrid();
+
+    void setup(const cocos2d::Rect& bounds, const float cellSize);
+    void setStaticRects(const std::vector<cocos2d::Rect>& staticRects);
+    bool isSetup() const { return m_columns > 0 && m_rows > 0; }
+
+    void clearEntities();
+    void insertEntity(const uint32_t entityID, const cocos2d::Rect& bounds);
+    void removeEntity(const uint32_t entityID, const cocos2d::Rect& bounds);
+    void moveEntity(const uint32_t entityID,
+                    const cocos2d::Rect& oldBounds,
+                    const cocos2d::Rect& newBounds);
+
+    // Results are sorted and contain no duplicates, output vectors are cleared first
+    void queryEntities(const cocos2d::Rect& area, std::vector<uint32_t>& entityIDs) const;
+    void queryStaticRects(const cocos2d::Rect& area, std::vector<size_t>& staticRectIndices) const;
+
+private:
+    static const size_t CELL_ENTITY_CAPACITY;
+
+    struct CellRange {
+        int minX;
+        int minY;
+        int maxX;
+        int maxY;
+    };
+
+    cocos2d::Vec2 m_origin;
+    float m_cellSize;
+    int m_columns;
+    int m_rows;
+
+    std::vector<std::vector<uint32_t>> m_entityCells;
+    std::vector<std::vector<size_t>> m_staticCells;
+
+    const CellRange getCellRange(const cocos2d::Rect& rect) const;
+    int getCellIndex(const int x, const int y) const { return (y * m_columns) + x; }
+};
+
+#endif /* SpatialGrid_h */
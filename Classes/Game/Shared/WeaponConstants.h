@@ -1,7 +1,7 @@
 #ifndef WeaponConstants_h
 #define WeaponConstants_h
 
-#include "cocos2d.h"
+#include "math/Vec2.h"
 
 namespace WeaponConstants
 {
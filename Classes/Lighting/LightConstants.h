@@ -1,7 +1,7 @@
 #ifndef LightConstants_h
 #define LightConstants_h
 
-#include "cocos2d.h"
+#include "base/ccTypes.h"
 
 enum LightType
 {
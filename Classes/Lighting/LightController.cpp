@@ -2,6 +2,7 @@
 #include "LightModel.h"
 #include "AddLightEvent.h"
 #include "RemoveLightEvent.h"
+#include "OccludersChangedEvent.h"
 #include "Core/Dispatcher.h"
 #include "Core/Injector.h"
 #include "GameView.h"
@@ -12,6 +13,7 @@ const std::string LightController::SETTING_RENDER_LIGHTING = "RenderLighting";
 const int LightController::MAX_LIGHT_RESOLUTION = 512;
 const cocos2d::Size LightController::LIGHT_TEXTURE_SIZE = cocos2d::Size(MAX_LIGHT_RESOLUTION, MAX_LIGHT_RESOLUTION);
 const cocos2d::Rect LightController::LIGHT_TEXTURE_RECT = cocos2d::Rect(cocos2d::Vec2::ZERO, LIGHT_TEXTURE_SIZE);
+const size_t LightController::MAX_CACHED_SHADOW_MAPS = 32;
 
 LightController::LightController(std::shared_ptr<LightModel> model,
                                  std::shared_ptr<GameSettings> gameSettings)
@@ -27,6 +29,7 @@ LightController::LightController(std::shared_ptr<LightModel> model,
 , m_shadowMapNoBlurShader(nullptr)
 , m_lightShader(nullptr)
 , m_windowResizeListener(nullptr)
+, m_frameCount(0)
 , m_enabled(false)
 , m_drawDebug(false)
 {
@@ -46,6 +49,9 @@ void LightController::initialize()
     Dispatcher::globalDispatcher().addListener<RemoveLightEvent>(std::bind(&LightController::onRemoveLight,
                                                                            this, std::placeholders::_1),
                                                                  this);
+    Dispatcher::globalDispatcher().addListener<OccludersChangedEvent>(std::bind(&LightController::onOccludersChanged,
+                                                                                this, std::placeholders::_1),
+                                                                      this);
 
     auto dispatcher = cocos2d::Director::getInstance()->getEventDispatcher();
     m_windowResizeListener = dispatcher->addCustomEventListener(cocos2d::GLViewImpl::EVENT_WINDOW_RESIZED,
@@ -63,6 +69,7 @@ void LightController::shutdown()
 {
     Dispatcher::globalDispatcher().removeListener<AddLightEvent>(this);
     Dispatcher::globalDispatcher().removeListener<RemoveLightEvent>(this);
+    Dispatcher::globalDispatcher().removeListener<OccludersChangedEvent>(this);
     cocos2d::Director::getInstance()->getEventDispatcher()->removeEventListener(m_windowResizeListener);
 
     m_occluderTexture = nullptr;
@@ -75,6 +82,9 @@ void LightController::shutdown()
     m_shadowMapNoBlurShader = nullptr;
     m_lightShader = nullptr;
     m_windowResizeListener = nullptr;
+    m_cachedShadowMaps.clear();
+    m_dynamicOccluderRects.clear();
+    m_cachedLightSprites.clear();
     
     m_enabled = false;
     m_drawDebug = false;
@@ -126,6 +136,8 @@ void LightController::enable()
     m_shadowMapNoBlurShader = cocos2d::GLProgram::createWithFilenames("res/shaders/vertex.vsh", "res/shaders/shadow_map_noblur.fsh");
     m_lightShader = cocos2d::GLProgram::createWithFilenames("res/shaders/vertex.vsh", "res/shaders/light_noshadow.fsh");
     
+    m_cachedShadowMaps.clear();
+    
     m_enabled = true;
     printf("LightController:: enabled with resolution: %f, %f\n", winSize.width, winSize.height);
 }
@@ -156,6 +168,11 @@ void LightController::update(const float deltaTime)
 
     renderStaticLights();
     
+    for (auto& cachePair : m_cachedShadowMaps)
+    {
+        cachePair.second.invalidTime = std::max(cachePair.second.invalidTime - deltaTime, 0.f);
+    }
+
     std::map<size_t, LightData>& lights = m_model->getLights();
     if (lights.empty())
     {
@@ -177,14 +194,19 @@ void LightController::update(const float deltaTime)
     viewPos.x = std::round(viewPos.x);
     viewPos.y = std::round(viewPos.y);
 #endif
-    if (m_model->getDrawShadows())
+    const bool drawShadows = m_model->getDrawShadows();
+    if (drawShadows)
     {
-        renderOccluders();
+        collectDynamicOccluders();
     }
     else
     {
         renderLight(cocos2d::Color4F::WHITE, MAX_LIGHT_RESOLUTION * 0.5f);
     }
+    // Occluders are only rendered once a light needs its shadows computed
+    bool renderedOccluders = false;
+    m_cachedLightSprites.clear();
+    m_frameCount++;
     
     std::vector<size_t> deadLightIDs;
     for (auto& lightPair : lights)
@@ -225,28 +247,81 @@ void LightController::update(const float deltaTime)
         const cocos2d::Vec2 lightIntersectPosition = cocos2d::Vec2(lightRadius, lightRadius) - lightIntersectDiff;
         const cocos2d::Size lightSize = lightRadiusSize * 2.f;
         const cocos2d::Vec2 lightRenderPosition = (lightScreenPosition - lightRadiusSize) * 0.5f;
+        bool isCached = false;
         
-        if (m_model->getDrawShadows())
+        if (drawShadows)
         {
-            renderOccludersToShadowMap(lightScreenIntersect, lightScreenRect);
+            // Only lights that stay in place can be cached, and only while all of the light is on screen
+            // as the occluders are read from the visible area
+            const bool isClipped = lightScreenRect.origin.x < 0.f || lightScreenRect.origin.y < 0.f ||
+                                   lightScreenRect.getMaxX() > winSize.width || lightScreenRect.getMaxY() > winSize.height;
+            CachedShadowMap* cachedShadowMap = nullptr;
+            if (light.lifeTime == -1.f &&
+                !isClipped &&
+                lightSize.width <= MAX_LIGHT_RESOLUTION &&
+                !hasDynamicOccluders(lightRect))
+            {
+                cachedShadowMap = &m_cachedShadowMaps[lightPair.first];
+                if (cachedShadowMap->position != lightPosition ||
+                    cachedShadowMap->radius != lightRadius ||
+                    cachedShadowMap->color != light.color)
+                {
+                    cachedShadowMap->texture = nullptr;
+                    cachedShadowMap->position = lightPosition;
+                    cachedShadowMap->radius = lightRadius;
+                    cachedShadowMap->color = light.color;
+                }
+                if (cachedShadowMap->invalidTime > 0.f)
+                {
+                    cachedShadowMap->texture = nullptr;
+                    cachedShadowMap = nullptr;
+                }
+            }
             
-            renderDistanceToLight(lightScreenRect, lightScreenIntersect, lightScreenPosition, lightRadius);
-
-            renderMinimumDistance(lightScreenIntersect, lightIntersectPosition, lightRadius);
+            if (cachedShadowMap && cachedShadowMap->texture)
+            {
+                isCached = true;
+            }
+            else
+            {
+                if (!renderedOccluders)
+                {
+                    renderOccluders();
+                    renderedOccluders = true;
+                }
+                
+                renderOccludersToShadowMap(lightScreenIntersect, lightScreenRect);
+                
+                renderDistanceToLight(lightScreenRect, lightScreenIntersect, lightScreenPosition, lightRadius);
 
-            renderShadows(light.color, lightRenderPosition, lightRadius, lightScreenRect, lightScreenIntersect);
+                renderMinimumDistance(lightScreenIntersect, lightIntersectPosition, lightRadius);
 
-            bool clipTop = lightScreenRect.size.height > lightScreenIntersect.size.height && lightScreenRect.origin.y < lightScreenIntersect.origin.y;
-            bool clipRight = lightScreenRect.size.width > lightScreenIntersect.size.width && lightScreenRect.origin.x < lightScreenIntersect.origin.x;
-            const cocos2d::Vec2 relativeOccluderPos = cocos2d::Vec2(clipRight ? lightScreenIntersect.origin.x : lightRenderPosition.x,
-                                                                    clipTop ? lightScreenIntersect.origin.y : lightRenderPosition.y);
+                renderShadows(light.color, lightRenderPosition, lightRadius, lightScreenRect, lightScreenIntersect);
+                
+                isCached = cachedShadowMap && storeShadowMap(*cachedShadowMap, lightSize);
+            }
             
-            auto lightSprite = m_shadowMapTexture->getSprite();
-            lightSprite->setBlendFunc(cocos2d::BlendFunc::ADDITIVE);
-            lightSprite->setPosition(relativeOccluderPos);
-            lightSprite->setTextureRect(cocos2d::Rect(cocos2d::Vec2::ZERO, lightScreenIntersect.size));
-            lightSprite->setGLProgram(cocos2d::GLProgramCache::getInstance()->getGLProgram(cocos2d::GLProgram::SHADER_NAME_POSITION_TEXTURE_COLOR));
-            renderToTexture(m_shadowMapTexture->getSprite(), m_lightMapTexture);
+            if (isCached)
+            {
+                // Cached lights are all added to the lightmap in one pass after the loop
+                cachedShadowMap->lastUsedFrame = m_frameCount;
+                cachedShadowMap->texture->getSprite()->setPosition(lightRenderPosition);
+                m_cachedLightSprites.push_back(cachedShadowMap->texture->getSprite());
+            }
+            else
+            {
+                bool clipTop = lightScreenRect.size.height > lightScreenIntersect.size.height && lightScreenRect.origin.y < lightScreenIntersect.origin.y;
+                bool clipRight = lightScreenRect.size.width > lightScreenIntersect.size.width && lightScreenRect.origin.x < lightScreenIntersect.origin.x;
+                const cocos2d::Vec2 relativeOccluderPos = cocos2d::Vec2(clipRight ? lightScreenIntersect.origin.x : lightRenderPosition.x,
+                                                                        clipTop ? lightScreenIntersect.origin.y : lightRenderPosition.y);
+                
+                auto lightSprite = m_shadowMapTexture->getSprite();
+                lightSprite->setBlendFunc(cocos2d::BlendFunc::ADDITIVE);
+                lightSprite->setPosition(relativeOccluderPos);
+                lightSprite->setTextureRect(cocos2d::Rect(cocos2d::Vec2::ZERO, lightScreenIntersect.size));
+                lightSprite->setGLProgram(cocos2d::GLProgramCache::getInstance()->getGLProgram(cocos2d::GLProgram::SHADER_NAME_POSITION_TEXTURE_COLOR));
+                renderToTexture(m_shadowMapTexture->getSprite(), m_lightMapTexture);
+            }
         }
         else
         {
@@ -266,7 +341,8 @@ void LightController::update(const float deltaTime)
         if (m_model->getDrawDebug())
         {
             gameView->getDebugDrawNode()->drawRect(lightScreenRect.origin,
-                                                   lightScreenRect.origin + lightScreenRect.size, cocos2d::Color4F::YELLOW);
+                                                   lightScreenRect.origin + lightScreenRect.size,
+                                                   isCached ? cocos2d::Color4F::GREEN : cocos2d::Color4F::YELLOW);
             gameView->getDebugDrawNode()->drawRect(cocos2d::Vec2::ONE,
                                                    winSize - cocos2d::Size(1,1), cocos2d::Color4F::MAGENTA);
 
@@ -274,6 +350,17 @@ void LightController::update(const float deltaTime)
             gameView->getDebugDrawNode()->drawRect(lightScreenIntersect.origin, lightScreenIntersect.origin + lightScreenIntersect.size, cocos2d::Color4F::YELLOW);
         }
     }
+    
+    if (!m_cachedLightSprites.empty())
+    {
+        m_lightMapTexture->begin();
+        for (cocos2d::Sprite* lightSprite : m_cachedLightSprites)
+        {
+            lightSprite->visit();
+        }
+        m_lightMapTexture->end();
+        director->getRenderer()->render();
+    }
         
     for (size_t deadLightID : deadLightIDs)
     {
@@ -452,6 +539,105 @@ void LightController::renderToTexture(cocos2d::Sprite* sprite,
     cocos2d::Director::getInstance()->getRenderer()->render();
 }
 
+void LightController::collectDynamicOccluders()
+{
+    m_dynamicOccluderRects.clear();
+    
+    // Entity sprites are the only occluders that move, anything else in the occluder node stays put
+    const auto& gameView = Injector::globalInjector().getInstance<GameView>();
+    const auto& spriteBatch = gameView->getSpriteBatch();
+    if (!spriteBatch)
+    {
+        return;
+    }
+    for (cocos2d::Node* child : spriteBatch->getChildren())
+    {
+        if (child->isVisible())
+        {
+            m_dynamicOccluderRects.push_back(child->getBoundingBox());
+        }
+    }
+}
+
+bool LightController::hasDynamicOccluders(const cocos2d::Rect& lightRect) const
+{
+    // Pad by a pixel as the occluders are drawn at the unrounded view position
+    const cocos2d::Rect paddedRect = cocos2d::Rect(lightRect.origin - cocos2d::Vec2::ONE,
+                                                   lightRect.size + cocos2d::Size(2.f, 2.f));
+    for (const cocos2d::Rect& occluderRect : m_dynamicOccluderRects)
+    {
+        if (occluderRect.intersectsRect(paddedRect))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool LightController::storeShadowMap(CachedShadowMap& cachedShadowMap,
+                                     const cocos2d::Size& lightSize)
+{
+    if (!cachedShadowMap.texture)
+    {
+        size_t cachedCount = 0;
+        for (const auto& cachePair : m_cachedShadowMaps)
+        {
+            if (cachePair.second.texture)
+            {
+                cachedCount++;
+            }
+        }
+        if (cachedCount >= MAX_CACHED_SHADOW_MAPS && !evictShadowMap())
+        {
+            return false;
+        }
+        
+        cachedShadowMap.texture = cocos2d::RenderTexture::create(std::ceil(lightSize.width), std::ceil(lightSize.height),
+                                                                 cocos2d::Texture2D::PixelFormat::RGB888,
+                                                                 0);
+        cachedShadowMap.texture->getSprite()->setAnchorPoint(cocos2d::Vec2::ZERO);
+        cachedShadowMap.texture->getSprite()->setBlendFunc(cocos2d::BlendFunc::ADDITIVE);
+        cachedShadowMap.texture->getSprite()->setTextureRect(cocos2d::Rect(cocos2d::Vec2::ZERO, lightSize));
+    }
+    
+    // Copy the light area of the shadow map as is
+    auto shadowSprite = m_shadowMapTexture->getSprite();
+    shadowSprite->setBlendFunc(cocos2d::BlendFunc::DISABLE);
+    shadowSprite->setPosition(cocos2d::Vec2::ZERO);
+    shadowSprite->setTextureRect(cocos2d::Rect(cocos2d::Vec2::ZERO, lightSize));
+    shadowSprite->setGLProgram(cocos2d::GLProgramCache::getInstance()->getGLProgram(cocos2d::GLProgram::SHADER_NAME_POSITION_TEXTURE_COLOR));
+    
+    cachedShadowMap.texture->beginWithClear(0, 0, 0, 0);
+    shadowSprite->visit();
+    cachedShadowMap.texture->end();
+    cocos2d::Director::getInstance()->getRenderer()->render();
+    return true;
+}
+
+bool LightController::evictShadowMap()
+{
+    // Drop the least recently drawn shadow map, unless they were all drawn this frame
+    CachedShadowMap* oldestShadowMap = nullptr;
+    for (auto& cachePair : m_cachedShadowMaps)
+    {
+        CachedShadowMap& cachedShadowMap = cachePair.second;
+        if (!cachedShadowMap.texture || cachedShadowMap.lastUsedFrame == m_frameCount)
+        {
+            continue;
+        }
+        if (!oldestShadowMap || cachedShadowMap.lastUsedFrame < oldestShadowMap->lastUsedFrame)
+        {
+            oldestShadowMap = &cachedShadowMap;
+        }
+    }
+    if (!oldestShadowMap)
+    {
+        return false;
+    }
+    oldestShadowMap->texture = nullptr;
+    return true;
+}
+
 void LightController::onAddLight(const AddLightEvent& event)
 {
     m_model->addLight(event.getLight());
@@ -460,6 +646,28 @@ void LightController::onAddLight(const AddLightEvent& event)
 void LightController::onRemoveLight(const RemoveLightEvent& event)
 {
     m_model->removeLight(event.getLightID());
+    m_cachedShadowMaps.erase(event.getLightID());
+}
+
+void LightController::onOccludersChanged(const OccludersChangedEvent& event)
+{
+    for (const auto& lightPair : m_model->getLights())
+    {
+        const LightData& light = lightPair.second;
+        if (light.lifeTime != -1.f)
+        {
+            continue;
+        }
+        const cocos2d::Size lightRadiusSize = cocos2d::Size(light.radius, light.radius);
+        const cocos2d::Rect lightRect = cocos2d::Rect(light.position - lightRadiusSize, lightRadiusSize * 2.f);
+        if (!lightRect.intersectsRect(event.getArea()))
+        {
+            continue;
+        }
+        CachedShadowMap& cachedShadowMap = m_cachedShadowMaps[lightPair.first];
+        cachedShadowMap.texture = nullptr;
+        cachedShadowMap.invalidTime = std::max(cachedShadowMap.invalidTime, event.getDuration());
+    }
 }
 
 void LightController::onWindowResized(cocos2d::EventCustom*)
@@ -2,11 +2,13 @@
 #define LightController_h
 
 #include "LightConstants.h"
+#include "cocos2d.h"
 
 class GameSettings;
 class LightModel;
 class AddLightEvent;
 class RemoveLightEvent;
+class OccludersChangedEvent;
 
 class LightController
 {
@@ -34,6 +36,23 @@ private:
     static const int MAX_LIGHT_RESOLUTION;
     static const cocos2d::Size LIGHT_TEXTURE_SIZE;
     static const cocos2d::Rect LIGHT_TEXTURE_RECT;
+    static const size_t MAX_CACHED_SHADOW_MAPS;
+
+    // Shadow map of a light that doesn't move or expire, reused until its occluders change
+    struct CachedShadowMap {
+        CachedShadowMap()
+        : radius(0.f)
+        , invalidTime(0.f)
+        , lastUsedFrame(0)
+        {}
+
+        cocos2d::RefPtr<cocos2d::RenderTexture> texture; // Null until rendered and after invalidation
+        cocos2d::Vec2 position;
+        float radius;
+        cocos2d::Color4F color;
+        float invalidTime; // Time left until the occluders around the light stop changing
+        uint32_t lastUsedFrame;
+    };
 
     std::shared_ptr<LightModel> m_model;
     std::shared_ptr<GameSettings> m_gameSettings;
@@ -50,6 +69,11 @@ private:
     cocos2d::RefPtr<cocos2d::GLProgram> m_shadowMapNoBlurShader;
     cocos2d::RefPtr<cocos2d::GLProgram> m_lightShader;
 
+    std::map<size_t, CachedShadowMap> m_cachedShadowMaps; // Keyed by light ID
+    std::vector<cocos2d::Rect> m_dynamicOccluderRects; // Occluders that move, lights they overlap are not cached
+    std::vector<cocos2d::Sprite*> m_cachedLightSprites; // Cached shadow maps to add to lightmap this frame
+    uint32_t m_frameCount;
+
     cocos2d::EventListenerCustom* m_windowResizeListener;
 
     bool m_enabled;
@@ -76,8 +100,15 @@ private:
     void renderToTexture(cocos2d::Sprite* lightSprite,
                          cocos2d::RenderTexture* texture);
 
+    void collectDynamicOccluders();
+    bool hasDynamicOccluders(const cocos2d::Rect& lightRect) const;
+    bool storeShadowMap(CachedShadowMap& cachedShadowMap,
+                        const cocos2d::Size& lightSize);
+    bool evictShadowMap();
+
     void onAddLight(const AddLightEvent& event);
     void onRemoveLight(const RemoveLightEvent& event);
+    void onOccludersChanged(const OccludersChangedEvent& event);
     
     void onWindowResized(cocos2d::EventCustom*);
 };
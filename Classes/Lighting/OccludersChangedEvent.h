@@ -0,0 +1,25 @@
+#ifndef OccludersChangedEvent_h
+#define OccludersChangedEvent_h
+
+#include "cocos2d.h"
+
+// Sent when something that casts shadows changes within an area of the level,
+// cached shadow maps of lights overlapping the area are re-rendered for the duration
+class OccludersChangedEvent
+{
+public:
+    OccludersChangedEvent(const cocos2d::Rect& area,
+                          const float duration)
+    : m_area(area)
+    , m_duration(duration)
+    {}
+
+    const cocos2d::Rect& getArea() const { return m_area; }
+    float getDuration() const { return m_duration; }
+
+private:
+    const cocos2d::Rect m_area;
+    const float m_duration;
+};
+
+#endif /* OccludersChangedEvent_h */
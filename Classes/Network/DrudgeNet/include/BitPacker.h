@@ -7,6 +7,8 @@ namespace Net
 {
     // bitpacker class
     //  + read and write non-8 multiples of bits efficiently
+    //  + bits go through a 64 bit scratch register and hit memory 32 bits at a time
+    //  + writers must call FlushBits before handing the buffer off
     class BitPacker
     {
     public:
@@ -26,6 +28,9 @@ namespace Net
         void ReadBits2(uint32_t& value, uint32_t bits = 32);
         void ReadBits(uint64_t& value, int32_t bits = 64);
         
+        // Stores any bits still pending in scratch, safe to call repeatedly and keep writing after
+        void FlushBits();
+        
         void Clear();
         
         void* GetData();
@@ -41,11 +46,16 @@ namespace Net
         bool IsValid() const;
 
     private:
-        int32_t bit_index;
-        unsigned char* ptr;
+        uint64_t scratch;
+        int32_t scratch_bits;
+        int32_t word_index;     // Byte offset of the word scratch maps to
+        int32_t bits_processed;
         unsigned char* buffer;
         int32_t bytes;
         Mode mode;
+        
+        void WriteWord(const uint32_t word);
+        uint32_t ReadWord();
     };
 }
 
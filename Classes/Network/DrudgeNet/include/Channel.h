@@ -2,30 +2,67 @@
 #define NET_CHANNEL_H
 
 #include "Network/DrudgeNet/include/DataTypes.h"
+#include "MessageQueue.h"
+#include <memory>
+#include <vector>
 
 namespace Net
 {
+    class Message;
+
     enum ChannelType
     {
         Channel_Reliable_Ordered,
         Channel_Unreliable_Unordered,
+        ChannelType_NumTypes
     };
-    
+
+    // Messages to and from one node, each packet carries messages of a single channel.
+    // The channel decides which queued messages go into the next packet and what to do
+    // with them once that packet is sent or acked, received messages come out of it in
+    // the order the channel guarantees.
     class Channel
     {
     public:
         virtual ~Channel() {};
-        
-        virtual bool SendPacket(NodeID nodeId,
-                                const unsigned char data[],
-                                int size) = 0;
-        
-        virtual int ReceivePacket(NodeID& nodeId,
-                                  unsigned char data[],
-                                  int size) = 0;
+
+        ChannelType getType() const { return m_type; }
+
+        // Returns 0 when the message can't be sent on this channel
+        virtual MessageID sendMessage(std::shared_ptr<Message>& message,
+                                      const uint32_t bitsRequired) = 0;
+
+        // Fills messageIDs with the messages for the next packet, empty when nothing is due
+        virtual void getPacketMessages(const int32_t bitsAvailable,
+                                       const float time,
+                                       std::vector<MessageID>& messageIDs) = 0;
+
+        virtual void onPacketSent(const PacketSequenceID packetID,
+                                  const std::vector<MessageID>& messageIDs,
+                                  const float time) = 0;
+
+        virtual void onPacketAcked(const PacketSequenceID packetID,
+                                   std::vector<MessageID>& ackedMessageIDs) = 0;
+
+        virtual void onMessageReceived(const MessageID messageID,
+                                       const std::shared_ptr<Message>& message) = 0;
+
+        // Pops the next message ready for the game, returns false when there is none
+        virtual bool receiveMessage(std::shared_ptr<Message>& message) = 0;
+
+        virtual void reset() = 0;
+
+        const std::shared_ptr<Message>& getMessage(const MessageID messageID) const { return m_sendQueue.getMessage(messageID); }
+        bool hasMessagesToSend() const { return !m_sendQueue.isEmpty(); }
+
     protected:
-        Channel(const ChannelType type) : m_type(type) {}
-        
+        Channel(const ChannelType type, const MessageQueue::Mode mode)
+        : m_sendQueue(mode)
+        , m_type(type)
+        {}
+
+        MessageQueue m_sendQueue;
+
     private:
         const ChannelType m_type;
     };
@@ -5,20 +5,58 @@
 
 namespace Net
 {
+    // Sliding window of reliable messages, every message in the window is resent until a
+    // packet carrying it is acked. The receiver buffers messages which arrive ahead of a
+    // gap and hands them on strictly in send order, duplicates are dropped.
     class ChannelReliable : public Channel
     {
     public:
-        ChannelReliable() : Channel(Channel_Reliable_Ordered) {}
+        static const int32_t MESSAGE_ID_BITS;
+        static const uint32_t WINDOW_SIZE;
 
-        virtual ~ChannelReliable() {};
+        ChannelReliable();
+
+        virtual ~ChannelReliable();
+        
+        // Refuses messages which don't fit in a single packet, acks are per packet
+        MessageID sendMessage(std::shared_ptr<Message>& message,
+                              const uint32_t bitsRequired) override;
+        
+        void getPacketMessages(const int32_t bitsAvailable,
+                               const float time,
+                               std::vector<MessageID>& messageIDs) override;
+        
+        void onPacketSent(const PacketSequenceID packetID,
+                          const std::vector<MessageID>& messageIDs,
+                          const float time) override;
+        
+        void onPacketAcked(const PacketSequenceID packetID,
+                           std::vector<MessageID>& ackedMessageIDs) override;
         
-        bool SendPacket(NodeID nodeId,
-                        const unsigned char data[],
-                        int size) override;
+        void onMessageReceived(const MessageID messageID,
+                               const std::shared_ptr<Message>& message) override;
         
-        int ReceivePacket(NodeID& nodeId,
-                          unsigned char data[],
-                          int size) override;
+        bool receiveMessage(std::shared_ptr<Message>& message) override;
+        
+        void reset() override;
+
+        void setMaxPacketBits(const int32_t maxPacketBits) { m_maxPacketBits = maxPacketBits; }
+        // Unacked messages are resent once they have been out for a little longer than a round trip
+        void setRoundTripTime(const float roundTripTime);
+
+    private:
+        static const float MIN_RESEND_TIME;
+
+        struct ReceivedMessage
+        {
+            uint16_t messageID;
+            std::shared_ptr<Message> message;
+        };
+
+        int32_t m_maxPacketBits;
+        float m_resendTime;
+        std::vector<ReceivedMessage> m_receiveBuffer; // Indexed by message ID modulo window size
+        uint16_t m_receiveMessageID; // Next one to hand on
     };
 }
 
@@ -2,9 +2,11 @@
 #define NET_CHANNEL_UNRELIABLE_H
 
 #include "Channel.h"
+#include <deque>
 
 namespace Net
 {
+    // Messages are sent once and dropped, received messages are handed on as they arrive
     class ChannelUnreliable : public Channel
     {
     public:
@@ -12,13 +14,29 @@ namespace Net
         
         virtual ~ChannelUnreliable();
         
-        bool SendPacket(NodeID nodeId,
-                        const unsigned char data[],
-                        int size) override;
+        MessageID sendMessage(std::shared_ptr<Message>& message,
+                              const uint32_t bitsRequired) override;
         
-        int ReceivePacket(NodeID& nodeId,
-                          unsigned char data[],
-                          int size) override;
+        void getPacketMessages(const int32_t bitsAvailable,
+                               const float time,
+                               std::vector<MessageID>& messageIDs) override;
+        
+        void onPacketSent(const PacketSequenceID packetID,
+                          const std::vector<MessageID>& messageIDs,
+                          const float time) override;
+        
+        void onPacketAcked(const PacketSequenceID packetID,
+                           std::vector<MessageID>& ackedMessageIDs) override;
+        
+        void onMessageReceived(const MessageID messageID,
+                               const std::shared_ptr<Message>& message) override;
+        
+        bool receiveMessage(std::shared_ptr<Message>& message) override;
+        
+        void reset() override;
+        
+    private:
+        std::deque<std::shared_ptr<Message>> m_receivedMessages;
     };
 }
 
@@ -9,6 +9,8 @@ namespace Net
     static constexpr int32_t MAXIMUM_PACKET_BITS = MAXIMUM_TRANSMISSION_UNIT_BYTES * 8;
     static constexpr int32_t MAXIMUM_PACKET_FRAGMENTS = 256;
     static constexpr int32_t BUFFER_SIZE_BYTES = MAXIMUM_PACKET_FRAGMENTS * MAXIMUM_TRANSMISSION_UNIT_BYTES;
+    // What's left of a packet once the transport has written its own header
+    static constexpr int32_t MAXIMUM_PAYLOAD_BYTES = MAXIMUM_TRANSMISSION_UNIT_BYTES - 20;
 }
 
 
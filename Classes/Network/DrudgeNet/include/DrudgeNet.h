@@ -3,6 +3,7 @@
 
 #include "Network/DrudgeNet/include/DataTypes.h"
 #include "Transport.h"
+#include "Channel.h"
 #include <map>
 #include <memory>
 #include <vector>
@@ -13,12 +14,13 @@ namespace Net
     class FragmentBuffer;
     class MeasureStream;
     class Message;
-    class MessageQueue;
     class ReadStream;
     class Stream;
     class WriteStream;
     class MessageFactory;
     class Channel;
+    class ChannelReliable;
+    class ChannelUnreliable;
     
     class DrudgeNet
     {
@@ -72,24 +74,34 @@ namespace Net
             Packet_Single,
             PacketType_NumTypes
         };
+        
+        static const int32_t UNRELIABLE_PACKET_BITS;
+        static const int32_t RELIABLE_PACKET_BITS;
+        static const int32_t FRAGMENT_HEADER_BYTES;
+        static const int32_t FRAGMENT_DATA_BYTES;
+        static const size_t MAX_FRAGMENTED_PACKETS_PER_NODE;
+        static const float FRAGMENT_TIMEOUT;
+        
         std::shared_ptr<MessageFactory> m_messageFactory;
         std::shared_ptr<Transport> m_transport;
         std::shared_ptr<Net::ReadStream> m_readStream;
         std::shared_ptr<Net::WriteStream> m_writeStream;
         std::shared_ptr<Net::MeasureStream> m_measureStream;
-        std::shared_ptr<Net::FragmentBuffer> m_readFragmentBuffer;
-        std::shared_ptr<Net::FragmentBuffer> m_writeFragmentBuffer;
+        // Fragmented packets being reassembled, a few per node so large packets don't block each other
+        std::map<NodeID, std::vector<std::shared_ptr<Net::FragmentBuffer>>> m_receivingFragments;
+        uint16_t m_nextFragmentSequence;
         
         unsigned char* m_readBuffer;
         unsigned char* m_writeBuffer;
         unsigned char* m_packetDataBuffer;
 
-        std::map<NodeID, std::shared_ptr<MessageQueue>> m_messagesUnreliable;
-        std::map<NodeID, std::shared_ptr<MessageQueue>> m_messagesReliable;
-        std::map<NodeID, std::vector<PacketSequenceID>> m_sentReliablePackets;
+        std::map<NodeID, std::shared_ptr<ChannelUnreliable>> m_unreliableChannels;
+        std::map<NodeID, std::shared_ptr<ChannelReliable>> m_reliableChannels;
+        std::vector<MessageID> m_packetMessageIDs;
+        std::vector<MessageID> m_ackedMessageIDs;
         
-        NodeID m_fragmentSenderID;
         bool m_isConnected;
+        float m_time;
 
         std::function<void()> m_onConnectedCallback;
         std::function<void()> m_onDisconnectedCallback;
@@ -101,8 +113,15 @@ namespace Net
         
         void processReadStream(const NodeID senderNode, const int receivedBytes);
         void processReadStreamFragment(const NodeID senderNode, const int receivedBytes);
+        FragmentBuffer* getFragmentBuffer(const NodeID nodeID,
+                                          const uint16_t sequence,
+                                          const uint8_t fragmentCount);
+        void removeStaleFragments();
 
-        void SendMessages(std::map<NodeID, std::shared_ptr<MessageQueue>> queue, bool reliable);
+        Channel* getChannel(const NodeID nodeID, const ChannelType channelType);
+        void SendChannelMessages(const NodeID nodeID,
+                                 Channel& channel,
+                                 const int32_t bitsAvailable);
         
         bool SendPacket(NodeID nodeID,
                         const unsigned char data[],
@@ -111,6 +130,7 @@ namespace Net
         bool SendFragment(const NodeID nodeID,
                           const unsigned char data[],
                           const int32_t size,
+                          const uint16_t sequence,
                           PacketFragmentID fragmentID,
                           uint8_t fragmentCount);
 
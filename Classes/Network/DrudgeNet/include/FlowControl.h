@@ -1,36 +1,47 @@
 #ifndef NET_FLOWCONTROL_H
 #define NET_FLOWCONTROL_H
 
+#include <stdint.h>
+
 namespace Net
 {
-    // simple binary flow control
-    //  + two modes of operation: good and bad mode
-    //  + if RTT exceeds 250ms drop to bad mode immediately
-    //  + if RTT is under 250ms for a period of time, return to good mode
+    class ReliabilitySystem;
+
+    // bandwidth based flow control
+    //  + keeps an estimate of how many bytes per second the connection carries
+    //  + every sample period without congestion the estimate grows additively
+    //  + packet loss or RTT climbing well above the lowest RTT seen cuts it multiplicatively
+    //  + sending spends a byte allowance refilled from the estimate, a send cycle may overdraw it
+    //    so packets and their fragments always go out whole, the next cycles wait until it is paid off
 
     class FlowControl
     {
     public:
-        
+
         FlowControl();
-        
+
         void Reset();
-        
-        void Update( float deltaTime, float rtt );
-        
-        inline float GetSendRate() { return mode == Good ? 60.0f : 30.0f; };
-        
+
+        void Update( float deltaTime, const ReliabilitySystem & reliability );
+
+        // Decided once per Update so every packet of a send cycle gets the same answer
+        inline bool CanSend() const { return can_send; };
+
+        void PacketSent( int32_t bytes );
+
+        // Bytes per second the connection is believed to carry
+        inline float GetBandwidth() const { return bandwidth; };
+
     private:
-        
-        enum FlowMode {
-            Good,
-            Bad
-        };
-        
-        FlowMode mode;
-        float penalty_time;
-        float good_conditions_time;
-        float penalty_reduction_accumulator;
+
+        float bandwidth;
+        float allowance;
+        bool can_send;
+        float rtt_minimum;
+        float sample_time;
+        float backoff_time;
+        uint32_t sample_lost_packets;
+        uint32_t sample_acked_packets;
     };
 }
 
@@ -2,58 +2,49 @@
 #define FRAGMENT_BUFFER_H
 
 #include "Network/DrudgeNet/include/DataTypes.h"
+#include <cstddef>
 #include <cstdint>
-#include <map>
+#include <vector>
 
 namespace Net
 {
+    // Reassembles one fragmented packet. Every fragment but the last is maxFragmentSize
+    // bytes so each lands at a fixed offset, the storage is kept for the next packet.
     class FragmentBuffer
     {
     public:
         FragmentBuffer(const int32_t maxFragmentSize);
         ~FragmentBuffer();
 
-        // pass nullptr to set up for receiving data
-        void setupFragmentData(const unsigned char* data,
-                               const int32_t dataSize);
+        void setup(const uint16_t sequence,
+                   const uint8_t fragmentCount,
+                   const float time);
         void clearData();
-        
-        // Send fragment interface
-        const unsigned char* getFragmentData(const PacketFragmentID fragmentID);
-        const int32_t getFragmentSize(const PacketFragmentID fragmentID);
-        
-        const unsigned char* getData() const { return m_data; }
-        const int32_t getDataSize() const { return m_dataSize; }
-        const int32_t getFragmentCount() const { return m_fragmentCount; }
-        
-        bool onFragmentSent(const PacketFragmentID fragmentID,
-                            const PacketSequenceID packetID);
-        bool onPacketAcked(const PacketSequenceID packetID);
 
-        // Receive fragment interface
         bool onFragmentReceived(const unsigned char* fragmentData,
                                 const int32_t size,
-                                PacketFragmentID fragmentID,
-                                PacketFragmentID fragmentCount);
+                                const PacketFragmentID fragmentID,
+                                const uint8_t fragmentCount,
+                                const float time);
+        
+        bool isInUse() const { return m_fragmentCount != 0; }
+        bool isComplete() const { return isInUse() && m_receivedCount == m_fragmentCount; }
         
-        bool isComplete();
+        const unsigned char* getData() const { return m_data.data(); }
+        // Only valid once complete
+        const int32_t getDataSize() const;
+        const int32_t getFragmentCount() const { return m_fragmentCount; }
+        uint16_t getSequence() const { return m_sequence; }
+        float getLastReceiveTime() const { return m_lastReceiveTime; }
 
     private:
-        struct FragmentData
-        {
-            int32_t size;
-            unsigned char* data;
-        };
-        
         const int32_t m_maxFragmentSize;
-        unsigned char* m_data;
-        int32_t m_dataSize;
+        std::vector<unsigned char> m_data;
+        std::vector<int32_t> m_fragmentSizes; // 0 until the fragment arrived
         int32_t m_fragmentCount;
-
-        std::map<PacketFragmentID, FragmentData> m_fragments;
-        std::map<PacketSequenceID, PacketFragmentID> m_sentFragments;
-        
-        const size_t getDataOffset(const uint8_t fragmentID) const;
+        int32_t m_receivedCount;
+        uint16_t m_sequence;
+        float m_lastReceiveTime;
     };
 
 }
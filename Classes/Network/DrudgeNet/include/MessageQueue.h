@@ -14,7 +14,7 @@
 namespace Net
 {
     class Message;
-    
+
     class MessageQueue
     {
     public:
@@ -23,36 +23,48 @@ namespace Net
             UNRELIABLE = 0,
             RELIABLE
         };
-        
+
         struct MessageData
         {
             std::shared_ptr<Message> message;
             uint32_t bitsRequired;
-            int32_t timeLastSent;
+            float timeLastSent; // Negative until the message went out in a packet
         };
-        
+
         MessageQueue(Mode mode);
-        
+
         void clear();
-        
+
+        // IDs start at 1, 0 is left for messages which couldn't be queued
         MessageID queueMessage(std::shared_ptr<Message>& message,
                                uint32_t bitsRequired);
         void removeMessage(const MessageID messageID);
-        
+
+        // Reliable queues remember which messages went out in which packet until it is acked
         void onPacketSent(const PacketSequenceID packetID,
-                          std::vector<MessageID>& messages);
-        
-        
-        bool getNextMessage(const int32_t bitsAvailable,
-                            MessageID& messageID,
-                            MessageData& data);
-        
+                          const std::vector<MessageID>& messages,
+                          const float time);
+        // Removes the messages the packet carried, acked is filled with the ones still queued
+        void onPacketAcked(const PacketSequenceID packetID,
+                           std::vector<MessageID>& acked);
+
         bool isEmpty() const { return m_messages.empty(); }
         std::map<MessageID, MessageData>& getMessages() { return m_messages; }
+        const std::shared_ptr<Message>& getMessage(const MessageID messageID) const;
 
     private:
+        static const size_t SENT_PACKET_BUFFER_SIZE;
+
+        struct SentPacket
+        {
+            PacketSequenceID packetID;
+            bool valid;
+            std::vector<MessageID> messageIDs;
+        };
+
         Mode m_mode;
         std::map<MessageID, MessageData> m_messages;
+        std::vector<SentPacket> m_sentPackets; // Ring indexed by packet sequence
         MessageID m_nextMessageID;
     };
 }
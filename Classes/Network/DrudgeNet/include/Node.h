@@ -39,6 +39,8 @@ namespace Net
         
         bool SendPacket(NodeID nodeID, const unsigned char data[], int size);
         int ReceivePacket(NodeID& nodeID, unsigned char data[], int size);
+        // Sends the packets batched up by SendPacket
+        void Flush();
         
         void setConnectedCallback(std::function<void()> callback) { m_onConnectedCallback = callback; }
         void setDisconnectedCallback(std::function<void()> callback) { m_onDisconnectedCallback = callback; }
@@ -77,10 +79,11 @@ namespace Net
         struct BufferedPacket
         {
             NodeID nodeID;
-            std::vector<uint8_t> data;
+            unsigned char* data; // Acquired from PacketPool
+            int32_t size;
         };
         
-        typedef std::stack<BufferedPacket*> PacketBuffer;
+        typedef std::stack<BufferedPacket> PacketBuffer;
         PacketBuffer m_receivedPackets;
         typedef std::map<Address, NodeState*> AddrToNode;
         AddrToNode m_addr2node;
@@ -0,0 +1,91 @@
+#ifndef NET_PACKET_POOL_H
+#define NET_PACKET_POOL_H
+
+#include "DataConstants.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Net
+{
+    // packet pool class
+    //  + fixed number of fixed size buffers carved out of one allocation
+    //  + lock-free free list, buffers can be released on a different thread than they were acquired on
+    //  + requests that don't fit a pooled buffer, or arrive when the pool is empty, fall back to the heap
+    class PacketPool
+    {
+    public:
+        static constexpr int32_t DEFAULT_BUFFER_BYTES = MAXIMUM_TRANSMISSION_UNIT_BYTES + 32; // Room for transport headers
+        static constexpr size_t DEFAULT_BUFFER_COUNT = 256;
+
+        struct Stats
+        {
+            size_t capacity;        // Pooled buffers available in total
+            size_t inUse;           // Pooled buffers currently acquired
+            size_t highWaterMark;   // Most pooled buffers ever acquired at once
+            size_t heapFallbacks;   // Acquires served by the heap instead of the pool
+            size_t acquires;        // Acquires in total
+        };
+
+        // Owns one acquired buffer and returns it to its pool when it goes out of scope
+        class Buffer
+        {
+        public:
+            Buffer() : m_pool(nullptr), m_data(nullptr) {}
+            Buffer(PacketPool* pool, unsigned char* data) : m_pool(pool), m_data(data) {}
+            Buffer(Buffer&& other) : m_pool(other.m_pool), m_data(other.m_data) { other.m_data = nullptr; }
+            Buffer& operator=(Buffer&& other);
+            ~Buffer() { reset(); }
+
+            unsigned char* get() const { return m_data; }
+            explicit operator bool() const { return m_data != nullptr; }
+            void reset();
+
+        private:
+            Buffer(const Buffer&) = delete;
+            Buffer& operator=(const Buffer&) = delete;
+
+            PacketPool* m_pool;
+            unsigned char* m_data;
+        };
+
+        PacketPool(const size_t bufferCount = DEFAULT_BUFFER_COUNT,
+                   const int32_t bufferBytes = DEFAULT_BUFFER_BYTES);
+        ~PacketPool();
+
+        // Never fails, buffers larger than getBufferBytes() always come from the heap
+        unsigned char* acquire(const int32_t bytes);
+        void release(unsigned char* data);
+        Buffer acquireScoped(const int32_t bytes) { return Buffer(this, acquire(bytes)); }
+
+        int32_t getBufferBytes() const { return m_bufferBytes; }
+        Stats getStats() const;
+        void resetHighWaterMark();
+
+        // Shared pool sized for single datagrams
+        static PacketPool& getDefault();
+
+    private:
+        static constexpr uint32_t NO_BUFFER = 0xFFFFFFFF;
+
+        const size_t m_bufferCount;
+        const int32_t m_bufferBytes;
+        std::vector<unsigned char> m_storage;
+        std::unique_ptr<std::atomic<uint32_t>[]> m_nextFree;
+        std::atomic<uint64_t> m_freeHead; // Tag in the high half stops ABA, buffer index in the low half
+
+        std::atomic<size_t> m_inUse;
+        std::atomic<size_t> m_highWaterMark;
+        std::atomic<size_t> m_heapFallbacks;
+        std::atomic<size_t> m_acquires;
+
+        PacketPool(const PacketPool&) = delete;
+        PacketPool& operator=(const PacketPool&) = delete;
+
+        bool isPooled(const unsigned char* data) const;
+    };
+}
+
+#endif /* NET_PACKET_POOL_H */
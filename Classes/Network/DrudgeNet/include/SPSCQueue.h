@@ -0,0 +1,59 @@
+#ifndef NET_SPSC_QUEUE_H
+#define NET_SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace Net
+{
+    // single producer single consumer queue
+    //  + bounded ring, lock-free, one thread pushes and one other thread pops
+    //  + a failed push leaves the value untouched so the producer can hold on to it and retry
+    template<typename T>
+    class SPSCQueue
+    {
+    public:
+        SPSCQueue(const size_t capacity)
+        : m_slots(capacity + 1) // One slot stays empty to tell a full ring from an empty one
+        , m_head(0)
+        , m_tail(0)
+        {}
+
+        // Producer thread only
+        bool push(T&& value)
+        {
+            const size_t tail = m_tail.load(std::memory_order_relaxed);
+            const size_t next = (tail + 1) % m_slots.size();
+            if (next == m_head.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+            m_slots[tail] = std::move(value);
+            m_tail.store(next, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer thread only
+        bool pop(T& value)
+        {
+            const size_t head = m_head.load(std::memory_order_relaxed);
+            if (head == m_tail.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+            value = std::move(m_slots[head]);
+            m_head.store((head + 1) % m_slots.size(), std::memory_order_release);
+            return true;
+        }
+
+    private:
+        std::vector<T> m_slots;
+        // Written by different threads, kept on separate cache lines
+        alignas(64) std::atomic<size_t> m_head;
+        alignas(64) std::atomic<size_t> m_tail;
+    };
+}
+
+#endif /* NET_SPSC_QUEUE_H */
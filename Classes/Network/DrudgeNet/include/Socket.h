@@ -3,6 +3,8 @@
 
 #include "SocketPlatform.h"
 #include "Address.h"
+#include <memory>
+#include <vector>
 
 namespace Net
 {
@@ -14,7 +16,8 @@ namespace Net
         
         enum SocketOptions {
             NonBlocking = 1,
-            Broadcast = 2
+            Broadcast = 2,
+            Batched = 4 // Only takes effect where SOCKET_BATCHED_IO is available
         };
         
         Socket(const int32_t options = NonBlocking);
@@ -27,10 +30,15 @@ namespace Net
         
         bool IsOpen() const;
         
+        // Batched sockets queue the packet until the batch is full or Flush is called
         bool Send(const Address& destination, const void* data, size_t size);
         
+        // Batched sockets read as many packets as are waiting in one go and hand them out one by one
         int64_t Receive(Address& sender, void* data, size_t size);
         
+        // Sends all packets queued on a batched socket, does nothing otherwise
+        void Flush();
+        
         static bool validateIpAddress(const std::string& ipAddress)
         {
             struct sockaddr_in sa;
@@ -42,6 +50,29 @@ namespace Net
         int32_t _socket;
         int32_t _options;
 
+#if SOCKET_BATCHED_IO
+        static const int32_t BATCH_SIZE;
+        static const int32_t BATCH_PACKET_BYTES;
+
+        // Fixed slots for one sendmmsg/recvmmsg call, set up once when the socket opens
+        struct PacketBatch
+        {
+            PacketBatch();
+
+            std::vector<unsigned char> data;
+            std::vector<mmsghdr> headers;
+            std::vector<iovec> buffers;
+            std::vector<sockaddr_in> addresses;
+            int32_t count;
+            int32_t next; // Next received packet to hand out
+        };
+
+        std::unique_ptr<PacketBatch> _sendBatch;
+        std::unique_ptr<PacketBatch> _receiveBatch;
+
+        int64_t ReceiveBatched(Address& sender, void* data, size_t size);
+#endif
+
 		static bool s_socketsInitialized;
     };
 }
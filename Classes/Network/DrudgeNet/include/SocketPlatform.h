@@ -27,6 +27,11 @@
 
     #include <arpa/inet.h>
     #include <netdb.h>
+
+    // recvmmsg/sendmmsg move a whole batch of datagrams per syscall
+    #if defined(__linux__) && !defined(__ANDROID__)
+        #define SOCKET_BATCHED_IO 1
+    #endif
 #else
 
     #error unsupported platform!
@@ -45,6 +45,8 @@ namespace Net
         virtual bool Checkpoint() = 0;
 
         virtual void Clear();
+        // Writes out bits still held by the packer, call before reading the buffer directly
+        void Flush();
         
         virtual bool IsReading() const;
         virtual bool IsWriting() const;
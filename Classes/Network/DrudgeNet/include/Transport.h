@@ -62,7 +62,13 @@ namespace Net
         
         virtual std::shared_ptr<ReliabilitySystem> GetReliability(NodeID nodeId) = 0;
         
+        // Bytes per second flow control lets through to the node, 0 when it isn't connected
+        virtual float GetBandwidth(NodeID nodeId) const = 0;
+        
         virtual void Update(float deltaTime) = 0;
+        
+        // Pushes out packets the transport may have held back to send them in one batch
+        virtual void Flush() = 0;
 
         virtual void Stop() = 0;
 
@@ -88,9 +88,11 @@ namespace Net
                               int32_t size) override;
         
         std::shared_ptr<ReliabilitySystem> GetReliability(NodeID m_nodeId) override;
+        float GetBandwidth(NodeID m_nodeId) const override;
         const std::map<NodeID, std::shared_ptr<FlowControl>>& getFlowControl() const { return m_flowControl; }
 
         void Update(float deltaTime) override;
+        void Flush() override;
         void Stop() override;
 
         TransportType GetType() const override;
@@ -129,7 +131,6 @@ namespace Net
 
         std::map<NodeID, std::shared_ptr<ReliabilitySystem>> m_reliabilitySystems;
         std::map<NodeID, std::shared_ptr<FlowControl>> m_flowControl;
-        std::map<NodeID, float> m_sendAccumulators;
         std::vector<LobbyEntry> m_lobbyEntries;
         
         void UpdateReliabilitySystems(const float deltaTime);
@@ -1,6 +1,6 @@
 #include "BitPacker.h"
 #include <cassert>
-#include <algorithm>
+#include <cstring>
 
 namespace Net
 {
@@ -9,9 +9,11 @@ namespace Net
         assert( bytes >= 0 );
         this->mode = mode;
         this->buffer = (unsigned char*)buffer;
-        this->ptr = (unsigned char*)buffer;
         this->bytes = bytes;
-        bit_index = 0;
+        scratch = 0;
+        scratch_bits = 0;
+        word_index = 0;
+        bits_processed = 0;
         if (mode == Write)
         {
             memset(buffer, 0, bytes);
@@ -20,155 +22,106 @@ namespace Net
     
     void BitPacker::WriteBits(uint32_t value, int32_t bits)
     {
-        assert(ptr);
         assert(buffer);
         assert(bits > 0);
         assert(bits <= 32);
         assert(mode == Write);
+        assert(bits_processed + bits <= bytes * 8);
         if (bits < 32)
         {
-            const int32_t mask = (1 << bits) - 1;
-            value &= mask;
+            value &= (1u << bits) - 1;
         }
-        do
+        scratch |= (uint64_t)value << scratch_bits;
+        scratch_bits += bits;
+        bits_processed += bits;
+        if (scratch_bits >= 32)
         {
-            assert(ptr - buffer < bytes);
-            *ptr |= (uint8_t)(value << bit_index);
-            assert(bit_index < 8);
-            const int32_t bits_written = std::min( bits, 8 - bit_index);
-            assert(bits_written > 0);
-            assert(bits_written <= 8);
-            bit_index += bits_written;
-            if (bit_index >= 8)
-            {
-                ptr++;
-                bit_index = 0;
-                value >>= bits_written;
-            }
-            bits -= bits_written;
-            assert(bits >= 0);
-            assert(bits <= 32);
+            WriteWord((uint32_t)scratch);
+            scratch >>= 32;
+            scratch_bits -= 32;
         }
-        while (bits > 0);
     }
 
-    void
-    BitPacker::WriteBits2(uint32_t value, uint32_t bits/* = 32*/)
-    {
-      if (bits < 32)
-      {
-        const uint32_t mask = (1 << bits) - 1;
-        value &= mask;
-      }
-      do
-      {
-
-        *this->ptr |= (uint8_t)(value << bit_index);
-
-        const uint32_t bitsWritten = std::min(bits, 8 - (uint32_t)bit_index);
-
-        bit_index += bitsWritten;
-
-        if (bit_index >= 8)
-        {
-          this->ptr++;
-          bit_index = 0;
-          value >>= bitsWritten;
-        }
-        bits -= bitsWritten;
-      }
-      while (bits > 0);
+    void BitPacker::WriteBits2(uint32_t value, uint32_t bits/* = 32*/)
+    {
+        WriteBits(value, (int32_t)bits);
     }
     
-    void BitPacker::WriteBits( uint64_t value, int32_t bits )
+    void BitPacker::WriteBits(uint64_t value, int32_t bits)
     {
-        uint32_t x = (uint32_t)(value>>32);
-        uint32_t y = (uint32_t)value;
-        WriteBits(x);
-        WriteBits(y);
+        assert(bits > 0);
+        assert(bits <= 64);
+        // Scratch holds at most 31 pending bits, so the low word always fits in one go
+        if (bits <= 32)
+        {
+            WriteBits((uint32_t)value, bits);
+            return;
+        }
+        WriteBits((uint32_t)value, 32);
+        WriteBits((uint32_t)(value >> 32), bits - 32);
     }
     
-    void BitPacker::ReadBits( uint64_t & value, int32_t bits )
+    void BitPacker::ReadBits(uint64_t& value, int32_t bits)
     {
-        uint32_t x, y;
-        ReadBits(x, 32);
-        ReadBits(y, 32);
-        value = ((uint64_t)x) << 32 | y;
+        assert(bits > 0);
+        assert(bits <= 64);
+        uint32_t low = 0, high = 0;
+        if (bits <= 32)
+        {
+            ReadBits(low, bits);
+        }
+        else
+        {
+            ReadBits(low, 32);
+            ReadBits(high, bits - 32);
+        }
+        value = ((uint64_t)high) << 32 | low;
     }
     
     void BitPacker::ReadBits(uint32_t& value, int32_t bits)
     {
-        assert(ptr);
         assert(buffer);
         assert(bits > 0);
         assert(bits <= 32);
         assert(mode == Read);
-        int32_t original_bits = bits;
-        int32_t value_index = 0;
-        value = 0;
-        do
-        {
-            assert(ptr - buffer < bytes );
-            assert(bits >= 0);
-            assert(bits <= 32);
-            int32_t bits_to_read = std::min(8 - bit_index, bits);
-            assert(bits_to_read > 0);
-            assert(bits_to_read <= 8);
-            value |= (*ptr >> bit_index) << value_index;
-            bits -= bits_to_read;
-            bit_index += bits_to_read;
-            value_index += bits_to_read;
-            assert(value_index >= 0);
-            assert(value_index <= 32);
-            if (bit_index >= 8)
-            {
-                ptr++;
-                bit_index = 0;
-            }
-        }
-        while (bits > 0);
-        if (original_bits < 32)
+        assert(bits_processed + bits <= bytes * 8);
+        if (scratch_bits < bits)
         {
-            const uint32_t mask = (1 << original_bits) - 1;
-            value &= mask;
+            scratch |= (uint64_t)ReadWord() << scratch_bits;
+            scratch_bits += 32;
         }
+        value = (uint32_t)(scratch & ((1ull << bits) - 1));
+        scratch >>= bits;
+        scratch_bits -= bits;
+        bits_processed += bits;
     }
 
-    void
-    BitPacker::ReadBits2(uint32_t& value, uint32_t bits/* = 32*/)
+    void BitPacker::ReadBits2(uint32_t& value, uint32_t bits/* = 32*/)
     {
-      uint32_t originalBits = bits;
-      uint32_t valueIndex = 0;
-      value = 0;
-
-      do
-      {
-        uint32_t bitsToRead = std::min(8 - (uint32_t)bit_index, bits);
-
-        value |= (*this->ptr >> bit_index) << valueIndex;
-        bits -= bitsToRead;
-        bit_index += bitsToRead;
-        valueIndex += bitsToRead;
-
-        if (bit_index >= 8)
+        ReadBits(value, (int32_t)bits);
+    }
+    
+    void BitPacker::FlushBits()
+    {
+        if (mode != Write || scratch_bits == 0)
         {
-          this->ptr++;
-          bit_index = 0;
+            return;
+        }
+        // Store the bytes touched by the pending bits, the word itself stays in scratch
+        const int32_t pending_bytes = (scratch_bits + 7) / 8;
+        assert(word_index + pending_bytes <= bytes);
+        for (int32_t i = 0; i < pending_bytes; i++)
+        {
+            buffer[word_index + i] = (unsigned char)(scratch >> (i * 8));
         }
-      }
-      while (bits > 0);
-
-      if (originalBits < 32)
-      {
-        const uint32_t mask = (1 << originalBits) - 1;
-        value &= mask;
-      }
     }
     
     void BitPacker::Clear()
     {
-        bit_index = 0;
-        ptr = buffer;
+        scratch = 0;
+        scratch_bits = 0;
+        word_index = 0;
+        bits_processed = 0;
     }
     
     void * BitPacker::GetData()
@@ -178,17 +131,17 @@ namespace Net
     
     int32_t BitPacker::GetBits() const
     {
-        return (int32_t)(ptr - buffer) * 8 + bit_index;
+        return bits_processed;
     }
     
     int32_t BitPacker::GetBytes() const
     {
-        return (int32_t)(ptr - buffer) + (bit_index > 0 ? 1 : 0);
+        return (bits_processed + 7) / 8;
     }
     
     int32_t BitPacker::BitsRemaining() const
     {
-        return (int32_t)(bytes * 8 - ((ptr - buffer) * 8 + bit_index));
+        return bytes * 8 - bits_processed;
     }
     
     BitPacker::Mode BitPacker::GetMode() const
@@ -200,4 +153,36 @@ namespace Net
     {
         return buffer != NULL;
     }
+
+    void BitPacker::WriteWord(const uint32_t word)
+    {
+        // Full words only get written once all their bits are in, which BitsRemaining guarantees fit
+        assert(word_index + 4 <= bytes);
+        unsigned char* ptr = buffer + word_index;
+        ptr[0] = (unsigned char)word;
+        ptr[1] = (unsigned char)(word >> 8);
+        ptr[2] = (unsigned char)(word >> 16);
+        ptr[3] = (unsigned char)(word >> 24);
+        word_index += 4;
+    }
+
+    uint32_t BitPacker::ReadWord()
+    {
+        const unsigned char* ptr = buffer + word_index;
+        uint32_t word = 0;
+        if (word_index + 4 <= bytes)
+        {
+            word = (uint32_t)ptr[0] | ((uint32_t)ptr[1] << 8) | ((uint32_t)ptr[2] << 16) | ((uint32_t)ptr[3] << 24);
+        }
+        else
+        {
+            // Buffer sizes aren't always a multiple of 4, read the tail byte by byte
+            for (int32_t i = 0; word_index + i < bytes; i++)
+            {
+                word |= (uint32_t)ptr[i] << (i * 8);
+            }
+        }
+        word_index += 4;
+        return word;
+    }
 }
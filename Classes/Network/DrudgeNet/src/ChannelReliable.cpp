@@ -0,0 +1,134 @@
+#include "ChannelReliable.h"
+#include "DataConstants.h"
+#include <algorithm>
+
+namespace Net
+{
+    const int32_t ChannelReliable::MESSAGE_ID_BITS = 16;
+    const uint32_t ChannelReliable::WINDOW_SIZE = 256;
+    const float ChannelReliable::MIN_RESEND_TIME = 0.05f;
+
+    ChannelReliable::ChannelReliable()
+    : Channel(Channel_Reliable_Ordered, MessageQueue::Mode::RELIABLE)
+    , m_maxPacketBits(MAXIMUM_PACKET_BITS)
+    , m_resendTime(0.1f)
+    , m_receiveBuffer(WINDOW_SIZE, {0, nullptr})
+    , m_receiveMessageID(1)
+    {
+    }
+
+    ChannelReliable::~ChannelReliable()
+    {
+    }
+
+    MessageID ChannelReliable::sendMessage(std::shared_ptr<Message>& message,
+                                           const uint32_t bitsRequired)
+    {
+        if ((int32_t)bitsRequired + MESSAGE_ID_BITS > m_maxPacketBits)
+        {
+            printf("ChannelReliable::sendMessage Error! Message of %u bits doesn't fit in a packet\n", bitsRequired);
+            return 0;
+        }
+
+        return m_sendQueue.queueMessage(message, bitsRequired);
+    }
+
+    void ChannelReliable::getPacketMessages(const int32_t bitsAvailable,
+                                            const float time,
+                                            std::vector<MessageID>& messageIDs)
+    {
+        messageIDs.clear();
+        const auto& messages = m_sendQueue.getMessages();
+        if (messages.empty())
+        {
+            return;
+        }
+
+        // IDs are 16 bits on the wire, the receiver can only tell them apart within the window.
+        // Messages past it wait in the queue until the oldest ones are acked.
+        const MessageID windowEnd = messages.begin()->first + WINDOW_SIZE;
+        int32_t bitsUsed = 0;
+        for (const auto& messagePair : messages)
+        {
+            if (messagePair.first >= windowEnd)
+            {
+                break;
+            }
+
+            const MessageQueue::MessageData& data = messagePair.second;
+            if (data.timeLastSent >= 0.f &&
+                time - data.timeLastSent < m_resendTime)
+            {
+                continue; // Still waiting on the ack
+            }
+
+            const int32_t messageBits = (int32_t)data.bitsRequired + MESSAGE_ID_BITS;
+            if (bitsUsed + messageBits > bitsAvailable)
+            {
+                continue; // The receiver orders them, a smaller later message can still fit
+            }
+            messageIDs.push_back(messagePair.first);
+            bitsUsed += messageBits;
+        }
+    }
+
+    void ChannelReliable::onPacketSent(const PacketSequenceID packetID,
+                                       const std::vector<MessageID>& messageIDs,
+                                       const float time)
+    {
+        m_sendQueue.onPacketSent(packetID, messageIDs, time);
+    }
+
+    void ChannelReliable::onPacketAcked(const PacketSequenceID packetID,
+                                        std::vector<MessageID>& ackedMessageIDs)
+    {
+        m_sendQueue.onPacketAcked(packetID, ackedMessageIDs);
+    }
+
+    void ChannelReliable::onMessageReceived(const MessageID messageID,
+                                            const std::shared_ptr<Message>& message)
+    {
+        const uint16_t receivedID = (uint16_t)messageID;
+        const uint16_t distance = receivedID - m_receiveMessageID;
+        if (distance >= WINDOW_SIZE)
+        {
+            return; // Already handed on, the ack for it must have been lost
+        }
+
+        ReceivedMessage& entry = m_receiveBuffer[receivedID % WINDOW_SIZE];
+        if (entry.message && entry.messageID == receivedID)
+        {
+            return; // Resent before the first copy was acked
+        }
+        entry.messageID = receivedID;
+        entry.message = message;
+    }
+
+    bool ChannelReliable::receiveMessage(std::shared_ptr<Message>& message)
+    {
+        ReceivedMessage& entry = m_receiveBuffer[m_receiveMessageID % WINDOW_SIZE];
+        if (!entry.message || entry.messageID != m_receiveMessageID)
+        {
+            return false; // Waiting for the next message in order
+        }
+        message = entry.message;
+        entry.message = nullptr;
+        m_receiveMessageID++;
+        return true;
+    }
+
+    void ChannelReliable::reset()
+    {
+        m_sendQueue.clear();
+        for (ReceivedMessage& entry : m_receiveBuffer)
+        {
+            entry.message = nullptr;
+        }
+        m_receiveMessageID = 1;
+    }
+
+    void ChannelReliable::setRoundTripTime(const float roundTripTime)
+    {
+        m_resendTime = std::max(roundTripTime * 1.25f, MIN_RESEND_TIME);
+    }
+}
@@ -3,7 +3,7 @@
 namespace Net
 {
     ChannelUnreliable::ChannelUnreliable()
-    : Channel(Channel_Unreliable_Unordered)
+    : Channel(Channel_Unreliable_Unordered, MessageQueue::Mode::UNRELIABLE)
     {
         
     }
@@ -12,19 +12,67 @@ namespace Net
     {
         
     }
-        
-    bool ChannelUnreliable::SendPacket(NodeID nodeId,
-                                       const unsigned char data[],
-                                       int size)
+    
+    MessageID ChannelUnreliable::sendMessage(std::shared_ptr<Message>& message,
+                                             const uint32_t bitsRequired)
+    {
+        return m_sendQueue.queueMessage(message, bitsRequired);
+    }
+    
+    void ChannelUnreliable::getPacketMessages(const int32_t bitsAvailable,
+                                              const float time,
+                                              std::vector<MessageID>& messageIDs)
+    {
+        messageIDs.clear();
+        int32_t bitsUsed = 0;
+        for (const auto& messagePair : m_sendQueue.getMessages())
+        {
+            const int32_t messageBits = (int32_t)messagePair.second.bitsRequired;
+            if (bitsUsed + messageBits > bitsAvailable)
+            {
+                break; // Rest goes in the next packet, keeping the queue order
+            }
+            messageIDs.push_back(messagePair.first);
+            bitsUsed += messageBits;
+        }
+    }
+    
+    void ChannelUnreliable::onPacketSent(const PacketSequenceID packetID,
+                                         const std::vector<MessageID>& messageIDs,
+                                         const float time)
+    {
+        for (const MessageID messageID : messageIDs)
+        {
+            m_sendQueue.removeMessage(messageID);
+        }
+    }
+    
+    void ChannelUnreliable::onPacketAcked(const PacketSequenceID packetID,
+                                          std::vector<MessageID>& ackedMessageIDs)
     {
+        ackedMessageIDs.clear();
+    }
         
+    void ChannelUnreliable::onMessageReceived(const MessageID messageID,
+                                              const std::shared_ptr<Message>& message)
+    {
+        m_receivedMessages.push_back(message);
+    }
+    
+    bool ChannelUnreliable::receiveMessage(std::shared_ptr<Message>& message)
+    {
+        if (m_receivedMessages.empty())
+        {
+            return false;
+        }
+        message = m_receivedMessages.front();
+        m_receivedMessages.pop_front();
         return true;
     }
-        
-    int ChannelUnreliable::ReceivePacket(NodeID& nodeId,
-                                         unsigned char data[],
-                                         int size)
+    
+    void ChannelUnreliable::reset()
     {
-        return 0;
+        m_sendQueue.clear();
+        m_receivedMessages.clear();
     }
 }
@@ -1,7 +1,9 @@
 #include "Connection.h"
+#include "PacketPool.h"
 #include <cassert>
 #include <stdio.h>
 #include <algorithm>
+#include <cstring>
 
 namespace Net
 {
@@ -109,31 +111,29 @@ namespace Net
         {
             return false;
         }
-        unsigned char* packet = new unsigned char[size+4];
+        PacketPool::Buffer buffer = PacketPool::getDefault().acquireScoped(size + 4);
+        unsigned char* packet = buffer.get();
         packet[0] = (unsigned char) (m_protocolId >> 24);
         packet[1] = (unsigned char) ((m_protocolId >> 16) & 0xFF);
         packet[2] = (unsigned char) ((m_protocolId >> 8) & 0xFF);
         packet[3] = (unsigned char) ((m_protocolId) & 0xFF);
         memcpy(&packet[4], data, size);
-        bool res = m_socket.Send(m_address, packet, size + 4);
-        delete [] packet;
-        return res;
+        return m_socket.Send(m_address, packet, size + 4);
     }
     
     int Connection::receivePacket(unsigned char data[], int size)
     {
         assert(m_running);
-        unsigned char* packet = new unsigned char[size+4];
+        PacketPool::Buffer buffer = PacketPool::getDefault().acquireScoped(size + 4);
+        unsigned char* packet = buffer.get();
         Address sender;
         int bytes_read = m_socket.Receive(sender, packet, size + 4);
         if (bytes_read == 0)
         {
-            delete [] packet;
             return 0;
         }
         if (bytes_read <= 4)
         {
-            delete [] packet;
             return 0;
         }
         if (packet[0] != (unsigned char) (m_protocolId >> 24) ||
@@ -141,7 +141,6 @@ namespace Net
             packet[2] != (unsigned char) ((m_protocolId >> 8) & 0xFF) ||
             packet[3] != (unsigned char) (m_protocolId & 0xFF))
         {
-            delete [] packet;
             return 0;
         }
         
@@ -161,10 +160,8 @@ namespace Net
             }
             m_timeoutAccumulator = 0.0f;
             memcpy(data, &packet[4], bytes_read - 4);
-            delete [] packet;
             return bytes_read - 4;
         }
-        delete [] packet;
         return 0;
     }
     
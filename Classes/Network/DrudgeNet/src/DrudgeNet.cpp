@@ -9,26 +9,39 @@
 #include "FragmentBuffer.h"
 #include "DataConstants.h"
 #include "Message.h"
-#include "MessageQueue.h"
+#include "ChannelReliable.h"
+#include "ChannelUnreliable.h"
 #include "ReliabilitySystem.h"
 #include "MessageFactory.h"
+#include <algorithm>
 #include <chrono>
+#include <cstring>
 
 namespace Net
 {
+    // Packet type, 16-bit sequence, fragment ID and count
+    const int32_t DrudgeNet::FRAGMENT_HEADER_BYTES = 5;
+    const int32_t DrudgeNet::FRAGMENT_DATA_BYTES = MAXIMUM_PAYLOAD_BYTES - FRAGMENT_HEADER_BYTES;
+    const size_t DrudgeNet::MAX_FRAGMENTED_PACKETS_PER_NODE = 4;
+    const float DrudgeNet::FRAGMENT_TIMEOUT = 1.f;
+    // Packets are prefixed with the channel type, unreliable ones may be split into as many
+    // fragments as the 8-bit fragment count holds
+    const int32_t DrudgeNet::UNRELIABLE_PACKET_BITS = ((MAXIMUM_PACKET_FRAGMENTS - 1) * FRAGMENT_DATA_BYTES - 1) * 8;
+    // Reliable packets are acked as a whole so they have to fit in a single one with the packet type
+    const int32_t DrudgeNet::RELIABLE_PACKET_BITS = (MAXIMUM_PAYLOAD_BYTES - 2) * 8;
+
     DrudgeNet::DrudgeNet(std::shared_ptr<MessageFactory>& messageFactory)
     : m_messageFactory(messageFactory)
     , m_transport(nullptr)
     , m_readStream(nullptr)
     , m_writeStream(nullptr)
     , m_measureStream(nullptr)
-    , m_readFragmentBuffer(nullptr)
-    , m_writeFragmentBuffer(nullptr)
     , m_readBuffer(nullptr)
     , m_writeBuffer(nullptr)
     , m_packetDataBuffer(nullptr)
-    , m_fragmentSenderID(0)
+    , m_nextFragmentSequence(0)
     , m_isConnected(false)
+    , m_time(0.f)
     , m_onConnectedCallback(nullptr)
     , m_onDisconnectedCallback(nullptr)
     , m_onNodeConnectedCallback(nullptr)
@@ -42,8 +55,6 @@ namespace Net
         m_readStream = std::make_shared<Net::ReadStream>(m_readBuffer, BUFFER_SIZE_BYTES);
         m_writeStream = std::make_shared<Net::WriteStream>(m_writeBuffer, BUFFER_SIZE_BYTES);
         m_measureStream = std::make_shared<Net::MeasureStream>(BUFFER_SIZE_BYTES);
-        m_readFragmentBuffer = std::make_shared<Net::FragmentBuffer>(MAXIMUM_TRANSMISSION_UNIT_BYTES - 20);
-        m_writeFragmentBuffer = std::make_shared<Net::FragmentBuffer>(MAXIMUM_TRANSMISSION_UNIT_BYTES - 20);
     }
     
     DrudgeNet::~DrudgeNet()
@@ -126,6 +137,9 @@ namespace Net
     {
         assert(m_transport);
         m_transport->Stop();
+        m_unreliableChannels.clear();
+        m_reliableChannels.clear();
+        m_receivingFragments.clear();
     }
     
     MessageID DrudgeNet::sendMessage(const NodeID nodeID,
@@ -134,43 +148,24 @@ namespace Net
     {
         assert(m_measureStream->GetBitsProcessed() == 0);
         message->serialize(*m_measureStream.get());
-        const uint32_t bitsRequired = m_measureStream->GetBitsProcessed();
+        // Message type byte in front, padded to the next byte after
+        const uint32_t bitsRequired = ((m_measureStream->GetBitsProcessed() + 8 + 7) / 8) * 8;
         m_measureStream->Clear();
         
-        if (bitsRequired > BUFFER_SIZE_BYTES * 8)
+        if (bitsRequired > UNRELIABLE_PACKET_BITS)
         {
             return 0;
         }
 
-        std::shared_ptr<MessageQueue> queue;
-        if (reliable)
-        {
-            if (!m_messagesReliable.count(nodeID))
-            {
-                m_messagesReliable[nodeID] = std::make_shared<MessageQueue>(MessageQueue::Mode::RELIABLE);
-            }
-            else if (!m_messagesReliable.at(nodeID)->getMessages().empty())
-            {
-                return 0;
-            }
-            queue = m_messagesReliable[nodeID];
-        }
-        else
-        {
-            if (!m_messagesUnreliable.count(nodeID))
-            {
-                m_messagesUnreliable[nodeID] = std::make_shared<MessageQueue>(MessageQueue::Mode::UNRELIABLE);
-            }
-            queue = m_messagesUnreliable[nodeID];
-        }
-        
-        MessageID messageID = queue->queueMessage(message, bitsRequired);
-        return messageID;
+        Channel* channel = getChannel(nodeID, reliable ? Channel_Reliable_Ordered : Channel_Unreliable_Unordered);
+        return channel->sendMessage(message, bitsRequired);
     }
     
     void DrudgeNet::update(const float deltaTime)
     {
+        m_time += deltaTime;
         m_transport->Update(deltaTime);
+        removeStaleFragments();
         
         if (m_transport->IsConnected())
         {
@@ -224,11 +219,27 @@ namespace Net
     void DrudgeNet::processReadStream(const NodeID senderNode,
                                       const int receivedBytes)
     {
-        int processedBytes = 0;
+        uint8_t channelType = ChannelType_NumTypes;
+        m_readStream->SerializeByte(channelType);
+        if (channelType >= ChannelType_NumTypes)
+        {
+            printf("DrudgeNet::processReadStream unknown channel %u from node %i\n", channelType, senderNode);
+            return;
+        }
+        Channel* channel = getChannel(senderNode, (ChannelType)channelType);
+        const bool reliable = channel->getType() == Channel_Reliable_Ordered;
+        
+        int processedBytes = m_readStream->GetBitsProcessed() / 8;
         while (processedBytes < receivedBytes)
         {
             printf("DrudgeNet::processReadStream received %i bytes, processed %i from: %i\n", receivedBytes, processedBytes, senderNode);
 
+            uint32_t messageID = 0;
+            if (reliable)
+            {
+                m_readStream->SerializeBits(messageID, ChannelReliable::MESSAGE_ID_BITS);
+            }
+            
             std::shared_ptr<Message> message = m_messageFactory->create(*m_readStream.get());
             if (!message)
             {
@@ -236,135 +247,201 @@ namespace Net
                 break;
             }
             
+            channel->onMessageReceived(messageID, message);
+            PadDataToNearestByte(m_readStream);
+            
+            processedBytes = m_readStream->GetBitsProcessed() / 8;
+        }
+        
+        // Reliable messages only come out once everything sent before them has arrived
+        std::shared_ptr<Message> message;
+        while (channel->receiveMessage(message))
+        {
             if (m_messageReceivedCallback)
             {
                 m_messageReceivedCallback(message, senderNode);
             }
-            PadDataToNearestByte(m_readStream);
-            
-            processedBytes = m_readStream->GetBitsProcessed() / 8;
         }
     }
     
     void DrudgeNet::processReadStreamFragment(const NodeID senderNode, const int receivedBytes)
     {
+        uint16_t sequence = 0;
         PacketFragmentID fragmentID = 0;
         uint8_t fragmentCount = 0;
+        m_readStream->SerializeShort(sequence);
         m_readStream->SerializeByte(fragmentID);
         m_readStream->SerializeByte(fragmentCount);
 
         const int dataOffset = m_readStream->GetBitsProcessed() / 8;
         const int fragSize = receivedBytes - dataOffset;
-        if (m_readFragmentBuffer->getData() == nullptr)
-        {
-            m_fragmentSenderID = senderNode;
-            m_readFragmentBuffer->setupFragmentData(nullptr, fragmentCount * 1180);
-        }
-        else if (m_fragmentSenderID != senderNode)
+        FragmentBuffer* fragmentBuffer = getFragmentBuffer(senderNode, sequence, fragmentCount);
+        if (!fragmentBuffer ||
+            !fragmentBuffer->onFragmentReceived(&m_readBuffer[dataOffset], fragSize, fragmentID, fragmentCount, m_time))
         {
-            memset(m_readBuffer, 0, receivedBytes);
-            m_readStream->Clear();
             return;
         }
-        m_readFragmentBuffer->onFragmentReceived(&m_readBuffer[dataOffset], fragSize, fragmentID, fragmentCount);
 
-        if (m_readFragmentBuffer->isComplete())
+        if (fragmentBuffer->isComplete())
         {
-            int32_t packetBytes = 0;
-            for (PacketFragmentID packetID = 0; packetID < m_readFragmentBuffer->getFragmentCount(); packetID++)
-            {
-                packetBytes += m_readFragmentBuffer->getFragmentSize(packetID);
-            }
-
+            const int32_t packetBytes = fragmentBuffer->getDataSize();
             m_readStream->Clear();
-            memcpy(m_readBuffer, m_readFragmentBuffer->getData(), packetBytes);
-            m_readFragmentBuffer->clearData();
+            memcpy(m_readBuffer, fragmentBuffer->getData(), packetBytes);
+            fragmentBuffer->clearData();
             
             processReadStream(senderNode, packetBytes);
         }
     }
-
-    void DrudgeNet::sendMessages()
+    
+    FragmentBuffer* DrudgeNet::getFragmentBuffer(const NodeID nodeID,
+                                                 const uint16_t sequence,
+                                                 const uint8_t fragmentCount)
     {
-        assert(m_writeStream->GetBitsProcessed() == 0);
+        if (fragmentCount < 2)
+        {
+            return nullptr;
+        }
         
-        SendMessages(m_messagesUnreliable, false);
-
-        SendMessages(m_messagesReliable, true);
+        std::vector<std::shared_ptr<FragmentBuffer>>& fragmentBuffers = m_receivingFragments[nodeID];
+        FragmentBuffer* freeBuffer = nullptr;
+        FragmentBuffer* oldestBuffer = nullptr;
+        for (const auto& fragmentBuffer : fragmentBuffers)
+        {
+            if (!fragmentBuffer->isInUse())
+            {
+                freeBuffer = fragmentBuffer.get();
+            }
+            else if (fragmentBuffer->getSequence() == sequence)
+            {
+                return fragmentBuffer.get();
+            }
+            else if (!oldestBuffer ||
+                     fragmentBuffer->getLastReceiveTime() < oldestBuffer->getLastReceiveTime())
+            {
+                oldestBuffer = fragmentBuffer.get();
+            }
+        }
+        
+        if (!freeBuffer)
+        {
+            if (fragmentBuffers.size() < MAX_FRAGMENTED_PACKETS_PER_NODE)
+            {
+                fragmentBuffers.push_back(std::make_shared<FragmentBuffer>(FRAGMENT_DATA_BYTES));
+                freeBuffer = fragmentBuffers.back().get();
+            }
+            else
+            {
+                // Whatever went quiet the longest has most likely lost a fragment
+                freeBuffer = oldestBuffer;
+            }
+        }
+        freeBuffer->setup(sequence, fragmentCount, m_time);
+        return freeBuffer;
     }
     
-    void DrudgeNet::SendMessages(std::map<NodeID, std::shared_ptr<MessageQueue>> queue, bool reliable)
+    void DrudgeNet::removeStaleFragments()
     {
-        assert(m_writeStream->GetBitsProcessed() == 0);
-
-        memset(m_packetDataBuffer, 0, BUFFER_SIZE_BYTES);
+        for (const auto& nodeBuffers : m_receivingFragments)
+        {
+            for (const auto& fragmentBuffer : nodeBuffers.second)
+            {
+                if (fragmentBuffer->isInUse() &&
+                    m_time - fragmentBuffer->getLastReceiveTime() > FRAGMENT_TIMEOUT)
+                {
+                    fragmentBuffer->clearData();
+                }
+            }
+        }
+    }
 
-        for (auto nodeId2messageQueue : queue)
+    void DrudgeNet::sendMessages()
+    {
+        assert(m_writeStream->GetBitsProcessed() == 0);
+        
+        for (const auto& channelPair : m_unreliableChannels)
         {
-            const NodeID nodeID = nodeId2messageQueue.first;
-            auto messageQueue = nodeId2messageQueue.second;
-            const size_t messageCount = messageQueue->getMessages().size();
+            SendChannelMessages(channelPair.first, *channelPair.second, UNRELIABLE_PACKET_BITS);
+        }
 
-            if (!m_transport->IsNodeConnected(nodeID))
+        for (const auto& channelPair : m_reliableChannels)
+        {
+            if (m_transport->IsNodeConnected(channelPair.first))
             {
-                messageQueue->clear();
-                continue;
+                channelPair.second->setRoundTripTime(m_transport->GetReliability(channelPair.first)->GetRoundTripTime());
             }
-            
-            if (messageCount == 0)
+            SendChannelMessages(channelPair.first, *channelPair.second, RELIABLE_PACKET_BITS);
+        }
+        
+        m_transport->Flush();
+    }
+    
+    Channel* DrudgeNet::getChannel(const NodeID nodeID, const ChannelType channelType)
+    {
+        if (channelType == Channel_Reliable_Ordered)
+        {
+            std::shared_ptr<ChannelReliable>& channel = m_reliableChannels[nodeID];
+            if (!channel)
             {
-                continue;
+                channel = std::make_shared<ChannelReliable>();
+                channel->setMaxPacketBits(RELIABLE_PACKET_BITS);
             }
-            
-            int32_t bitsAvailable = BUFFER_SIZE_BYTES;
-            MessageID messageID = 0;
-            MessageQueue::MessageData messageData;
-            
-            for (size_t i = 0; i < messageCount; i++)
+            return channel.get();
+        }
+
+        std::shared_ptr<ChannelUnreliable>& channel = m_unreliableChannels[nodeID];
+        if (!channel)
+        {
+            channel = std::make_shared<ChannelUnreliable>();
+        }
+        return channel.get();
+    }
+    
+    void DrudgeNet::SendChannelMessages(const NodeID nodeID,
+                                        Channel& channel,
+                                        const int32_t bitsAvailable)
+    {
+        assert(m_writeStream->GetBitsProcessed() == 0);
+
+        if (!m_transport->IsNodeConnected(nodeID))
+        {
+            channel.reset();
+            return;
+        }
+        
+        const bool reliable = channel.getType() == Channel_Reliable_Ordered;
+        while (channel.hasMessagesToSend())
+        {
+            channel.getPacketMessages(bitsAvailable, m_time, m_packetMessageIDs);
+            if (m_packetMessageIDs.empty())
             {
-                if (messageQueue->getNextMessage(bitsAvailable, messageID, messageData))
-                {
-                    MessageType messageType = messageData.message->getType();
-                    m_writeStream->SerializeByte(messageType);
-                    messageData.message->serialize(*m_writeStream.get());
-                    bitsAvailable -= messageData.bitsRequired;
-                    if (!reliable)
-                    {
-                        messageQueue->removeMessage(messageID);
-                    }
-                }
-                else if (m_writeStream->GetBitsProcessed())
-                {
-                    PadDataToNearestByte(m_writeStream);
-                    const int bytesProcessed = m_writeStream->GetBitsProcessed() / 8;
-                    memcpy(m_packetDataBuffer, m_writeBuffer, bytesProcessed);
-                    memset(m_writeBuffer, 0, bytesProcessed);
-                    m_writeStream->Clear();
-                    SendPacket(nodeID, m_packetDataBuffer, bytesProcessed);
-                    
-                    if (reliable)
-                    {
-                        uint32_t packetSequence = m_transport->GetReliability(nodeID)->GetLocalSequence() - 1;
-                        m_sentReliablePackets[nodeID].push_back(packetSequence);
-                    }
-                }
+                break; // Everything left is waiting on acks
             }
             
-            if (m_writeStream->GetBitsProcessed())
+            uint8_t channelType = (uint8_t)channel.getType();
+            m_writeStream->SerializeByte(channelType);
+            for (const MessageID messageID : m_packetMessageIDs)
             {
-                PadDataToNearestByte(m_writeStream);
-                const int bytesProcessed = m_writeStream->GetBitsProcessed() / 8;
-                memcpy(m_packetDataBuffer, m_writeBuffer, bytesProcessed);
-                memset(m_writeBuffer, 0, bytesProcessed);
-                m_writeStream->Clear();
-                SendPacket(nodeID, m_packetDataBuffer, bytesProcessed);
-                
                 if (reliable)
                 {
-                    uint32_t packetSequence = m_transport->GetReliability(nodeID)->GetLocalSequence() -1;
-                    m_sentReliablePackets[nodeID].push_back(packetSequence);
+                    uint32_t wireMessageID = messageID & 0xFFFF;
+                    m_writeStream->SerializeBits(wireMessageID, ChannelReliable::MESSAGE_ID_BITS);
                 }
+                const std::shared_ptr<Message>& message = channel.getMessage(messageID);
+                MessageType messageType = message->getType();
+                m_writeStream->SerializeByte(messageType);
+                message->serialize(*m_writeStream.get());
+                PadDataToNearestByte(m_writeStream);
             }
+            
+            m_writeStream->Flush();
+            const int bytesProcessed = m_writeStream->GetBitsProcessed() / 8;
+            memcpy(m_packetDataBuffer, m_writeBuffer, bytesProcessed);
+            memset(m_writeBuffer, 0, bytesProcessed);
+            m_writeStream->Clear();
+            SendPacket(nodeID, m_packetDataBuffer, bytesProcessed);
+            
+            const PacketSequenceID packetSequence = m_transport->GetReliability(nodeID)->GetLocalSequence() - 1;
+            channel.onPacketSent(packetSequence, m_packetMessageIDs, m_time);
         }
     }
 
@@ -372,30 +449,31 @@ namespace Net
                                const unsigned char data[],
                                const int32_t size)
     {
-        const int32_t fragmentSize = MAXIMUM_TRANSMISSION_UNIT_BYTES - 20;
-        
-        if (size >= fragmentSize)
+        if (size >= MAXIMUM_PAYLOAD_BYTES)
         {
-            if (m_writeFragmentBuffer->getDataSize() != 0)
+            // Every fragment but the last is full so the receiver knows where each one goes
+            const int32_t fragmentCount = (size + FRAGMENT_DATA_BYTES - 1) / FRAGMENT_DATA_BYTES;
+            if (fragmentCount >= MAXIMUM_PACKET_FRAGMENTS)
             {
-                printf("DrudgeNet::SendPacket Error! Already sending a fragmented packet!\n");
+                printf("DrudgeNet::SendPacket Error! %i bytes need too many fragments!\n", size);
                 return false;
             }
-            m_writeFragmentBuffer->setupFragmentData(data, size);
-            const int32_t fragmentCount = m_writeFragmentBuffer->getFragmentCount();
-            for (PacketFragmentID fragmentID = 0; fragmentID < fragmentCount; fragmentID++)
+            
+            const uint16_t sequence = m_nextFragmentSequence++;
+            for (int32_t fragmentID = 0; fragmentID < fragmentCount; fragmentID++)
             {
+                const int32_t offset = fragmentID * FRAGMENT_DATA_BYTES;
                 if (!SendFragment(nodeID,
-                                  m_writeFragmentBuffer->getFragmentData(fragmentID),
-                                  m_writeFragmentBuffer->getFragmentSize(fragmentID),
-                                  fragmentID, fragmentCount))
+                                  &data[offset],
+                                  std::min(FRAGMENT_DATA_BYTES, size - offset),
+                                  sequence,
+                                  (PacketFragmentID)fragmentID,
+                                  (uint8_t)fragmentCount))
                 {
                     printf("DrudgeNet::SendPacket Error! Failed to send fragment!\n");
-                    m_writeFragmentBuffer->clearData();
                     return false;
                 }
             }
-            m_writeFragmentBuffer->clearData();
             return true;
         }
         else
@@ -403,6 +481,7 @@ namespace Net
             uint32_t packet_type = PacketType::Packet_Single;
             m_writeStream->SerializeBits(packet_type, Stream::BitsRequired(PacketType::PacketType_NumTypes));
             PadDataToNearestByte(m_writeStream);
+            m_writeStream->Flush();
             
             const int32_t headerBytes = m_writeStream->GetBitsProcessed() / 8;
             memcpy(m_writeBuffer + headerBytes, data, size);
@@ -422,16 +501,21 @@ namespace Net
     bool DrudgeNet::SendFragment(const NodeID nodeID,
                                  const unsigned char data[],
                                  const int32_t size,
+                                 const uint16_t sequence,
                                  PacketFragmentID fragmentID,
                                  uint8_t fragmentCount)
     {
         uint32_t packet_type = PacketType::Packet_Fragment;
         m_writeStream->SerializeBits(packet_type, Stream::BitsRequired(PacketType::PacketType_NumTypes));
         PadDataToNearestByte(m_writeStream);
+        uint16_t fragmentSequence = sequence;
+        m_writeStream->SerializeShort(fragmentSequence);
         m_writeStream->SerializeByte(fragmentID);
         m_writeStream->SerializeByte(fragmentCount);
+        m_writeStream->Flush();
 
         const int32_t headerBytes = m_writeStream->GetBitsProcessed() / 8;
+        assert(headerBytes == FRAGMENT_HEADER_BYTES);
         memcpy(m_writeBuffer + headerBytes, data, size);
         
         bool success = m_transport->SendPacket(nodeID, m_writeBuffer, size + headerBytes);
@@ -444,39 +528,18 @@ namespace Net
     
     void DrudgeNet::onPacketAcked(PacketSequenceID ackedPacketSequence, NodeID nodeID)
     {
-        if (m_messagesReliable.count(nodeID))
+        auto channelIt = m_reliableChannels.find(nodeID);
+        if (channelIt != m_reliableChannels.end())
         {
-            bool found = false;
-            auto it = m_sentReliablePackets.find(nodeID);
-            if (it != m_sentReliablePackets.end())
-            {
-                const std::vector<PacketSequenceID>& packets = it->second;
-                for (const PacketSequenceID packetID : packets)
-                {
-                    if (packetID == ackedPacketSequence)
-                    {
-                        found = true;
-                        break;
-                    }
-                }
-            }
-            if (found)
+            channelIt->second->onPacketAcked(ackedPacketSequence, m_ackedMessageIDs);
+            if (m_onReliableMessageAckedCallback)
             {
-                if (m_onReliableMessageAckedCallback)
+                for (const MessageID messageID : m_ackedMessageIDs)
                 {
-                    const auto& messages = m_messagesReliable.at(nodeID)->getMessages();
-                    const MessageID messageID = messages.begin()->first;
                     m_onReliableMessageAckedCallback(nodeID, messageID);
                 }
-                m_sentReliablePackets.erase(it);
-                m_messagesReliable.erase(nodeID);
             }
         }
-        
-        if (m_writeFragmentBuffer->getFragmentCount())
-        {
-            m_writeFragmentBuffer->onPacketAcked(ackedPacketSequence);
-        }
     }
 
     void DrudgeNet::onConnected()
@@ -507,21 +570,10 @@ namespace Net
 
     void DrudgeNet::onNodeDisconnected(const NodeID nodeID)
     {
-        auto reliableIt = m_messagesReliable.find(nodeID);
-        if (reliableIt != m_messagesReliable.end())
-        {
-            m_messagesReliable[nodeID]->clear();
-        }
-        auto unreliableIt = m_messagesUnreliable.find(nodeID);
-        if (unreliableIt != m_messagesUnreliable.end())
-        {
-            m_messagesUnreliable[nodeID]->clear();
-        }
-        auto sentIt = m_sentReliablePackets.find(nodeID);
-        if (sentIt != m_sentReliablePackets.end())
-        {
-            m_sentReliablePackets[nodeID].clear();
-        }
+        // Message IDs start over with the next connection
+        m_reliableChannels.erase(nodeID);
+        m_unreliableChannels.erase(nodeID);
+        m_receivingFragments.erase(nodeID);
 
         if (m_onNodeDisconnectedCallback)
         {
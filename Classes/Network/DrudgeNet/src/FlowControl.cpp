@@ -1,72 +1,87 @@
 #include "FlowControl.h"
+#include "ReliabilitySystem.h"
 #include <stdio.h>
 
 namespace Net
 {
+    // Bandwidths are in bytes per second, times in seconds
+    static const float Bandwidth_Minimum = 4.0f * 1024.0f;
+    static const float Bandwidth_Maximum = 256.0f * 1024.0f;
+    static const float Bandwidth_Start = 32.0f * 1024.0f;
+    static const float Bandwidth_Increase = 4.0f * 1024.0f;     // per sample without congestion
+    static const float Bandwidth_Backoff = 0.75f;               // scale on congestion
+    static const float Sample_Period = 0.5f;
+    static const float Backoff_Hold = 1.0f;                     // losses show up one rtt_maximum late, don't cut twice for them
+    static const float Loss_Threshold = 0.05f;
+    static const float Queueing_Threshold = 0.05f;              // RTT above the minimum which means packets are queueing
+    static const float Burst_Time = 0.1f;                       // allowance banked while idle
+    static const uint32_t Rtt_Warmup_Acks = 32;                 // the smoothed RTT starts at zero, trust it after this many acks
+
     FlowControl::FlowControl()
     {
         printf( "Network flow control initialized\n" );
         Reset();
     }
-    
+
     void FlowControl::Reset()
     {
-        mode = Good;
-        penalty_time = 4.0f;
-        good_conditions_time = 0.0f;
-        penalty_reduction_accumulator = 0.0f;
+        bandwidth = Bandwidth_Start;
+        allowance = 0.0f;
+        can_send = true;
+        rtt_minimum = 0.0f;
+        sample_time = 0.0f;
+        backoff_time = Backoff_Hold;
+        sample_lost_packets = 0;
+        sample_acked_packets = 0;
     }
-    
-    void FlowControl::Update( float deltaTime, float rtt )
+
+    void FlowControl::Update( float deltaTime, const ReliabilitySystem & reliability )
     {
-        const float RTT_Threshold = 250.0f;
-        
-        if ( mode == Good )
-        {
-            if ( rtt > RTT_Threshold )
-            {
-                printf( "FlowControl: *** dropping to bad mode ***\n" );
-                mode = Bad;
-                if ( good_conditions_time < 10.0f && penalty_time < 60.0f )
-                {
-                    penalty_time *= 2.0f;
-                    if ( penalty_time > 60.0f )
-                        penalty_time = 60.0f;
-                    printf("FlowControl: penalty time increased to %.1f\n", penalty_time );
-                }
-                good_conditions_time = 0.0f;
-                penalty_reduction_accumulator = 0.0f;
-                return;
-            }
-            
-            good_conditions_time += deltaTime;
-            penalty_reduction_accumulator += deltaTime;
-            
-            if ( penalty_reduction_accumulator > 10.0f && penalty_time > 1.0f )
-            {
-                penalty_time /= 2.0f;
-                if ( penalty_time < 1.0f )
-                    penalty_time = 1.0f;
-                printf( "FlowControl: penalty time reduced to %.1f\n", penalty_time );
-                penalty_reduction_accumulator = 0.0f;
-            }
-        }
-        
-        if ( mode == Bad )
+        allowance += bandwidth * deltaTime;
+        if ( allowance > bandwidth * Burst_Time )
+            allowance = bandwidth * Burst_Time;
+        can_send = allowance > 0.0f;
+
+        const float rtt = reliability.GetRoundTripTime();
+        if ( reliability.GetAckedPackets() >= Rtt_Warmup_Acks &&
+             ( rtt_minimum <= 0.0f || rtt < rtt_minimum ) )
+            rtt_minimum = rtt;
+
+        backoff_time += deltaTime;
+        sample_time += deltaTime;
+        if ( sample_time < Sample_Period )
+            return;
+        sample_time = 0.0f;
+
+        const uint32_t lost = reliability.GetLostPackets() - sample_lost_packets;
+        const uint32_t acked = reliability.GetAckedPackets() - sample_acked_packets;
+        sample_lost_packets = reliability.GetLostPackets();
+        sample_acked_packets = reliability.GetAckedPackets();
+
+        const float loss = ( lost + acked ) > 0 ? lost / float( lost + acked ) : 0.0f;
+        const bool queueing = rtt_minimum > 0.0f && rtt > rtt_minimum + Queueing_Threshold;
+
+        if ( loss > Loss_Threshold || queueing )
         {
-            if ( rtt <= RTT_Threshold )
-                good_conditions_time += deltaTime;
-            else
-                good_conditions_time = 0.0f;
-            
-            if ( good_conditions_time > penalty_time )
-            {
-                printf( "FlowControl: *** upgrading to good mode ***\n" );
-                good_conditions_time = 0.0f;
-                penalty_reduction_accumulator = 0.0f;
-                mode = Good;
+            if ( backoff_time < Backoff_Hold )
                 return;
-            }
+            backoff_time = 0.0f;
+            bandwidth *= Bandwidth_Backoff;
+            if ( bandwidth < Bandwidth_Minimum )
+                bandwidth = Bandwidth_Minimum;
+            printf( "FlowControl: loss %.1f%% rtt %.0fms, bandwidth reduced to %.1fkB/s\n",
+                    loss * 100.0f, rtt * 1000.0f, bandwidth / 1024.0f );
+            return;
         }
+
+        // Keeps probing upwards, an estimate above what is sent costs nothing until the link pushes back
+        bandwidth += Bandwidth_Increase;
+        if ( bandwidth > Bandwidth_Maximum )
+            bandwidth = Bandwidth_Maximum;
+    }
+
+    void FlowControl::PacketSent( int32_t bytes )
+    {
+        allowance -= bytes;
     }
 }
@@ -1,174 +1,79 @@
 #include "FragmentBuffer.h"
-#include <algorithm>
-#include <cassert>
+#include <cstring>
 
 namespace Net
 {
     FragmentBuffer::FragmentBuffer(const int32_t maxFragmentSize)
     : m_maxFragmentSize(maxFragmentSize)
-    , m_data(nullptr)
-    , m_dataSize(0)
     , m_fragmentCount(0)
+    , m_receivedCount(0)
+    , m_sequence(0)
+    , m_lastReceiveTime(0.f)
     {
     }
 
     FragmentBuffer::~FragmentBuffer()
     {
-        clearData();
     }
 
-    void FragmentBuffer::setupFragmentData(const unsigned char* data,
-                                           const int32_t dataSize)
+    void FragmentBuffer::setup(const uint16_t sequence,
+                               const uint8_t fragmentCount,
+                               const float time)
     {
-        assert(dataSize > 0);
-        assert(m_data == nullptr);
-        assert(m_dataSize == 0);
-        assert(m_fragments.empty());
-        
-        const int32_t fragmentCount = (dataSize + m_maxFragmentSize - 1) / m_maxFragmentSize;
-        assert(fragmentCount < 256);
-
+        m_sequence = sequence;
         m_fragmentCount = fragmentCount;
-        m_data = (unsigned char*)malloc(dataSize);
-        
-        if (data)
-        {
-            memcpy(m_data, data, dataSize);
-            
-            int32_t bytesLeft = dataSize;
-            
-            for (PacketFragmentID fragmentID = 0; fragmentID < fragmentCount; fragmentID++)
-            {
-                int32_t fragSize = std::min(bytesLeft, m_maxFragmentSize);
-                
-                FragmentData fragmentData;
-                fragmentData.data = &m_data[getDataOffset(fragmentID)];
-                fragmentData.size = fragSize;
-                m_fragments[fragmentID] = fragmentData;
-                
-                bytesLeft -= fragSize;
-            }
-        }
+        m_receivedCount = 0;
+        m_lastReceiveTime = time;
+        m_data.resize(fragmentCount * m_maxFragmentSize);
+        m_fragmentSizes.assign(fragmentCount, 0);
     }
 
     void FragmentBuffer::clearData()
     {
-        if (m_data)
-        {
-            delete [] m_data;
-            m_data = nullptr;
-        }
-        
-        m_dataSize = 0;
         m_fragmentCount = 0;
-        
-        m_fragments.clear();
-        m_sentFragments.clear();
-    }
-    
-    const unsigned char* FragmentBuffer::getFragmentData(const PacketFragmentID fragmentID)
-    {
-        return m_fragments.at(fragmentID).data;
-    }
-    
-    const int32_t FragmentBuffer::getFragmentSize(const PacketFragmentID fragmentID)
-    {
-        return m_fragments.at(fragmentID).size;
-    }
-    
-    bool FragmentBuffer::onFragmentSent(const PacketFragmentID fragmentID,
-                                        const PacketSequenceID packetID)
-    {
-        if (m_fragments.count(fragmentID))
-        {
-            return false;
-        }
-        
-        if (m_sentFragments.count(packetID))
-        {
-            return false;
-        }
-        
-        m_sentFragments[packetID] = fragmentID;
-        
-        return true;
-    }
-    
-    bool FragmentBuffer::onPacketAcked(const PacketSequenceID packetID)
-    {
-        if (m_sentFragments.count(packetID) == 0)
-        {
-            // Acked packet did not contain fragment
-            return false;
-        }
-        
-        const PacketFragmentID ackedFragmentID = m_sentFragments.at(packetID);
-        
-        // Remove all packet IDs which contained the acked fragment
-        for(auto it = m_sentFragments.begin(); it != m_sentFragments.end();)
-        {
-            if (it->second == ackedFragmentID)
-            {
-                m_sentFragments.erase(it++);
-            }
-            else
-            {
-                ++it;
-            }
-        }
-        
-        // Fragment was acked so it no longer needs to be sent
-        m_fragments.erase(ackedFragmentID);
-        
-        if (m_fragments.empty())
-        {
-            // All fragments have been acked
-            clearData();
-        }
-        
-        return true;
+        m_receivedCount = 0;
+        m_fragmentSizes.clear();
     }
     
     bool FragmentBuffer::onFragmentReceived(const unsigned char* fragmentData,
                                             const int32_t size,
-                                            PacketFragmentID fragmentID,
-                                            uint8_t fragmentCount)
+                                            const PacketFragmentID fragmentID,
+                                            const uint8_t fragmentCount,
+                                            const float time)
     {
-        if (m_fragments.count(fragmentID))
+        if (fragmentCount != m_fragmentCount ||
+            fragmentID >= m_fragmentCount)
         {
             return false;
         }
-        
-        if (m_fragmentCount != fragmentCount)
+
+        const bool isLastFragment = fragmentID == m_fragmentCount - 1;
+        if (size <= 0 ||
+            size > m_maxFragmentSize ||
+            (!isLastFragment && size != m_maxFragmentSize))
         {
-            return false;
+            return false; // Would leave a gap in the data
         }
         
-        memcpy(&m_data[getDataOffset(fragmentID)], fragmentData, size);
+        if (m_fragmentSizes[fragmentID] != 0)
+        {
+            return false; // Duplicate
+        }
         
-        FragmentData data;
-        data.data = &m_data[getDataOffset(fragmentID)];
-        data.size = size;
-        m_fragments[fragmentID] = data;
+        memcpy(&m_data[fragmentID * m_maxFragmentSize], fragmentData, size);
+        m_fragmentSizes[fragmentID] = size;
+        m_receivedCount++;
+        m_lastReceiveTime = time;
         
         return true;
     }
     
-    bool FragmentBuffer::isComplete()
+    const int32_t FragmentBuffer::getDataSize() const
     {
-        for (uint8_t i = 0; i < m_fragmentCount; i++)
+        if (!isComplete())
         {
-            if (m_fragments.count(i) == 0)
-            {
-                return false;
-            }
+            return 0;
         }
-        return true;
-    }
-    
-    const size_t FragmentBuffer::getDataOffset(const PacketFragmentID fragmentID) const
-    {
-        return fragmentID * m_maxFragmentSize;
+        return ((m_fragmentCount - 1) * m_maxFragmentSize) + m_fragmentSizes[m_fragmentCount - 1];
     }
 }
-
@@ -1,5 +1,6 @@
 #include "Listener.h"
 #include "Serialization.h"
+#include <cstring>
 
 namespace Net
 {
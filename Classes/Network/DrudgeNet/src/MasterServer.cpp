@@ -9,6 +9,7 @@
 #include "WriteStream.h"
 #include <iostream>
 #include <algorithm>
+#include <cstring>
 
 namespace Net {
 MasterServer::MasterServer(const Net::Port serverPort,
@@ -213,6 +214,7 @@ void MasterServer::sendMessage(const std::shared_ptr<Net::Message>& message,
     Net::MessageType messageType = message->getType();
     m_writeStream->SerializeByte(messageType);
     message->serialize(*m_writeStream.get());
+    m_writeStream->Flush();
     
     const int bytesWritten = m_writeStream->GetBitsProcessed() / 8 + (m_writeStream->GetBitsProcessed() % 8 ? 1 : 0);
     writeHeaderData(bytesWritten);
@@ -232,6 +234,7 @@ void MasterServer::sendPing(const Net::Address& address, const bool isPong)
 
     std::string PING_STRING = isPong ? "pong" : "ping";
     m_writeStream->SerializeString(PING_STRING);
+    m_writeStream->Flush();
     const int bytesWritten = m_writeStream->GetBitsProcessed() / 8 + (m_writeStream->GetBitsProcessed() % 8 ? 1 : 0);
     writeHeaderData(bytesWritten);
     
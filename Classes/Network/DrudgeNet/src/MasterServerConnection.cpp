@@ -8,6 +8,7 @@
 #include "Socket.h"
 #include "WriteStream.h"
 #include <iostream>
+#include <cstring>
 
 namespace Net {
 MasterServerConnection::MasterServerConnection(const Mode mode,
@@ -280,6 +281,7 @@ void MasterServerConnection::sendMessage(const std::shared_ptr<Net::Message>& me
     Net::MessageType messageType = message->getType();
     m_writeStream->SerializeByte(messageType);
     message->serialize(*m_writeStream.get());
+    m_writeStream->Flush();
     const int bytesWritten = m_writeStream->GetBitsProcessed() / 8 + (m_writeStream->GetBitsProcessed() % 8 ? 1 : 0);
     writeHeaderData(bytesWritten);
 
@@ -298,6 +300,7 @@ void MasterServerConnection::sendPing(const bool isPong)
     Net::Serialization::WriteInteger(m_writeBuffer, m_protocolID);
     m_writeStream->SerializeByte(messageType);
     m_writeStream->SerializeString(PING_STRING);
+    m_writeStream->Flush();
     const int bytesWritten = m_writeStream->GetBitsProcessed() / 8 + (m_writeStream->GetBitsProcessed() % 8 ? 1 : 0);
     writeHeaderData(bytesWritten);
     
@@ -9,6 +9,7 @@ namespace Net
                int maxNodes,
                float sendRate,
                float timeout)
+    : socket(Socket::NonBlocking | Socket::Batched)
     {
         assert(maxNodes >= 1);
         assert(maxNodes <= 255);
@@ -234,6 +235,7 @@ namespace Net
             }
             sendAccumulator -= sendRate;
         }
+        socket.Flush();
     }
     
     void Mesh::CheckForTimeouts( float deltaTime )
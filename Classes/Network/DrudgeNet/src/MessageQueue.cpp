@@ -2,25 +2,37 @@
 
 namespace Net
 {
+    const size_t MessageQueue::SENT_PACKET_BUFFER_SIZE = 1024;
+
     MessageQueue::MessageQueue(Mode mode)
     : m_mode(mode)
-    , m_nextMessageID(0)
+    , m_nextMessageID(1)
     {
+        if (m_mode == RELIABLE)
+        {
+            m_sentPackets.resize(SENT_PACKET_BUFFER_SIZE, {0, false, {}});
+        }
     }
 
     void MessageQueue::clear()
     {
         m_messages.clear();
+        for (SentPacket& sentPacket : m_sentPackets)
+        {
+            sentPacket.valid = false;
+            sentPacket.messageIDs.clear();
+        }
+        m_nextMessageID = 1;
     }
-    
+
     MessageID MessageQueue::queueMessage(std::shared_ptr<Message>& message,
                                          uint32_t bitsRequired)
     {
         MessageData data;
         data.message = message;
         data.bitsRequired = bitsRequired;
-        data.timeLastSent = -1;
-        
+        data.timeLastSent = -1.f;
+
         MessageID msgID = m_nextMessageID;
         m_nextMessageID++;
 
@@ -35,39 +47,67 @@ namespace Net
             m_messages.erase(messageID);
         }
     }
-    
+
     void MessageQueue::onPacketSent(const PacketSequenceID packetID,
-                                    std::vector<MessageID>& messages)
+                                    const std::vector<MessageID>& messages,
+                                    const float time)
     {
         if (m_mode == UNRELIABLE)
         {
             return;
         }
+
+        SentPacket& sentPacket = m_sentPackets[packetID % SENT_PACKET_BUFFER_SIZE];
+        sentPacket.packetID = packetID;
+        sentPacket.valid = true;
+        sentPacket.messageIDs = messages;
+
+        for (const MessageID messageID : messages)
+        {
+            auto it = m_messages.find(messageID);
+            if (it != m_messages.end())
+            {
+                it->second.timeLastSent = time;
+            }
+        }
     }
-    
-    bool MessageQueue::getNextMessage(const int32_t bitsAvailable,
-                                      MessageID& messageID,
-                                      MessageData& data)
+
+    void MessageQueue::onPacketAcked(const PacketSequenceID packetID,
+                                     std::vector<MessageID>& acked)
     {
-        if (m_messages.empty())
+        acked.clear();
+        if (m_mode == UNRELIABLE)
         {
-            return false;
+            return;
         }
-        
-        auto pair = *m_messages.begin();
-        
-        if (pair.second.bitsRequired < bitsAvailable)
+
+        SentPacket& sentPacket = m_sentPackets[packetID % SENT_PACKET_BUFFER_SIZE];
+        if (!sentPacket.valid || sentPacket.packetID != packetID)
         {
-            messageID = pair.first;
-            data = pair.second;
-            return true;
+            return; // Not one of ours or already overwritten
         }
-        else
+
+        for (const MessageID messageID : sentPacket.messageIDs)
         {
-            return false;
+            auto it = m_messages.find(messageID);
+            if (it != m_messages.end())
+            {
+                m_messages.erase(it);
+                acked.push_back(messageID); // An earlier resend may have been acked already
+            }
         }
-        
-        return false;
+        sentPacket.valid = false;
+        sentPacket.messageIDs.clear();
     }
-}
 
+    const std::shared_ptr<Message>& MessageQueue::getMessage(const MessageID messageID) const
+    {
+        static const std::shared_ptr<Message> NO_MESSAGE;
+        auto it = m_messages.find(messageID);
+        if (it == m_messages.end())
+        {
+            return NO_MESSAGE;
+        }
+        return it->second.message;
+    }
+}
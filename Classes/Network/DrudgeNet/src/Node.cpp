@@ -1,7 +1,9 @@
 #include "Node.h"
 #include "Serialization.h"
 #include "CRC32.h"
+#include "PacketPool.h"
 #include <cassert>
+#include <cstring>
 
 namespace Net
 {
@@ -9,7 +11,8 @@ namespace Net
                float sendRate,
                float timeout,
                int32_t maxPacketSize)
-    : m_protocolId(protocolId)
+    : m_socket(Socket::NonBlocking | Socket::Batched)
+    , m_protocolId(protocolId)
     , m_sendRate(sendRate)
     , m_timeout(timeout)
     , m_maxPacketSize(maxPacketSize)
@@ -110,43 +113,43 @@ namespace Net
         return m_socket.Send( m_nodes[nodeID].address, data, size );
     }
     
+    void Node::Flush()
+    {
+        m_socket.Flush();
+    }
+    
     int Node::ReceivePacket(NodeID & nodeID, unsigned char data[], int32_t size)
     {
         assert( m_running );
         if ( !m_receivedPackets.empty() )
         {
-            BufferedPacket * packet = m_receivedPackets.top();
-            assert( packet );
-            if (packet->data.size() <= size )
+            const BufferedPacket packet = m_receivedPackets.top();
+            m_receivedPackets.pop();
+            if ( packet.size <= size )
             {
-                nodeID = packet->nodeID;
-                size = (int)packet->data.size();
-                memcpy( data, &packet->data[0], size );
-                delete packet;
-                m_receivedPackets.pop();
+                nodeID = packet.nodeID;
+                size = packet.size;
+                memcpy( data, packet.data, size );
+                PacketPool::getDefault().release( packet.data );
                 return size;
             }
-            else
-            {
-                delete packet;
-                m_receivedPackets.pop();
-            }
+            PacketPool::getDefault().release( packet.data );
         }
         return 0;
     }
      
     void Node::ReceivePackets()
     {
+        // One scratch buffer for the whole batch, node packets get copied out into their own pooled buffer
+        PacketPool::Buffer data = PacketPool::getDefault().acquireScoped(m_maxPacketSize);
         while (true)
         {
             Address sender;
-            unsigned char *data;
-            data = new unsigned char[m_maxPacketSize];
-            int32_t size = (int32_t)m_socket.Receive(sender, data, m_maxPacketSize);
+            int32_t size = (int32_t)m_socket.Receive(sender, data.get(), m_maxPacketSize);
             if (!size)
                 break;
 //            printf("Node %i: received %i bytes\n", m_localNodeID, size);
-            ProcessPacket(sender, data, size);
+            ProcessPacket(sender, data.get(), size);
         }
     }
     
@@ -188,6 +191,7 @@ namespace Net
             }
             m_meshSendAccumulator -= m_sendRate;
         }
+        m_socket.Flush();
     }
     
     void Node::CheckForTimeout( float deltaTime )
@@ -226,8 +230,7 @@ namespace Net
         m_addr2node.clear();
         while (!m_receivedPackets.empty())
         {
-            BufferedPacket * packet = m_receivedPackets.top();
-            delete packet;
+            PacketPool::getDefault().release(m_receivedPackets.top().data);
             m_receivedPackets.pop();
         }
         m_meshSendAccumulator = 0.0f;
@@ -386,10 +389,11 @@ namespace Net
             assert(nodeID >= 0 );
             assert(nodeID < (int32_t)m_nodes.size());
             
-            BufferedPacket * packet = new BufferedPacket;
-            packet->nodeID = nodeID;
-            packet->data.resize(size);
-            memcpy(&packet->data[0], data, size);
+            BufferedPacket packet;
+            packet.nodeID = nodeID;
+            packet.data = PacketPool::getDefault().acquire(size);
+            packet.size = size;
+            memcpy(packet.data, data, size);
             m_receivedPackets.push(packet);
         }
     }
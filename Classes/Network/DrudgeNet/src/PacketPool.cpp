@@ -0,0 +1,150 @@
+#include "PacketPool.h"
+#include <cassert>
+#include <cstdio>
+
+namespace Net
+{
+    constexpr int32_t PacketPool::DEFAULT_BUFFER_BYTES;
+    constexpr size_t PacketPool::DEFAULT_BUFFER_COUNT;
+    constexpr uint32_t PacketPool::NO_BUFFER;
+
+    PacketPool::Buffer& PacketPool::Buffer::operator=(Buffer&& other)
+    {
+        if (this != &other)
+        {
+            reset();
+            m_pool = other.m_pool;
+            m_data = other.m_data;
+            other.m_data = nullptr;
+        }
+        return *this;
+    }
+
+    void PacketPool::Buffer::reset()
+    {
+        if (m_data)
+        {
+            m_pool->release(m_data);
+            m_data = nullptr;
+        }
+    }
+
+    PacketPool::PacketPool(const size_t bufferCount,
+                           const int32_t bufferBytes)
+    : m_bufferCount(bufferCount)
+    , m_bufferBytes(bufferBytes)
+    , m_storage(bufferCount * bufferBytes)
+    , m_nextFree(new std::atomic<uint32_t>[bufferCount])
+    , m_freeHead(bufferCount ? 0 : NO_BUFFER)
+    , m_inUse(0)
+    , m_highWaterMark(0)
+    , m_heapFallbacks(0)
+    , m_acquires(0)
+    {
+        assert(bufferBytes > 0);
+        assert(bufferCount < NO_BUFFER);
+        for (size_t i = 0; i < bufferCount; i++)
+        {
+            m_nextFree[i].store(i + 1 < bufferCount ? (uint32_t)(i + 1) : NO_BUFFER, std::memory_order_relaxed);
+        }
+    }
+
+    PacketPool::~PacketPool()
+    {
+        if (m_inUse.load() != 0)
+        {
+            printf("PacketPool: destroyed with %zu buffers still in use\n", m_inUse.load());
+        }
+    }
+
+    unsigned char* PacketPool::acquire(const int32_t bytes)
+    {
+        assert(bytes >= 0);
+        m_acquires.fetch_add(1, std::memory_order_relaxed);
+        if (bytes <= m_bufferBytes)
+        {
+            uint64_t head = m_freeHead.load(std::memory_order_acquire);
+            while ((uint32_t)head != NO_BUFFER)
+            {
+                const uint32_t index = (uint32_t)head;
+                const uint64_t tag = (head >> 32) + 1;
+                const uint64_t next = (tag << 32) | m_nextFree[index].load(std::memory_order_relaxed);
+                if (m_freeHead.compare_exchange_weak(head, next,
+                                                     std::memory_order_acq_rel,
+                                                     std::memory_order_acquire))
+                {
+                    const size_t inUse = m_inUse.fetch_add(1, std::memory_order_relaxed) + 1;
+                    size_t highWaterMark = m_highWaterMark.load(std::memory_order_relaxed);
+                    while (inUse > highWaterMark &&
+                           !m_highWaterMark.compare_exchange_weak(highWaterMark, inUse, std::memory_order_relaxed))
+                    {
+                    }
+                    return &m_storage[index * m_bufferBytes];
+                }
+            }
+        }
+
+        m_heapFallbacks.fetch_add(1, std::memory_order_relaxed);
+        return new unsigned char[bytes > 0 ? bytes : 1];
+    }
+
+    void PacketPool::release(unsigned char* data)
+    {
+        if (!data)
+        {
+            return;
+        }
+        if (!isPooled(data))
+        {
+            delete [] data;
+            return;
+        }
+
+        const uint32_t index = (uint32_t)((data - &m_storage[0]) / m_bufferBytes);
+        assert(data == &m_storage[index * m_bufferBytes]);
+        // Count it out before it becomes visible to acquire, keeps inUse within capacity
+        m_inUse.fetch_sub(1, std::memory_order_relaxed);
+        uint64_t head = m_freeHead.load(std::memory_order_relaxed);
+        uint64_t next = 0;
+        do
+        {
+            m_nextFree[index].store((uint32_t)head, std::memory_order_relaxed);
+            next = (((head >> 32) + 1) << 32) | index;
+        }
+        while (!m_freeHead.compare_exchange_weak(head, next,
+                                                 std::memory_order_release,
+                                                 std::memory_order_relaxed));
+    }
+
+    PacketPool::Stats PacketPool::getStats() const
+    {
+        Stats stats;
+        stats.capacity = m_bufferCount;
+        stats.inUse = m_inUse.load(std::memory_order_relaxed);
+        stats.highWaterMark = m_highWaterMark.load(std::memory_order_relaxed);
+        stats.heapFallbacks = m_heapFallbacks.load(std::memory_order_relaxed);
+        stats.acquires = m_acquires.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    void PacketPool::resetHighWaterMark()
+    {
+        m_highWaterMark.store(m_inUse.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    PacketPool& PacketPool::getDefault()
+    {
+        static PacketPool pool;
+        return pool;
+    }
+
+    bool PacketPool::isPooled(const unsigned char* data) const
+    {
+        if (m_storage.empty())
+        {
+            return false;
+        }
+        const unsigned char* begin = &m_storage[0];
+        return data >= begin && data < begin + m_storage.size();
+    }
+}
@@ -1,4 +1,5 @@
 #include "ReliabilitySystem.h"
+#include <cstdio>
 
 namespace Net
 {
@@ -1,4 +1,6 @@
 #include "ReliableConnection.h"
+#include "PacketPool.h"
+#include <cstring>
 
 namespace Net
 {
@@ -28,7 +30,8 @@ namespace Net
     bool ReliableConnection::sendPacket(const unsigned char data[], int size)
     {
         const int header = 12;
-        unsigned char * packet = new unsigned char[header+size];
+        PacketPool::Buffer buffer = PacketPool::getDefault().acquireScoped(header + size);
+        unsigned char * packet = buffer.get();
         uint32_t seq = m_reliabilitySystem.GetLocalSequence();
         uint32_t ack = m_reliabilitySystem.GetRemoteSequence();
         uint32_t ack_bits = m_reliabilitySystem.GenerateAckBits();
@@ -39,7 +42,6 @@ namespace Net
             return false;
         }
         m_reliabilitySystem.PacketSent(size);
-        delete [] packet;
         return true;
     }
     
@@ -50,16 +52,15 @@ namespace Net
         {
             return false;
         }
-        unsigned char * packet = new unsigned char[header+size];
+        PacketPool::Buffer buffer = PacketPool::getDefault().acquireScoped(header + size);
+        unsigned char * packet = buffer.get();
         int received_bytes = Connection::receivePacket( packet, size + header );
         if ( received_bytes == 0 )
         {
-            delete [] packet;
             return false;
         }
         if ( received_bytes <= header )
         {
-            delete [] packet;
             return false;
         }
         uint32_t packet_sequence = 0;
@@ -69,7 +70,6 @@ namespace Net
         m_reliabilitySystem.PacketReceived( packet_sequence, received_bytes - header );
         m_reliabilitySystem.ProcessAck( packet_ack, packet_ack_bits );
         memcpy( data, packet + header, received_bytes - header );
-        delete [] packet;
         return received_bytes - header;
     }
 
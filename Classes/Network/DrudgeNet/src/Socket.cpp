@@ -1,8 +1,10 @@
 #include "Socket.h"
+#include "DataConstants.h"
 
 #include <stdio.h>
 #include <cassert>
 #include <algorithm>
+#include <cstring>
 
 #ifdef _WIN32
 #else
@@ -13,6 +15,31 @@ namespace Net
 {
 	bool Socket::s_socketsInitialized = false;
 
+#if SOCKET_BATCHED_IO
+    const int32_t Socket::BATCH_SIZE = 64;
+    const int32_t Socket::BATCH_PACKET_BYTES = MAXIMUM_TRANSMISSION_UNIT_BYTES;
+
+    Socket::PacketBatch::PacketBatch()
+    : data(BATCH_SIZE * BATCH_PACKET_BYTES)
+    , headers(BATCH_SIZE)
+    , buffers(BATCH_SIZE)
+    , addresses(BATCH_SIZE)
+    , count(0)
+    , next(0)
+    {
+        memset(headers.data(), 0, headers.size() * sizeof(mmsghdr));
+        for (int32_t i = 0; i < BATCH_SIZE; i++)
+        {
+            buffers[i].iov_base = &data[i * BATCH_PACKET_BYTES];
+            buffers[i].iov_len = BATCH_PACKET_BYTES;
+            headers[i].msg_hdr.msg_name = &addresses[i];
+            headers[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            headers[i].msg_hdr.msg_iov = &buffers[i];
+            headers[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+#endif
+
     bool Socket::InitializeSockets()
     {
         if (s_socketsInitialized)
@@ -137,6 +164,14 @@ namespace Net
             }
         }
         
+#if SOCKET_BATCHED_IO
+        if (_options & Batched)
+        {
+            _sendBatch = std::unique_ptr<PacketBatch>(new PacketBatch());
+            _receiveBatch = std::unique_ptr<PacketBatch>(new PacketBatch());
+        }
+#endif
+        
         return true;
     }
     
@@ -144,6 +179,11 @@ namespace Net
     {
         if (_socket != 0)
         {
+            Flush();
+#if SOCKET_BATCHED_IO
+            _sendBatch = nullptr;
+            _receiveBatch = nullptr;
+#endif
 #if PLATFORM == PLATFORM_MAC || PLATFORM == PLATFORM_UNIX
             close(_socket);
 #elif PLATFORM == PLATFORM_WINDOWS
@@ -174,6 +214,26 @@ namespace Net
         address.sin_addr.s_addr = htonl( destination.GetAddressIP4() );
         address.sin_port = htons( (unsigned short) destination.GetPort() );
         
+#if SOCKET_BATCHED_IO
+        if (_sendBatch)
+        {
+            if (size <= (size_t)BATCH_PACKET_BYTES)
+            {
+                if (_sendBatch->count == BATCH_SIZE)
+                {
+                    Flush();
+                }
+                const int32_t index = _sendBatch->count++;
+                memcpy(_sendBatch->buffers[index].iov_base, data, size);
+                _sendBatch->buffers[index].iov_len = size;
+                _sendBatch->addresses[index] = address;
+                return true;
+            }
+            // Too big for a slot, send what's queued first so packets go out in order
+            Flush();
+        }
+#endif
+        
         int sent_bytes = (int)sendto(_socket,
                                      (const char*)data,
                                      size,
@@ -191,6 +251,13 @@ namespace Net
         if (_socket == 0)
             return false;
         
+#if SOCKET_BATCHED_IO
+        if (_receiveBatch)
+        {
+            return ReceiveBatched(sender, data, size);
+        }
+#endif
+        
 #if PLATFORM == PLATFORM_WINDOWS
         typedef int socklen_t;
 #endif
@@ -215,5 +282,77 @@ namespace Net
 
         return received_bytes;
     }
+    
+    void Socket::Flush()
+    {
+#if SOCKET_BATCHED_IO
+        if (!_sendBatch || _sendBatch->count == 0)
+        {
+            return;
+        }
+        
+        int32_t sent = 0;
+        while (sent < _sendBatch->count)
+        {
+            const int result = sendmmsg(_socket,
+                                        &_sendBatch->headers[sent],
+                                        _sendBatch->count - sent,
+                                        0);
+            if (result <= 0)
+            {
+                break; // Same as a failed sendto, the rest of the batch is dropped
+            }
+            sent += result;
+        }
+        _sendBatch->count = 0;
+#endif
+    }
+    
+#if SOCKET_BATCHED_IO
+    int64_t Socket::ReceiveBatched(Address& sender, void* data, size_t size)
+    {
+        PacketBatch& batch = *_receiveBatch;
+        while (true)
+        {
+            if (batch.next == batch.count)
+            {
+                batch.count = 0;
+                batch.next = 0;
+                for (int32_t i = 0; i < BATCH_SIZE; i++)
+                {
+                    batch.buffers[i].iov_len = BATCH_PACKET_BYTES;
+                    batch.headers[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+                    batch.headers[i].msg_hdr.msg_flags = 0;
+                }
+                
+                // Blocking sockets only wait for the first packet
+                const int received = recvmmsg(_socket,
+                                              batch.headers.data(),
+                                              BATCH_SIZE,
+                                              MSG_WAITFORONE,
+                                              nullptr);
+                if (received <= 0)
+                {
+                    return 0;
+                }
+                batch.count = received;
+            }
+            
+            const int32_t index = batch.next++;
+            const mmsghdr& header = batch.headers[index];
+            if (header.msg_len == 0 || (header.msg_hdr.msg_flags & MSG_TRUNC))
+            {
+                continue; // Bigger than a slot, the tail is lost so drop the whole packet
+            }
+            
+            const size_t receivedBytes = std::min(size, (size_t)header.msg_len);
+            memcpy(data, batch.buffers[index].iov_base, receivedBytes);
+            
+            const sockaddr_in& from = batch.addresses[index];
+            sender = Address(ntohl(from.sin_addr.s_addr), ntohs(from.sin_port));
+            
+            return (int64_t)receivedBytes;
+        }
+    }
+#endif
 }
-
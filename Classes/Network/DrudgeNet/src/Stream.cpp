@@ -20,6 +20,12 @@ namespace Net
         bitpacker.Clear();
     }
     
+    void Stream::Flush()
+    {
+        bitpacker.FlushBits();
+        journal.FlushBits();
+    }
+    
     bool Stream::IsReading() const
     {
         return bitpacker.GetMode() == BitPacker::Read;
@@ -83,6 +89,7 @@ namespace Net
         {
             printf("-----------------------------\n");
             printf("dump journal:\n");
+            journal.FlushBits();
             BitPacker reader(BitPacker::Read, journal.GetData(), journal.GetBytes());
             while (reader.BitsRemaining() > 6)
             {
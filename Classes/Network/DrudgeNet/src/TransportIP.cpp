@@ -18,6 +18,8 @@
 #include <string>
 #include <vector>
 #include <cassert>
+#include <algorithm>
+#include <cstring>
 
 #ifdef DEBUG
 #define NET_UNIT_TEST
@@ -243,14 +245,13 @@ namespace Net
         assert(size < BUFFER_SIZE_BYTES);
         assert(m_writeStream->GetBitsProcessed() == 0);
         
-        const float sendRate = m_flowControl[m_nodeID]->GetSendRate();
-        if (m_sendAccumulators[m_nodeID] < 1.0f / sendRate)
+        auto flowControl = m_flowControl.find(m_nodeID);
+        if (flowControl != m_flowControl.end() &&
+            !flowControl->second->CanSend())
         {
             return false;
         }
         
-        m_sendAccumulators[m_nodeID] -= 1.0f / sendRate;
-        
         std::shared_ptr<ReliabilitySystem> reliabilitySystem = GetReliability(m_nodeID);
         uint32_t seq = reliabilitySystem->GetLocalSequence();
         uint32_t ack = reliabilitySystem->GetRemoteSequence();
@@ -259,6 +260,7 @@ namespace Net
         m_writeStream->SerializeInteger(seq);
         m_writeStream->SerializeInteger(ack);
         m_writeStream->SerializeInteger(ack_bits);
+        m_writeStream->Flush();
         
         const int32_t headerBytes = m_writeStream->GetBitsProcessed() / 8;
         memcpy(m_writeBuffer + headerBytes, data, size);
@@ -267,6 +269,10 @@ namespace Net
         if (success)
         {
             reliabilitySystem->PacketSent(size);
+            if (flowControl != m_flowControl.end())
+            {
+                flowControl->second->PacketSent(size + headerBytes);
+            }
         }
         else
         {
@@ -330,6 +336,16 @@ namespace Net
         return m_reliabilitySystems[m_nodeId];
     }
     
+    float TransportIP::GetBandwidth(NodeID m_nodeId) const
+    {
+        auto flowControl = m_flowControl.find(m_nodeId);
+        if (flowControl == m_flowControl.end())
+        {
+            return 0.f;
+        }
+        return flowControl->second->GetBandwidth();
+    }
+    
     void TransportIP::Update(float deltaTime)
     {
         m_tickAccumulator++;
@@ -348,7 +364,7 @@ namespace Net
             {
                 if (IsNodeConnected(m_nodeID))
                 {
-                    m_flowControl[m_nodeID]->Update(deltaTime, GetReliability(m_nodeID)->GetRoundTripTime() * 1000.f);
+                    m_flowControl[m_nodeID]->Update(deltaTime, *GetReliability(m_nodeID));
                 }
             }
         }
@@ -358,17 +374,20 @@ namespace Net
             
             if (m_node->IsConnected())
             {
-                m_flowControl[0]->Update(deltaTime, GetReliability(0)->GetRoundTripTime() * 1000.f);
+                m_flowControl[0]->Update(deltaTime, *GetReliability(0));
             }
         }
         if (m_mesh || m_node)
         {
             UpdateReliabilitySystems(deltaTime);
-            
-            for (auto& accumulator : m_sendAccumulators)
-            {
-                accumulator.second = accumulator.second + deltaTime;
-            }
+        }
+    }
+    
+    void TransportIP::Flush()
+    {
+        if (m_node)
+        {
+            m_node->Flush();
         }
     }
     
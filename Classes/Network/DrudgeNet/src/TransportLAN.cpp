@@ -20,6 +20,7 @@
 #include <string>
 #include <vector>
 #include <cassert>
+#include <cstring>
 
 #ifdef DEBUG
 #define NET_UNIT_TEST
@@ -292,14 +293,13 @@ namespace Net
         assert(size < BUFFER_SIZE_BYTES);
         assert(m_writeStream->GetBitsProcessed() == 0);
         
-        const float sendRate = m_flowControl[nodeID]->GetSendRate();
-        if (m_sendAccumulators[nodeID] < 1.0f / sendRate)
+        auto flowControl = m_flowControl.find(nodeID);
+        if (flowControl != m_flowControl.end() &&
+            !flowControl->second->CanSend())
         {
             return false;
         }
         
-        m_sendAccumulators[nodeID] -= 1.0f / sendRate;
-        
         std::shared_ptr<ReliabilitySystem> reliabilitySystem = GetReliability(nodeID);
         uint32_t seq = reliabilitySystem->GetLocalSequence();
         uint32_t ack = reliabilitySystem->GetRemoteSequence();
@@ -308,6 +308,7 @@ namespace Net
         m_writeStream->SerializeInteger(seq);
         m_writeStream->SerializeInteger(ack);
         m_writeStream->SerializeInteger(ack_bits);
+        m_writeStream->Flush();
         
         const int32_t headerBytes = m_writeStream->GetBitsProcessed() / 8;
         memcpy(m_writeBuffer + headerBytes, data, size);
@@ -316,6 +317,10 @@ namespace Net
         if (success)
         {
             reliabilitySystem->PacketSent(size);
+            if (flowControl != m_flowControl.end())
+            {
+                flowControl->second->PacketSent(size + headerBytes);
+            }
         }
         else
         {
@@ -379,6 +384,16 @@ namespace Net
         return m_reliabilitySystems[nodeId];
     }
     
+    float TransportLAN::GetBandwidth(NodeID nodeId) const
+    {
+        auto flowControl = m_flowControl.find(nodeId);
+        if (flowControl == m_flowControl.end())
+        {
+            return 0.f;
+        }
+        return flowControl->second->GetBandwidth();
+    }
+    
     void TransportLAN::Update(float deltaTime)
     {
         m_tickAccumulator++;
@@ -404,7 +419,7 @@ namespace Net
             {
                 if (IsNodeConnected(nodeID))
                 {
-                    m_flowControl[nodeID]->Update(deltaTime, GetReliability(nodeID)->GetRoundTripTime() * 1000.f);
+                    m_flowControl[nodeID]->Update(deltaTime, *GetReliability(nodeID));
                 }
             }
         }
@@ -414,17 +429,20 @@ namespace Net
             
             if (node->IsConnected())
             {
-                m_flowControl[0]->Update(deltaTime, GetReliability(0)->GetRoundTripTime() * 1000.f);
+                m_flowControl[0]->Update(deltaTime, *GetReliability(0));
             }
         }
         if (mesh || node)
         {
             UpdateReliabilitySystems(deltaTime);
-            
-            for (auto& accumulator : m_sendAccumulators)
-            {
-                accumulator.second = accumulator.second + deltaTime;
-            }
+        }
+    }
+    
+    void TransportLAN::Flush()
+    {
+        if (node)
+        {
+            node->Flush();
         }
     }
     
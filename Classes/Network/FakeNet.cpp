@@ -2,40 +2,73 @@
 
 #include <random>
 
+// Whole messages go through FakeNet unfragmented, so buffers are sized for a full snapshot
+const size_t FAKENET_POOL_BUFFER_COUNT = 64;
+const int32_t FAKENET_POOL_BUFFER_BYTES = 4096;
+// Seconds of data a bandwidth limited link holds before it starts dropping
+const float FAKENET_LINK_QUEUE_TIME = 0.25f;
+
 FakeNet::FakeNet()
-: m_clientDataCallback(nullptr)
+: m_packetPool(FAKENET_POOL_BUFFER_COUNT, FAKENET_POOL_BUFFER_BYTES)
+, m_clientDataCallback(nullptr)
 , m_serverDataCallback(nullptr)
 , m_time(0.f)
 , m_inputDelay(0.1f)
 , m_serverDelay(0.1f)
 , m_packetLoss(0.f)
+, m_bandwidth(0.f)
+, m_clientLinkTime(0.f)
+, m_serverLinkTime(0.f)
 {
     printf("FakeNet:: constructor: %p\n", this);
 }
 
 FakeNet::~FakeNet()
 {
+    terminate();
     printf("FakeNet:: destructor: %p\n", this);
 }
 
 void FakeNet::terminate()
 {
-    std::queue<ClientData> emptyClientData;
-    std::swap(m_clientData, emptyClientData);
-    std::queue<ServerData> emptyServerData;
-    std::swap(m_serverData, emptyServerData);
+    while (!m_clientData.empty())
+    {
+        m_packetPool.release(m_clientData.front().data);
+        m_clientData.pop();
+    }
+    while (!m_serverData.empty())
+    {
+        m_packetPool.release(m_serverData.front().data);
+        m_serverData.pop();
+    }
+    while (!m_clientAcks.empty())
+    {
+        m_clientAcks.pop();
+    }
+    m_clientLinkReliability.Reset();
     m_clientDataCallback = nullptr;
     m_serverDataCallback = nullptr;
     m_time = 0.f;
     m_inputDelay = 0.1f;
     m_serverDelay = 0.1f;
     m_packetLoss = 0.f;
+    m_bandwidth = 0.f;
+    m_clientLinkTime = 0.f;
+    m_serverLinkTime = 0.f;
 }
 
 void FakeNet::update(const float deltaTime)
 {
     m_time += deltaTime;
 
+    while (!m_clientAcks.empty() &&
+           m_clientAcks.front().time <= m_time)
+    {
+        m_clientLinkReliability.ProcessAck(m_clientAcks.front().sequence, 0);
+        m_clientAcks.pop();
+    }
+    m_clientLinkReliability.Update(deltaTime);
+
     if (m_clientDataCallback)
     {
         const float delayedInputTime = m_time - m_inputDelay;
@@ -49,8 +82,10 @@ void FakeNet::update(const float deltaTime)
                 m_clientDataCallback(clientData.playerID,
                                      clientData.data,
                                      clientData.dataSize);
+                ClientAck ack = {m_time + m_serverDelay, clientData.sequence};
+                m_clientAcks.push(ack);
             }
-            delete [] m_clientData.front().data;
+            m_packetPool.release(m_clientData.front().data);
             m_clientData.pop();
         }
     }
@@ -66,7 +101,7 @@ void FakeNet::update(const float deltaTime)
                 m_serverDataCallback(m_serverData.front().data,
                                      m_serverData.front().dataSize);
             }
-            delete [] m_serverData.front().data;
+            m_packetPool.release(m_serverData.front().data);
             m_serverData.pop();
         }
     }
@@ -74,22 +109,55 @@ void FakeNet::update(const float deltaTime)
 
 void FakeNet::takeClientData(const uint8_t playerID, const unsigned char* data, const size_t dataSize)
 {
-    unsigned char* localData = new unsigned char[dataSize];
+    const uint32_t sequence = m_clientLinkReliability.GetLocalSequence();
+    m_clientLinkReliability.PacketSent((int32_t)dataSize);
+
+    float time = m_time;
+    if (!queueOnLink(m_clientLinkTime, dataSize, time))
+    {
+        return;
+    }
+
+    unsigned char* localData = m_packetPool.acquire((int32_t)dataSize);
     memcpy(localData, data, dataSize);
     
-    ClientData d = {m_time, playerID, localData, dataSize};
+    ClientData d = {time, playerID, localData, dataSize, sequence};
     m_clientData.push(d);
 }
 
 void FakeNet::takeServerData(const unsigned char* data, const size_t dataSize)
 {
-    unsigned char* localData = new unsigned char[dataSize];
+    float time = m_time;
+    if (!queueOnLink(m_serverLinkTime, dataSize, time))
+    {
+        return;
+    }
+
+    unsigned char* localData = m_packetPool.acquire((int32_t)dataSize);
     memcpy(localData, data, dataSize);
     
-    ServerData d = {m_time, localData, dataSize};
+    ServerData d = {time, localData, dataSize};
     m_serverData.push(d);
 }
 
+bool FakeNet::queueOnLink(float& linkTime, const size_t dataSize, float& arrivalTime) const
+{
+    if (m_bandwidth <= 0.f)
+    {
+        return true;
+    }
+
+    const float start = linkTime > m_time ? linkTime : m_time;
+    if (start - m_time > FAKENET_LINK_QUEUE_TIME)
+    {
+        return false;
+    }
+
+    linkTime = start + dataSize / m_bandwidth;
+    arrivalTime = linkTime;
+    return true;
+}
+
 void FakeNet::setClientDataCallback(std::function<void(const uint8_t playerID, const unsigned char* data, const size_t dataSize)> cb)
 {
     m_clientDataCallback = cb;
@@ -5,6 +5,7 @@
 #include <functional>
 #include "Network/NetworkMessages.h"
 #include "ReliabilitySystem.h"
+#include "PacketPool.h"
 
 class FakeNet
 {
@@ -24,25 +25,42 @@ public:
     
     void setInputDelay(const float delay) { m_inputDelay = delay; }
     void setServerDelay(const float delay) { m_serverDelay = delay; }
+    // Loss in percent, applies to both directions
+    void setPacketLoss(const float loss) { m_packetLoss = loss; }
+    // Bytes per second each direction carries, 0 for unlimited. Data beyond it waits in a
+    // short link queue and is dropped once that is full, like a constrained connection would.
+    void setBandwidth(const float bandwidth) { m_bandwidth = bandwidth; }
     
     float getInputDelay() const { return m_inputDelay; }
     float getServerDelay() const { return m_serverDelay; }
+    // Acks for data sent to the client, the server's view of its link for flow control
+    const Net::ReliabilitySystem& getClientLinkReliability() const { return m_clientLinkReliability; }
+    Net::PacketPool::Stats getPacketPoolStats() const { return m_packetPool.getStats(); }
 
 private:
     struct ClientData {
         float time;
         uint8_t playerID;
-        const unsigned char* data;
+        unsigned char* data;
         const size_t dataSize;
+        uint32_t sequence;
     };
     struct ServerData {
         float time;
-        const unsigned char* data;
+        unsigned char* data;
         const size_t dataSize;
     };
+    struct ClientAck {
+        float time;
+        uint32_t sequence;
+    };
     
+    Net::PacketPool m_packetPool; // Holds packets while they sit in the delay queues
+
     std::queue<ClientData> m_clientData;
     std::queue<ServerData> m_serverData;
+    std::queue<ClientAck> m_clientAcks;
+    Net::ReliabilitySystem m_clientLinkReliability;
 
     std::function<void(const uint8_t playerID, const unsigned char* data, const size_t dataSize)> m_clientDataCallback;
     std::function<void(const unsigned char* data, const size_t dataSize)> m_serverDataCallback;
@@ -51,6 +69,11 @@ private:
     float m_inputDelay;
     float m_serverDelay;
     float m_packetLoss;
+    float m_bandwidth;
+    float m_clientLinkTime; // When each direction is done sending what is queued on it
+    float m_serverLinkTime;
+
+    bool queueOnLink(float& linkTime, const size_t dataSize, float& arrivalTime) const;
 };
 
 #endif /* FakeNet_h */
@@ -62,6 +62,7 @@ void FakeNetworkController::terminate()
     m_writeBuffer = nullptr;
     m_readStream = nullptr;
     m_writeStream = nullptr;
+    m_flowControl.Reset();
     m_fakeNet->terminate();
 }
 
@@ -70,9 +71,15 @@ void FakeNetworkController::update(const float deltaTime)
     if (m_fakeNet && m_mode != NetworkMode::CLIENT)
     {
         m_fakeNet->update(deltaTime);
+        m_flowControl.Update(deltaTime, m_fakeNet->getClientLinkReliability());
     }
 }
 
+void FakeNetworkController::setDeltaDataCallback(std::function<const SnapshotData&(const uint32_t)> dataCallback)
+{
+    m_messageFactory->setDeltaDataCallback(dataCallback);
+}
+
 float FakeNetworkController::getSentBandwidth(const Net::NodeID nodeID)
 {
     return m_sentBandwidth;
@@ -88,6 +95,11 @@ float FakeNetworkController::getRoundTripTime(const Net::NodeID nodeID)
     return m_fakeNet->getInputDelay() + m_fakeNet->getServerDelay();
 }
 
+float FakeNetworkController::getBandwidth(const Net::NodeID nodeID)
+{
+    return m_flowControl.GetBandwidth();
+}
+
 Net::MessageID FakeNetworkController::sendMessage(const Net::NodeID nodeID,
                                                   std::shared_ptr<Net::Message>& message,
                                                   bool reliable /*= false*/)
@@ -99,6 +111,7 @@ Net::MessageID FakeNetworkController::sendMessage(const Net::NodeID nodeID,
     uint8_t messageType = message->getType();
     m_writeStream->SerializeByte(messageType);
     message->serialize(*m_writeStream);
+    m_writeStream->Flush();
     if (m_mode == NetworkMode::CLIENT)
     {
         m_fakeNet->takeServerData(m_writeBuffer, m_writeStream->GetDataBytes());
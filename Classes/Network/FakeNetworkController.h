@@ -3,16 +3,17 @@
 
 #include "INetworkController.h"
 #include "Network/NetworkMessages.h"
+#include "FlowControl.h"
 
 namespace Net
 {
     class Message;
     class ReadStream;
     class WriteStream;
-    class MessageFactory;
 }
 
 class FakeNet;
+class NetworkMessageFactory;
 
 class FakeNetworkController : public INetworkController
 {
@@ -34,6 +35,8 @@ public:
     
     void update(const float deltaTime) override;
 
+    void setDeltaDataCallback(std::function<const SnapshotData&(const uint32_t)> dataCallback) override;
+
     void receiveMessages() override {};
     void sendMessages() override {};
 
@@ -41,6 +44,7 @@ public:
     float getSentBandwidth(const Net::NodeID nodeID) override;
     float getAckedBandwidth(const Net::NodeID nodeID) override;
     float getRoundTripTime(const Net::NodeID nodeID) override;
+    float getBandwidth(const Net::NodeID nodeID) override;
     const Net::NodeID getLocalNodeID() const override { return 0; };
 
     bool isBroadcasting() const override { return true; }
@@ -56,11 +60,12 @@ private:
     unsigned char* m_writeBuffer;
     std::shared_ptr<Net::ReadStream> m_readStream;
     std::shared_ptr<Net::WriteStream> m_writeStream;
-    std::shared_ptr<Net::MessageFactory> m_messageFactory;
+    std::shared_ptr<NetworkMessageFactory> m_messageFactory;
     float m_sentBytes;
     float m_ackedBytes;
     float m_sentBandwidth;
     float m_ackedBandwidth;
+    Net::FlowControl m_flowControl; // Estimates the FakeNet link towards the client
 
     std::function<void(const uint8_t playerID, const std::shared_ptr<Net::Message> data)> m_clientCallback;
     std::function<void(const std::shared_ptr<Net::Message> data)> m_serverCallback;
@@ -43,11 +43,19 @@ public:
 
     virtual void receiveMessages() = 0;
     virtual void sendMessages() = 0;
+
+    // Receiving, acking and sending move onto their own thread, messages are handed over in
+    // sendMessage and receiveMessages. Only for processes where nothing else touches the transport.
+    virtual void startIOThread() {}
+    virtual void stopIOThread() {}
+    virtual bool isIOThreadRunning() const { return false; }
     
     virtual const std::shared_ptr<Net::Transport> getTransport() = 0;
     virtual float getSentBandwidth(const Net::NodeID nodeID) = 0;
     virtual float getAckedBandwidth(const Net::NodeID nodeID) = 0;
     virtual float getRoundTripTime(const Net::NodeID nodeID) = 0;
+    // Bytes per second flow control believes the connection to the node carries
+    virtual float getBandwidth(const Net::NodeID nodeID) = 0;
     virtual const Net::NodeID getLocalNodeID() const = 0;
 
     void setMessageReceivedCallback(MessageReceivedCallback callback) { m_messageReceivedCallback = callback; }
@@ -8,9 +8,10 @@
 #include "TransportLAN.h"
 #include "ReliabilitySystem.h"
 #include "Message.h"
-#include "cocos2d.h"
+#include "base/ccMacros.h"
 #include "GameSettings.h"
 #include "AddressResolver.h"
+#include <cassert>
 
 const int NetworkController::BUFFER_SIZE = 2 * 1024 * 1024;
 const std::string NetworkController::SETTING_NETWORK_TYPE = "NetworkType";
@@ -23,6 +24,8 @@ const std::string NetworkController::SETTING_NETWORK_CLIENT_PORT = "NetworkClien
 const std::string NetworkController::SETTING_NETWORK_MESH_SEND_RATE = "NetworkMeshSendRate";
 const std::string NetworkController::SETTING_NETWORK_TIMEOUT = "NetworkTimeout";
 const std::string NetworkController::SETTING_NETWORK_MAX_NODES = "NetworkMaxNodes";
+const size_t NetworkController::IO_QUEUE_CAPACITY = 4096;
+const std::chrono::microseconds NetworkController::IO_THREAD_INTERVAL(1000);
 
 NetworkController::NetworkController(std::shared_ptr<NetworkModel> model,
                                      std::shared_ptr<GameSettings> gameSettings)
@@ -35,9 +38,14 @@ NetworkController::NetworkController(std::shared_ptr<NetworkModel> model,
 , m_readStream(nullptr)
 , m_writeStream(nullptr)
 , m_mode(NetworkMode::HOST)
+, m_portOffset(0)
 , m_isBroadcasting(false)
 , m_isListening(false)
 , m_isConnected(false)
+, m_ioThreadRunning(false)
+, m_outgoingMessages(IO_QUEUE_CAPACITY)
+, m_networkEvents(IO_QUEUE_CAPACITY)
+, m_localNodeID(-1)
 {
     m_messageFactory = std::make_shared<NetworkMessageFactory>();
     auto messageFactory = std::static_pointer_cast<Net::MessageFactory>(m_messageFactory);
@@ -47,6 +55,7 @@ NetworkController::NetworkController(std::shared_ptr<NetworkModel> model,
 
 NetworkController::~NetworkController()
 {
+    stopIOThread();
     printf("NetworkController:: destructor %p\n", this);
 }
 
@@ -72,9 +81,9 @@ void NetworkController::initialize(const NetworkMode mode)
     
     const Net::Address masterServerAddress = Net::AddressResolver::getAddressForHost(hostString, portString);
     const Net::Port masterServerConnectPort = masterServerPortSetting.asInt();
-    const Net::Port meshPort = meshPortSetting.asInt();
-    const Net::Port serverPort = serverPortSetting.asInt();
-    const Net::Port clientPort = clientPortSetting.asInt();
+    const Net::Port meshPort = meshPortSetting.asInt() + m_portOffset;
+    const Net::Port serverPort = serverPortSetting.asInt() + m_portOffset;
+    const Net::Port clientPort = clientPortSetting.asInt() + m_portOffset;
     const Net::ProtocolID protocolID = netProtocolIDSetting.asInt();
     const float meshSendRate = meshSendRateSetting.asFloat();
     const float timeout = timeoutSetting.asFloat();
@@ -106,11 +115,7 @@ void NetworkController::initialize(const NetworkMode mode)
                                 timeout,
                                 maxNodes);
     }
-    m_drudgeNet->setMessageReceivedCallback(std::bind(&NetworkController::onMessageReceived, this, std::placeholders::_1, std::placeholders::_2));
-    m_drudgeNet->setReliableMessageAckedCallback(std::bind(&NetworkController::onMessageAcked, this, std::placeholders::_1, std::placeholders::_2));
-    m_drudgeNet->setNodeConnectedCallback(std::bind(&NetworkController::onNodeConnected, this, std::placeholders::_1));
-    m_drudgeNet->setNodeDisconnectedCallback(std::bind(&NetworkController::onNodeDisconnected, this, std::placeholders::_1));
-    m_drudgeNet->setMasterServerConnectionCallback(std::bind(&NetworkController::onMasterSystemConnection, this, std::placeholders::_1));
+    setDrudgeNetCallbacks(false);
 
     m_readBuffer = new unsigned char[BUFFER_SIZE];
     m_writeBuffer = new unsigned char[BUFFER_SIZE];
@@ -130,6 +135,7 @@ void NetworkController::initialize(const NetworkMode mode)
 
 void NetworkController::terminate()
 {
+    stopIOThread();
     delete [] m_readBuffer;
     m_readBuffer = nullptr;
     delete [] m_writeBuffer;
@@ -139,6 +145,10 @@ void NetworkController::terminate()
 
 void NetworkController::update(float deltaTime)
 {
+    if (isIOThreadRunning())
+    {
+        return; // Keeps its own time
+    }
     if (m_drudgeNet)
     {
         m_drudgeNet->update(deltaTime);
@@ -164,6 +174,7 @@ void NetworkController::enterLobby()
 
 void NetworkController::stop()
 {
+    stopIOThread();
     m_drudgeNet->stop();
     
     m_isBroadcasting = false;
@@ -181,19 +192,230 @@ Net::MessageID NetworkController::sendMessage(const Net::NodeID nodeID,
         onMessageReceived(message, nodeID);
         return 0;
     }
+    if (isIOThreadRunning())
+    {
+        // The message ID is only known once the I/O thread queued it on a channel
+        OutgoingMessage outgoing = {nodeID, message, reliable};
+        if (!m_pendingOutgoingMessages.empty() ||
+            !m_outgoingMessages.push(std::move(outgoing)))
+        {
+            m_pendingOutgoingMessages.push_back(std::move(outgoing));
+        }
+        return 0;
+    }
     return m_drudgeNet->sendMessage(nodeID, message, reliable);
 }
 
 void NetworkController::receiveMessages()
 {
+    if (isIOThreadRunning())
+    {
+        NetworkEvent event;
+        while (m_networkEvents.pop(event))
+        {
+            dispatchNetworkEvent(event);
+        }
+        return;
+    }
     m_drudgeNet->receiveMessages();
 }
 
 void NetworkController::sendMessages()
 {
+    if (isIOThreadRunning())
+    {
+        flushOutgoingMessages(); // Sent as soon as the I/O thread picks them up
+        return;
+    }
     m_drudgeNet->sendMessages();
 }
 
+void NetworkController::startIOThread()
+{
+    // Snapshot diffs are decoded against the sim's baselines, only a host can hand decoding off
+    assert(m_mode == NetworkMode::HOST);
+    if (isIOThreadRunning())
+    {
+        return;
+    }
+    
+    for (NodeStats& stats : m_nodeStats)
+    {
+        stats.sentBandwidth = 0.f;
+        stats.ackedBandwidth = 0.f;
+        stats.roundTripTime = 0.f;
+        stats.bandwidth = 0.f;
+    }
+    publishNodeStats();
+    setDrudgeNetCallbacks(true);
+    
+    m_ioThreadRunning = true;
+    m_ioThread = std::thread(&NetworkController::runIOThread, this);
+}
+
+void NetworkController::stopIOThread()
+{
+    if (!isIOThreadRunning())
+    {
+        return;
+    }
+    
+    m_ioThreadRunning = false;
+    m_ioThread.join();
+    setDrudgeNetCallbacks(false);
+    
+    // DrudgeNet is back on this thread, hand it whatever was still in flight between the two
+    OutgoingMessage outgoing;
+    while (m_outgoingMessages.pop(outgoing))
+    {
+        m_drudgeNet->sendMessage(outgoing.nodeID, outgoing.message, outgoing.reliable);
+    }
+    for (OutgoingMessage& pending : m_pendingOutgoingMessages)
+    {
+        m_drudgeNet->sendMessage(pending.nodeID, pending.message, pending.reliable);
+    }
+    m_pendingOutgoingMessages.clear();
+    
+    NetworkEvent event;
+    while (m_networkEvents.pop(event))
+    {
+        dispatchNetworkEvent(event);
+    }
+    for (const NetworkEvent& pending : m_pendingNetworkEvents)
+    {
+        dispatchNetworkEvent(pending);
+    }
+    m_pendingNetworkEvents.clear();
+}
+
+void NetworkController::runIOThread()
+{
+    std::chrono::steady_clock::time_point previousTime = std::chrono::steady_clock::now();
+    while (m_ioThreadRunning)
+    {
+        OutgoingMessage outgoing;
+        while (m_outgoingMessages.pop(outgoing))
+        {
+            m_drudgeNet->sendMessage(outgoing.nodeID, outgoing.message, outgoing.reliable);
+        }
+        outgoing.message = nullptr; // Lets the sim recycle pooled messages once the channel is done with them
+        
+        m_drudgeNet->receiveMessages();
+        
+        const std::chrono::steady_clock::time_point timeNow = std::chrono::steady_clock::now();
+        const float deltaTime = std::chrono::duration_cast<std::chrono::microseconds>(timeNow - previousTime).count() / 1000000.f;
+        previousTime = timeNow;
+        m_drudgeNet->update(deltaTime);
+        
+        m_drudgeNet->sendMessages();
+        publishNodeStats();
+        
+        while (!m_pendingNetworkEvents.empty() &&
+               m_networkEvents.push(std::move(m_pendingNetworkEvents.front())))
+        {
+            m_pendingNetworkEvents.pop_front();
+        }
+        
+        std::this_thread::sleep_for(IO_THREAD_INTERVAL);
+    }
+}
+
+void NetworkController::pushNetworkEvent(NetworkEvent&& event)
+{
+    // A stalled sim must not stall acks, events back up here until it catches up
+    if (!m_pendingNetworkEvents.empty() ||
+        !m_networkEvents.push(std::move(event)))
+    {
+        m_pendingNetworkEvents.push_back(std::move(event));
+    }
+}
+
+void NetworkController::flushOutgoingMessages()
+{
+    while (!m_pendingOutgoingMessages.empty() &&
+           m_outgoingMessages.push(std::move(m_pendingOutgoingMessages.front())))
+    {
+        m_pendingOutgoingMessages.pop_front();
+    }
+}
+
+void NetworkController::publishNodeStats()
+{
+    const std::shared_ptr<Net::Transport>& transport = m_drudgeNet->getTransport();
+    if (!transport)
+    {
+        return;
+    }
+    
+    m_localNodeID = transport->GetLocalNodeId();
+    const int32_t transportNodes = transport->GetMaxNodes();
+    const int32_t maxNodes = transportNodes < MAX_NODE_STATS ? transportNodes : MAX_NODE_STATS;
+    for (int32_t nodeID = 0; nodeID < maxNodes; nodeID++)
+    {
+        if (!transport->IsNodeConnected(nodeID))
+        {
+            continue;
+        }
+        const std::shared_ptr<Net::ReliabilitySystem> reliability = transport->GetReliability(nodeID);
+        m_nodeStats[nodeID].sentBandwidth = reliability->GetSentBandwidth();
+        m_nodeStats[nodeID].ackedBandwidth = reliability->GetAckedBandwidth();
+        m_nodeStats[nodeID].roundTripTime = reliability->GetRoundTripTime();
+        m_nodeStats[nodeID].bandwidth = transport->GetBandwidth(nodeID);
+    }
+}
+
+void NetworkController::dispatchNetworkEvent(const NetworkEvent& event)
+{
+    switch (event.type)
+    {
+        case NetworkEvent::MESSAGE_RECEIVED:
+            onMessageReceived(event.message, event.nodeID);
+            break;
+        case NetworkEvent::MESSAGE_ACKED:
+            onMessageAcked(event.nodeID, event.messageID);
+            break;
+        case NetworkEvent::NODE_CONNECTED:
+            onNodeConnected(event.nodeID);
+            break;
+        case NetworkEvent::NODE_DISCONNECTED:
+            onNodeDisconnected(event.nodeID);
+            break;
+        case NetworkEvent::MASTER_SERVER_CONNECTION:
+            onMasterSystemConnection(event.connected);
+            break;
+    }
+}
+
+void NetworkController::setDrudgeNetCallbacks(const bool queued)
+{
+    if (!queued)
+    {
+        m_drudgeNet->setMessageReceivedCallback(std::bind(&NetworkController::onMessageReceived, this, std::placeholders::_1, std::placeholders::_2));
+        m_drudgeNet->setReliableMessageAckedCallback(std::bind(&NetworkController::onMessageAcked, this, std::placeholders::_1, std::placeholders::_2));
+        m_drudgeNet->setNodeConnectedCallback(std::bind(&NetworkController::onNodeConnected, this, std::placeholders::_1));
+        m_drudgeNet->setNodeDisconnectedCallback(std::bind(&NetworkController::onNodeDisconnected, this, std::placeholders::_1));
+        m_drudgeNet->setMasterServerConnectionCallback(std::bind(&NetworkController::onMasterSystemConnection, this, std::placeholders::_1));
+        return;
+    }
+    
+    // Called on the I/O thread, only queue up what happened for the sim thread
+    m_drudgeNet->setMessageReceivedCallback([this](const std::shared_ptr<Net::Message>& message, const Net::NodeID nodeID) {
+        pushNetworkEvent({NetworkEvent::MESSAGE_RECEIVED, nodeID, 0, message, false});
+    });
+    m_drudgeNet->setReliableMessageAckedCallback([this](const Net::NodeID nodeID, const Net::MessageID messageID) {
+        pushNetworkEvent({NetworkEvent::MESSAGE_ACKED, nodeID, messageID, nullptr, false});
+    });
+    m_drudgeNet->setNodeConnectedCallback([this](const Net::NodeID nodeID) {
+        pushNetworkEvent({NetworkEvent::NODE_CONNECTED, nodeID, 0, nullptr, false});
+    });
+    m_drudgeNet->setNodeDisconnectedCallback([this](const Net::NodeID nodeID) {
+        pushNetworkEvent({NetworkEvent::NODE_DISCONNECTED, nodeID, 0, nullptr, false});
+    });
+    m_drudgeNet->setMasterServerConnectionCallback([this](bool connected) {
+        pushNetworkEvent({NetworkEvent::MASTER_SERVER_CONNECTION, 0, 0, nullptr, connected});
+    });
+}
+
 void NetworkController::setDeltaDataCallback(std::function<const SnapshotData&(const uint32_t)> dataCallback)
 {
     m_messageFactory->setDeltaDataCallback(dataCallback);
@@ -201,20 +423,45 @@ void NetworkController::setDeltaDataCallback(std::function<const SnapshotData&(c
 
 float NetworkController::getSentBandwidth(const Net::NodeID nodeID)
 {
+    if (isIOThreadRunning())
+    {
+        return (nodeID >= 0 && nodeID < MAX_NODE_STATS) ? m_nodeStats[nodeID].sentBandwidth.load() : 0.f;
+    }
     return m_drudgeNet->getTransport()->GetReliability(nodeID)->GetSentBandwidth();
 }
 float NetworkController::getAckedBandwidth(const Net::NodeID nodeID)
 {
+    if (isIOThreadRunning())
+    {
+        return (nodeID >= 0 && nodeID < MAX_NODE_STATS) ? m_nodeStats[nodeID].ackedBandwidth.load() : 0.f;
+    }
     return m_drudgeNet->getTransport()->GetReliability(nodeID)->GetAckedBandwidth();
 }
 
 float NetworkController::getRoundTripTime(const Net::NodeID nodeID)
 {
+    if (isIOThreadRunning())
+    {
+        return (nodeID >= 0 && nodeID < MAX_NODE_STATS) ? m_nodeStats[nodeID].roundTripTime.load() : 0.f;
+    }
     return m_drudgeNet->getTransport()->GetReliability(nodeID)->GetRoundTripTime();
 }
 
+float NetworkController::getBandwidth(const Net::NodeID nodeID)
+{
+    if (isIOThreadRunning())
+    {
+        return (nodeID >= 0 && nodeID < MAX_NODE_STATS) ? m_nodeStats[nodeID].bandwidth.load() : 0.f;
+    }
+    return m_drudgeNet->getTransport()->GetBandwidth(nodeID);
+}
+
 const Net::NodeID NetworkController::getLocalNodeID() const
 {
+    if (isIOThreadRunning())
+    {
+        return m_localNodeID;
+    }
     return m_drudgeNet->getTransport()->GetLocalNodeId();
 }
 
@@ -4,6 +4,11 @@
 #include "INetworkController.h"
 #include "NetworkMessages.h"
 #include "Network/DrudgeNet/include/DrudgeNet.h"
+#include "Network/DrudgeNet/include/SPSCQueue.h"
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <thread>
 
 class NetworkModel;
 class NetworkMessageFactory;
@@ -24,6 +29,9 @@ public:
     void initialize(const NetworkMode mode) override;
     void terminate() override;
     
+    // Added to the configured mesh, server and client ports so several hosts can share a machine
+    void setPortOffset(const uint16_t portOffset) { m_portOffset = portOffset; }
+    
     void host(const std::string& name) override;
     void join(const std::string& host) override;
     void enterLobby() override;
@@ -37,10 +45,15 @@ public:
     void receiveMessages() override;
     void sendMessages() override;
 
+    void startIOThread() override;
+    void stopIOThread() override;
+    bool isIOThreadRunning() const override { return m_ioThread.joinable(); }
+
     const std::shared_ptr<Net::Transport> getTransport() override { return m_drudgeNet->getTransport(); }
     float getSentBandwidth(const Net::NodeID nodeID) override;
     float getAckedBandwidth(const Net::NodeID nodeID) override;
     float getRoundTripTime(const Net::NodeID nodeID) override;
+    float getBandwidth(const Net::NodeID nodeID) override;
     const Net::NodeID getLocalNodeID() const override;
     
     bool isBroadcasting() const override { return m_isBroadcasting; }
@@ -61,6 +74,43 @@ private:
     static const std::string SETTING_NETWORK_MESH_SEND_RATE;
     static const std::string SETTING_NETWORK_TIMEOUT;
     static const std::string SETTING_NETWORK_MAX_NODES;
+    static const size_t IO_QUEUE_CAPACITY;
+    static const std::chrono::microseconds IO_THREAD_INTERVAL;
+    static const int32_t MAX_NODE_STATS = 256;
+
+    struct OutgoingMessage
+    {
+        Net::NodeID nodeID;
+        std::shared_ptr<Net::Message> message;
+        bool reliable;
+    };
+
+    // Everything DrudgeNet reports on the I/O thread, replayed on the sim thread
+    struct NetworkEvent
+    {
+        enum Type
+        {
+            MESSAGE_RECEIVED,
+            MESSAGE_ACKED,
+            NODE_CONNECTED,
+            NODE_DISCONNECTED,
+            MASTER_SERVER_CONNECTION
+        };
+        Type type;
+        Net::NodeID nodeID;
+        Net::MessageID messageID;
+        std::shared_ptr<Net::Message> message;
+        bool connected;
+    };
+
+    // Published by the I/O thread so stats can be read without touching the transport
+    struct NodeStats
+    {
+        std::atomic<float> sentBandwidth;
+        std::atomic<float> ackedBandwidth;
+        std::atomic<float> roundTripTime;
+        std::atomic<float> bandwidth;
+    };
 
     std::shared_ptr<NetworkModel> m_model;
     std::shared_ptr<GameSettings> m_gameSettings;
@@ -72,6 +122,7 @@ private:
     unsigned char* m_writeBuffer;
     
     NetworkMode m_mode;
+    uint16_t m_portOffset;
 
     // server data
     bool m_isBroadcasting;
@@ -83,6 +134,23 @@ private:
     bool m_isListening;
     bool m_isConnected;
 
+    std::thread m_ioThread;
+    std::atomic<bool> m_ioThreadRunning;
+    Net::SPSCQueue<OutgoingMessage> m_outgoingMessages;
+    Net::SPSCQueue<NetworkEvent> m_networkEvents;
+    // Whatever didn't fit the queues yet, each is only touched by the thread that pushes
+    std::deque<OutgoingMessage> m_pendingOutgoingMessages;
+    std::deque<NetworkEvent> m_pendingNetworkEvents;
+    NodeStats m_nodeStats[MAX_NODE_STATS];
+    std::atomic<Net::NodeID> m_localNodeID;
+
+    void runIOThread();
+    void pushNetworkEvent(NetworkEvent&& event);
+    void flushOutgoingMessages();
+    void publishNodeStats();
+    void dispatchNetworkEvent(const NetworkEvent& event);
+    void setDrudgeNetCallbacks(const bool queued);
+
     void processReadStream(int bytesRead, const int nodeID);
     
     void onNodeConnected(const Net::NodeID nodeID);
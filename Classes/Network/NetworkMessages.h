@@ -4,7 +4,9 @@
 #include "Game/Shared/EntityConstants.h"
 
 #include "Network/DrudgeNet/include/Message.h"
-#include "cocos2d.h"
+
+#include <map>
+#include <vector>
 
 enum MessageTypes {
     MESSAGE_TYPE_CLIENT_INFO = 0,
@@ -365,6 +367,32 @@ struct FrameHitData {
     bool isLethal;
 };
 
+// Assigns over a map without constructing the values again for keys both maps have.
+// A plain map assignment reuses the nodes but copy constructs the values into them,
+// which allocates for values owning storage, like the weapon slots of a PlayerState.
+template <typename Key, typename Value>
+void assignMapValues(std::map<Key, Value>& to, const std::map<Key, Value>& from)
+{
+    auto toIt = to.begin();
+    for (const auto& entry : from)
+    {
+        while (toIt != to.end() && toIt->first < entry.first)
+        {
+            toIt = to.erase(toIt);
+        }
+        if (toIt != to.end() && toIt->first == entry.first)
+        {
+            toIt->second = entry.second;
+            ++toIt;
+        }
+        else
+        {
+            to.emplace_hint(toIt, entry);
+        }
+    }
+    to.erase(toIt, to.end());
+}
+
 struct SnapshotData {
     uint32_t serverTick;
     uint32_t lastReceivedInput;
@@ -374,6 +402,23 @@ struct SnapshotData {
     std::map<uint32_t, EntitySnapshot> entityData;
     std::vector<InventoryItemState> inventory;
     std::vector<FrameHitData> hitData;
+    
+    // Snapshot buffers and pooled messages are assigned over every tick, keep what they hold
+    SnapshotData& operator=(const SnapshotData& other)
+    {
+        if (this != &other)
+        {
+            serverTick = other.serverTick;
+            lastReceivedInput = other.lastReceivedInput;
+            playerCount = other.playerCount;
+            entityCount = other.entityCount;
+            assignMapValues(playerData, other.playerData);
+            entityData = other.entityData;
+            inventory = other.inventory;
+            hitData = other.hitData;
+        }
+        return *this;
+    }
 };
 
 struct SnapshotDiffData {
@@ -390,17 +435,115 @@ struct SnapshotDiffData {
 
 static const SnapshotData SNAPSHOT_ZERO = {0,0,0,0};
 
+// Entity state wire format, written at the start of every snapshot so the reader needs no setup.
+// Quantized positions are clamped to [0, bounds] and rotations are expected within [-PI, PI].
+struct SnapshotEncoding {
+    bool quantize;
+    float boundsWidth;
+    float boundsHeight;
+    float positionResolution;
+    uint8_t rotationBits;
+};
+
+static const SnapshotEncoding SNAPSHOT_ENCODING_RAW = { false, 0.f, 0.f, 0.f, 0 };
+static const uint32_t SNAPSHOT_MAX_QUANTIZED_ENTITIES = 0xFFFF;
+static const uint32_t SNAPSHOT_MAX_QUANTIZED_ITEMS = 0xFF;
+
+template <typename Stream> bool serializeSnapshotEncoding(Stream& stream, SnapshotEncoding& encoding)
+{
+    stream.SerializeBoolean(encoding.quantize);
+    if (encoding.quantize)
+    {
+        uint32_t rotationBits = encoding.rotationBits;
+        stream.SerializeFloat(encoding.boundsWidth);
+        stream.SerializeFloat(encoding.boundsHeight);
+        stream.SerializeFloat(encoding.positionResolution);
+        stream.SerializeBits(rotationBits, 5);
+        encoding.rotationBits = (uint8_t)rotationBits;
+    }
+    return true;
+}
+
+template <typename Stream> bool serializeSnapshotCount(Stream& stream,
+                                                       const SnapshotEncoding& encoding,
+                                                       uint32_t& count,
+                                                       const uint32_t maxQuantizedCount)
+{
+    if (encoding.quantize)
+    {
+        return stream.SerializeInteger(count, 0, maxQuantizedCount);
+    }
+    return stream.SerializeBits(count, 32);
+}
+
+template <typename Stream> bool serializeSnapshotPosition(Stream& stream,
+                                                          const SnapshotEncoding& encoding,
+                                                          float& value,
+                                                          const float bounds)
+{
+    if (encoding.quantize)
+    {
+        return stream.SerializeFloatCompressed(value, 0.f, bounds, encoding.positionResolution);
+    }
+    return stream.SerializeFloat(value);
+}
+
+template <typename Stream> bool serializeSnapshotRotation(Stream& stream,
+                                                          const SnapshotEncoding& encoding,
+                                                          float& value)
+{
+    if (!encoding.quantize)
+    {
+        return stream.SerializeFloat(value);
+    }
+    
+    const uint32_t maxIntegerValue = (1 << encoding.rotationBits) - 1;
+    if (stream.IsReading() && !stream.IsMeasuring())
+    {
+        uint32_t integerValue = 0;
+        if (!stream.SerializeBits(integerValue, encoding.rotationBits))
+        {
+            return false;
+        }
+        value = ((integerValue / float(maxIntegerValue)) * 2.f * M_PI) - M_PI;
+        return true;
+    }
+    
+    const float wrappedValue = std::remainder(value, 2.f * (float)M_PI);
+    const float normalizedValue = std::min(1.f, std::max((wrappedValue + (float)M_PI) / (2.f * (float)M_PI), 0.f));
+    uint32_t integerValue = (uint32_t)std::floor(normalizedValue * maxIntegerValue + 0.5f);
+    return stream.SerializeBits(integerValue, encoding.rotationBits);
+}
+
+// Bits one entity takes in a full snapshot, for fitting snapshots into a bandwidth budget
+static inline uint32_t getSnapshotEntityBits(const SnapshotEncoding& encoding)
+{
+    if (!encoding.quantize)
+    {
+        return 16 + 32 + 32 + 32 + 8;
+    }
+    const uint32_t positionBitsX = Net::Stream::BitsRequired(0, (uint32_t)std::ceil(encoding.boundsWidth / encoding.positionResolution));
+    const uint32_t positionBitsY = Net::Stream::BitsRequired(0, (uint32_t)std::ceil(encoding.boundsHeight / encoding.positionResolution));
+    return 16 + positionBitsX + positionBitsY + encoding.rotationBits + 8;
+}
+
+// Bits one player's state takes in a full snapshot, the same for every encoding
+static const uint32_t SNAPSHOT_PLAYER_BITS = 8 + 16 + 8 + 8 + 32 + 32 + 32 + 1 + 1 + 8 + 5 * (8 + 16);
+
 class ServerSnapshotMessage : public Net::Message {
 public:
     SnapshotData data;
+    SnapshotEncoding encoding;
     
     ServerSnapshotMessage()
-    : Message(MESSAGE_TYPE_SERVER_SNAPSHOT) {}
+    : Message(MESSAGE_TYPE_SERVER_SNAPSHOT)
+    , encoding(SNAPSHOT_ENCODING_RAW) {}
     
     template <typename Stream> bool serializeInternal(Stream& stream)
     {
         stream.SerializeBits(data.serverTick, 32);
         stream.SerializeBits(data.lastReceivedInput, 32);
+        serializeSnapshotEncoding(stream, encoding);
         if (stream.IsReading())
         {
             stream.SerializeByte(data.playerCount);
@@ -444,7 +587,7 @@ public:
                 }
             }
             
-            stream.SerializeBits(data.entityCount, 32);
+            serializeSnapshotCount(stream, encoding, data.entityCount, SNAPSHOT_MAX_QUANTIZED_ENTITIES);
             for (size_t i = 0; i < data.entityCount; i++)
             {
                 uint32_t entityID = 0;
@@ -453,9 +596,9 @@ public:
                 float rotation;
                 uint8_t entityType = 0;
                 stream.SerializeBits(entityID, 16);
-                stream.SerializeFloat(positionX);
-                stream.SerializeFloat(positionY);
-                stream.SerializeFloat(rotation);
+                serializeSnapshotPosition(stream, encoding, positionX, encoding.boundsWidth);
+                serializeSnapshotPosition(stream, encoding, positionY, encoding.boundsHeight);
+                serializeSnapshotRotation(stream, encoding, rotation);
                 stream.SerializeByte(entityType);
                 if (!stream.IsMeasuring())
                 {
@@ -464,7 +607,7 @@ public:
             }
             
             uint32_t inventoryCount = 0;
-            stream.SerializeBits(inventoryCount, 32);
+            serializeSnapshotCount(stream, encoding, inventoryCount, SNAPSHOT_MAX_QUANTIZED_ITEMS);
             for (size_t i = 0; i < inventoryCount; i++)
             {
                 uint8_t entityType;
@@ -477,7 +620,7 @@ public:
                 }
             }
             uint32_t hitCount = 0;
-            stream.SerializeBits(hitCount, 32);
+            serializeSnapshotCount(stream, encoding, hitCount, SNAPSHOT_MAX_QUANTIZED_ITEMS);
             for (size_t i = 0; i < hitCount; i++)
             {
                 FrameHitData hitData;
@@ -523,30 +666,40 @@ public:
             }
             
             data.entityCount = (uint32_t)data.entityData.size();
-            stream.SerializeBits(data.entityCount, 32);
+            serializeSnapshotCount(stream, encoding, data.entityCount, SNAPSHOT_MAX_QUANTIZED_ENTITIES);
             for (auto pair : data.entityData)
             {
                 uint32_t entityID = pair.first;
                 stream.SerializeBits(entityID, 16);
-                stream.SerializeFloat(pair.second.positionX);
-                stream.SerializeFloat(pair.second.positionY);
-                stream.SerializeFloat(pair.second.rotation);
+                serializeSnapshotPosition(stream, encoding, pair.second.positionX, encoding.boundsWidth);
+                serializeSnapshotPosition(stream, encoding, pair.second.positionY, encoding.boundsHeight);
+                serializeSnapshotRotation(stream, encoding, pair.second.rotation);
                 stream.SerializeByte(pair.second.type);
             }
             
             uint32_t inventoryCount = (uint32_t)data.inventory.size();
-            stream.SerializeBits(inventoryCount, 32);
-            for (const auto& inventoryItem : data.inventory)
+            if (encoding.quantize)
+            {
+                inventoryCount = std::min(inventoryCount, SNAPSHOT_MAX_QUANTIZED_ITEMS);
+            }
+            serializeSnapshotCount(stream, encoding, inventoryCount, SNAPSHOT_MAX_QUANTIZED_ITEMS);
+            for (size_t i = 0; i < inventoryCount; i++)
             {
+                const auto& inventoryItem = data.inventory.at(i);
                 uint8_t entityType = inventoryItem.type;
                 uint8_t amount = inventoryItem.amount;
                 stream.SerializeByte(entityType);
                 stream.SerializeByte(amount);
             }
             uint32_t hitCount = (uint32_t)data.hitData.size();
-            stream.SerializeBits(hitCount, 32);
-            for (const auto& hit : data.hitData)
+            if (encoding.quantize)
             {
+                hitCount = std::min(hitCount, SNAPSHOT_MAX_QUANTIZED_ITEMS);
+            }
+            serializeSnapshotCount(stream, encoding, hitCount, SNAPSHOT_MAX_QUANTIZED_ITEMS);
+            for (size_t i = 0; i < hitCount; i++)
+            {
+                const auto& hit = data.hitData.at(i);
                 uint32_t hitterEntityID = hit.hitterEntityID;
                 uint32_t hitEntityID = hit.hitEntityID;
                 float damage = hit.damage;
@@ -574,18 +727,30 @@ public:
 class ServerSnapshotDiffMessage : public Net::Message {
 public:
     SnapshotData data;
+    SnapshotEncoding encoding;
     uint32_t previousServerTick;
+    SnapshotData baseline; // Only filled by senders that can't keep their own baseline still until it's written
 
     ServerSnapshotDiffMessage(std::function<const SnapshotData&(const uint32_t)> getDataCallback)
     : Message(MESSAGE_TYPE_SERVER_SNAPSHOT_DIFF)
+    , encoding(SNAPSHOT_ENCODING_RAW)
     , m_getDataCallback(getDataCallback) {}
     
+    // Messages are recycled between ticks, each one is sent against its own baseline
+    void setDataCallback(std::function<const SnapshotData&(const uint32_t)> getDataCallback) { m_getDataCallback = getDataCallback; }
+    
+    // Measuring has to follow the writing path since the reading path sizes loops from the stream
+    template <typename Stream> static bool isDecoding(Stream& stream)
+    {
+        return stream.IsReading() && !stream.IsMeasuring();
+    }
+    
     template <typename Stream> bool streamBitsDiff(Stream& stream,
                                                    uint32_t previous,
                                                    uint32_t& value,
                                                    int32_t bits)
     {
-        if (stream.IsReading())
+        if (isDecoding(stream))
         {
             bool valueChanged = false;
             stream.SerializeBoolean(valueChanged);
@@ -614,7 +779,7 @@ public:
                                                    uint8_t previous,
                                                    uint8_t& value)
     {
-        if (stream.IsReading())
+        if (isDecoding(stream))
         {
             bool valueChanged = false;
             stream.SerializeBoolean(valueChanged);
@@ -643,7 +808,7 @@ public:
                                                     uint16_t previous,
                                                     uint16_t& value)
     {
-        if (stream.IsReading())
+        if (isDecoding(stream))
         {
             bool valueChanged = false;
             stream.SerializeBoolean(valueChanged);
@@ -672,7 +837,7 @@ public:
                                                     float previous,
                                                     float& value)
     {
-        if (stream.IsReading())
+        if (isDecoding(stream))
         {
             bool valueChanged = false;
             stream.SerializeBoolean(valueChanged);
@@ -697,11 +862,118 @@ public:
         return true;
     }
     
+    template <typename Stream> bool streamPositionDiff(Stream& stream,
+                                                       float previous,
+                                                       float& value,
+                                                       const float bounds)
+    {
+        if (isDecoding(stream))
+        {
+            bool valueChanged = false;
+            stream.SerializeBoolean(valueChanged);
+            if (valueChanged)
+            {
+                return serializeSnapshotPosition(stream, encoding, value, bounds);
+            }
+            else
+            {
+                value = previous;
+            }
+        }
+        else
+        {
+            bool valueChanged = previous != value;
+            stream.SerializeBoolean(valueChanged);
+            if (valueChanged)
+            {
+                return serializeSnapshotPosition(stream, encoding, value, bounds);
+            }
+        }
+        return true;
+    }
+    
+    template <typename Stream> bool streamRotationDiff(Stream& stream,
+                                                       float previous,
+                                                       float& value)
+    {
+        if (isDecoding(stream))
+        {
+            bool valueChanged = false;
+            stream.SerializeBoolean(valueChanged);
+            if (valueChanged)
+            {
+                return serializeSnapshotRotation(stream, encoding, value);
+            }
+            else
+            {
+                value = previous;
+            }
+        }
+        else
+        {
+            bool valueChanged = previous != value;
+            stream.SerializeBoolean(valueChanged);
+            if (valueChanged)
+            {
+                return serializeSnapshotRotation(stream, encoding, value);
+            }
+        }
+        return true;
+    }
+    
+    // Shared by both directions so the field order can't drift between reading and writing
+    template <typename Stream> bool streamPlayerDiff(Stream& stream,
+                                                     const PlayerState& previous,
+                                                     PlayerState& player)
+    {
+        streamBitsDiff(stream, previous.entityID, player.entityID, 16);
+        streamByteDiff(stream, previous.kills, player.kills);
+        streamByteDiff(stream, previous.animationState, player.animationState);
+        streamFloatDiff(stream, previous.aimPointX, player.aimPointX);
+        streamFloatDiff(stream, previous.aimPointY, player.aimPointY);
+        streamFloatDiff(stream, previous.health, player.health);
+        stream.SerializeBoolean(player.flipX);
+        stream.SerializeBoolean(player.weaponFired);
+        streamByteDiff(stream, previous.activeWeaponSlot, player.activeWeaponSlot);
+        
+        if (isDecoding(stream))
+        {
+            player.weaponSlots.resize(5);
+        }
+        for (size_t i = 0; i < 5; i++)
+        {
+            streamByteDiff(stream, previous.weaponSlots.at(i).type, player.weaponSlots.at(i).type);
+            streamShortDiff(stream, previous.weaponSlots.at(i).amount, player.weaponSlots.at(i).amount);
+        }
+        return true;
+    }
+    
+    // Only the fields the full snapshot carries are diffed, amount and owner aren't replicated
+    template <typename Stream> bool streamEntityDiff(Stream& stream,
+                                                     const EntitySnapshot& previous,
+                                                     EntitySnapshot& entity)
+    {
+        streamPositionDiff(stream, previous.positionX, entity.positionX, encoding.boundsWidth);
+        streamPositionDiff(stream, previous.positionY, entity.positionY, encoding.boundsHeight);
+        streamRotationDiff(stream, previous.rotation, entity.rotation);
+        streamByteDiff(stream, previous.type, entity.type);
+        return true;
+    }
+    
+    static bool hasEntityChanged(const EntitySnapshot& previous, const EntitySnapshot& entity)
+    {
+        return (previous.positionX != entity.positionX ||
+                previous.positionY != entity.positionY ||
+                previous.rotation != entity.rotation ||
+                previous.type != entity.type);
+    }
+    
     template <typename Stream> bool serializeInternal(Stream& stream)
     {
         stream.SerializeBits(data.serverTick, 32);
         stream.SerializeBits(data.lastReceivedInput, 32);
         stream.SerializeBits(previousServerTick, 32);
+        serializeSnapshotEncoding(stream, encoding);
 
         if (!m_getDataCallback)
         {
@@ -710,147 +982,178 @@ public:
         
         // At this point the previous tick is known so we can load the data for that
         const SnapshotData& previousState = m_getDataCallback(previousServerTick);
+        if (previousState.serverTick != previousServerTick)
+        {
+            return false; // Baseline is gone, the data can't be reconstructed
+        }
         
-        if (stream.IsReading())
+        static const PlayerState PLAYER_STATE_ZERO = { 0, 0, 0, 0.f, 0.f, 0.f, false, false, 0, std::vector<InventoryItemState>(5, {0, 0}) };
+        static const EntitySnapshot ENTITY_SNAPSHOT_ZERO = { 0.f, 0.f, 0.f, 0, 0, 0 };
+        
+        if (isDecoding(stream))
         {
-            streamByteDiff(stream, previousState.playerCount, data.playerCount);
-
+            stream.SerializeByte(data.playerCount);
             for (size_t i = 0; i < data.playerCount; i++)
             {
                 uint8_t playerID = 0;
-                uint32_t entityID = 0;
-                uint8_t kills = 0;
                 stream.SerializeByte(playerID);
-                stream.SerializeBits(entityID, 16);
-                
-                uint8_t animationState = 0;
-                float aimPointX = 0.f;
-                float aimPointY = 0.f;
-                bool flipX = false;
-                bool weaponFired = false;
-                float health = 0.f;
-                uint8_t activeWeaponSlot = 0;
-                std::vector<InventoryItemState> weaponSlots;
                 
                 auto previousPlayerIt = previousState.playerData.find(playerID);
-                if (previousPlayerIt != previousState.playerData.end())
-                {
-                    streamByteDiff(stream, previousPlayerIt->second.animationState, animationState);
-                    streamByteDiff(stream, previousPlayerIt->second.kills, kills);
-                    streamFloatDiff(stream, previousPlayerIt->second.aimPointX, aimPointX);
-                    streamFloatDiff(stream, previousPlayerIt->second.aimPointY, aimPointY);
-                    streamFloatDiff(stream, previousPlayerIt->second.health, health);
-                }
-                else
-                {
-                    streamByteDiff(stream, 0, animationState);
-                    streamByteDiff(stream, 0, kills);
-                    streamFloatDiff(stream, 0.f, aimPointX);
-                    streamFloatDiff(stream, 0.f, aimPointY);
-                    streamFloatDiff(stream, 0.f, health);
-                }
-                stream.SerializeBoolean(flipX);
-                stream.SerializeBoolean(weaponFired);
-                
-                if (previousPlayerIt != previousState.playerData.end())
-                {
-                    streamByteDiff(stream, previousPlayerIt->second.activeWeaponSlot, activeWeaponSlot);
-                }
-                else
-                {
-                    streamByteDiff(stream, 0, activeWeaponSlot);
-                }
-                
-                for (size_t i = 0; i < 5; i++)
-                {
-                    uint8_t type;
-                    uint16_t amount;
-                    
-                    if (previousPlayerIt != previousState.playerData.end())
-                    {
-                        streamByteDiff(stream, previousPlayerIt->second.weaponSlots.at(i).type, type);
-                        streamShortDiff(stream, previousPlayerIt->second.weaponSlots.at(i).amount, amount);
-                    }
-                    else
-                    {
-                        streamByteDiff(stream, 0, type);
-                        streamShortDiff(stream, 0, amount);
-                    }
-                    
-                    stream.SerializeByte(type);
-                    stream.SerializeShort(amount);
-                    weaponSlots.push_back({type, amount});
-                }
+                const PlayerState& previousPlayer = previousPlayerIt != previousState.playerData.end() ? previousPlayerIt->second : PLAYER_STATE_ZERO;
+                PlayerState player = PLAYER_STATE_ZERO;
+                streamPlayerDiff(stream, previousPlayer, player);
+                data.playerData[playerID] = player;
+            }
+            
+            // Start from the baseline and apply removals and changes on top
+            data.entityData = previousState.entityData;
+            uint32_t removedCount = 0;
+            stream.SerializeBits(removedCount, 16);
+            for (size_t i = 0; i < removedCount; i++)
+            {
+                uint32_t entityID = 0;
+                stream.SerializeBits(entityID, 16);
+                data.entityData.erase(entityID);
+            }
+            
+            uint32_t changedCount = 0;
+            stream.SerializeBits(changedCount, 16);
+            for (size_t i = 0; i < changedCount; i++)
+            {
+                uint32_t entityID = 0;
+                stream.SerializeBits(entityID, 16);
                 
-                if (!stream.IsMeasuring())
-                {
-                    data.playerData[playerID] = {
-                        entityID,
-                        kills,
-                        animationState,
-                        aimPointX,
-                        aimPointY,
-                        health,
-                        flipX,
-                        weaponFired,
-                        activeWeaponSlot,
-                        weaponSlots
-                    };
-                }
+                auto previousEntityIt = data.entityData.find(entityID);
+                const EntitySnapshot previousEntity = previousEntityIt != data.entityData.end() ? previousEntityIt->second : ENTITY_SNAPSHOT_ZERO;
+                EntitySnapshot entity = ENTITY_SNAPSHOT_ZERO;
+                streamEntityDiff(stream, previousEntity, entity);
+                data.entityData[entityID] = entity;
+            }
+            data.entityCount = (uint32_t)data.entityData.size();
+            
+            uint32_t inventoryCount = 0;
+            serializeSnapshotCount(stream, encoding, inventoryCount, SNAPSHOT_MAX_QUANTIZED_ITEMS);
+            for (size_t i = 0; i < inventoryCount; i++)
+            {
+                uint8_t entityType;
+                uint8_t amount;
+                stream.SerializeByte(entityType);
+                stream.SerializeByte(amount);
+                data.inventory.push_back({entityType, amount});
+            }
+            uint32_t hitCount = 0;
+            serializeSnapshotCount(stream, encoding, hitCount, SNAPSHOT_MAX_QUANTIZED_ITEMS);
+            for (size_t i = 0; i < hitCount; i++)
+            {
+                FrameHitData hitData;
+                uint32_t hitterEntityID = 0;
+                uint32_t hitEntityID = 0;
+                stream.SerializeBits(hitterEntityID, 16);
+                stream.SerializeBits(hitEntityID, 16);
+                hitData.hitterEntityID = hitterEntityID;
+                hitData.hitEntityID = hitEntityID;
+                stream.SerializeFloat(hitData.damage);
+                stream.SerializeFloat(hitData.hitPosX);
+                stream.SerializeFloat(hitData.hitPosY);
+                stream.SerializeBoolean(hitData.isHeadshot);
+                stream.SerializeBoolean(hitData.isLethal);
+                data.hitData.push_back(hitData);
             }
         }
         else
         {
             data.playerCount = (uint8_t)data.playerData.size();
-            streamByteDiff(stream, previousState.playerCount, data.playerCount);
-
-            for (auto pair : data.playerData)
+            stream.SerializeByte(data.playerCount);
+            for (auto& pair : data.playerData)
             {
                 uint8_t playerID = pair.first;
                 stream.SerializeByte(playerID);
-                stream.SerializeBits(pair.second.entityID, 16);
                 
                 auto previousPlayerIt = previousState.playerData.find(playerID);
-                if (previousPlayerIt != previousState.playerData.end())
-                {
-                    streamByteDiff(stream, previousPlayerIt->second.animationState, pair.second.animationState);
-                    streamFloatDiff(stream, previousPlayerIt->second.aimPointX, pair.second.aimPointX);
-                    streamFloatDiff(stream, previousPlayerIt->second.aimPointY, pair.second.aimPointY);
-                    streamFloatDiff(stream, previousPlayerIt->second.health, pair.second.health);
-                }
-                else
+                const PlayerState& previousPlayer = previousPlayerIt != previousState.playerData.end() ? previousPlayerIt->second : PLAYER_STATE_ZERO;
+                streamPlayerDiff(stream, previousPlayer, pair.second);
+            }
+            
+            uint32_t removedCount = 0;
+            for (const auto& pair : previousState.entityData)
+            {
+                if (!data.entityData.count(pair.first))
                 {
-                    streamByteDiff(stream, 0, pair.second.animationState);
-                    streamFloatDiff(stream, 0.f, pair.second.aimPointX);
-                    streamFloatDiff(stream, 0.f, pair.second.aimPointY);
-                    streamFloatDiff(stream, 0, pair.second.health);
+                    removedCount++;
                 }
-                
-                stream.SerializeBoolean(pair.second.flipX);
-                stream.SerializeBoolean(pair.second.weaponFired);
-                
-                if (previousPlayerIt != previousState.playerData.end())
+            }
+            stream.SerializeBits(removedCount, 16);
+            for (const auto& pair : previousState.entityData)
+            {
+                if (!data.entityData.count(pair.first))
                 {
-                    streamByteDiff(stream, previousPlayerIt->second.activeWeaponSlot, pair.second.activeWeaponSlot);
+                    uint32_t entityID = pair.first;
+                    stream.SerializeBits(entityID, 16);
                 }
-                else
+            }
+            
+            uint32_t changedCount = 0;
+            for (const auto& pair : data.entityData)
+            {
+                auto previousEntityIt = previousState.entityData.find(pair.first);
+                if (previousEntityIt == previousState.entityData.end() ||
+                    hasEntityChanged(previousEntityIt->second, pair.second))
                 {
-                    streamByteDiff(stream, 0, pair.second.activeWeaponSlot);
+                    changedCount++;
                 }
-                
-                for (size_t i = 0; i < 5; i++)
+            }
+            stream.SerializeBits(changedCount, 16);
+            for (auto& pair : data.entityData)
+            {
+                auto previousEntityIt = previousState.entityData.find(pair.first);
+                const bool isNewEntity = previousEntityIt == previousState.entityData.end();
+                if (!isNewEntity && !hasEntityChanged(previousEntityIt->second, pair.second))
                 {
-                    if (previousPlayerIt != previousState.playerData.end())
-                    {
-                        streamByteDiff(stream, previousPlayerIt->second.weaponSlots.at(i).type, pair.second.weaponSlots.at(i).type);
-                        streamShortDiff(stream, previousPlayerIt->second.weaponSlots.at(i).amount, pair.second.weaponSlots.at(i).amount);
-                    }
-                    else
-                    {
-                        streamByteDiff(stream, 0, pair.second.weaponSlots.at(i).type);
-                        streamShortDiff(stream, 0, pair.second.weaponSlots.at(i).amount);
-                    }
+                    continue;
                 }
+                uint32_t entityID = pair.first;
+                stream.SerializeBits(entityID, 16);
+                streamEntityDiff(stream, isNewEntity ? ENTITY_SNAPSHOT_ZERO : previousEntityIt->second, pair.second);
+            }
+            data.entityCount = (uint32_t)data.entityData.size();
+            
+            uint32_t inventoryCount = (uint32_t)data.inventory.size();
+            if (encoding.quantize)
+            {
+                inventoryCount = std::min(inventoryCount, SNAPSHOT_MAX_QUANTIZED_ITEMS);
+            }
+            serializeSnapshotCount(stream, encoding, inventoryCount, SNAPSHOT_MAX_QUANTIZED_ITEMS);
+            for (size_t i = 0; i < inventoryCount; i++)
+            {
+                const auto& inventoryItem = data.inventory.at(i);
+                uint8_t entityType = inventoryItem.type;
+                uint8_t amount = inventoryItem.amount;
+                stream.SerializeByte(entityType);
+                stream.SerializeByte(amount);
+            }
+            uint32_t hitCount = (uint32_t)data.hitData.size();
+            if (encoding.quantize)
+            {
+                hitCount = std::min(hitCount, SNAPSHOT_MAX_QUANTIZED_ITEMS);
+            }
+            serializeSnapshotCount(stream, encoding, hitCount, SNAPSHOT_MAX_QUANTIZED_ITEMS);
+            for (size_t i = 0; i < hitCount; i++)
+            {
+                const auto& hit = data.hitData.at(i);
+                uint32_t hitterEntityID = hit.hitterEntityID;
+                uint32_t hitEntityID = hit.hitEntityID;
+                float damage = hit.damage;
+                float hitPosX = hit.hitPosX;
+                float hitPosY = hit.hitPosY;
+                bool isHeadshot = hit.isHeadshot;
+                bool isLethal = hit.isLethal;
+                stream.SerializeBits(hitterEntityID, 16);
+                stream.SerializeBits(hitEntityID, 16);
+                stream.SerializeFloat(damage);
+                stream.SerializeFloat(hitPosX);
+                stream.SerializeFloat(hitPosY);
+                stream.SerializeBoolean(isHeadshot);
+                stream.SerializeBoolean(isLethal);
             }
         }
         return true;
@@ -1,7 +1,7 @@
 #ifndef COLLISION_UTILS_H
 #define COLLISION_UTILS_H
 
-#include "cocos2d.h"
+#include "math/CCGeometry.h"
 
 class CollisionUtils
 {
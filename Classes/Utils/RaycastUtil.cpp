@@ -1,113 +1,46 @@
 #include "RaycastUtil.h"
-#include "Entity.h"
 #include "CollisionUtils.h"
 #include "EntityDataModel.h"
+#include "LevelModel.h"
 
-RayElement RaycastUtil::rayCast(const cocos2d::Vec2& start,
-                                const cocos2d::Vec2& end,
-                                const uint32_t ignoreEntityID,
-                                const std::map<uint32_t, std::shared_ptr<Entity>>& entities,
-                                const std::vector<cocos2d::Rect>& staticRects)
+RayElement RaycastUtil::rayCastWalls(const cocos2d::Vec2& start,
+                                     const cocos2d::Vec2& end,
+                                     const LevelModel& levelModel,
+                                     float& closestDistance)
 {
     RayElement result;
     result.hitEntityID = 0;
     result.shotStartPoint = start;
     result.shotEndPoint = end;
-    float closestDistance = (end - start).length();
-    for (const auto& entityPair : entities)
-    {
-        if (entityPair.first == ignoreEntityID)
-        {
-            continue;
-        }
-        cocos2d::Vec2 entityPosition;
-        entityPosition = entityPair.second->getPosition();
-        size_t index = 0;
-        const auto& rects = EntityDataModel::getCollisionRects(entityPair.second->getEntityType());
-        for (const cocos2d::Rect& baseRect : rects)
-        {
-            const cocos2d::Rect rect = cocos2d::Rect(baseRect.origin + entityPosition, baseRect.size);
-            cocos2d::Vec2 collisionPoint;
-            
-            if (CollisionUtils::lineToRect(start, end, rect, collisionPoint))
-            {
-                const float distance = (collisionPoint - start).length();
-                if (distance < closestDistance)
-                {
-                    closestDistance = distance;
-                    result.shotEndPoint = collisionPoint;
-                    result.hitEntityID = entityPair.first;
-                    result.hitShapeIndex = index;
-                }
-            }
-            index++;
-        }
-    }
+    result.hitShapeIndex = 0;
+    closestDistance = (end - start).length();
     
-    for (const auto& rect : staticRects)
+    // Entities behind the first wall can't be hit, so walls are checked first
+    cocos2d::Vec2 wallPoint;
+    if (levelModel.rayCast(start, end, wallPoint))
     {
-        cocos2d::Vec2 collisionPoint;
-
-        if (CollisionUtils::lineToRect(start, end, rect, collisionPoint))
-        {
-            const float distance = (collisionPoint - start).length();
-            if (distance < closestDistance)
-            {
-                closestDistance = distance;
-                result.shotEndPoint = collisionPoint;
-                result.hitEntityID = 0;
-                result.hitShapeIndex = 0;
-            }
-        }
+        closestDistance = (wallPoint - start).length();
+        result.shotEndPoint = wallPoint;
     }
 
     return result;
 }
 
-RayElement RaycastUtil::rayCast2(const cocos2d::Vec2& start,
-                                 const cocos2d::Vec2& end,
-                                 const uint32_t ignoreEntityID,
-                                 const std::map<uint32_t, EntitySnapshot>& entities,
-                                 const std::vector<cocos2d::Rect>& staticRects)
+void RaycastUtil::rayCastEntity(const cocos2d::Vec2& start,
+                                const cocos2d::Vec2& end,
+                                const uint32_t entityID,
+                                const EntityType entityType,
+                                const cocos2d::Vec2& entityPosition,
+                                RayElement& result,
+                                float& closestDistance)
 {
-    RayElement result;
-    result.hitEntityID = 0;
-    result.shotStartPoint = start;
-    result.shotEndPoint = end;
-    float closestDistance = (end - start).length();
-    for (const auto& entityPair : entities)
-    {
-        if (entityPair.first == ignoreEntityID)
-        {
-            continue;
-        }
-        cocos2d::Vec2 entityPosition = cocos2d::Vec2(entityPair.second.positionX, entityPair.second.positionY);
-        size_t index = 0;
-        const auto& rects = EntityDataModel::getCollisionRects((EntityType)entityPair.second.type);
-        for (const cocos2d::Rect& baseRect : rects)
-        {
-            const cocos2d::Rect rect = cocos2d::Rect(baseRect.origin + entityPosition, baseRect.size);
-            cocos2d::Vec2 collisionPoint;
-            
-            if (CollisionUtils::lineToRect(start, end, rect, collisionPoint))
-            {
-                const float distance = (collisionPoint - start).length();
-                if (distance < closestDistance)
-                {
-                    closestDistance = distance;
-                    result.shotEndPoint = collisionPoint;
-                    result.hitEntityID = entityPair.first;
-                    result.hitShapeIndex = index;
-                }
-            }
-            index++;
-        }
-    }
-    
-    for (const auto& rect : staticRects)
+    size_t index = 0;
+    const auto& rects = EntityDataModel::getCollisionRects(entityType);
+    for (const cocos2d::Rect& baseRect : rects)
     {
+        const cocos2d::Rect rect = cocos2d::Rect(baseRect.origin + entityPosition, baseRect.size);
         cocos2d::Vec2 collisionPoint;
-
+        
         if (CollisionUtils::lineToRect(start, end, rect, collisionPoint))
         {
             const float distance = (collisionPoint - start).length();
@@ -115,12 +48,10 @@ RayElement RaycastUtil::rayCast2(const cocos2d::Vec2& start,
             {
                 closestDistance = distance;
                 result.shotEndPoint = collisionPoint;
-                result.hitEntityID = 0;
-                result.hitShapeIndex = 0;
+                result.hitEntityID = entityID;
+                result.hitShapeIndex = index;
             }
         }
+        index++;
     }
-
-    return result;
-
 }
@@ -1,10 +1,11 @@
 #ifndef RaycastUtil_h
 #define RaycastUtil_h
 
-#include "cocos2d.h"
+#include "math/Vec2.h"
+#include "Entity.h"
 #include "Network/NetworkMessages.h"
 
-class Entity;
+class LevelModel;
 
 struct RayElement {
     uint32_t hitEntityID;
@@ -13,20 +14,87 @@ struct RayElement {
     size_t hitShapeIndex;
 };
 
+// Entity views for RaycastUtil::rayCast, forEach calls visit(entityID, entityType, position)
+// for every entity straight from the underlying container without copying it
+class LiveEntityView
+{
+public:
+    explicit LiveEntityView(const std::map<uint32_t, std::shared_ptr<Entity>>& entities)
+    : m_entities(entities)
+    {}
+
+    template<typename Visitor>
+    void forEach(Visitor&& visit) const
+    {
+        for (const auto& entityPair : m_entities)
+        {
+            visit(entityPair.first, entityPair.second->getEntityType(), entityPair.second->getPosition());
+        }
+    }
+
+private:
+    const std::map<uint32_t, std::shared_ptr<Entity>>& m_entities;
+};
+
+class SnapshotEntityView
+{
+public:
+    explicit SnapshotEntityView(const std::map<uint32_t, EntitySnapshot>& entities)
+    : m_entities(entities)
+    {}
+
+    template<typename Visitor>
+    void forEach(Visitor&& visit) const
+    {
+        for (const auto& entityPair : m_entities)
+        {
+            visit(entityPair.first,
+                  (EntityType)entityPair.second.type,
+                  cocos2d::Vec2(entityPair.second.positionX, entityPair.second.positionY));
+        }
+    }
+
+private:
+    const std::map<uint32_t, EntitySnapshot>& m_entities;
+};
+
 class RaycastUtil
 {
 public:
+    template<typename EntityView>
     static RayElement rayCast(const cocos2d::Vec2& start,
                               const cocos2d::Vec2& end,
                               const uint32_t ignoreEntityID,
-                              const std::map<uint32_t, std::shared_ptr<Entity>>& entities,
-                              const std::vector<cocos2d::Rect>& staticRects);
-    
-    static RayElement rayCast2(const cocos2d::Vec2& start,
-                               const cocos2d::Vec2& end,
-                               const uint32_t ignoreEntityID,
-                               const std::map<uint32_t, EntitySnapshot>& entities,
-                               const std::vector<cocos2d::Rect>& staticRects);
+                              const EntityView& entities,
+                              const LevelModel& levelModel)
+    {
+        float closestDistance = 0.f;
+        RayElement result = rayCastWalls(start, end, levelModel, closestDistance);
+        entities.forEach([&](const uint32_t entityID,
+                             const EntityType entityType,
+                             const cocos2d::Vec2& entityPosition)
+        {
+            if (entityID != ignoreEntityID)
+            {
+                rayCastEntity(start, end, entityID, entityType, entityPosition, result, closestDistance);
+            }
+        });
+        return result;
+    }
+
+private:
+    static RayElement rayCastWalls(const cocos2d::Vec2& start,
+                                   const cocos2d::Vec2& end,
+                                   const LevelModel& levelModel,
+                                   float& closestDistance);
+
+    static void rayCastEntity(const cocos2d::Vec2& start,
+                              const cocos2d::Vec2& end,
+                              const uint32_t entityID,
+                              const EntityType entityType,
+                              const cocos2d::Vec2& entityPosition,
+                              RayElement& result,
+                              float& closestDistance);
 };
 
 #endif /* RaycastUtil_h */
@@ -0,0 +1,90 @@
+// Sends as much as flow control allows over FakeNet links of a few rates, the way the transports do,
+// and fails unless the bandwidth estimate settles near each link's rate. Unlimited links should take
+// the estimate all the way to the flow control's cap.
+#include "Network/FakeNet.h"
+#include "DataConstants.h"
+#include "FlowControl.h"
+
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+    struct Link
+    {
+        const char* name;
+        float bandwidth; // Bytes per second, 0 for unlimited
+        float minEstimate; // Range the averaged estimate has to end up in
+        float maxEstimate;
+    };
+
+    const float TICK_TIME = 1.f / 60.f;
+    const int TICKS = 60 * 90;
+    const int SETTLED_TICKS = 60 * 30; // The last ticks, averaged once the estimate had time to get there
+    const float FLOW_CONTROL_MAXIMUM = 256.f * 1024.f;
+
+    const Link LINKS[] = {
+        { "16kB/s", 16.f * 1024.f, 12.f * 1024.f, 20.f * 1024.f },
+        { "64kB/s", 64.f * 1024.f, 48.f * 1024.f, 80.f * 1024.f },
+        { "unlimited", 0.f, FLOW_CONTROL_MAXIMUM * 0.9f, FLOW_CONTROL_MAXIMUM },
+    };
+
+    bool runLink(const Link& link)
+    {
+        FakeNet fakeNet;
+        fakeNet.setBandwidth(link.bandwidth);
+        size_t deliveredBytes = 0;
+        fakeNet.setClientDataCallback([&deliveredBytes](const uint8_t playerID, const unsigned char* data, const size_t dataSize) {
+            deliveredBytes += dataSize;
+        });
+
+        // Always more to send than the link carries, like a server whose snapshots fill whatever they're given
+        Net::FlowControl flowControl;
+        std::vector<unsigned char> packet(Net::MAXIMUM_TRANSMISSION_UNIT_BYTES, 0);
+        double estimateSum = 0.0;
+        size_t settledStartBytes = 0;
+        for (int tick = 0; tick < TICKS; tick++)
+        {
+            fakeNet.update(TICK_TIME);
+            flowControl.Update(TICK_TIME, fakeNet.getClientLinkReliability());
+            // A tick's worth of the estimate goes out whole once it may send at all, the next ticks pay off what it overdrew
+            if (flowControl.CanSend())
+            {
+                float cycleBytes = flowControl.GetBandwidth() * TICK_TIME;
+                while (cycleBytes > 0.f)
+                {
+                    fakeNet.takeClientData(0, packet.data(), packet.size());
+                    flowControl.PacketSent((int32_t)packet.size());
+                    cycleBytes -= packet.size();
+                }
+            }
+            if (tick == TICKS - SETTLED_TICKS)
+            {
+                settledStartBytes = deliveredBytes;
+            }
+            if (tick >= TICKS - SETTLED_TICKS)
+            {
+                estimateSum += flowControl.GetBandwidth();
+            }
+        }
+
+        const float settledTime = SETTLED_TICKS * TICK_TIME;
+        const float estimate = (float)(estimateSum / SETTLED_TICKS);
+        const float delivered = (deliveredBytes - settledStartBytes) / settledTime;
+        const bool settled = estimate >= link.minEstimate && estimate <= link.maxEstimate;
+        printf("FakeNetBandwidthTest:: %-9s link, estimate %.1fkB/s, delivered %.1fkB/s, expected %.1f-%.1fkB/s %s\n",
+               link.name, estimate / 1024.f, delivered / 1024.f,
+               link.minEstimate / 1024.f, link.maxEstimate / 1024.f, settled ? "" : "FAILED");
+        return settled;
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    bool passed = true;
+    for (const Link& link : LINKS)
+    {
+        passed &= runLink(link);
+    }
+    return passed ? 0 : 1;
+}
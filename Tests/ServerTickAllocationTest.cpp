@@ -0,0 +1,123 @@
+// Runs a bot match on a headless server and fails if a tick allocates once the match has settled.
+// A spawned or removed entity needs memory of its own, and every snapshot and frame still holding
+// the old entities is assigned over with the new ones, ticks until the history has caught up are
+// left out. Snapshots cover the whole level, entities moving in and out of a client's radius would
+// cost nodes as well.
+#include "Core/Injector.h"
+#include "Core/JobSystem.h"
+#include "Game/Client/InitServerCommand.h"
+#include "Game/Server/EntitiesModel.h"
+#include "Game/Server/ServerController.h"
+#include "Game/Shared/SharedConstants.h"
+#include "Network/FakeNet.h"
+#include "Network/FakeNetworkController.h"
+#include "platform/CCFileUtils.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    std::atomic<bool> s_counting(false);
+    std::atomic<size_t> s_allocations(0);
+
+    const float TICK_TIME = 1.f / 60.f;
+    const int WARMUP_TICKS = 60 * 30;
+    const int MEASURED_TICKS = 60 * 60;
+    // Workers whatever the machine, jobs handed to other threads take a different path
+    const size_t JOB_WORKERS = 3;
+    const uint32_t MATCH_SEED = 1337;
+}
+
+// Counts every allocation on any thread, the job system's workers run part of the tick
+void* operator new(size_t size)
+{
+    if (s_counting)
+    {
+        s_allocations++;
+    }
+    void* memory = malloc(size ? size : 1);
+    if (!memory)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+    free(memory);
+}
+
+int main(int argc, const char* argv[])
+{
+    cocos2d::FileUtils::getInstance()->addSearchPath(MAYHEM_RESOURCES_DIR);
+
+    Injector injector;
+    injector.mapInstance<JobSystem>(std::make_shared<JobSystem>(JOB_WORKERS));
+    injector.mapSingleton<FakeNet>();
+    injector.mapSingleton<FakeNetworkController, FakeNet>();
+    injector.mapInterfaceToType<INetworkController, FakeNetworkController>();
+    injector.getInstance<FakeNetworkController>()->initialize(NetworkMode::HOST);
+
+    const GameMode::Config config = { GameModeType::GAME_MODE_DEATHMATCH, 60, 16, 1, "BitTileMap.tmx" };
+    InitServerCommand initServer(config, MATCH_SEED, true, injector);
+    if (!initServer.run())
+    {
+        printf("ServerTickAllocationTest:: failed to set up the server\n");
+        return 1;
+    }
+    auto serverController = injector.getInstance<ServerController>();
+    auto entitiesModel = injector.getInstance<EntitiesModel>();
+    serverController->setRelevancyRadius(0.f);
+    serverController->initDebugStuff();
+
+    for (int tick = 0; tick < WARMUP_TICKS; tick++)
+    {
+        serverController->update(TICK_TIME);
+    }
+
+    size_t unchangedTicks = 0;
+    int measuredTicks = 0;
+    int allocatingTicks = 0;
+    size_t allocations = 0;
+    for (int tick = 0; tick < MEASURED_TICKS; tick++)
+    {
+        const size_t entityCount = entitiesModel->getEntities().size();
+        const uint32_t nextEntityID = entitiesModel->getNextEntityID();
+
+        s_allocations = 0;
+        s_counting = true;
+        serverController->update(TICK_TIME);
+        s_counting = false;
+
+        if (entitiesModel->getEntities().size() != entityCount ||
+            entitiesModel->getNextEntityID() != nextEntityID)
+        {
+            unchangedTicks = 0;
+            continue;
+        }
+        unchangedTicks++;
+        if (unchangedTicks <= SNAPSHOT_BASELINE_BUFFER_SIZE)
+        {
+            continue;
+        }
+        measuredTicks++;
+        if (s_allocations > 0)
+        {
+            allocatingTicks++;
+            allocations += s_allocations;
+        }
+    }
+
+    printf("ServerTickAllocationTest:: %i steady ticks, %i allocated, %zu allocations\n",
+           measuredTicks, allocatingTicks, allocations);
+    if (measuredTicks == 0)
+    {
+        printf("ServerTickAllocationTest:: entities changed all the time, nothing was measured\n");
+        return 1;
+    }
+    return allocatingTicks == 0 ? 0 : 1;
+}
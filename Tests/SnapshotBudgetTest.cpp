@@ -0,0 +1,150 @@
+// Connects a client over FakeNet, gives its player more projectiles than a snapshot's entity budget
+// holds among the level's loot, and fails unless every snapshot it receives still carries its player
+// and all of those projectiles. The client never acks, so each snapshot is a full one.
+#include "Core/Injector.h"
+#include "Core/JobSystem.h"
+#include "Game/Client/InitServerCommand.h"
+#include "Game/Server/EntitiesController.h"
+#include "Game/Server/EntitiesModel.h"
+#include "Game/Server/GameController.h"
+#include "Game/Server/Player.h"
+#include "Game/Server/Projectile.h"
+#include "Game/Server/ServerController.h"
+#include "Game/Shared/LevelModel.h"
+#include "Network/FakeNet.h"
+#include "Network/FakeNetworkController.h"
+#include "Network/NetworkMessageFactory.h"
+#include "ReadStream.h"
+#include "WriteStream.h"
+#include "platform/CCFileUtils.h"
+
+#include <cstdio>
+#include <set>
+#include <vector>
+
+namespace
+{
+    const float TICK_TIME = 1.f / 60.f;
+    const int TICKS = 60 * 2;
+    const uint32_t MATCH_SEED = 1337;
+    const uint8_t PLAYER_ID = 0;
+    // Far more than fit the budget of a fresh connection, around a hundred entities at most
+    const size_t PROJECTILE_COUNT = 300;
+    const size_t BUFFER_SIZE_BYTES = 16 * 1024;
+
+    // Spread over open tiles so none of them start out inside a wall
+    void spawnProjectiles(const std::shared_ptr<GameController>& gameController,
+                          std::set<uint32_t>& projectileIDs)
+    {
+        const auto& entitiesModel = gameController->getEntitiesModel();
+        const cocos2d::Size mapSize = gameController->getLevelModel()->getMapSizeInTiles();
+        const cocos2d::Size tileSize = gameController->getLevelModel()->getTileSize();
+        for (int row = 1; row < (int)mapSize.height - 1 && projectileIDs.size() < PROJECTILE_COUNT; row += 2)
+        {
+            for (int column = 1; column < (int)mapSize.width - 1 && projectileIDs.size() < PROJECTILE_COUNT; column += 2)
+            {
+                if (gameController->isTileSolid(cocos2d::Vec2(column, row)))
+                {
+                    continue;
+                }
+                const cocos2d::Vec2 position((column + 0.5f) * tileSize.width, (mapSize.height - row - 0.5f) * tileSize.height);
+                const uint16_t entityID = entitiesModel->getNextEntityID();
+                entitiesModel->incrementNextEntityID();
+                auto projectile = gameController->getEntitiesController()->createProjectile(entityID,
+                                                                                            EntityType::Projectile_Bullet,
+                                                                                            position,
+                                                                                            cocos2d::Vec2::ZERO,
+                                                                                            0.f);
+                projectile->setOwnerID(PLAYER_ID);
+                projectileIDs.insert(entityID);
+            }
+        }
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    cocos2d::FileUtils::getInstance()->addSearchPath(MAYHEM_RESOURCES_DIR);
+
+    Injector injector;
+    injector.mapInstance<JobSystem>(std::make_shared<JobSystem>(0));
+    injector.mapSingleton<FakeNet>();
+    injector.mapSingleton<FakeNetworkController, FakeNet>();
+    injector.mapInterfaceToType<INetworkController, FakeNetworkController>();
+    injector.getInstance<FakeNetworkController>()->initialize(NetworkMode::HOST);
+
+    const GameMode::Config config = { GameModeType::GAME_MODE_DEATHMATCH, 60, 16, 1, "BitTileMap.tmx" };
+    InitServerCommand initServer(config, MATCH_SEED, true, injector);
+    if (!initServer.run())
+    {
+        printf("SnapshotBudgetTest:: failed to set up the server\n");
+        return 1;
+    }
+    auto serverController = injector.getInstance<ServerController>();
+    auto gameController = serverController->getGameController();
+    serverController->setRelevancyRadius(0.f);
+
+    std::set<uint32_t> projectileIDs;
+    spawnProjectiles(gameController, projectileIDs);
+    if (projectileIDs.size() < PROJECTILE_COUNT)
+    {
+        printf("SnapshotBudgetTest:: only found room for %zu projectiles\n", projectileIDs.size());
+        return 1;
+    }
+
+    // Receives what the server sends the client, only full snapshots are looked at
+    auto fakeNet = injector.getInstance<FakeNet>();
+    NetworkMessageFactory messageFactory;
+    std::vector<unsigned char> readBuffer(BUFFER_SIZE_BYTES, 0);
+    int snapshots = 0;
+    int incompleteSnapshots = 0;
+    size_t fewestEntities = 0;
+    fakeNet->setClientDataCallback([&](const uint8_t playerID, const unsigned char* data, const size_t dataSize) {
+        std::fill(readBuffer.begin(), readBuffer.end(), 0);
+        std::copy(data, data + dataSize, readBuffer.begin());
+        Net::ReadStream stream(readBuffer.data(), (int32_t)readBuffer.size());
+        auto snapshotMessage = std::dynamic_pointer_cast<ServerSnapshotMessage>(messageFactory.create(stream));
+        auto player = gameController->getEntitiesModel()->getPlayer(PLAYER_ID);
+        if (!snapshotMessage || !player)
+        {
+            return;
+        }
+        const auto& entityData = snapshotMessage->data.entityData;
+        size_t missing = entityData.count(player->getEntityID()) ? 0 : 1;
+        for (const uint32_t projectileID : projectileIDs)
+        {
+            missing += entityData.count(projectileID) ? 0 : 1;
+        }
+        if (missing > 0)
+        {
+            incompleteSnapshots++;
+        }
+        fewestEntities = snapshots == 0 ? entityData.size() : std::min(fewestEntities, entityData.size());
+        snapshots++;
+    });
+
+    // What a client sends once it has the level, the server spawns its player and starts sending snapshots
+    ClientStateUpdateMessage levelLoaded;
+    levelLoaded.state = ClientState::LEVEL_LOADED;
+    std::vector<unsigned char> writeBuffer(BUFFER_SIZE_BYTES, 0);
+    Net::WriteStream writeStream(writeBuffer.data(), (int32_t)writeBuffer.size());
+    uint8_t messageType = levelLoaded.getType();
+    writeStream.SerializeByte(messageType);
+    levelLoaded.serialize(writeStream);
+    writeStream.Flush();
+    fakeNet->takeServerData(writeBuffer.data(), writeStream.GetDataBytes());
+
+    for (int tick = 0; tick < TICKS; tick++)
+    {
+        serverController->update(TICK_TIME);
+    }
+
+    printf("SnapshotBudgetTest:: %i snapshots, %i missing required entities, at least %zu entities for %zu projectiles\n",
+           snapshots, incompleteSnapshots, fewestEntities, projectileIDs.size());
+    if (snapshots == 0)
+    {
+        printf("SnapshotBudgetTest:: the client never got a snapshot\n");
+        return 1;
+    }
+    return incompleteSnapshots == 0 ? 0 : 1;
+}